@@ -0,0 +1,94 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/string/hexencode.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+namespace {
+
+using byte = ::liberate::types::byte;
+
+// Process roughly this many Bytes per measurement.
+constexpr size_t TOTAL_BYTES = 256 * 1024 * 1024;
+
+
+template <typename funcT>
+double
+measure(size_t size, funcT && func)
+{
+  size_t const rounds = TOTAL_BYTES / size;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0 ; i < rounds ; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> secs = end - start;
+  return (static_cast<double>(rounds * size) / (1024 * 1024)) / secs.count();
+}
+
+} // anonymous namespace
+
+
+int main(int, char **)
+{
+  std::cout << std::setw(10) << "Size"
+    << std::setw(16) << "encode MiB/s"
+    << std::setw(16) << "decode MiB/s" << std::endl;
+
+  size_t checksum = 0;
+  for (size_t size : {8, 16, 32, 64, 256, 4096, 65536}) {
+    std::vector<byte> input(size);
+    for (size_t i = 0 ; i < size ; ++i) {
+      input[i] = static_cast<byte>(i * 7);
+    }
+    std::vector<byte> encoded(size * 2);
+    std::vector<byte> decoded(size);
+
+    // Throughput is measured in input Bytes for both directions.
+    auto encode = measure(size, [&]()
+    {
+      checksum += liberate::string::hexencode(encoded.data(), encoded.size(),
+          input.data(), input.size());
+    });
+    auto decode = measure(size, [&]()
+    {
+      checksum += liberate::string::hexdecode(decoded.data(), decoded.size(),
+          encoded.data(), encoded.size());
+    });
+
+    if (decoded != input) {
+      std::cerr << "Round trip failed for size " << size << std::endl;
+      return 1;
+    }
+
+    std::cout << std::setw(10) << size
+      << std::setw(16) << std::fixed << std::setprecision(1) << encode
+      << std::setw(16) << decode << std::endl;
+  }
+
+  // Keep the results alive.
+  return checksum == 0 ? 1 : 0;
+}
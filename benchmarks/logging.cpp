@@ -0,0 +1,108 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging.h>
+#include <liberate/string/hexencode.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr size_t ROUNDS = 4 * 1024 * 1024;
+
+
+/**
+ * Returns nanoseconds per call of func.
+ */
+template <typename funcT>
+double
+measure(size_t rounds, funcT && func)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0 ; i < rounds ; ++i) {
+    func(i);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::nano> nsecs = end - start;
+  return nsecs.count() / static_cast<double>(rounds);
+}
+
+
+void
+report(char const * name, double disabled, double formatting)
+{
+  std::cout << std::setw(10) << name
+    << std::setw(16) << std::fixed << std::setprecision(2) << disabled
+    << std::setw(16) << formatting << std::endl;
+}
+
+} // anonymous namespace
+
+
+int main(int, char **)
+{
+  namespace logging = liberate::logging;
+
+  // Disable everything below fatal at runtime; none of the statements below
+  // should get as far as formatting their message.
+  logging::set_level(logging::level::fatal);
+
+  std::string packet(256, '\x42');
+  liberate::string::canonical_hexdump hd;
+  size_t checksum = 0;
+
+  std::cout << std::setw(10) << "Message"
+    << std::setw(16) << "disabled ns"
+    << std::setw(16) << "format ns" << std::endl;
+
+  // A short message with a number
+  auto disabled = measure(ROUNDS, []([[maybe_unused]] size_t i)
+  {
+    LIBLOG_DEBUG("Received " << i << " bytes.");
+  });
+  auto formatting = measure(ROUNDS, [&checksum](size_t i)
+  {
+    std::ostringstream sstream;
+    sstream << "Received " << i << " bytes.";
+    checksum += sstream.tellp();
+  });
+  report("short", disabled, formatting);
+
+  // A hexdump, which is expensive to produce
+  disabled = measure(ROUNDS, [&packet, &hd](size_t)
+  {
+    LIBLOG_DEBUG("Received packet:" << std::endl << hd(packet));
+  });
+  formatting = measure(ROUNDS / 64, [&packet, &hd, &checksum](size_t)
+  {
+    std::ostringstream sstream;
+    sstream << "Received packet:" << std::endl << hd(packet);
+    checksum += sstream.tellp();
+  });
+  report("hexdump", disabled, formatting);
+
+  // Keep the results alive.
+  return checksum == 0 ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/string/utf8.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Process roughly this many Bytes per measurement.
+constexpr size_t TOTAL_BYTES = 256 * 1024 * 1024;
+
+
+template <typename funcT>
+double
+measure(size_t size, funcT && func)
+{
+  size_t const rounds = TOTAL_BYTES / size;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0 ; i < rounds ; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> secs = end - start;
+  return (static_cast<double>(rounds * size) / (1024 * 1024)) / secs.count();
+}
+
+
+std::string
+make_input(std::string const & pattern, size_t size)
+{
+  std::string ret;
+  while (ret.size() + pattern.size() <= size) {
+    ret += pattern;
+  }
+  ret.resize(size, ' ');
+  return ret;
+}
+
+} // anonymous namespace
+
+
+int main(int, char **)
+{
+  std::pair<char const *, std::string> const inputs[] = {
+    { "ascii", "The quick brown fox jumps over the lazy dog. " },
+    { "latin", "Grüße aus Köln, schöne Äpfel. " },
+    { "mixed", "Hello 世界, привет мир 😀 " },
+  };
+
+  std::cout << std::setw(8) << "Input"
+    << std::setw(10) << "Size"
+    << std::setw(18) << "validate MiB/s"
+    << std::setw(18) << "to_utf16 MiB/s" << std::endl;
+
+  size_t checksum = 0;
+  for (auto & [name, pattern] : inputs) {
+    for (size_t size : {64, 4096, 65536}) {
+      auto input = make_input(pattern, size);
+      std::vector<char16_t> output(input.size());
+
+      auto validate = measure(size, [&]()
+      {
+        checksum += liberate::string::utf8_validate(input.c_str(),
+            input.size());
+      });
+      auto transcode = measure(size, [&]()
+      {
+        checksum += liberate::string::utf8_to_utf16(output.data(),
+            output.size(), input.c_str(), input.size());
+      });
+
+      std::cout << std::setw(8) << name
+        << std::setw(10) << size
+        << std::setw(18) << std::fixed << std::setprecision(1) << validate
+        << std::setw(18) << transcode << std::endl;
+    }
+  }
+
+  // Keep the results alive.
+  return checksum == 0 ? 1 : 0;
+}
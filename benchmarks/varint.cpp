@@ -0,0 +1,172 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/serialization/varint.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace {
+
+using varint = ::liberate::types::varint;
+using varint_base = ::liberate::types::varint_base;
+
+// Process roughly this many values per measurement.
+constexpr size_t TOTAL_VALUES = 32 * 1024 * 1024;
+constexpr size_t AMOUNT = 4096;
+
+
+template <typename funcT>
+double
+measure(funcT && func)
+{
+  size_t const rounds = TOTAL_VALUES / AMOUNT;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0 ; i < rounds ; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> secs = end - start;
+  return (static_cast<double>(rounds * AMOUNT) / 1000000) / secs.count();
+}
+
+
+/**
+ * Simple xorshift generator, so that runs are reproducible.
+ */
+inline uint64_t
+next_random(uint64_t & state)
+{
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+
+template <typename formatT>
+bool
+run_format(std::string const & name, std::vector<varint> const & values,
+    size_t & checksum)
+{
+  using namespace liberate::serialization;
+
+  std::vector<uint8_t> buf(values.size() * VARINT_MAX_BUFSIZE);
+  std::vector<varint> decoded(values.size());
+  size_t used = 0;
+
+  auto encode = measure([&]()
+  {
+    size_t offset = 0;
+    for (auto & value : values) {
+      offset += serialize_varint<formatT>(buf.data() + offset,
+          buf.size() - offset, value);
+    }
+    used = offset;
+    checksum += offset;
+  });
+
+  auto decode = measure([&]()
+  {
+    size_t offset = 0;
+    for (auto & value : decoded) {
+      offset += deserialize_varint<formatT>(value, buf.data() + offset,
+          used - offset);
+    }
+    checksum += offset;
+  });
+
+  std::cout << std::setw(14) << name
+    << std::setw(12) << std::fixed << std::setprecision(2)
+    << (static_cast<double>(used) / values.size())
+    << std::setw(16) << std::setprecision(1) << encode
+    << std::setw(16) << decode << std::endl;
+
+  return decoded == values;
+}
+
+} // anonymous namespace
+
+
+int main(int, char **)
+{
+  using namespace liberate::serialization;
+
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+
+  // Distributions: bits of magnitude, and whether values may be negative.
+  struct distribution
+  {
+    char const *  name;
+    int           bits;
+    bool          negative;
+  };
+  distribution const distributions[] = {
+    { "7 bit", 7, false },
+    { "14 bit", 14, false },
+    { "28 bit", 28, false },
+    { "mixed", 0, false },
+    { "signed 14 bit", 14, true },
+  };
+
+  size_t checksum = 0;
+  for (auto & dist : distributions) {
+    std::vector<varint> values(AMOUNT);
+    for (auto & value : values) {
+      auto rand = next_random(state);
+      // Mixed picks a random magnitude up to 56 bits per value.
+      auto bits = dist.bits ? dist.bits : static_cast<int>(rand % 8 + 1) * 7;
+      auto val = static_cast<varint_base>((rand >> 8)
+          & ((uint64_t{1} << (bits - 1)) - 1));
+      if (dist.negative && (rand & 1)) {
+        val = -val;
+      }
+      value = varint{val};
+    }
+
+    std::cout << dist.name << std::endl;
+    std::cout << std::setw(14) << "Format"
+      << std::setw(12) << "Bytes/val"
+      << std::setw(16) << "encode M/s"
+      << std::setw(16) << "decode M/s" << std::endl;
+
+    bool ok = true;
+    if (!dist.negative) {
+      // Negative values cannot be serialized in this format.
+      ok = run_format<varint_continuation>("continuation", values, checksum)
+        && ok;
+    }
+    ok = run_format<varint_zigzag>("zigzag", values, checksum) && ok;
+    ok = run_format<varint_prefix>("prefix", values, checksum) && ok;
+    if (!ok) {
+      std::cerr << "Round trip failed for " << dist.name << std::endl;
+      return 1;
+    }
+    std::cout << std::endl;
+  }
+
+  // Keep the results alive.
+  return checksum == 0 ? 1 : 0;
+}
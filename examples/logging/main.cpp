@@ -14,6 +14,9 @@
 #define LIBLOG_LEVEL_FATAL ERROR
 #include <iostream>
 
+#elif LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_BINARY
+#include <iostream>
+
 #endif
 
 
@@ -31,6 +34,9 @@ int main(int, char **)
   loguru::g_stderr_verbosity = loguru::Verbosity_MAX;
   std::cerr << "WARNING: FATAL logs are redirected to ERROR for this example." << std::endl;
 
+#elif LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_BINARY
+  std::cerr << "Logging to: " << liberate::logging::binary_logger::global().path() << std::endl;
+
 #endif
 
   LIBLOG(LIBLOG_LEVEL_TRACE, "This is a verbose trace message.");
@@ -63,4 +69,10 @@ int main(int, char **)
   LIBLOG_ERRNO("Errno log message");
 
   LIBLOG_EXC(std::runtime_error{"runtime error message"}, "Exception logging");
+
+  for (int i = 0 ; i < 10 ; ++i) {
+    LIBLOG_EVERY_N(LIBLOG_LEVEL_INFO, 5, "Every 5th message: " << i);
+    LIBLOG_FIRST_N(LIBLOG_LEVEL_INFO, 2, "First 2 messages: " << i);
+    LIBLOG_RATE_LIMITED(LIBLOG_LEVEL_WARN, 1, 3, "Rate limited message: " << i);
+  }
 }
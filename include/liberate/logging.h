@@ -27,6 +27,8 @@
 #include <liberate.h>
 
 #include <liberate/sys/error.h>
+#include <liberate/logging/level.h>
+#include <liberate/logging/rate_limit.h>
 
 #include <sstream>
 
@@ -41,6 +43,8 @@
 #define LIBERATE_LOG_BACKEND_PLOG   2
 #define LIBERATE_LOG_BACKEND_SPDLOG 3
 #define LIBERATE_LOG_BACKEND_LOGURU 4
+#define LIBERATE_LOG_BACKEND_ASYNC  5
+#define LIBERATE_LOG_BACKEND_BINARY 6
 
 #if !defined(LIBERATE_LOG_BACKEND)
 #define LIBERATE_LOG_BACKEND LIBERATE_LOG_BACKEND_STDERR
@@ -48,6 +52,10 @@
 
 /**
  * Backends
+ *
+ * Each backend defines the LIBLOG_LEVEL_* values, LIBLOG_LEVEL_OF() to map
+ * them to liberate::logging::level, and LIBLOG_EMIT() to pass a message to
+ * the backend.
  */
 #if LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_PLOG
 
@@ -67,8 +75,20 @@
 #define LIBLOG_LEVEL_ERROR plog::error
 #define LIBLOG_LEVEL_FATAL plog::fatal
 
+namespace liberate::logging::detail {
+
+constexpr level
+from_backend(plog::Severity severity)
+{
+  return static_cast<level>(plog::verbose - severity);
+}
+
+} // namespace liberate::logging::detail
+
+#define LIBLOG_LEVEL_OF(level) ::liberate::logging::detail::from_backend(level)
+
 // Basic macro
-#define LIBLOG(level, message) PLOG_MACRO(level) << message;
+#define LIBLOG_EMIT(level, message) PLOG_MACRO(level) << message;
 
 #elif LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_SPDLOG
 
@@ -82,12 +102,15 @@
 #define LIBLOG_LEVEL_ERROR spdlog::level::err
 #define LIBLOG_LEVEL_FATAL spdlog::level::critical
 
-// Basic macro
-#define LIBLOG(level, message) { \
-  std::stringstream sstream; \
-  sstream << message; \
-  SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, sstream.str()); \
-}
+#define LIBLOG_LEVEL_OF(lvl) static_cast<::liberate::logging::level>(lvl)
+
+// Basic macro; spdlog filters only after formatting, so check first.
+#define LIBLOG_EMIT(level, message) \
+  if (spdlog::default_logger_raw()->should_log(level)) { \
+    std::stringstream sstream; \
+    sstream << message; \
+    SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, sstream.str()); \
+  }
 
 #elif LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_LOGURU
 
@@ -102,8 +125,61 @@
 #define LIBLOG_LEVEL_ERROR ERROR
 #define LIBLOG_LEVEL_FATAL FATAL
 
+namespace liberate::logging::detail {
+
+constexpr level
+from_backend(loguru::NamedVerbosity verbosity)
+{
+  if (verbosity > loguru::Verbosity_INFO) {
+    return (verbosity >= loguru::Verbosity_MAX) ? level::trace : level::debug;
+  }
+  switch (verbosity) {
+    case loguru::Verbosity_INFO:
+      return level::info;
+    case loguru::Verbosity_WARNING:
+      return level::warn;
+    case loguru::Verbosity_ERROR:
+      return level::error;
+    default:
+      return level::fatal;
+  }
+}
+
+} // namespace liberate::logging::detail
+
+#define LIBLOG_LEVEL_OF(level) \
+  ::liberate::logging::detail::from_backend(loguru::Verbosity_ ## level)
+
+// Basic macro
+#define LIBLOG_EMIT(level, message) LOG_S(level) << message;
+
+#elif LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_ASYNC \
+  || LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_BINARY
+
+#if LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_ASYNC
+#include <liberate/logging/async.h>
+#define LIBLOG_LOGGER ::liberate::logging::async_logger::global()
+#else
+#include <liberate/logging/binary.h>
+#define LIBLOG_LOGGER ::liberate::logging::binary_logger::global()
+#endif
+
+// Levels
+#define LIBLOG_LEVEL_TRACE ::liberate::logging::level::trace
+#define LIBLOG_LEVEL_DEBUG ::liberate::logging::level::debug
+#define LIBLOG_LEVEL_INFO ::liberate::logging::level::info
+#define LIBLOG_LEVEL_WARN ::liberate::logging::level::warn
+#define LIBLOG_LEVEL_ERROR ::liberate::logging::level::error
+#define LIBLOG_LEVEL_FATAL ::liberate::logging::level::fatal
+
+#define LIBLOG_LEVEL_OF(level) (level)
+
 // Basic macro
-#define LIBLOG(level, message) LOG_S(level) << message;
+#define LIBLOG_EMIT(level, message) { \
+  ::liberate::logging::record_stream liblog_record{ \
+    LIBLOG_LOGGER, level, __FILE__, __LINE__}; \
+  liblog_record << message; \
+}
 
 #else // LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_STDERR
 
@@ -111,14 +187,14 @@
 
 #include <iostream>
 
-#define LIBLOG(level, msg) { \
+#define LIBLOG_EMIT(level, msg) { \
   std::stringstream sstream; \
   sstream << "[" << __FILE__ << ":" \
   << __LINE__ << "] " << level << ": " << msg << std::endl; \
   std::cerr << sstream.str(); \
 }
 #else
-#define LIBLOG(level, msg)
+#define LIBLOG_EMIT(level, msg)
 #endif
 
 // Levels
@@ -129,8 +205,54 @@
 #define LIBLOG_LEVEL_ERROR "ERROR"
 #define LIBLOG_LEVEL_FATAL "FATAL"
 
+namespace liberate::logging::detail {
+
+constexpr level
+from_backend(char const * name)
+{
+  switch (name[0]) {
+    case 'T':
+      return level::trace;
+    case 'D':
+      return level::debug;
+    case 'I':
+      return level::info;
+    case 'W':
+      return level::warn;
+    case 'E':
+      return level::error;
+    default:
+      return level::fatal;
+  }
+}
+
+} // namespace liberate::logging::detail
+
+#define LIBLOG_LEVEL_OF(level) ::liberate::logging::detail::from_backend(level)
+
 #endif // LIBERATE_LOG_BACKEND == LIBERATE_LOG_BACKEND_STDERR
 
+/**
+ * Basic macro (applies to all backends). The level must be a constant
+ * expression. Statements below LIBERATE_LOG_MIN_LEVEL are discarded at compile
+ * time, but still type-checked, and statements below the runtime level (see
+ * liberate/logging/level.h) return before the message is formatted.
+ */
+#define LIBLOG(level, message) LIBLOG_IF(level, true, message)
+
+/**
+ * As LIBLOG, but the message is only logged if the condition is true. The
+ * condition is evaluated after the level checks.
+ */
+#define LIBLOG_IF(level, condition, message) { \
+  if constexpr (::liberate::logging::is_compiled_in(LIBLOG_LEVEL_OF(level))) { \
+    if (::liberate::logging::is_enabled(LIBLOG_LEVEL_OF(level)) \
+        && (condition)) { \
+      LIBLOG_EMIT(level, message) \
+    } \
+  } \
+}
+
 // Long macros (apply to all backends)
 #define LIBLOG_TRACE(msg) LIBLOG(LIBLOG_LEVEL_TRACE, msg)
 #define LIBLOG_DEBUG(msg) LIBLOG(LIBLOG_LEVEL_DEBUG, msg)
@@ -150,8 +272,46 @@
 /**
  * Error logging macros
  */
-#define LIBLOG_ERR(code, message) LIBLOG_ERROR(message << " // " << liberate::sys::error_message(code))
+#define LIBLOG_ERR(code, message) LIBLOG_ERROR(message << " // " << liberate::sys::error_info{code})
 #define LIBLOG_ERRNO(message) LIBLOG_ERR(liberate::sys::error_code(), message);
 #define LIBLOG_EXC(exc, message) LIBLOG_ERROR(message << " // " << (exc.what()))
 
+/**
+ * Sampled and rate limited macros (apply to all backends). Each call site
+ * keeps its own state in lock-free atomics, see liberate/logging/rate_limit.h.
+ *
+ * - LIBLOG_EVERY_N logs the first, and then every n-th, message.
+ * - LIBLOG_FIRST_N logs the first n messages only.
+ * - LIBLOG_RATE_LIMITED logs up to per_second messages per second on
+ *   average, with bursts of up to burst messages. The next message that is
+ *   logged ends in " [suppressed N messages]" if any were dropped.
+ *
+ * Messages below the current log level are neither counted nor suppressed.
+ */
+#define LIBLOG_EVERY_N(level, n, message) { \
+  static ::liberate::logging::every_n liblog_sampler; \
+  LIBLOG_IF(level, liblog_sampler.should_log(n), message) \
+}
+
+#define LIBLOG_FIRST_N(level, n, message) { \
+  static ::liberate::logging::first_n liblog_sampler; \
+  LIBLOG_IF(level, liblog_sampler.should_log(n), message) \
+}
+
+#define LIBLOG_RATE_LIMITED(level, per_second, burst, message) { \
+  static ::liberate::logging::token_bucket liblog_bucket; \
+  static ::liberate::logging::suppression_counter liblog_suppressed; \
+  LIBLOG_IF(level, \
+      liblog_bucket.should_log(per_second, burst) \
+        || (liblog_suppressed.add(), false), \
+      message << ::liberate::logging::suppressed{liblog_suppressed.take()}) \
+}
+
+#define LIBLOG_ERR_RATE_LIMITED(per_second, burst, code, message) \
+  LIBLOG_RATE_LIMITED(LIBLOG_LEVEL_ERROR, per_second, burst, \
+      message << " // " << liberate::sys::error_info{code})
+#define LIBLOG_ERRNO_RATE_LIMITED(per_second, burst, message) \
+  LIBLOG_ERR_RATE_LIMITED(per_second, burst, liberate::sys::error_code(), \
+      message)
+
 #endif // guard
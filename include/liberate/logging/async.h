@@ -0,0 +1,128 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_LOGGING_ASYNC_H
+#define LIBERATE_LOGGING_ASYNC_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <liberate/logging/record.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+namespace liberate::logging {
+
+/**
+ * What to do with a log message if the logging thread's buffer is full.
+ * - drop discards the message.
+ * - count discards the message, and later logs how many were discarded.
+ * - block waits until the background thread has made room.
+ *
+ * Fatal messages always block.
+ */
+enum class overflow_policy : uint8_t
+{
+  drop = 0,
+  count,
+  block,
+};
+
+
+/**
+ * Options for the async_logger below.
+ *
+ * - buffer_size is the size of each thread's buffer, rounded up to the next
+ *   power of two.
+ * - interval is how often the background thread checks for messages.
+ * - sink receives each formatted line, without a trailing newline. By
+ *   default, lines are written to stderr.
+ */
+struct LIBERATE_API async_options
+{
+  std::size_t                                   buffer_size = 64 * 1024;
+  overflow_policy                               overflow = overflow_policy::count;
+  std::chrono::milliseconds                     interval = std::chrono::milliseconds{5};
+  std::function<void (level, std::string_view)> sink = {};
+};
+
+
+/**
+ * Asynchronous logger. Log statements capture their arguments into a buffer
+ * that belongs to the logging thread, without taking locks. A background
+ * tasklet formats the captured messages and passes them to the sink.
+ *
+ * Messages of one thread are written in order; messages of different threads
+ * may be interleaved differently than they were logged.
+ *
+ * Logging a fatal message flushes the logger before the log statement
+ * returns, so that the message is written even if the process terminates
+ * immediately afterwards.
+ */
+class LIBERATE_API async_logger : public record_consumer
+{
+public:
+  explicit async_logger(async_options const & options = async_options{});
+
+  /**
+   * Writes all pending messages.
+   */
+  ~async_logger();
+
+  /**
+   * Blocks until all messages logged before the call have been written.
+   * Must not be called from the sink.
+   */
+  void flush();
+
+  /**
+   * The number of messages discarded due to full buffers.
+   */
+  std::size_t dropped() const;
+
+  /**
+   * The logger used by the LIBLOG macros with the async backend. It is
+   * created on first use, and flushed at exit. To use options other than
+   * the defaults, call configure_global() before the first log statement;
+   * it returns false if the global logger already exists.
+   */
+  static async_logger & global();
+  static bool configure_global(async_options const & options);
+
+  // record_consumer
+  void commit(level lvl, void const * record, std::size_t size) override;
+
+private:
+  async_logger(async_logger const &) = delete;
+  async_logger & operator=(async_logger const &) = delete;
+
+  struct async_logger_impl;
+  std::unique_ptr<async_logger_impl> m_impl;
+};
+
+} // namespace liberate::logging
+
+#endif // guard
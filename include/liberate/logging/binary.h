@@ -0,0 +1,132 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_LOGGING_BINARY_H
+#define LIBERATE_LOGGING_BINARY_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <liberate/logging/record.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace liberate::logging {
+
+/**
+ * Options for the binary_logger below.
+ *
+ * - path is the log file. The format dictionary is written next to it, to
+ *   path + ".dict". Both files are replaced if they exist. If the path is
+ *   empty, a new file in the temporary directory is used, with the process
+ *   ID in its name; see binary_logger::path().
+ * - size is the capacity of the log file's ring buffer. Once it is full, the
+ *   oldest messages are overwritten.
+ */
+struct LIBERATE_API binary_options
+{
+  std::string path = {};
+  std::size_t size = 16 * 1024 * 1024;
+};
+
+
+/**
+ * Binary logger. Rather than formatting messages, it writes their arguments
+ * in a compact binary encoding to a memory-mapped ring buffer file. Use
+ * decode_binary_log() or the liblog-decode tool to turn the file back into
+ * text.
+ *
+ * The constant text of a log statement, i.e. string literals and stream
+ * manipulators, is written to the dictionary once, when the statement is
+ * first executed. Each message then consists of the statement's ID, a
+ * timestamp and the remaining arguments. Integers are written as varints,
+ * so small values take a single Byte.
+ *
+ * Messages that do not match the first execution of their log statement,
+ * e.g. because a constant character array changed its contents, or because
+ * they contain unknown stream manipulators, are written as text.
+ *
+ * Messages are written when the log statement completes; the operating
+ * system writes them to disk, even if the process crashes.
+ */
+class LIBERATE_API binary_logger : public record_consumer
+{
+public:
+  /**
+   * Throws std::runtime_error if the files cannot be created.
+   */
+  explicit binary_logger(binary_options const & options = binary_options{});
+  ~binary_logger();
+
+  /**
+   * Writes the log file to disk.
+   */
+  void flush();
+
+  /**
+   * The number of messages too large for the log file.
+   */
+  std::size_t dropped() const;
+
+  /**
+   * The path of the log file.
+   */
+  std::string const & path() const;
+
+  /**
+   * The logger used by the LIBLOG macros with the binary backend. It is
+   * created on first use. To use options other than the defaults, call
+   * configure_global() before the first log statement; it returns false if
+   * the global logger already exists.
+   */
+  static binary_logger & global();
+  static bool configure_global(binary_options const & options);
+
+  // record_consumer
+  void commit(level lvl, void const * record, std::size_t size) override;
+  bool consumes_immediately() const override;
+
+private:
+  binary_logger(binary_logger const &) = delete;
+  binary_logger & operator=(binary_logger const &) = delete;
+
+  struct binary_logger_impl;
+  std::unique_ptr<binary_logger_impl> m_impl;
+};
+
+
+/**
+ * Decodes the log file at the given path, and the dictionary next to it, and
+ * writes the messages in the format of the async backend, prefixed with a
+ * UTC timestamp unless timestamps is false. Returns the number of messages.
+ *
+ * Throws std::runtime_error if the files cannot be read or are malformed.
+ */
+LIBERATE_API std::size_t
+decode_binary_log(std::ostream & out, std::string const & path,
+    bool timestamps = true);
+
+} // namespace liberate::logging
+
+#endif // guard
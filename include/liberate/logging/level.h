@@ -0,0 +1,112 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_LOGGING_LEVEL_H
+#define LIBERATE_LOGGING_LEVEL_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Numeric log levels, for use in preprocessor conditions. Define
+ * LIBERATE_LOG_MIN_LEVEL to one of these to compile out all log statements
+ * below that level.
+ */
+#define LIBLOG_LEVEL_NUM_TRACE 0
+#define LIBLOG_LEVEL_NUM_DEBUG 1
+#define LIBLOG_LEVEL_NUM_INFO  2
+#define LIBLOG_LEVEL_NUM_WARN  3
+#define LIBLOG_LEVEL_NUM_ERROR 4
+#define LIBLOG_LEVEL_NUM_FATAL 5
+
+#if !defined(LIBERATE_LOG_MIN_LEVEL)
+#define LIBERATE_LOG_MIN_LEVEL LIBLOG_LEVEL_NUM_TRACE
+#endif
+
+namespace liberate::logging {
+
+/**
+ * Log levels, in order of increasing severity. The values correspond to the
+ * LIBLOG_LEVEL_NUM_* macros.
+ */
+enum class level : uint8_t
+{
+  trace = LIBLOG_LEVEL_NUM_TRACE,
+  debug = LIBLOG_LEVEL_NUM_DEBUG,
+  info  = LIBLOG_LEVEL_NUM_INFO,
+  warn  = LIBLOG_LEVEL_NUM_WARN,
+  error = LIBLOG_LEVEL_NUM_ERROR,
+  fatal = LIBLOG_LEVEL_NUM_FATAL,
+};
+
+LIBERATE_API char const *
+level_name(level lvl);
+
+
+/**
+ * The runtime minimum level. Log statements below it are skipped before
+ * their message is formatted. This applies in addition to any filtering the
+ * log backend performs. The default is level::trace, i.e. no filtering.
+ */
+LIBERATE_API void
+set_level(level lvl);
+
+LIBERATE_API level
+get_level();
+
+
+namespace detail {
+
+LIBERATE_API extern std::atomic<uint8_t> runtime_min_level;
+
+} // namespace detail
+
+
+/**
+ * Returns true if a log statement at the given level was compiled in.
+ */
+constexpr bool
+is_compiled_in(level lvl)
+{
+  constexpr int min_level = LIBERATE_LOG_MIN_LEVEL;
+  return static_cast<int>(lvl) >= min_level;
+}
+
+
+/**
+ * Returns true if a log statement at the given level should be formatted.
+ * This is a single relaxed load, cheap enough to precede every log statement.
+ */
+inline bool
+is_enabled(level lvl)
+{
+  return is_compiled_in(lvl)
+    && static_cast<uint8_t>(lvl)
+      >= detail::runtime_min_level.load(std::memory_order_relaxed);
+}
+
+} // namespace liberate::logging
+
+#endif // guard
@@ -0,0 +1,189 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_LOGGING_RATE_LIMIT_H
+#define LIBERATE_LOGGING_RATE_LIMIT_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace liberate::logging {
+
+/**
+ * Per call site state for the sampled and rate limited LIBLOG macros. All
+ * of these are meant to be function local statics; they are constant
+ * initialized, and only use relaxed atomic operations.
+ */
+
+/**
+ * Permits the first, and then every n-th, call.
+ */
+class every_n
+{
+public:
+  constexpr every_n() = default;
+
+  inline bool
+  should_log(uint64_t n)
+  {
+    return !n || m_count.fetch_add(1, std::memory_order_relaxed) % n == 0;
+  }
+
+private:
+  std::atomic<uint64_t> m_count = 0;
+};
+
+
+/**
+ * Permits the first n calls. Once they have passed, a call costs a single
+ * relaxed load.
+ */
+class first_n
+{
+public:
+  constexpr first_n() = default;
+
+  inline bool
+  should_log(uint64_t n)
+  {
+    if (m_count.load(std::memory_order_relaxed) >= n) {
+      return false;
+    }
+    return m_count.fetch_add(1, std::memory_order_relaxed) < n;
+  }
+
+private:
+  std::atomic<uint64_t> m_count = 0;
+};
+
+
+/**
+ * Token bucket that refills at per_second tokens per second, and holds up
+ * to burst tokens. It is implemented as the equivalent generic cell rate
+ * algorithm, which needs only a single atomic: the time at which the bucket
+ * is full again. Rejected calls cost a relaxed load.
+ */
+class token_bucket
+{
+public:
+  constexpr token_bucket() = default;
+
+  inline bool
+  should_log(double per_second, uint64_t burst)
+  {
+    return should_log(per_second, burst, now());
+  }
+
+  /**
+   * Same as above, at the given time in nanoseconds; mostly for testing.
+   */
+  inline bool
+  should_log(double per_second, uint64_t burst, uint64_t now_ns)
+  {
+    if (per_second <= 0) {
+      return false;
+    }
+    auto interval = static_cast<uint64_t>(1e9 / per_second);
+    auto tolerance = interval * (burst ? burst - 1 : 0);
+
+    auto full = m_full.load(std::memory_order_relaxed);
+    uint64_t next = 0;
+    do {
+      auto start = (full > now_ns) ? full : now_ns;
+      if (start - now_ns > tolerance) {
+        return false;
+      }
+      next = start + interval;
+    } while (!m_full.compare_exchange_weak(full, next,
+          std::memory_order_relaxed));
+    return true;
+  }
+
+private:
+  static inline uint64_t
+  now()
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  std::atomic<uint64_t> m_full = 0;
+};
+
+
+/**
+ * Counts the messages a call site suppressed since it last logged.
+ */
+class suppression_counter
+{
+public:
+  constexpr suppression_counter() = default;
+
+  inline void
+  add()
+  {
+    m_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the count, and resets it to zero.
+   */
+  inline uint64_t
+  take()
+  {
+    if (!m_count.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+    return m_count.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> m_count = 0;
+};
+
+
+/**
+ * Streams " [suppressed N messages]" if the count is non-zero, and nothing
+ * otherwise.
+ */
+struct suppressed
+{
+  uint64_t count;
+};
+
+inline std::ostream &
+operator<<(std::ostream & os, suppressed const & value)
+{
+  if (value.count) {
+    os << " [suppressed " << value.count << " messages]";
+  }
+  return os;
+}
+
+} // namespace liberate::logging
+
+#endif // guard
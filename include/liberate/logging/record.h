@@ -0,0 +1,306 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_LOGGING_RECORD_H
+#define LIBERATE_LOGGING_RECORD_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <liberate/logging/level.h>
+
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace liberate::logging {
+
+/**
+ * Receives the records captured by record_stream below. The record layout
+ * is described in the detail namespace.
+ *
+ * If consumes_immediately() returns true, the consumer is done with each
+ * record when commit() returns. Records may then refer to constant character
+ * arrays, such as string literals, by address rather than contain a copy.
+ */
+class LIBERATE_API record_consumer
+{
+public:
+  virtual ~record_consumer() = default;
+
+  virtual void commit(level lvl, void const * record, std::size_t size) = 0;
+
+  virtual bool consumes_immediately() const
+  {
+    return false;
+  }
+};
+
+
+namespace detail {
+
+/**
+ * Record layout: a record_header, followed by arguments. Each argument is a
+ * tag Byte followed by its value; strings have a 32 bit length prefix.
+ * Static text is a pointer followed by a 32 bit length.
+ */
+struct record_header
+{
+  uint32_t      size;
+  level         lvl;
+  uint32_t      line;
+  char const *  file;
+};
+
+enum arg_tag : uint8_t
+{
+  ARG_BOOL = 0,
+  ARG_CHAR,
+  ARG_SIGNED,
+  ARG_UNSIGNED,
+  ARG_DOUBLE,
+  ARG_STRING,
+  ARG_POINTER,
+  ARG_MANIPULATOR,
+  ARG_IOS_MANIPULATOR,
+  ARG_STATIC,
+};
+
+template <typename T>
+constexpr bool is_char_v = std::is_same_v<T, char>
+  || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>;
+
+
+/**
+ * Calls func(tag, value, size) for each argument of a record. The value
+ * points to the argument's value; for strings and static text, it points to
+ * the characters, and size is their length. Returns false if the record is
+ * malformed.
+ */
+template <typename funcT>
+bool
+for_each_arg(uint8_t const * record, std::size_t size, funcT && func)
+{
+  std::size_t offset = sizeof(record_header);
+  while (offset < size) {
+    auto tag = static_cast<arg_tag>(record[offset++]);
+    std::size_t value_size = 0;
+    switch (tag) {
+      case ARG_BOOL:
+        value_size = sizeof(bool);
+        break;
+      case ARG_CHAR:
+        value_size = sizeof(char);
+        break;
+      case ARG_SIGNED:
+        value_size = sizeof(int64_t);
+        break;
+      case ARG_UNSIGNED:
+        value_size = sizeof(uint64_t);
+        break;
+      case ARG_DOUBLE:
+        value_size = sizeof(double);
+        break;
+      case ARG_POINTER:
+        value_size = sizeof(void const *);
+        break;
+      case ARG_MANIPULATOR:
+        value_size = sizeof(std::ostream & (*)(std::ostream &));
+        break;
+      case ARG_IOS_MANIPULATOR:
+        value_size = sizeof(std::ios_base & (*)(std::ios_base &));
+        break;
+
+      case ARG_STRING:
+        {
+          uint32_t length = 0;
+          if (offset + sizeof(length) > size) {
+            return false;
+          }
+          std::memcpy(&length, record + offset, sizeof(length));
+          offset += sizeof(length);
+          if (offset + length > size) {
+            return false;
+          }
+          func(tag, record + offset, std::size_t{length});
+          offset += length;
+        }
+        continue;
+
+      case ARG_STATIC:
+        {
+          char const * text = nullptr;
+          uint32_t length = 0;
+          if (offset + sizeof(text) + sizeof(length) > size) {
+            return false;
+          }
+          std::memcpy(&text, record + offset, sizeof(text));
+          std::memcpy(&length, record + offset + sizeof(text), sizeof(length));
+          offset += sizeof(text) + sizeof(length);
+          func(tag, text, std::size_t{length});
+        }
+        continue;
+
+      default:
+        return false;
+    }
+
+    if (offset + value_size > size) {
+      return false;
+    }
+    func(tag, record + offset, value_size);
+    offset += value_size;
+  }
+  return true;
+}
+
+
+/**
+ * Writes the arguments of a record to the output stream, i.e. the message
+ * without the header.
+ */
+LIBERATE_API void
+format_args(std::ostream & out, uint8_t const * record, std::size_t size);
+
+} // namespace detail
+
+
+/**
+ * Captures the arguments of one log statement, and commits them to the
+ * consumer when destroyed. Numbers, strings, pointers and stream manipulators
+ * are captured as they are, and formatted later. Anything else is formatted
+ * immediately with its stream output operator.
+ *
+ * Manipulators that take arguments, such as std::setw(), only affect the
+ * argument following them if that is formatted immediately.
+ */
+class LIBERATE_API record_stream
+{
+public:
+  record_stream(record_consumer & consumer, level lvl, char const * file,
+      unsigned line);
+  ~record_stream();
+
+  template <typename T>
+  inline record_stream &
+  operator<<(T && value)
+  {
+    using type = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (std::is_same_v<type, bool>) {
+      append(detail::ARG_BOOL, value);
+    }
+    else if constexpr (detail::is_char_v<type>) {
+      append(detail::ARG_CHAR, static_cast<char>(value));
+    }
+    else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>) {
+      append(detail::ARG_SIGNED, static_cast<int64_t>(value));
+    }
+    else if constexpr (std::is_integral_v<type>) {
+      append(detail::ARG_UNSIGNED, static_cast<uint64_t>(value));
+    }
+    else if constexpr (std::is_same_v<type, float>
+        || std::is_same_v<type, double>)
+    {
+      append(detail::ARG_DOUBLE, static_cast<double>(value));
+    }
+    else if constexpr (std::is_convertible_v<T, std::string_view>) {
+      append_string(std::string_view{value});
+    }
+    else if constexpr (std::is_pointer_v<std::decay_t<T>>) {
+      append(detail::ARG_POINTER, static_cast<void const *>(value));
+    }
+    else {
+      std::ostringstream sstream;
+      sstream << value;
+      append_string(sstream.str());
+    }
+    return *this;
+  }
+
+  /**
+   * Constant character arrays, such as string literals, are static text. It
+   * is referred to by address if the consumer permits it. Not every constant
+   * array is a literal, so consumers must not assume that the text at an
+   * address stays the same.
+   */
+  template <std::size_t N>
+  inline record_stream &
+  operator<<(char const (&value)[N])
+  {
+    std::string_view text{value, N};
+    text = text.substr(0, text.find('\0'));
+    if (m_static_text) {
+      append_static(text.data(), text.size());
+    }
+    else {
+      append_string(text);
+    }
+    return *this;
+  }
+
+  inline record_stream &
+  operator<<(std::ostream & (*manipulator)(std::ostream &))
+  {
+    append(detail::ARG_MANIPULATOR, manipulator);
+    return *this;
+  }
+
+  inline record_stream &
+  operator<<(std::ios_base & (*manipulator)(std::ios_base &))
+  {
+    append(detail::ARG_IOS_MANIPULATOR, manipulator);
+    return *this;
+  }
+
+private:
+  record_stream(record_stream const &) = delete;
+  record_stream & operator=(record_stream const &) = delete;
+
+  template <typename T>
+  inline void
+  append(detail::arg_tag tag, T const & value)
+  {
+    auto offset = m_buffer->size();
+    m_buffer->resize(offset + 1 + sizeof(T));
+    auto out = m_buffer->data() + offset;
+    *out = tag;
+    std::memcpy(out + 1, &value, sizeof(T));
+  }
+
+  void append_string(std::string_view value);
+  void append_static(char const * text, std::size_t length);
+
+  record_consumer &       m_consumer;
+  level                   m_level;
+  bool                    m_static_text;
+  std::vector<uint8_t> *  m_buffer;
+  std::vector<uint8_t>    m_own = {};
+};
+
+} // namespace liberate::logging
+
+#endif // guard
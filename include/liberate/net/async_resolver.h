@@ -0,0 +1,138 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_ASYNC_RESOLVER_H
+#define LIBERATE_NET_ASYNC_RESOLVER_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <liberate/net/address_type.h>
+#include <liberate/net/socket_address.h>
+
+namespace liberate::net {
+
+class resolver_backend;
+
+/**
+ * Options for the async_resolver below.
+ *
+ * - workers is the number of threads performing lookups. It bounds the
+ *   number of concurrent lookups; further requests are queued.
+ */
+struct LIBERATE_API async_resolver_options
+{
+  std::size_t workers = 4;
+};
+
+
+/**
+ * Resolves host names without blocking the caller.
+ *
+ * Requests are handed to a pool of worker threads, which perform the actual
+ * lookups via resolve(), with the system or a provided backend, or via a
+ * provided lookup function; the latter can also be a resolver_cache. For
+ * AT_UNSPEC, the IPv4 and IPv6 lookups are issued in parallel, and their
+ * results merged and ordered with sort_by_preference(). If only one of them
+ * fails, its error is ignored.
+ *
+ * Each request may have a timeout. If it expires, or if the request is
+ * cancelled, the request completes immediately with an error. The underlying
+ * system call cannot be interrupted, so the worker remains busy until it
+ * returns; its result is then discarded.
+ *
+ * Errors are reported as exceptions, either via the future or the exception
+ * pointer passed to the callback:
+ * - std::system_error with std::errc::timed_out if the timeout expired.
+ * - std::system_error with std::errc::operation_canceled if the request was
+ *   cancelled, also when the resolver is destroyed.
+ * - Anything the lookup throws, see resolve().
+ *
+ * Callbacks are invoked on the worker thread that finished the request, or
+ * on the thread that cancelled or timed it out. They must not block for
+ * long.
+ */
+class LIBERATE_API async_resolver
+{
+public:
+  using result_type = std::vector<socket_address>;
+  using lookup_function = std::function<
+    result_type (address_type, std::string const &)
+  >;
+  using callback = std::function<
+    void (result_type const & results, std::exception_ptr error)
+  >;
+  using request_id = std::size_t;
+
+  explicit async_resolver(api & api,
+      async_resolver_options const & options = async_resolver_options{});
+  explicit async_resolver(resolver_backend & backend,
+      async_resolver_options const & options = async_resolver_options{});
+  explicit async_resolver(lookup_function && lookup,
+      async_resolver_options const & options = async_resolver_options{});
+
+  /**
+   * Cancels all outstanding requests, and waits for the workers to finish.
+   */
+  ~async_resolver();
+
+  /**
+   * Start resolving. Arguments are the same as for resolve(), and are
+   * validated immediately. A timeout of zero means the request does not
+   * time out.
+   *
+   * The callback variant returns the request's identifier, for use with
+   * cancel(). The future variant stores it in the id argument, if provided.
+   */
+  request_id resolve(address_type type, std::string const & hostname,
+      callback && cb,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+  std::future<result_type> resolve(address_type type,
+      std::string const & hostname,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+      request_id * id = nullptr);
+
+  /**
+   * Cancel a request. Returns false if the request already completed.
+   */
+  bool cancel(request_id id);
+
+private:
+  async_resolver(async_resolver const &) = delete;
+  async_resolver & operator=(async_resolver const &) = delete;
+
+  struct async_resolver_impl;
+  std::unique_ptr<async_resolver_impl> m_impl;
+};
+
+} // namespace liberate::net
+
+#endif // guard
@@ -0,0 +1,183 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_FLOW_KEY_H
+#define LIBERATE_NET_FLOW_KEY_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <array>
+#include <vector>
+
+#include <liberate/cpp/operators/comparison.h>
+#include <liberate/net/ip.h>
+#include <liberate/net/socket_address.h>
+
+namespace liberate::net {
+
+/**
+ * Identifies the flow a packet belongs to, i.e. the 5-tuple of transport
+ * protocol, source and destination addresses, and source and destination
+ * ports. Addresses are kept as in packet_headers; ports are zero unless
+ * has_ports is set.
+ */
+struct LIBERATE_API flow_key
+  : public ::liberate::cpp::comparison_operators<flow_key>
+{
+  using address_bytes = packet_headers::address_bytes;
+
+  address_type    type = AT_UNSPEC;
+  uint8_t         protocol = 0;
+  bool            has_ports = false;
+  address_bytes   source = {};
+  address_bytes   dest = {};
+  uint16_t        source_port = 0;
+  uint16_t        dest_port = 0;
+
+  flow_key() = default;
+
+  /**
+   * Construct from the given packet's fields of parse_headers() results.
+   */
+  flow_key(packet_headers const & headers, size_t index);
+
+  /**
+   * Construct from socket addresses, including their ports. Both must be
+   * either IPv4 or IPv6 addresses, otherwise std::invalid_argument is thrown.
+   */
+  flow_key(uint8_t protocol, socket_address const & source,
+      socket_address const & dest);
+
+  /**
+   * The key of the opposite direction of the flow.
+   */
+  flow_key reversed() const;
+
+  /**
+   * Fast hash for use in hash tables. Unlike symmetric_flow_hash(), both
+   * directions of a flow hash differently.
+   */
+  size_t hash() const;
+
+private:
+  friend struct ::liberate::cpp::comparison_operators<flow_key>;
+
+  bool is_equal_to(flow_key const & other) const;
+  bool is_less_than(flow_key const & other) const;
+};
+
+
+/**
+ * Fast hash over a flow key that is the same for both directions of a flow,
+ * e.g. for steering both to the same thread.
+ */
+LIBERATE_API uint64_t
+symmetric_flow_hash(flow_key const & key, uint64_t seed = 0);
+
+
+/**
+ * The Toeplitz hash used by network cards for receive side scaling (RSS).
+ * With the same key, it yields the same hashes as the hardware, so software
+ * steering can match hardware steering.
+ *
+ * As in RSS, the input for flow keys is the source address, destination
+ * address, source port and destination port in network byte order; ports are
+ * only included if the key has them. Network cards that only hash addresses
+ * for some protocols correspond to keys without ports.
+ *
+ * DEFAULT_KEY is the key from Microsoft's RSS specification, which many
+ * drivers use by default. SYMMETRIC_KEY produces the same hash for both
+ * directions of a flow.
+ *
+ * The constructor precomputes tables for the given key; create one instance
+ * and reuse it.
+ */
+class LIBERATE_API toeplitz_hash
+{
+public:
+  using key_type = std::array<uint8_t, 40>;
+
+  static constexpr key_type DEFAULT_KEY = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+  };
+
+  static constexpr key_type SYMMETRIC_KEY = {
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  };
+
+  explicit toeplitz_hash(key_type const & key = DEFAULT_KEY);
+
+  /**
+   * Keys of other sizes, as some network cards use; a key of N Bytes can
+   * hash up to N - 4 Bytes of input. Shorter keys than 8 Bytes are rejected
+   * with std::invalid_argument.
+   */
+  toeplitz_hash(uint8_t const * key, size_t key_size);
+
+  /**
+   * The maximum input size in Bytes.
+   */
+  inline size_t max_input_size() const
+  {
+    return m_table.size() / 256;
+  }
+
+  /**
+   * Hash raw input, or a flow key. Input exceeding max_input_size() results
+   * in std::invalid_argument.
+   */
+  uint32_t operator()(uint8_t const * input, size_t size) const;
+  uint32_t operator()(flow_key const & key) const;
+
+private:
+  // For each input Byte position and value, the hash bits it contributes.
+  std::vector<uint32_t> m_table;
+};
+
+} // namespace liberate::net
+
+
+/*******************************************************************************
+ * std namespace specializations
+ **/
+namespace std {
+
+template <> struct LIBERATE_API hash<liberate::net::flow_key>
+{
+  size_t operator()(liberate::net::flow_key const & x) const
+  {
+    return x.hash();
+  }
+};
+
+} // namespace std
+
+#endif // guard
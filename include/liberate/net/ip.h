@@ -26,7 +26,11 @@
 
 #include <liberate.h>
 
+#include <array>
+#include <vector>
+
 #include <liberate/net/socket_address.h>
+#include <liberate/serialization/buffer.h>
 #include <liberate/types/byte.h>
 
 namespace liberate::net {
@@ -54,6 +58,76 @@ parse_dest_address(socket_address & dest,
     ::liberate::types::byte const * buffer, size_t bufsize);
 
 
+/**
+ * Header information of a batch of IP packets, as extracted by
+ * parse_headers() below. Each field is kept in its own array, indexed by
+ * packet, so that code looking at only some fields of many packets touches
+ * little memory. Reuse an instance for multiple batches to avoid
+ * allocations.
+ *
+ * - type is AT_INET4 or AT_INET6, or AT_UNSPEC if the packet could not be
+ *   parsed; all other fields are then zero.
+ * - flags is a combination of the PH_* values.
+ * - protocol is the transport protocol number; for IPv6, this is the first
+ *   header after the extension header chain.
+ * - transport_offset is the offset of the transport header in the packet.
+ * - source and dest are the addresses in network byte order. IPv4 addresses
+ *   occupy the first four Bytes, and the rest is zero.
+ * - source_port and dest_port are in host byte order. They are only set if
+ *   PH_PORTS is in flags.
+ */
+struct LIBERATE_API packet_headers
+{
+  using address_bytes = std::array<::liberate::types::byte, 16>;
+
+  enum flag : uint8_t
+  {
+    PH_FRAGMENT = 1,  // The packet is a fragment.
+    PH_PORTS    = 2,  // Ports were parsed from the transport header.
+  };
+
+  std::vector<address_type>   type = {};
+  std::vector<uint8_t>        flags = {};
+  std::vector<uint8_t>        protocol = {};
+  std::vector<uint16_t>       transport_offset = {};
+  std::vector<address_bytes>  source = {};
+  std::vector<address_bytes>  dest = {};
+  std::vector<uint16_t>       source_port = {};
+  std::vector<uint16_t>       dest_port = {};
+
+  inline size_t size() const
+  {
+    return type.size();
+  }
+
+  void resize(size_t size);
+
+  /**
+   * Construct socket addresses from the given packet's fields, including
+   * the port if one was parsed.
+   */
+  socket_address source_address(size_t index) const;
+  socket_address dest_address(size_t index) const;
+};
+
+
+/**
+ * Parse the IP headers of a batch of packets, e.g. as received by a single
+ * recvmmsg() call. The headers object is resized to the number of packets,
+ * and filled as described above. Returns the number of packets that could be
+ * parsed.
+ *
+ * For IPv6, the extension header chain is followed to find the transport
+ * header. Ports are parsed for TCP, UDP, UDP-Lite, SCTP and DCCP, unless the
+ * packet is a fragment other than the first.
+ *
+ * As with parse_addresses(), this does not verify that packets are valid
+ * beyond the lengths required for reading them.
+ */
+LIBERATE_API size_t
+parse_headers(packet_headers & headers,
+    ::liberate::serialization::const_segment const * packets, size_t amount);
+
 } // namespace liberate::net
 
 #endif // guard
@@ -113,6 +113,18 @@ public:
    **/
   bool in_network(socket_address const & address) const;
 
+  /**
+   * Batch version of the above, e.g. for packet filtering. For each of the
+   * amount addresses, the corresponding bit in the bitmap is set if the
+   * address is part of the network, and cleared otherwise. Bit i is found
+   * in bitmap[i / 64] at position (i % 64); the bitmap must be large enough
+   * to hold (amount + 63) / 64 words.
+   *
+   * Returns the number of addresses that are part of the network.
+   **/
+  size_t in_network(socket_address const * addresses, size_t amount,
+      uint64_t * bitmap) const;
+
 
   /**
    * Return the network, default gateway and broadcast addresses of this
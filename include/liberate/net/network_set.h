@@ -0,0 +1,175 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_NETWORK_SET_H
+#define LIBERATE_NET_NETWORK_SET_H
+
+// *** Config
+#include <liberate.h>
+
+// *** C++ includes
+#include <string>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+// *** Own includes
+#include <liberate/cpp/operators/comparison.h>
+#include <liberate/net/address_type.h>
+#include <liberate/net/socket_address.h>
+#include <liberate/net/network.h>
+
+namespace liberate::net {
+
+/*****************************************************************************
+ * Network set
+ **/
+/**
+ * A set of IPv4 and IPv6 addresses, expressed as networks.
+ *
+ * Internally, the set is kept normalized: networks that overlap, contain one
+ * another or are adjacent are merged into address ranges. That makes the
+ * set operations below linear in the number of ranges, and address lookups
+ * logarithmic.
+ *
+ * Note that a network_set does *not* manage address reservations like the
+ * network class does; it only deals with address membership.
+ **/
+class LIBERATE_API network_set
+  : public ::liberate::cpp::comparison_operators<network_set>
+{
+public:
+  network_set();
+  ~network_set();
+
+  /**
+   * Behave like a value type.
+   **/
+  network_set(network_set const & other);
+  network_set(network_set &&);
+  network_set & operator=(network_set const & other);
+  network_set & operator=(network_set &&);
+
+  /**
+   * Add a network to the set. The network may overlap or be adjacent to
+   * existing networks; they will be merged.
+   *
+   * The netspec version throws like the network constructor does.
+   **/
+  void insert(network const & net);
+  void insert(std::string const & netspec);
+
+  /**
+   * Remove all addresses of a network from the set. This may split existing
+   * ranges.
+   **/
+  void erase(network const & net);
+  void erase(std::string const & netspec);
+
+  /**
+   * Remove all networks from the set.
+   **/
+  void clear();
+
+  /**
+   * Returns true if the set contains no addresses.
+   **/
+  bool empty() const;
+
+  /**
+   * Returns true if the address is part of any network in the set. The port
+   * of the address is ignored.
+   **/
+  bool contains(socket_address const & address) const;
+
+  /**
+   * Returns true if all addresses of the network are part of the set.
+   **/
+  bool contains(network const & net) const;
+
+  /**
+   * Returns true if at least one address of the network is part of the set.
+   **/
+  bool overlaps(network const & net) const;
+  bool overlaps(network_set const & other) const;
+
+  /**
+   * Set algebra. The results are normalized sets again.
+   **/
+  network_set set_union(network_set const & other) const;
+  network_set set_intersection(network_set const & other) const;
+  network_set set_difference(network_set const & other) const;
+
+  /**
+   * Return the minimal list of networks covering exactly the addresses in
+   * this set, sorted by family and address.
+   *
+   * Because the network class does not support a zero-length netmask, an
+   * entire address family is returned as two networks of mask size 1.
+   **/
+  std::vector<network> networks() const;
+
+  /**
+   * Return the minimal list of networks covering exactly the address range
+   * from first to last (inclusive). Ports are ignored.
+   *
+   * Throws std::invalid_argument if the addresses are not both IPv4 or both
+   * IPv6 addresses, or if last is smaller than first.
+   **/
+  static std::vector<network> cidr_cover(socket_address const & first,
+      socket_address const & last);
+
+  void swap(network_set & other);
+
+protected:
+  /**
+   * Used by cpp::comparison_operators
+   **/
+  friend struct liberate::cpp::comparison_operators<network_set>;
+
+  bool is_equal_to(network_set const & other) const;
+  bool is_less_than(network_set const & other) const;
+
+private:
+  // Pointer to implementation
+  struct network_set_impl;
+  std::unique_ptr<network_set_impl> m_impl;
+
+  friend LIBERATE_API_FRIEND std::ostream & operator<<(std::ostream & os, network_set const & set);
+};
+
+
+/**
+ * Formats a network set as a comma separated list of netspecs.
+ **/
+LIBERATE_API std::ostream & operator<<(std::ostream & os, network_set const & set);
+
+
+/**
+ * Swappable
+ **/
+inline void
+swap(network_set & first, network_set & second)
+{
+  return first.swap(second);
+}
+
+} // namespace liberate::net
+
+#endif // guard
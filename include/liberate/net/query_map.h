@@ -0,0 +1,285 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_QUERY_MAP_H
+#define LIBERATE_NET_QUERY_MAP_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <utility>
+
+#include <liberate/cpp/operators/comparison.h>
+
+namespace liberate::net {
+
+/**
+ * A flat map of URL query parameters.
+ *
+ * URLs rarely carry more than a handful of query parameters, so instead of
+ * allocating a tree node per parameter like std::map does, query_map keeps
+ * its entries sorted in a single vector. Short keys and values additionally
+ * benefit from std::string's small string optimization, so a typical URL's
+ * query needs a single allocation.
+ *
+ * The hash of each key is computed once on insertion and kept alongside the
+ * entries. Lookups, comparisons and hashing of the map compare or combine
+ * these hashes rather than the key strings.
+ *
+ * The interface is a subset of std::map's, and iteration order is the same.
+ * As with C++23's std::flat_map, the entries are not stored as pairs, so
+ * iterators yield a pair of references, the first of which is const:
+ *
+ *   for (auto const & [key, value] : map) { ... }
+ */
+class LIBERATE_API query_map
+  : public ::liberate::cpp::comparison_operators<query_map>
+{
+private:
+  using entry_type = std::pair<std::string, std::string>;
+  using storage_type = std::vector<entry_type>;
+
+public:
+  using key_type = std::string;
+  using mapped_type = std::string;
+  using value_type = std::pair<std::string, std::string>;
+  using size_type = std::size_t;
+  using reference = std::pair<std::string const &, std::string &>;
+  using const_reference = std::pair<std::string const &, std::string const &>;
+
+  /**
+   * Random access iterator over the entries; the key cannot be modified.
+   */
+  template <bool CONST>
+  class basic_iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = query_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<CONST, query_map::const_reference,
+          query_map::reference>;
+
+    // Dereferencing yields a temporary, so operator-> needs to hold it.
+    struct pointer
+    {
+      reference ref;
+      inline reference const * operator->() const { return &ref; }
+    };
+
+    basic_iterator() = default;
+
+    // Conversion from iterator to const_iterator.
+    template <bool OTHER, typename = std::enable_if_t<CONST && !OTHER>>
+    basic_iterator(basic_iterator<OTHER> const & other)
+      : m_iter{other.m_iter}
+    {
+    }
+
+    inline reference operator*() const
+    {
+      return reference{m_iter->first, m_iter->second};
+    }
+
+    inline pointer operator->() const { return pointer{**this}; }
+    inline reference operator[](difference_type n) const
+    {
+      return *(*this + n);
+    }
+
+    inline basic_iterator & operator++() { ++m_iter; return *this; }
+    inline basic_iterator & operator--() { --m_iter; return *this; }
+    inline basic_iterator operator++(int) { return basic_iterator{m_iter++}; }
+    inline basic_iterator operator--(int) { return basic_iterator{m_iter--}; }
+
+    inline basic_iterator & operator+=(difference_type n)
+    {
+      m_iter += n;
+      return *this;
+    }
+
+    inline basic_iterator & operator-=(difference_type n)
+    {
+      m_iter -= n;
+      return *this;
+    }
+
+    inline basic_iterator operator+(difference_type n) const
+    {
+      return basic_iterator{m_iter + n};
+    }
+
+    inline basic_iterator operator-(difference_type n) const
+    {
+      return basic_iterator{m_iter - n};
+    }
+
+    // Friends, so that iterators and const_iterators can be mixed.
+    friend inline difference_type
+    operator-(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter - second.m_iter;
+    }
+
+    friend inline bool
+    operator==(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter == second.m_iter;
+    }
+
+    friend inline bool
+    operator!=(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter != second.m_iter;
+    }
+
+    friend inline bool
+    operator<(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter < second.m_iter;
+    }
+
+    friend inline bool
+    operator>(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter > second.m_iter;
+    }
+
+    friend inline bool
+    operator<=(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter <= second.m_iter;
+    }
+
+    friend inline bool
+    operator>=(basic_iterator const & first, basic_iterator const & second)
+    {
+      return first.m_iter >= second.m_iter;
+    }
+
+  private:
+    friend class query_map;
+    friend class basic_iterator<!CONST>;
+
+    using base_type = std::conditional_t<CONST,
+          storage_type::const_iterator, storage_type::iterator>;
+
+    explicit basic_iterator(base_type iter)
+      : m_iter{iter}
+    {
+    }
+
+    base_type m_iter = {};
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  query_map() = default;
+  query_map(std::initializer_list<value_type> init);
+
+  /**
+   * Capacity
+   */
+  inline size_type size() const { return m_entries.size(); }
+  inline bool empty() const { return m_entries.empty(); }
+  void clear();
+
+  /**
+   * Iteration, in ascending key order.
+   */
+  inline iterator begin() { return iterator{m_entries.begin()}; }
+  inline iterator end() { return iterator{m_entries.end()}; }
+  inline const_iterator begin() const { return const_iterator{m_entries.begin()}; }
+  inline const_iterator end() const { return const_iterator{m_entries.end()}; }
+  inline const_iterator cbegin() const { return begin(); }
+  inline const_iterator cend() const { return end(); }
+
+  /**
+   * Lookup. Keys are accepted as string_view, so that lookups do not need to
+   * allocate. at() throws std::out_of_range if the key does not exist.
+   */
+  iterator find(std::string_view key);
+  const_iterator find(std::string_view key) const;
+  size_type count(std::string_view key) const;
+  std::string & at(std::string_view key);
+  std::string const & at(std::string_view key) const;
+
+  /**
+   * Modification. operator[] inserts an empty value if the key does not yet
+   * exist. insert() and emplace() leave existing values unchanged, whereas
+   * insert_or_assign() replaces them.
+   */
+  std::string & operator[](std::string_view key);
+  std::pair<iterator, bool> insert(value_type value);
+  std::pair<iterator, bool> insert_or_assign(std::string_view key,
+      std::string value);
+  size_type erase(std::string_view key);
+  iterator erase(const_iterator pos);
+
+  template <typename... argsT>
+  inline std::pair<iterator, bool>
+  emplace(argsT && ... args)
+  {
+    return insert(value_type(std::forward<argsT>(args)...));
+  }
+
+  /**
+   * Hash over all entries.
+   */
+  size_t hash() const;
+
+  void swap(query_map & other);
+
+private:
+  friend struct liberate::cpp::comparison_operators<query_map>;
+
+  bool is_equal_to(query_map const & other) const;
+  bool is_less_than(query_map const & other) const;
+
+  // Returns the index at which the key is found or would be inserted.
+  size_type lower_bound(std::string_view key, size_t key_hash,
+      bool & found) const;
+
+  storage_type            m_entries;
+  std::vector<size_t>     m_hashes;
+};
+
+
+/**
+ * Swappable
+ **/
+inline void
+swap(query_map & first, query_map & second)
+{
+  return first.swap(second);
+}
+
+} // namespace liberate::net
+
+#endif // guard
@@ -27,13 +27,15 @@
 #include <liberate.h>
 
 #include <string>
-#include <set>
+#include <vector>
 
 #include <liberate/net/address_type.h>
 #include <liberate/net/socket_address.h>
 
 namespace liberate::net {
 
+class resolver_backend;
+
 /**
  * Resolves network host names to IP addresses.
  * - specify AT_UNSPEC if you want both IPv4 and IPv6 addresses.
@@ -41,6 +43,12 @@ namespace liberate::net {
  *   respectively.
  * - any other address type will yield errors.
  *
+ * The host name may be followed by a colon and a port, which is then set on
+ * all results.
+ *
+ * Results are ordered by preference, as returned by the system resolver or
+ * the given backend (see resolver_backend.h); use the first one that works.
+ *
  * An empty list means the name could not be resolved. Actual errors
  * are reported as exceptions.
  * - std::invalid_argument if arguments were invalid.
@@ -52,9 +60,29 @@ namespace liberate::net {
  * - std::logic_error for unspecified errors.
  */
 LIBERATE_API
-std::set<socket_address>
+std::vector<socket_address>
 resolve(api & api, address_type type, std::string const & hostname);
 
+LIBERATE_API
+std::vector<socket_address>
+resolve(resolver_backend & backend, address_type type,
+    std::string const & hostname);
+
+
+/**
+ * Sort addresses by the destination address selection rules of RFC 6724.
+ * Rules that depend on the available source addresses cannot be applied
+ * here, so this only prefers addresses with higher precedence in the
+ * default policy table (rule 6), then those with smaller scope (rule 8).
+ * Otherwise, the order is left unchanged.
+ *
+ * The system resolver already applies all rules; this is for addresses from
+ * other sources.
+ */
+LIBERATE_API
+void
+sort_by_preference(std::vector<socket_address> & addresses);
+
 } // namespace liberate::net
 
 #endif // guard
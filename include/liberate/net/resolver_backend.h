@@ -0,0 +1,167 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_RESOLVER_BACKEND_H
+#define LIBERATE_NET_RESOLVER_BACKEND_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <liberate/net/address_type.h>
+#include <liberate/net/socket_address.h>
+
+namespace liberate::net {
+
+/**
+ * Backends perform the actual lookups for resolve(). They receive a host name
+ * without port, and AT_UNSPEC, AT_INET4 or AT_INET6 as the address type.
+ * Results are returned in order of preference, most preferred first; an
+ * empty result means the name is not known to the backend.
+ *
+ * Backends must be safe to use from multiple threads at once.
+ */
+class LIBERATE_API resolver_backend
+{
+public:
+  virtual ~resolver_backend();
+
+  virtual std::vector<socket_address>
+  lookup(address_type type, std::string const & hostname) = 0;
+};
+
+
+/**
+ * Uses the system resolver, i.e. getaddrinfo(). Results are in the order
+ * the system returns them, which is usually already sorted as per RFC 6724.
+ */
+class LIBERATE_API system_resolver_backend : public resolver_backend
+{
+public:
+  // Note: the api instance is unused, but we need an instance for WSASetup()
+  //       to have occurred.
+  explicit system_resolver_backend(api & api);
+
+  virtual std::vector<socket_address>
+  lookup(address_type type, std::string const & hostname) override;
+};
+
+
+/**
+ * An in-memory table of host names and addresses. Lookups do not involve any
+ * system calls. Host names are case insensitive, and each name may have
+ * multiple addresses; these are kept sorted via sort_by_preference().
+ *
+ * The table may be modified while lookups happen.
+ */
+class LIBERATE_API static_resolver_backend : public resolver_backend
+{
+public:
+  static_resolver_backend();
+  virtual ~static_resolver_backend();
+
+  /**
+   * Add an address for the host name; adding the same address twice has no
+   * effect. Only IPv4 and IPv6 addresses can be added; other addresses
+   * result in std::invalid_argument.
+   */
+  void add(std::string const & hostname, socket_address const & address);
+
+  /**
+   * Remove all addresses of the host name, or all host names.
+   */
+  void remove(std::string const & hostname);
+  void clear();
+
+  /**
+   * The number of host names in the table.
+   */
+  std::size_t size() const;
+
+  virtual std::vector<socket_address>
+  lookup(address_type type, std::string const & hostname) override;
+
+private:
+  static_resolver_backend(static_resolver_backend const &) = delete;
+  static_resolver_backend & operator=(static_resolver_backend const &) = delete;
+
+  struct static_resolver_backend_impl;
+  std::unique_ptr<static_resolver_backend_impl> m_impl;
+};
+
+
+/**
+ * A static_resolver_backend filled from files in the format of /etc/hosts.
+ * Each line contains an address followed by one or more host names; '#'
+ * starts a comment. Lines with addresses that cannot be parsed, such as
+ * IPv6 addresses with a zone index, are skipped.
+ *
+ * The files are parsed once; later changes to them are not picked up unless
+ * they are loaded again.
+ */
+class LIBERATE_API hosts_resolver_backend : public static_resolver_backend
+{
+public:
+  hosts_resolver_backend() = default;
+
+  /**
+   * Add the entries from the given stream or file. Returns the number of
+   * host name entries read. If the file cannot be opened, std::runtime_error is
+   * thrown.
+   */
+  std::size_t load(std::istream & input);
+  std::size_t load_file(std::string const & path = default_path());
+
+  /**
+   * The location of the system's hosts file.
+   */
+  static std::string default_path();
+};
+
+
+/**
+ * Asks each of the given backends in turn, and returns the first non-empty
+ * result. This makes it possible to e.g. answer frequently used names from
+ * a static_resolver_backend, and fall back to the system resolver for all
+ * others.
+ */
+class LIBERATE_API chained_resolver_backend : public resolver_backend
+{
+public:
+  using backend_list = std::vector<std::shared_ptr<resolver_backend>>;
+
+  explicit chained_resolver_backend(backend_list && backends);
+
+  virtual std::vector<socket_address>
+  lookup(address_type type, std::string const & hostname) override;
+
+private:
+  backend_list  m_backends;
+};
+
+} // namespace liberate::net
+
+#endif // guard
@@ -0,0 +1,119 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_RESOLVER_CACHE_H
+#define LIBERATE_NET_RESOLVER_CACHE_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <liberate/net/address_type.h>
+#include <liberate/net/socket_address.h>
+
+namespace liberate::net {
+
+class resolver_backend;
+
+/**
+ * Options for the resolver_cache below.
+ *
+ * - positive_ttl is how long successful lookups are cached.
+ * - negative_ttl is how long lookups without results are cached.
+ * - max_entries bounds the size of the cache; the least recently used
+ *   entries are evicted first.
+ * - now returns the current time; if unset, std::chrono::steady_clock is
+ *   used. This mainly exists for testing.
+ */
+struct LIBERATE_API resolver_cache_options
+{
+  using clock = std::chrono::steady_clock;
+
+  std::chrono::milliseconds           positive_ttl = std::chrono::seconds{60};
+  std::chrono::milliseconds           negative_ttl = std::chrono::seconds{5};
+  std::size_t                         max_entries = 1024;
+  std::function<clock::time_point ()> now = {};
+};
+
+
+/**
+ * Caches the results of resolve() by host name and address type.
+ *
+ * Concurrent lookups of the same name and type are deduplicated: only the
+ * first caller performs the lookup, and all others wait for and share its
+ * result. Errors are reported to all waiting callers, but not cached.
+ *
+ * By default, the cache uses resolve() for lookups; a different backend or
+ * lookup function can be provided, e.g. for testing.
+ *
+ * The cache is thread-safe. Lookups happen without holding its lock, so
+ * that lookups of different names do not block each other.
+ */
+class LIBERATE_API resolver_cache
+{
+public:
+  using result_type = std::vector<socket_address>;
+  using lookup_function = std::function<
+    result_type (address_type, std::string const &)
+  >;
+
+  explicit resolver_cache(api & api,
+      resolver_cache_options const & options = resolver_cache_options{});
+  explicit resolver_cache(resolver_backend & backend,
+      resolver_cache_options const & options = resolver_cache_options{});
+  explicit resolver_cache(lookup_function && lookup,
+      resolver_cache_options const & options = resolver_cache_options{});
+  ~resolver_cache();
+
+  /**
+   * Same as the resolve() function, including the exceptions thrown.
+   */
+  result_type resolve(address_type type, std::string const & hostname);
+
+  /**
+   * Remove a single entry, or all entries from the cache. Lookups in progress
+   * are not affected, but their results will not be cached.
+   */
+  void invalidate(address_type type, std::string const & hostname);
+  void clear();
+
+  /**
+   * The number of cached entries, including lookups in progress.
+   */
+  std::size_t size() const;
+
+private:
+  resolver_cache(resolver_cache const &) = delete;
+  resolver_cache & operator=(resolver_cache const &) = delete;
+
+  struct resolver_cache_impl;
+  std::unique_ptr<resolver_cache_impl> m_impl;
+};
+
+} // namespace liberate::net
+
+#endif // guard
@@ -27,9 +27,9 @@
 #include <liberate.h>
 
 #include <string>
-#include <map>
 
 #include <liberate/cpp/operators/comparison.h>
+#include <liberate/net/query_map.h>
 
 namespace liberate::net {
 
@@ -58,11 +58,11 @@ struct LIBERATE_API url
 {
 public:
   // Data members
-  std::string                         scheme;
-  std::string                         authority;
-  std::string                         path;
-  std::map<std::string, std::string>  query;
-  std::string                         fragment;
+  std::string scheme;
+  std::string authority;
+  std::string path;
+  query_map   query;
+  std::string fragment;
 
   // Static parse functions
   static url parse(char const * url_string);
@@ -0,0 +1,136 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_NET_URL_VIEW_H
+#define LIBERATE_NET_URL_VIEW_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <string>
+#include <string_view>
+#include <optional>
+
+#include <liberate/net/url.h>
+
+namespace liberate::net {
+
+/**
+ * The url_view class splits a URL in the same way as url::parse(), but
+ * does not copy anything. Instead, it keeps views into the original buffer,
+ * which must outlive the url_view.
+ *
+ * Consequently, the component accessors return the *raw* components, i.e.
+ * without lower-casing the scheme or URL decoding anything. Query parameters
+ * are only split, decoded and normalized when they are looked up, and the
+ * lookup itself does not allocate.
+ *
+ * Use to_url() to produce the equivalent url instance, with all of the
+ * normalization applied that url::parse() describes.
+ */
+class LIBERATE_API url_view
+{
+public:
+  url_view() = default;
+
+  /**
+   * Parse the URL string. Throws std::invalid_argument if no scheme can be
+   * found.
+   */
+  static url_view parse(std::string_view url_string);
+
+  /**
+   * Raw components. The query does not include the leading '?', and the
+   * fragment does not include the leading '#'.
+   */
+  inline std::string_view scheme() const { return m_scheme; }
+  inline std::string_view authority() const { return m_authority; }
+  inline std::string_view path() const { return m_path; }
+  inline std::string_view query() const { return m_query; }
+  inline std::string_view fragment() const { return m_fragment; }
+
+  /**
+   * Compare the scheme case-insensitively to the given, lower-case scheme.
+   */
+  bool scheme_is(std::string_view lower_scheme) const;
+
+  /**
+   * Returns true if a query parameter with the given name exists. The name
+   * is compared to the URL decoded, lower-cased parameter names, just as
+   * url::parse() would produce them.
+   */
+  bool has_query(std::string_view key) const;
+
+  /**
+   * Returns the URL decoded, normalized value of the named query parameter,
+   * or nothing if no such parameter exists. As with url::parse(), the last
+   * parameter of the same name wins, and parameters without value are
+   * treated as boolean flags with the value "1".
+   */
+  std::optional<std::string> query_value(std::string_view key) const;
+
+  /**
+   * Iterate over the raw query parameters. The function is invoked with
+   * the raw key and value; for parameters without value, the value is
+   * empty and the third parameter is false. Empty parameters, e.g. produced
+   * by a trailing '&', are skipped.
+   */
+  template <typename funcT>
+  inline void for_each_query(funcT && func) const
+  {
+    auto remaining = m_query;
+    while (!remaining.empty()) {
+      auto end = remaining.find('&');
+      auto param = remaining.substr(0, end);
+      remaining = (end == std::string_view::npos)
+        ? std::string_view{} : remaining.substr(end + 1);
+      if (param.empty()) {
+        continue;
+      }
+
+      auto equal = param.find('=');
+      if (equal == std::string_view::npos) {
+        func(param, std::string_view{}, false);
+      }
+      else {
+        func(param.substr(0, equal), param.substr(equal + 1), true);
+      }
+    }
+  }
+
+  /**
+   * Convert to a url, decoding and normalizing all components.
+   */
+  url to_url() const;
+
+private:
+  std::string_view  m_scheme;
+  std::string_view  m_authority;
+  std::string_view  m_path;
+  std::string_view  m_query;
+  std::string_view  m_fragment;
+};
+
+
+} // namespace liberate::net
+
+#endif // guard
@@ -0,0 +1,377 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_SERIALIZATION_BUFFER_H
+#define LIBERATE_SERIALIZATION_BUFFER_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <liberate/types/byte.h>
+#include <liberate/serialization/integer.h>
+#include <liberate/serialization/varint.h>
+#include <liberate/serialization/schema.h>
+
+namespace liberate::serialization {
+
+/**
+ * A contiguous region of memory. A buffer can consist of several segments,
+ * e.g. a header buffer followed by a separately allocated payload.
+ */
+template <typename byteT>
+struct basic_segment
+{
+  byteT *       data = nullptr;
+  std::size_t   size = 0;
+};
+
+using segment = basic_segment<::liberate::types::byte>;
+using const_segment = basic_segment<::liberate::types::byte const>;
+
+
+/**
+ * Cursors for writing to and reading from buffers.
+ *
+ * Instead of returning the amount of Bytes processed, each operation advances
+ * the cursor and returns it, so that operations can be chained:
+ *
+ *   buffer_writer writer{buf, size};
+ *   writer.write_int(id).write_varint(length).write_bytes(data, length);
+ *   if (!writer) {
+ *     // The buffer was too small.
+ *   }
+ *
+ * The first failing operation sets an error flag, and all subsequent
+ * operations do nothing, so it is sufficient to check for errors once at the
+ * end.
+ *
+ * Both cursors can span several segments; values may straddle segment
+ * boundaries. Values that fit into the current segment are processed in
+ * place, so the common case is as fast as calling the serialization functions
+ * directly. Segments are not copied, and must outlive the cursor.
+ */
+class LIBERATE_API buffer_writer
+{
+public:
+  using byte = ::liberate::types::byte;
+
+  buffer_writer(byte * buffer, std::size_t size);
+  buffer_writer(segment const * segments, std::size_t amount);
+
+  /**
+   * Write values, see serialize_int(), serialize_varint() and
+   * serialize_struct().
+   */
+  template <typename T>
+  inline buffer_writer &
+  write_int(T const & value)
+  {
+    if (!m_error && sizeof(T) <= space()) {
+      detail::serialize_int_fast(current(), sizeof(T), value);
+      m_cur += sizeof(T);
+      return *this;
+    }
+
+    std::uint8_t tmp[sizeof(T)];
+    detail::serialize_int_fast(tmp, sizeof(tmp), value);
+    return write_slow(tmp, sizeof(tmp));
+  }
+
+  template <typename formatT = varint_continuation>
+  inline buffer_writer &
+  write_varint(::liberate::types::varint const & value)
+  {
+    if (!m_error && VARINT_MAX_BUFSIZE <= space()) {
+      auto written = serialize_varint<formatT>(current(), space(), value);
+      if (!written) {
+        return fail();
+      }
+      m_cur += written;
+      return *this;
+    }
+
+    if (m_error) {
+      return *this;
+    }
+    std::uint8_t tmp[VARINT_MAX_BUFSIZE];
+    auto written = serialize_varint<formatT>(tmp, sizeof(tmp), value);
+    if (!written) {
+      return fail();
+    }
+    return write_slow(tmp, written);
+  }
+
+  template <typename structT>
+  inline buffer_writer &
+  write_struct(structT const & value)
+  {
+    using schema_type = typename structT::serialization_schema;
+
+    if (!m_error && schema_type::MAX_SIZE <= space()) {
+      auto written = schema_type::write_all(current(), value);
+      if (!written) {
+        return fail();
+      }
+      m_cur += written;
+      return *this;
+    }
+
+    if (m_error) {
+      return *this;
+    }
+    std::vector<std::uint8_t> tmp(schema_type::serialized_size(value));
+    auto written = schema_type::serialize(tmp.data(), tmp.size(), value);
+    if (!written) {
+      return fail();
+    }
+    return write_slow(tmp.data(), written);
+  }
+
+  /**
+   * Copy raw Bytes.
+   */
+  inline buffer_writer &
+  write_bytes(void const * data, std::size_t size)
+  {
+    return write_slow(data, size);
+  }
+
+  /**
+   * Bytes written so far, and available space in total.
+   */
+  inline std::size_t written() const
+  {
+    return m_done + static_cast<std::size_t>(m_cur - m_start);
+  }
+
+  inline std::size_t remaining() const
+  {
+    return m_capacity - written();
+  }
+
+  /**
+   * Error state; once set, it is only reset by reset().
+   */
+  inline bool ok() const { return !m_error; }
+  inline explicit operator bool() const { return !m_error; }
+
+  /**
+   * Rewind to the start of the buffer and clear the error state.
+   */
+  void reset();
+
+private:
+  inline std::size_t space() const
+  {
+    return static_cast<std::size_t>(m_end - m_cur);
+  }
+
+  inline std::uint8_t * current()
+  {
+    return reinterpret_cast<std::uint8_t *>(m_cur);
+  }
+
+  buffer_writer & write_slow(void const * data, std::size_t size);
+  buffer_writer & fail();
+  void enter_segment(std::size_t index);
+
+  // A single buffer is kept in m_single, so that copies remain valid.
+  segment         m_single;
+  segment const * m_segments = nullptr;
+  std::size_t     m_amount = 1;
+  std::size_t     m_index = 0;
+  std::size_t     m_capacity = 0;
+  std::size_t     m_done = 0;
+  byte *          m_start = nullptr;
+  byte *          m_cur = nullptr;
+  byte *          m_end = nullptr;
+  bool            m_error = false;
+};
+
+
+
+class LIBERATE_API buffer_reader
+{
+public:
+  using byte = ::liberate::types::byte;
+
+  buffer_reader(byte const * buffer, std::size_t size);
+  buffer_reader(const_segment const * segments, std::size_t amount);
+
+  /**
+   * Read values, see deserialize_int(), deserialize_varint() and
+   * deserialize_struct().
+   */
+  template <typename T>
+  inline buffer_reader &
+  read_int(T & value)
+  {
+    if (!m_error && sizeof(T) <= space()) {
+      detail::deserialize_int_fast(value, current(), sizeof(T));
+      m_cur += sizeof(T);
+      return *this;
+    }
+
+    std::uint8_t tmp[sizeof(T)];
+    if (read_slow(tmp, sizeof(tmp))) {
+      detail::deserialize_int_fast(value, tmp, sizeof(tmp));
+    }
+    return *this;
+  }
+
+  template <typename formatT = varint_continuation>
+  inline buffer_reader &
+  read_varint(::liberate::types::varint & value)
+  {
+    if (!m_error && VARINT_MAX_BUFSIZE <= space()) {
+      return advance(deserialize_varint<formatT>(value, current(), space()));
+    }
+
+    if (m_error) {
+      return *this;
+    }
+    std::uint8_t tmp[VARINT_MAX_BUFSIZE];
+    auto available = peek(tmp, sizeof(tmp));
+    return skip_checked(deserialize_varint<formatT>(value, tmp, available));
+  }
+
+  template <typename structT>
+  inline buffer_reader &
+  read_struct(structT & value)
+  {
+    using schema_type = typename structT::serialization_schema;
+
+    if (!m_error && schema_type::MAX_SIZE <= space()) {
+      return advance(schema_type::template read_all<false>(value, current(),
+            space()));
+    }
+
+    if (m_error) {
+      return *this;
+    }
+    std::vector<std::uint8_t> tmp(schema_type::MAX_SIZE);
+    auto available = peek(tmp.data(), tmp.size());
+    return skip_checked(schema_type::deserialize(value, tmp.data(),
+          available));
+  }
+
+  /**
+   * Copy raw Bytes.
+   */
+  inline buffer_reader &
+  read_bytes(void * data, std::size_t size)
+  {
+    read_slow(data, size);
+    return *this;
+  }
+
+  /**
+   * Zero-copy access to the next size Bytes, which must be contiguous, i.e.
+   * not straddle a segment boundary. On success, view points into the
+   * buffer.
+   */
+  buffer_reader & read_view(byte const * & view, std::size_t size);
+
+  /**
+   * Skip the given amount of Bytes.
+   */
+  buffer_reader & skip(std::size_t size);
+
+  /**
+   * Bytes consumed so far, and those left to read.
+   */
+  inline std::size_t consumed() const
+  {
+    return m_done + static_cast<std::size_t>(m_cur - m_start);
+  }
+
+  inline std::size_t remaining() const
+  {
+    return m_capacity - consumed();
+  }
+
+  /**
+   * Error state; once set, it is only reset by reset().
+   */
+  inline bool ok() const { return !m_error; }
+  inline explicit operator bool() const { return !m_error; }
+
+  /**
+   * Rewind to the start of the buffer and clear the error state.
+   */
+  void reset();
+
+private:
+  inline std::size_t space() const
+  {
+    return static_cast<std::size_t>(m_end - m_cur);
+  }
+
+  inline std::uint8_t const * current() const
+  {
+    return reinterpret_cast<std::uint8_t const *>(m_cur);
+  }
+
+  // Advance within the current segment; zero means failure.
+  inline buffer_reader & advance(std::size_t size)
+  {
+    if (!size) {
+      return fail();
+    }
+    m_cur += size;
+    return *this;
+  }
+
+  // Skip across segments; zero means failure.
+  inline buffer_reader & skip_checked(std::size_t size)
+  {
+    if (!size) {
+      return fail();
+    }
+    return skip(size);
+  }
+
+  bool read_slow(void * data, std::size_t size);
+  std::size_t peek(void * data, std::size_t size) const;
+  buffer_reader & fail();
+  void enter_segment(std::size_t index);
+
+  // A single buffer is kept in m_single, so that copies remain valid.
+  const_segment         m_single;
+  const_segment const * m_segments = nullptr;
+  std::size_t           m_amount = 1;
+  std::size_t           m_index = 0;
+  std::size_t           m_capacity = 0;
+  std::size_t           m_done = 0;
+  byte const *          m_start = nullptr;
+  byte const *          m_cur = nullptr;
+  byte const *          m_end = nullptr;
+  bool                  m_error = false;
+};
+
+} // namespace liberate::serialization
+
+#endif // guard
@@ -27,10 +27,39 @@
 #include <liberate.h>
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <type_traits>
 
 #include <liberate/types/type_traits.h>
 
+/**
+ * Serialized integers are big-endian. Library code knows the host byte order
+ * from the build configuration; elsewhere, we ask the compiler. MSVC only
+ * targets little-endian platforms.
+ */
+#if defined(LIBERATE_BIGENDIAN) \
+  || (defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) \
+      && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#  define LIBERATE_SERIALIZATION_HOST_BIGENDIAN
+#endif
+
+#if defined(_MSC_VER)
+#  include <stdlib.h>
+#endif
+
+/**
+ * The fast paths below use memcpy and intrinsics, which cannot be evaluated at
+ * compile time. Where the compiler can tell, constant evaluation uses the
+ * generic implementation instead; otherwise, the generic implementation is
+ * always used.
+ */
+#if (defined(__clang__) && __clang_major__ >= 9) \
+  || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 9) \
+  || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#  define LIBERATE_SERIALIZATION_FAST_INT
+#endif
+
 namespace liberate::serialization {
 
 /**
@@ -142,6 +171,146 @@ deserialize_int_impl(outT & output, inT const * input, std::size_t input_length)
 }
 
 
+/**
+ * Unsigned integer types by size, and Byte swapping for them.
+ */
+template <std::size_t SIZE>
+struct unsigned_of_size {};
+
+template <> struct unsigned_of_size<1> { using type = std::uint8_t; };
+template <> struct unsigned_of_size<2> { using type = std::uint16_t; };
+template <> struct unsigned_of_size<4> { using type = std::uint32_t; };
+template <> struct unsigned_of_size<8> { using type = std::uint64_t; };
+
+template <typename T>
+using unsigned_of_size_t = typename unsigned_of_size<sizeof(T)>::type;
+
+
+inline std::uint8_t
+byte_swap(std::uint8_t value)
+{
+  return value;
+}
+
+
+inline std::uint16_t
+byte_swap(std::uint16_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_ushort(value);
+#else
+  return __builtin_bswap16(value);
+#endif
+}
+
+
+inline std::uint32_t
+byte_swap(std::uint32_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_ulong(value);
+#else
+  return __builtin_bswap32(value);
+#endif
+}
+
+
+inline std::uint64_t
+byte_swap(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
+
+/**
+ * Generic deserialization from 8-bit buffers. Unlike deserialize_int_impl(),
+ * this reads the Bytes as unsigned, so the result matches the fast path below
+ * for char buffers with the high bit set.
+ */
+template <typename outT, typename inT>
+constexpr integer_serialization_enabled<outT>
+deserialize_int_bytes(outT & output, inT const * input,
+    std::size_t input_length)
+{
+  if (!input || input_length < sizeof(outT)) {
+    return 0;
+  }
+
+  unsigned_of_size_t<outT> tmp = 0;
+  for (std::size_t i = 0 ; i < sizeof(outT) ; ++i) {
+    tmp = static_cast<unsigned_of_size_t<outT>>((tmp << 8)
+        | static_cast<std::uint8_t>(input[i]));
+  }
+  output = static_cast<outT>(tmp);
+  return sizeof(outT);
+}
+
+
+/**
+ * Convert between host and big-endian byte order; the conversion is its own
+ * inverse.
+ */
+template <typename T>
+inline T
+to_big_endian(T value)
+{
+#if defined(LIBERATE_SERIALIZATION_HOST_BIGENDIAN)
+  return value;
+#else
+  return byte_swap(value);
+#endif
+}
+
+
+/**
+ * For 8-bit buffers, copying the value in one go and swapping Bytes is much
+ * faster than shifting out one Byte at a time.
+ */
+template <typename inT>
+inline integer_serialization_enabled<inT>
+serialize_int_fast(std::uint8_t * output, std::size_t output_length,
+    inT const & value)
+{
+  if (!output || output_length < sizeof(inT)) {
+    return 0;
+  }
+
+  auto tmp = to_big_endian(static_cast<unsigned_of_size_t<inT>>(value));
+  std::memcpy(output, &tmp, sizeof(tmp));
+  return sizeof(tmp);
+}
+
+
+template <typename outT>
+inline integer_serialization_enabled<outT>
+deserialize_int_fast(outT & output, std::uint8_t const * input,
+    std::size_t input_length)
+{
+  if (!input || input_length < sizeof(outT)) {
+    return 0;
+  }
+
+  unsigned_of_size_t<outT> tmp;
+  std::memcpy(&tmp, input, sizeof(tmp));
+  output = static_cast<outT>(to_big_endian(tmp));
+  return sizeof(tmp);
+}
+
+
+/**
+ * Copy amount integers of width Bytes each, converting between host and
+ * big-endian byte order. Widths of 2, 4 and 8 are vectorized where SIMD is
+ * available.
+ */
+LIBERATE_API
+void
+convert_byte_order(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t amount, std::size_t width);
+
 } // namespace detail
 
 /**
@@ -166,6 +335,12 @@ template <
 constexpr integer_serialization_enabled<inT>
 serialize_int(outT * output, std::size_t output_length, inT const & value)
 {
+#if defined(LIBERATE_SERIALIZATION_FAST_INT)
+  if (!__builtin_is_constant_evaluated()) {
+    return detail::serialize_int_fast(reinterpret_cast<std::uint8_t *>(output),
+        output_length, value);
+  }
+#endif
   return detail::serialize_int_impl(output, output_length, value);
 }
 
@@ -192,7 +367,68 @@ template <
 constexpr integer_serialization_enabled<outT>
 deserialize_int(outT & output, inT const * input, std::size_t const & input_length)
 {
-  return detail::deserialize_int_impl(output, input, input_length);
+#if defined(LIBERATE_SERIALIZATION_FAST_INT)
+  if (!__builtin_is_constant_evaluated()) {
+    return detail::deserialize_int_fast(output,
+        reinterpret_cast<std::uint8_t const *>(input), input_length);
+  }
+#endif
+  return detail::deserialize_int_bytes(output, input, input_length);
+}
+
+
+/**
+ * Bulk variants of the above, for arrays of integers serialized back to back.
+ *
+ * serialize_ints() returns the number of units written, and deserialize_ints()
+ * the number of units consumed. Both return zero if the buffer is too small
+ * for the given amount of values.
+ */
+template <
+  typename outT,
+  typename inT,
+  std::enable_if_t<liberate::types::is_8bit_type<outT>::value, int> = 0
+>
+inline integer_serialization_enabled<inT>
+serialize_ints(outT * output, std::size_t output_length, inT const * values,
+    std::size_t amount)
+{
+  if (!output || !values) {
+    return 0;
+  }
+
+  auto required = amount * sizeof(inT);
+  if (output_length < required) {
+    return 0;
+  }
+
+  detail::convert_byte_order(reinterpret_cast<std::uint8_t *>(output),
+      reinterpret_cast<std::uint8_t const *>(values), amount, sizeof(inT));
+  return required;
+}
+
+
+template <
+  typename outT,
+  typename inT,
+  std::enable_if_t<liberate::types::is_8bit_type<inT>::value, int> = 0
+>
+inline integer_serialization_enabled<outT>
+deserialize_ints(outT * values, std::size_t amount, inT const * input,
+    std::size_t input_length)
+{
+  if (!values || !input) {
+    return 0;
+  }
+
+  auto required = amount * sizeof(outT);
+  if (input_length < required) {
+    return 0;
+  }
+
+  detail::convert_byte_order(reinterpret_cast<std::uint8_t *>(values),
+      reinterpret_cast<std::uint8_t const *>(input), amount, sizeof(outT));
+  return required;
 }
 
 } // namespace liberate::serialization
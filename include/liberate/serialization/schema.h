@@ -0,0 +1,504 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_SERIALIZATION_SCHEMA_H
+#define LIBERATE_SERIALIZATION_SCHEMA_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <liberate.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <liberate/types/byte.h>
+#include <liberate/types/type_traits.h>
+#include <liberate/serialization/integer.h>
+#include <liberate/serialization/varint.h>
+#include <liberate/net/socket_address.h>
+
+/**
+ * Schema-driven serialization of structs.
+ *
+ * Instead of hand-writing a sequence of serialize_int(), serialize_varint()
+ * and similar calls, each with its own bounds check, a struct declares its
+ * fields in order:
+ *
+ *   struct message
+ *   {
+ *     uint16_t                          id;
+ *     liberate::types::varint           sequence;
+ *     liberate::net::socket_address     peer;
+ *     std::vector<liberate::types::byte> payload;
+ *
+ *     using serialization_schema = liberate::serialization::schema<
+ *       liberate::serialization::int_field<&message::id>,
+ *       liberate::serialization::varint_field<&message::sequence>,
+ *       liberate::serialization::address_field<&message::peer>,
+ *       liberate::serialization::bytes_field<&message::payload, 1024>
+ *     >;
+ *   };
+ *
+ * The schema knows the minimum and maximum serialized size at compile time.
+ * Serializing checks the buffer size once, and then writes all fields
+ * without further checks. Deserializing skips the checks on fixed size
+ * fields if the buffer can hold the maximum size; variable size fields are
+ * validated as they are decoded.
+ *
+ * Use serialize_struct(), deserialize_struct() and serialized_size_struct()
+ * with such a struct, or the schema's static functions directly.
+ */
+namespace liberate::serialization {
+
+namespace detail {
+
+template <typename T>
+struct member_pointer_traits {};
+
+template <typename classT, typename memberT>
+struct member_pointer_traits<memberT classT::*>
+{
+  using class_type = classT;
+  using member_type = memberT;
+};
+
+template <auto MEMBER>
+using member_type_t = typename member_pointer_traits<
+  decltype(MEMBER)>::member_type;
+
+
+/**
+ * Upper bound for the serialized size of a varint with the given value,
+ * usable at compile time.
+ */
+constexpr std::size_t
+varint_size_bound(std::uint64_t value)
+{
+  std::size_t ret = 1;
+  while (ret < VARINT_MAX_BUFSIZE && value >= VARINT_THRESHOLDS[ret]) {
+    ++ret;
+  }
+  return ret;
+}
+
+} // namespace detail
+
+
+/**
+ * Field descriptors. Each takes a pointer to the struct member it describes.
+ *
+ * Field descriptors provide MIN_SIZE and MAX_SIZE, and the size(), write()
+ * and read() functions. write() assumes that the buffer is large enough for
+ * size(), and returns the number of Bytes written, or zero on error. read()
+ * returns the number of Bytes consumed, or zero on error; bounds checks are
+ * only skipped if CHECKED is false, in which case the buffer must hold at
+ * least MAX_SIZE Bytes.
+ */
+
+/**
+ * Integers for which serialize_int() is enabled, in big-endian order.
+ */
+template <auto MEMBER>
+struct int_field
+{
+  using member_type = detail::member_type_t<MEMBER>;
+  using value_type = std::remove_cv_t<member_type>;
+  using size_type = integer_serialization_enabled<value_type>;
+
+  static constexpr size_type MIN_SIZE = sizeof(value_type);
+  static constexpr size_type MAX_SIZE = sizeof(value_type);
+
+  template <typename structT>
+  static inline std::size_t
+  size(structT const &)
+  {
+    return sizeof(value_type);
+  }
+
+  template <typename structT>
+  static inline std::size_t
+  write(std::uint8_t * output, structT const & value)
+  {
+    auto tmp = detail::to_big_endian(
+        static_cast<detail::unsigned_of_size_t<value_type>>(value.*MEMBER));
+    std::memcpy(output, &tmp, sizeof(tmp));
+    return sizeof(tmp);
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read(structT & value, std::uint8_t const * input, std::size_t input_length)
+  {
+    if constexpr (CHECKED) {
+      if (input_length < sizeof(value_type)) {
+        return 0;
+      }
+    }
+    detail::unsigned_of_size_t<value_type> tmp;
+    std::memcpy(&tmp, input, sizeof(tmp));
+    value.*MEMBER = static_cast<value_type>(detail::to_big_endian(tmp));
+    return sizeof(tmp);
+  }
+};
+
+
+/**
+ * Varints in any of the formats in varint.h.
+ */
+template <auto MEMBER, typename formatT = varint_continuation>
+struct varint_field
+{
+  static_assert(std::is_same_v<detail::member_type_t<MEMBER>,
+      ::liberate::types::varint>, "varint_field requires a varint member.");
+
+  static constexpr std::size_t MIN_SIZE = 1;
+  static constexpr std::size_t MAX_SIZE = VARINT_MAX_BUFSIZE;
+
+  template <typename structT>
+  static inline std::size_t
+  size(structT const & value)
+  {
+    return serialized_size<formatT>(value.*MEMBER);
+  }
+
+  template <typename structT>
+  static inline std::size_t
+  write(std::uint8_t * output, structT const & value)
+  {
+    return serialize_varint<formatT>(output, MAX_SIZE, value.*MEMBER);
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read(structT & value, std::uint8_t const * input, std::size_t input_length)
+  {
+    return deserialize_varint<formatT>(value.*MEMBER, input, input_length);
+  }
+};
+
+
+/**
+ * IPv4 and IPv6 socket addresses, including their type and optionally the
+ * port. See socket_address::serialize().
+ */
+template <auto MEMBER, bool WITH_PORT = true>
+struct address_field
+{
+  static_assert(std::is_same_v<detail::member_type_t<MEMBER>,
+      ::liberate::net::socket_address>,
+      "address_field requires a socket_address member.");
+
+  // Type, then four or sixteen Bytes of address, then the port.
+  static constexpr std::size_t PORT_SIZE = WITH_PORT ? 2 : 0;
+  static constexpr std::size_t MIN_SIZE = 1 + 4 + PORT_SIZE;
+  static constexpr std::size_t MAX_SIZE = 1 + 16 + PORT_SIZE;
+
+  template <typename structT>
+  static inline std::size_t
+  size(structT const & value)
+  {
+    return (value.*MEMBER).min_bufsize(true, WITH_PORT);
+  }
+
+  template <typename structT>
+  static inline std::size_t
+  write(std::uint8_t * output, structT const & value)
+  {
+    return (value.*MEMBER).serialize(output, MAX_SIZE, true, WITH_PORT);
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read(structT & value, std::uint8_t const * input, std::size_t input_length)
+  {
+    auto [used, addr] = ::liberate::net::socket_address::deserialize(input,
+        input_length, WITH_PORT);
+    if (used) {
+      value.*MEMBER = addr;
+    }
+    return used;
+  }
+};
+
+
+/**
+ * Byte buffers of up to MAX_LENGTH Bytes, prefixed with their length as a
+ * varint. Longer buffers fail to serialize or deserialize.
+ */
+template <auto MEMBER, std::size_t MAX_LENGTH>
+struct bytes_field
+{
+  static_assert(std::is_same_v<detail::member_type_t<MEMBER>,
+      std::vector<::liberate::types::byte>>,
+      "bytes_field requires a std::vector<liberate::types::byte> member.");
+
+  static constexpr std::size_t MIN_SIZE = 1;
+  static constexpr std::size_t MAX_SIZE = detail::varint_size_bound(MAX_LENGTH)
+    + MAX_LENGTH;
+
+  template <typename structT>
+  static inline std::size_t
+  size(structT const & value)
+  {
+    auto length = (value.*MEMBER).size();
+    return serialized_size(static_cast<::liberate::types::varint>(length))
+      + length;
+  }
+
+  template <typename structT>
+  static inline std::size_t
+  write(std::uint8_t * output, structT const & value)
+  {
+    auto const & buf = value.*MEMBER;
+    if (buf.size() > MAX_LENGTH) {
+      return 0;
+    }
+
+    auto used = serialize_varint(output, MAX_SIZE,
+        static_cast<::liberate::types::varint>(buf.size()));
+    if (!buf.empty()) {
+      std::memcpy(output + used, buf.data(), buf.size());
+    }
+    return used + buf.size();
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read(structT & value, std::uint8_t const * input, std::size_t input_length)
+  {
+    ::liberate::types::varint length{0};
+    auto used = deserialize_varint(length, input, input_length);
+    if (!used) {
+      return 0;
+    }
+
+    auto size = static_cast<std::size_t>(length);
+    if (static_cast<::liberate::types::varint_base>(length) < 0
+        || size > MAX_LENGTH || size > input_length - used)
+    {
+      return 0;
+    }
+
+    auto start = reinterpret_cast<::liberate::types::byte const *>(
+        input + used);
+    (value.*MEMBER).assign(start, start + size);
+    return used + size;
+  }
+};
+
+
+/**
+ * Nested structs with their own serialization_schema.
+ */
+template <auto MEMBER>
+struct struct_field
+{
+  using member_schema =
+    typename detail::member_type_t<MEMBER>::serialization_schema;
+
+  static constexpr std::size_t MIN_SIZE = member_schema::MIN_SIZE;
+  static constexpr std::size_t MAX_SIZE = member_schema::MAX_SIZE;
+
+  template <typename structT>
+  static inline std::size_t
+  size(structT const & value)
+  {
+    return member_schema::serialized_size(value.*MEMBER);
+  }
+
+  template <typename structT>
+  static inline std::size_t
+  write(std::uint8_t * output, structT const & value)
+  {
+    return member_schema::write_all(output, value.*MEMBER);
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read(structT & value, std::uint8_t const * input, std::size_t input_length)
+  {
+    return member_schema::template read_all<CHECKED>(value.*MEMBER, input,
+        input_length);
+  }
+};
+
+
+/**
+ * The schema itself, composed of field descriptors in serialization order.
+ */
+template <typename... fieldsT>
+struct schema
+{
+  static constexpr std::size_t MIN_SIZE = (fieldsT::MIN_SIZE + ... + 0);
+  static constexpr std::size_t MAX_SIZE = (fieldsT::MAX_SIZE + ... + 0);
+
+  /**
+   * Exact serialized size of the value.
+   */
+  template <typename structT>
+  static inline std::size_t
+  serialized_size(structT const & value)
+  {
+    return (fieldsT::size(value) + ... + 0);
+  }
+
+  /**
+   * Serialize to buffer. Returns the number of units written, or zero if the
+   * buffer is too small or a field cannot be serialized.
+   */
+  template <
+    typename outT,
+    typename structT,
+    std::enable_if_t<liberate::types::is_8bit_type<outT>::value, int> = 0
+  >
+  static inline std::size_t
+  serialize(outT * output, std::size_t output_length, structT const & value)
+  {
+    if (!output) {
+      return 0;
+    }
+    // Only compute the exact size if the buffer might be too small.
+    if (output_length < MAX_SIZE && output_length < serialized_size(value)) {
+      return 0;
+    }
+    return write_all(reinterpret_cast<std::uint8_t *>(output), value);
+  }
+
+  /**
+   * Deserialize from buffer. Returns the number of units consumed, or zero if
+   * decoding failed; the value may then be partially modified.
+   */
+  template <
+    typename structT,
+    typename inT,
+    std::enable_if_t<liberate::types::is_8bit_type<inT>::value, int> = 0
+  >
+  static inline std::size_t
+  deserialize(structT & value, inT const * input, std::size_t input_length)
+  {
+    if (!input || input_length < MIN_SIZE) {
+      return 0;
+    }
+    auto buf = reinterpret_cast<std::uint8_t const *>(input);
+    if (input_length >= MAX_SIZE) {
+      return read_all<false>(value, buf, input_length);
+    }
+    return read_all<true>(value, buf, input_length);
+  }
+
+
+  /**
+   * Unchecked building blocks of the above.
+   */
+  template <typename structT>
+  static inline std::size_t
+  write_all(std::uint8_t * output, structT const & value)
+  {
+    std::size_t offset = 0;
+    bool ok = (write_one<fieldsT>(output, offset, value) && ...);
+    return ok ? offset : 0;
+  }
+
+  template <bool CHECKED, typename structT>
+  static inline std::size_t
+  read_all(structT & value, std::uint8_t const * input,
+      std::size_t input_length)
+  {
+    std::size_t offset = 0;
+    bool ok = (read_one<fieldsT, CHECKED>(value, input, input_length, offset)
+        && ...);
+    return ok ? offset : 0;
+  }
+
+private:
+  template <typename fieldT, typename structT>
+  static inline bool
+  write_one(std::uint8_t * output, std::size_t & offset,
+      structT const & value)
+  {
+    auto written = fieldT::write(output + offset, value);
+    offset += written;
+    return written > 0;
+  }
+
+  template <typename fieldT, bool CHECKED, typename structT>
+  static inline bool
+  read_one(structT & value, std::uint8_t const * input,
+      std::size_t input_length, std::size_t & offset)
+  {
+    auto read = fieldT::template read<CHECKED>(value, input + offset,
+        input_length - offset);
+    offset += read;
+    return read > 0;
+  }
+};
+
+
+/**
+ * Convenience functions for structs that declare a serialization_schema.
+ */
+template <typename structT>
+constexpr std::size_t max_serialized_size_v =
+  structT::serialization_schema::MAX_SIZE;
+
+
+template <typename structT>
+inline std::size_t
+serialized_size_struct(structT const & value)
+{
+  return structT::serialization_schema::serialized_size(value);
+}
+
+
+template <
+  typename outT,
+  typename structT,
+  std::enable_if_t<liberate::types::is_8bit_type<outT>::value, int> = 0
+>
+inline std::size_t
+serialize_struct(outT * output, std::size_t output_length,
+    structT const & value)
+{
+  return structT::serialization_schema::serialize(output, output_length,
+      value);
+}
+
+
+template <
+  typename structT,
+  typename inT,
+  std::enable_if_t<liberate::types::is_8bit_type<inT>::value, int> = 0
+>
+inline std::size_t
+deserialize_struct(structT & value, inT const * input,
+    std::size_t input_length)
+{
+  return structT::serialization_schema::deserialize(value, input,
+      input_length);
+}
+
+} // namespace liberate::serialization
+
+#endif // guard
@@ -26,6 +26,7 @@
 
 #include <liberate.h>
 
+#include <cstdint>
 #include <cstring>
 
 #include <type_traits>
@@ -50,6 +51,56 @@ constexpr std::size_t ceil(double input)
     : static_cast<std::size_t>(input) + ((input > 0) ? 1 : 0);
 }
 
+/**
+ * The number of significant bits in the value.
+ */
+inline int
+bit_width(std::uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return value ? 64 - __builtin_clzll(value) : 0;
+#else
+  int ret = 0;
+  for ( ; value ; value >>= 1, ++ret) {} //!OCLINT
+  return ret;
+#endif
+}
+
+/**
+ * Each continuation Byte in the encoding adds one to the value it carries.
+ * As a result, the smallest value requiring N + 1 Bytes is the sum of 128^k
+ * for k = 1..N, listed here by N.
+ */
+constexpr std::uint64_t VARINT_THRESHOLDS[] = {
+  0ULL,
+  128ULL,
+  16512ULL,
+  2113664ULL,
+  270549120ULL,
+  34630287488ULL,
+  4432676798592ULL,
+  567382630219904ULL,
+  72624976668147840ULL,
+  9295997013522923648ULL,
+};
+
+/**
+ * Serialized size of an unsigned value in the continuation format.
+ */
+inline std::size_t
+continuation_size(std::uint64_t value)
+{
+  // Seven bits per Byte, but the offsets added by continuation Bytes can
+  // save a Byte just above the power of 128. Unsigned arithmetic throughout
+  // keeps -Wstrict-overflow quiet in optimized builds.
+  if (!value) {
+    return 1;
+  }
+  auto width = static_cast<std::size_t>(bit_width(value));
+  std::size_t result = 1 + (width - 1) / 7;
+  return result - std::size_t{value < VARINT_THRESHOLDS[result - 1]};
+}
+
 } // namespace detail
 
 /**
@@ -65,13 +116,8 @@ constexpr std::size_t const VARINT_MAX_BUFSIZE = detail::ceil(
 inline std::size_t
 serialized_size(::liberate::types::varint const & value)
 {
-  auto input = static_cast<liberate::types::varint_base>(value);
-  std::size_t result = 1;
-
-  while (input >>= 7) {
-    ++result;
-  }
-  return result;
+  return detail::continuation_size(static_cast<std::uint64_t>(
+      static_cast<liberate::types::varint_base>(value)));
 }
 
 /**
@@ -158,13 +204,13 @@ deserialize_varint(::liberate::types::varint & value, inT const * input, std::si
       // Overflow
       return 0;
     }
-    c = *buf++;
-    val = (val << 7) + static_cast<varint_base>((c & static_cast<inT>(127)));
-
     if (static_cast<std::size_t>(buf - input) >= input_length) {
       // Not done decoding, but the buffer ends
       return 0;
     }
+
+    c = *buf++;
+    val = (val << 7) + static_cast<varint_base>((c & static_cast<inT>(127)));
   }
 
   value = liberate::types::varint{val};
@@ -172,6 +218,363 @@ deserialize_varint(::liberate::types::varint & value, inT const * input, std::si
 }
 
 
+/**
+ * Alternative formats. The functions above use the continuation format,
+ * which is also available via the varint_continuation tag. Each format tag
+ * can be passed as the first template parameter of serialized_size(),
+ * serialize_varint() and deserialize_varint(), e.g.:
+ *
+ *   auto written = serialize_varint<varint_zigzag>(buf, size, value);
+ *
+ * - varint_continuation: big-endian groups of seven bits, where the high bit
+ *   of each Byte marks that another Byte follows. Negative values cannot be
+ *   serialized.
+ * - varint_zigzag: maps signed values to unsigned ones first, so that values
+ *   of small magnitude take few Bytes regardless of sign, i.e. 0, -1, 1, -2,
+ *   ... become 0, 1, 2, 3, ... The result is serialized in the continuation
+ *   format.
+ * - varint_prefix: the number of leading one bits in the first Byte, plus one,
+ *   is the encoded length, as in UTF-8. The remaining bits of the first Byte
+ *   and all following Bytes hold the value in big-endian order. Up to eight
+ *   Bytes carry seven bits each; a first Byte of 0xff is followed by the full
+ *   64 bits of the value. Decoding needs to look at the first Byte only once,
+ *   and then reads the whole value in a single load. The value's two's
+ *   complement bits are encoded, so negative values take nine Bytes.
+ */
+struct varint_continuation {};
+struct varint_zigzag {};
+struct varint_prefix {};
+
+namespace detail {
+
+/**
+ * Big-endian loads and stores of 64 bit values. Compilers turn these into a
+ * single, possibly Byte-swapping, unaligned load or store.
+ */
+inline std::uint64_t
+load_be64(std::uint8_t const * input)
+{
+  return (static_cast<std::uint64_t>(input[0]) << 56)
+    | (static_cast<std::uint64_t>(input[1]) << 48)
+    | (static_cast<std::uint64_t>(input[2]) << 40)
+    | (static_cast<std::uint64_t>(input[3]) << 32)
+    | (static_cast<std::uint64_t>(input[4]) << 24)
+    | (static_cast<std::uint64_t>(input[5]) << 16)
+    | (static_cast<std::uint64_t>(input[6]) << 8)
+    | static_cast<std::uint64_t>(input[7]);
+}
+
+
+inline void
+store_be64(std::uint8_t * output, std::uint64_t value)
+{
+  for (std::size_t i = 0 ; i < 8 ; ++i) {
+    output[i] = static_cast<std::uint8_t>(value >> (56 - i * 8));
+  }
+}
+
+
+/**
+ * Continuation format for the full unsigned 64 bit range.
+ */
+inline std::size_t
+serialize_continuation(std::uint8_t * output, std::size_t output_length,
+    std::uint64_t value)
+{
+  auto required = continuation_size(value);
+  if (output_length < required) {
+    return 0;
+  }
+
+  // Start at the end
+  std::size_t offset = required - 1;
+  output[offset] = static_cast<std::uint8_t>(value & 127);
+  while (offset > 0) {
+    value = (value >> 7) - 1;
+    output[--offset] = static_cast<std::uint8_t>(128 | (value & 127));
+  }
+  return required;
+}
+
+
+inline std::size_t
+deserialize_continuation(std::uint64_t & value, std::uint8_t const * input,
+    std::size_t input_length)
+{
+  std::size_t offset = 0;
+  std::uint8_t c = input[offset++];
+  std::uint64_t val = c & 127;
+  while (c & 128) {
+    if (val >= (std::numeric_limits<std::uint64_t>::max() >> 7)) {
+      // Overflow
+      return 0;
+    }
+    if (offset >= input_length) {
+      // Not done decoding, but the buffer ends
+      return 0;
+    }
+
+    c = input[offset++];
+    val = ((val + 1) << 7) | (c & 127);
+  }
+
+  value = val;
+  return offset;
+}
+
+
+/**
+ * Codecs for each format; all of them operate on non-empty buffers only.
+ */
+template <typename formatT>
+struct varint_codec;
+
+template <>
+struct varint_codec<varint_continuation>
+{
+  static inline std::size_t
+  size(liberate::types::varint const & value)
+  {
+    return serialized_size(value);
+  }
+
+  static inline std::size_t
+  serialize(std::uint8_t * output, std::size_t output_length,
+      liberate::types::varint const & value)
+  {
+    return serialize_varint(output, output_length, value);
+  }
+
+  static inline std::size_t
+  deserialize(liberate::types::varint & value, std::uint8_t const * input,
+      std::size_t input_length)
+  {
+    return deserialize_varint(value, input, input_length);
+  }
+};
+
+
+template <>
+struct varint_codec<varint_zigzag>
+{
+  static inline std::uint64_t
+  encode(liberate::types::varint const & value)
+  {
+    auto input = static_cast<liberate::types::varint_base>(value);
+    return (static_cast<std::uint64_t>(input) << 1)
+      ^ static_cast<std::uint64_t>(input >> 63);
+  }
+
+  static inline std::size_t
+  size(liberate::types::varint const & value)
+  {
+    return continuation_size(encode(value));
+  }
+
+  static inline std::size_t
+  serialize(std::uint8_t * output, std::size_t output_length,
+      liberate::types::varint const & value)
+  {
+    return serialize_continuation(output, output_length, encode(value));
+  }
+
+  static inline std::size_t
+  deserialize(liberate::types::varint & value, std::uint8_t const * input,
+      std::size_t input_length)
+  {
+    std::uint64_t val = 0;
+    auto read = deserialize_continuation(val, input, input_length);
+    if (read) {
+      value = liberate::types::varint{static_cast<liberate::types::varint_base>(
+          (val >> 1) ^ (~(val & 1) + 1))};
+    }
+    return read;
+  }
+};
+
+
+template <>
+struct varint_codec<varint_prefix>
+{
+  static constexpr std::size_t const MAX_SIZE = 9;
+
+  static inline std::size_t
+  size(liberate::types::varint const & value)
+  {
+    auto bits = static_cast<std::size_t>(bit_width(static_cast<std::uint64_t>(
+          static_cast<liberate::types::varint_base>(value))));
+    if (bits > 56) {
+      return MAX_SIZE;
+    }
+    return bits ? (bits + 6) / 7 : 1;
+  }
+
+  static inline std::size_t
+  serialize(std::uint8_t * output, std::size_t output_length,
+      liberate::types::varint const & value)
+  {
+    auto required = size(value);
+    if (output_length < required) {
+      return 0;
+    }
+
+    auto input = static_cast<std::uint64_t>(
+        static_cast<liberate::types::varint_base>(value));
+    if (required == MAX_SIZE) {
+      output[0] = 0xff;
+      store_be64(output + 1, input);
+      return required;
+    }
+
+    for (std::size_t i = 0 ; i < required ; ++i) {
+      output[i] = static_cast<std::uint8_t>(input >> ((required - i - 1) * 8));
+    }
+    output[0] |= static_cast<std::uint8_t>(0xff << (MAX_SIZE - required));
+    return required;
+  }
+
+  static inline std::size_t
+  deserialize(liberate::types::varint & value, std::uint8_t const * input,
+      std::size_t input_length)
+  {
+    // Single Byte values are by far the most common.
+    if (!(input[0] & 0x80)) {
+      value = liberate::types::varint{input[0]};
+      return 1;
+    }
+
+    // One plus the number of leading one bits.
+    std::size_t length = MAX_SIZE - static_cast<std::size_t>(bit_width(
+          static_cast<std::uint8_t>(~input[0])));
+    if (input_length < length) {
+      return 0;
+    }
+
+    std::uint64_t val = 0;
+    if (length == MAX_SIZE) {
+      val = load_be64(input + 1);
+    }
+    else {
+      // Read eight Bytes at once if the buffer permits, and discard those
+      // that belong to whatever follows.
+      std::uint64_t word = 0;
+      if (input_length >= 8) {
+        word = load_be64(input);
+      }
+      else {
+        std::uint8_t tmp[8] = { 0 };
+        std::memcpy(tmp, input, length);
+        word = load_be64(tmp);
+      }
+      auto bits = length * 7;
+      val = (word >> (64 - length * 8)) & ((std::uint64_t{1} << bits) - 1);
+    }
+
+    value = liberate::types::varint{static_cast<liberate::types::varint_base>(
+        val)};
+    return length;
+  }
+};
+
+} // namespace detail
+
+
+template <typename formatT>
+inline std::size_t
+serialized_size(::liberate::types::varint const & value)
+{
+  return detail::varint_codec<formatT>::size(value);
+}
+
+
+template <
+  typename formatT,
+  typename outT,
+  std::enable_if_t<liberate::types::is_8bit_type<outT>::value, int> = 0
+>
+std::size_t
+serialize_varint(outT * output, std::size_t output_length, ::liberate::types::varint const & value)
+{
+  if (!output || !output_length) {
+    return 0;
+  }
+  return detail::varint_codec<formatT>::serialize(
+      reinterpret_cast<std::uint8_t *>(output), output_length, value);
+}
+
+
+template <
+  typename formatT,
+  typename inT,
+  std::enable_if_t<liberate::types::is_8bit_type<inT>::value, int> = 0
+>
+std::size_t
+deserialize_varint(::liberate::types::varint & value, inT const * input, std::size_t input_length)
+{
+  if (!input || !input_length) {
+    return 0;
+  }
+  return detail::varint_codec<formatT>::deserialize(value,
+      reinterpret_cast<std::uint8_t const *>(input), input_length);
+}
+
+
+/**
+ * Bulk variants of the above, for arrays of varints encoded back to back.
+ *
+ * serialized_size() returns the size of the entire array. serialize_varints()
+ * returns the number of units written, or zero if the buffer is too small.
+ * deserialize_varints() decodes exactly the given amount of values, and
+ * returns the number of units consumed, or zero if decoding failed.
+ *
+ * Long runs of small values are decoded a block at a time where SIMD is
+ * available.
+ */
+LIBERATE_API
+std::size_t
+serialized_size(::liberate::types::varint const * values, std::size_t amount);
+
+namespace detail {
+
+LIBERATE_API
+std::size_t
+serialize_varints(std::uint8_t * output, std::size_t output_length,
+    ::liberate::types::varint const * values, std::size_t amount);
+
+LIBERATE_API
+std::size_t
+deserialize_varints(::liberate::types::varint * values, std::size_t amount,
+    std::uint8_t const * input, std::size_t input_length);
+
+} // namespace detail
+
+
+template <
+  typename outT,
+  std::enable_if_t<liberate::types::is_8bit_type<outT>::value, int> = 0
+>
+std::size_t
+serialize_varints(outT * output, std::size_t output_length,
+    ::liberate::types::varint const * values, std::size_t amount)
+{
+  return detail::serialize_varints(reinterpret_cast<std::uint8_t *>(output),
+      output_length, values, amount);
+}
+
+
+template <
+  typename inT,
+  std::enable_if_t<liberate::types::is_8bit_type<inT>::value, int> = 0
+>
+std::size_t
+deserialize_varints(::liberate::types::varint * values, std::size_t amount,
+    inT const * input, std::size_t input_length)
+{
+  return detail::deserialize_varints(values, amount,
+      reinterpret_cast<std::uint8_t const *>(input), input_length);
+}
+
+
 } // namespace liberate::serialization
 
 #endif // guard
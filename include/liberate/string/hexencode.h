@@ -23,18 +23,24 @@
 #include <liberate.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
-#include <sstream>
+#include <ostream>
+#include <algorithm>
+#include <cstring>
 
 #include <liberate/types/byte.h>
-#include <liberate/serialization/integer.h>
 
 namespace liberate::string {
 
 /**
  * Hex encode and decode. Return the size of the output buffer used, or 0 if
- * nothing could be transcoded (e.g. due to a too small output buffer).
+ * nothing could be transcoded (e.g. due to a too small output buffer, or
+ * invalid or an odd number of input characters when decoding).
+ *
+ * Both directions use SIMD kernels where the CPU supports them; the best
+ * kernel is selected at runtime on first use.
  **/
 LIBERATE_API
 size_t
@@ -80,6 +86,11 @@ hexdecode(::liberate::types::byte const * input, size_t input_size);
  * canonical_hexdump hd;
  * std::cerr << "Something weird in this memory region: "
  *    << hd(buf, bufsize) << std::endl;
+ *
+ * For large regions, prefer the streaming variants, which write the dump line
+ * by line without building it in memory first:
+ *
+ * hd(std::cerr, buf, bufsize);
  */
 template <
   // Size of an offset; this can be used to calculate the number of Bytes
@@ -151,7 +162,64 @@ struct hexdump
       size_t input_size,
       bool from_zero = true) const
   {
-    return format(
+    std::string result;
+    result.reserve(output_size(input_size));
+    format_to([&result](char const * line, size_t line_size)
+        {
+          result.append(line, line_size);
+        },
+        input, input_size, from_zero);
+    return result;
+  }
+
+  inline std::string operator()(std::string const & str, bool from_zero = true) const
+  {
+    return operator()(str.c_str(), str.size(), from_zero);
+  }
+
+
+  /**
+   * Streaming variants of the above. Rather than building the entire dump in
+   * memory, each line is written to the output stream as soon as it is
+   * formatted.
+   */
+  template <typename T>
+  inline void operator()(
+      std::ostream & os,
+      T const * input,
+      size_t input_size,
+      bool from_zero = true) const
+  {
+    format_to([&os](char const * line, size_t line_size)
+        {
+          os.write(line, line_size);
+        },
+        input, input_size, from_zero);
+  }
+
+  inline void operator()(std::ostream & os, std::string const & str,
+      bool from_zero = true) const
+  {
+    operator()(os, str.c_str(), str.size(), from_zero);
+  }
+
+
+  /**
+   * The most general variant passes each line to a sink functor with the
+   * signature void(char const * line, size_t line_size). Lines include their
+   * trailing newline, except the final one containing the end offset.
+   *
+   * The line buffer is reused for every line, so the sink must copy what it
+   * wants to keep. Formatting itself does not allocate.
+   */
+  template <typename sinkT, typename T>
+  static inline void format_to(
+      sinkT && sink,
+      T const * input,
+      size_t input_size,
+      bool from_zero = true)
+  {
+    format(std::forward<sinkT>(sink),
         reinterpret_cast<::liberate::types::byte const *>(input),
         input_size,
         from_zero
@@ -160,223 +228,142 @@ struct hexdump
       );
   }
 
-  inline std::string operator()(std::string const & str, bool from_zero = true) const
+
+  /**
+   * The number of characters a dump of input_size Bytes produces.
+   */
+  static constexpr size_t output_size(size_t input_size)
   {
-    return operator()(str.c_str(), str.size(), from_zero);
+    if (!input_size) {
+      return 0;
+    }
+    return (input_size / BYTES_PER_LINE) * (O_LINE_WIDTH + 1)
+      + (O_PLAIN_START + ((FRAME == '\0') ? 0 : 2)
+          + (input_size % BYTES_PER_LINE) + 1)
+      + O_OFFSET_WIDTH_UNPADDED;
   }
 
 
 private:
-  static inline std::string format(
+  // Where the plain text column starts.
+  static constexpr size_t O_PLAIN_START = O_OFFSET_WIDTH
+    + (GROUPS * O_GROUP_WIDTH);
+
+  /**
+   * All padding in a line is in fixed positions, so we can prepare a blank
+   * line once and only fill in the characters that change. The same goes for
+   * the position of each Byte's hex representation.
+   */
+  struct layout
+  {
+    char    blank[O_LINE_WIDTH + 1];
+    size_t  hex_pos[BYTES_PER_LINE];
+  };
+
+  static constexpr layout make_layout()
+  {
+    layout ret{};
+    for (size_t i = 0 ; i < sizeof(ret.blank) ; ++i) {
+      ret.blank[i] = ' ';
+    }
+
+    for (size_t i = 0 ; i < BYTES_PER_LINE ; ++i) {
+      auto column = i / BYTES_PER_COLUMN;
+      ret.hex_pos[i] = O_OFFSET_WIDTH
+        + ((column / COLUMNS_PER_GROUP) * O_GROUP_WIDTH)
+        + ((column % COLUMNS_PER_GROUP) * O_COLUMN_WIDTH)
+        + ((i % BYTES_PER_COLUMN) * 2);
+    }
+    return ret;
+  }
+
+  static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+
+  template <typename sinkT>
+  static inline void format(
+      sinkT && sink,
       ::liberate::types::byte const * input,
       size_t input_size,
       ::liberate::types::byte const * display_base
     )
   {
     if (!input || !input_size) {
-      return {};
+      return;
     }
 
     // Fixed sized line buffer (plus EOL)
-    ::liberate::types::byte linebuf[O_LINE_WIDTH + 1];
+    char linebuf[O_LINE_WIDTH + 1];
 
-    // Number of lines
+    // Number of lines; the last one may be incomplete or even empty.
     auto num_lines = (input_size + BYTES_PER_LINE) / BYTES_PER_LINE;
 
     // Display offset base may be different from the actual input base,
     // e.g. for displaying Bytes in a file vs memory.
-    auto display_offset = display_base;
+    auto display_offset = reinterpret_cast<uintptr_t>(display_base);
     auto offset = input;
     auto remaining = input_size;
 
-    std::stringstream result;
-
-    // Handle all but the last line the same.
-    for (size_t line = 0 ; line < num_lines - 1 ; ++line) {
-      auto line_offset = linebuf;
-      size_t line_remaining = sizeof(linebuf);
+    for (size_t line = 0 ; line < num_lines ; ++line) {
+      auto amount = std::min(BYTES_PER_LINE, remaining);
+      auto line_size = format_line(linebuf, display_offset, offset, amount);
+      linebuf[line_size++] = '\n';
+      sink(static_cast<char const *>(linebuf), line_size);
 
-      // First output the display offset. We'll treat the pointer as Bytes
-      // here.
-      add_offset(line_offset, line_remaining, display_offset);
-      add_pad(line_offset, line_remaining, GROUP_PAD);
-
-      // Add groups
-      add_groups(line_offset, line_remaining, offset, BYTES_PER_LINE);
-
-      // Add plaintext
-      add_plaintext(line_offset, line_remaining, offset, BYTES_PER_LINE);
-
-      *line_offset = '\0';
-      result << linebuf << std::endl;
-
-      // End of the line, increment display offset and offset
-      display_offset += BYTES_PER_LINE;
-      offset += BYTES_PER_LINE;
-      remaining -= BYTES_PER_LINE;
+      display_offset += amount;
+      offset += amount;
+      remaining -= amount;
     }
 
-    // The last line is similar, but we have to take care of padding incomplete
-    // columns.
-    auto line_offset = linebuf;
-    size_t line_remaining = sizeof(linebuf);
-
-    // First output the display offset. We'll treat the pointer as Bytes
-    // here.
-    add_offset(line_offset, line_remaining, display_offset);
-    add_pad(line_offset, line_remaining, GROUP_PAD);
-
-    // Add groups
-    add_groups(line_offset, line_remaining, offset, remaining);
-
-    // Add plaintext
-    add_plaintext(line_offset, line_remaining, offset, remaining);
-
-    *line_offset = '\0';
-    result << linebuf << std::endl;
-
     // As the very last line, we'll add the end offset
-    display_offset += remaining;
-    line_offset = linebuf;
-    line_remaining = sizeof(linebuf);
-
-    add_offset(line_offset, line_remaining, display_offset);
-
-    *line_offset = '\0';
-    result << linebuf;
-
-    return result.str();
+    add_offset(linebuf, display_offset);
+    sink(static_cast<char const *>(linebuf), O_OFFSET_WIDTH_UNPADDED);
   }
 
 
-  static inline void add_plaintext(::liberate::types::byte *& buf,
-      size_t & remaining, liberate::types::byte const * offset,
-      size_t offset_size)
+  static inline size_t format_line(char * buf, uintptr_t display_offset,
+      ::liberate::types::byte const * offset, size_t amount)
   {
-    // Add frame, if we have it.
-    if (FRAME) {
-      *buf++ = FRAME;
-      --remaining;
-    }
+    static constexpr layout LAYOUT = make_layout();
+    std::memcpy(buf, LAYOUT.blank, O_LINE_WIDTH);
 
-    // Now display the line, using the replacement character if
-    // necessary.
-    for (size_t i = 0 ; i < offset_size ; ++i) {
-      auto c = *(offset + i);
-      *buf++ = std::isprint(c) && c != ' '
-        ? c
-        : (PLACEHOLDER ? PLACEHOLDER : ' ');
-      --remaining;
-    }
+    add_offset(buf, display_offset);
 
-    // Also add closing frame
+    auto plain = buf + O_PLAIN_START;
     if (FRAME) {
-      *buf++ = FRAME;
-      --remaining;
+      *plain++ = FRAME;
     }
-  }
-
-
-  static inline void add_groups(::liberate::types::byte *& buf,
-      size_t & remaining, liberate::types::byte const * offset,
-      size_t offset_size)
-  {
-    auto offs = offset;
-    auto rem = offset_size;
-    for (size_t i = 0 ; i < GROUPS ; ++i) {
-      size_t to_process = std::min(BYTES_PER_GROUP, rem);
-
-      add_single_group(buf, remaining, offs, to_process);
-      add_pad(buf, remaining, GROUP_PAD);
-
-      offs += to_process;
-      rem -= to_process;
-    }
-  }
-
-  static inline void add_single_group(::liberate::types::byte *& buf,
-      size_t & remaining, liberate::types::byte const * offset,
-      size_t offset_size)
-  {
-    auto offs = offset;
-    auto rem = offset_size;
-
-    // First N columns
-    for (size_t i = 0 ; i < COLUMNS_PER_GROUP - 1 ; ++i) {
-      size_t to_process = std::min(BYTES_PER_COLUMN, rem);
-
-      add_column(buf, remaining, offs, to_process);
-      add_pad(buf, remaining, COLUMN_PAD);
-
-      offs += to_process;
-      rem -= to_process;
-    }
-
-    // Last column - without trailing pad
-    size_t to_process = std::min(BYTES_PER_COLUMN, rem);
-
-    add_column(buf, remaining, offs, to_process);
-
-    offs += to_process;
-    rem -= to_process;
-  }
-
-  static inline void add_column(::liberate::types::byte *& buf,
-      size_t & remaining, liberate::types::byte const * offset,
-      size_t offset_size)
-  {
-    // Each column is easy to encode.
-    auto res = hexencode(buf, remaining, offset, offset_size);
-    if (res != offset_size * 2) {
-      return;
-    }
-
-    // We also add padding empty columns or remaining parts.
-    auto rem = (BYTES_PER_COLUMN * 2) - res;
-    add_pad(buf, remaining, rem);
-
-    buf += res;
-    remaining -= res;
-  }
 
+    for (size_t i = 0 ; i < amount ; ++i) {
+      auto c = static_cast<unsigned char>(offset[i]);
 
-  static inline void add_offset(::liberate::types::byte *& buf,
-      size_t & remaining, void const * display_offset)
-  {
-    ::liberate::types::byte offsbuf[sizeof(intptr_t)];
+      auto hex = buf + LAYOUT.hex_pos[i];
+      hex[0] = HEX_DIGITS[c >> 4];
+      hex[1] = HEX_DIGITS[c & 0x0f];
 
-    intptr_t offs = reinterpret_cast<intptr_t>(display_offset);
-    auto res = ::liberate::serialization::serialize_int(offsbuf,
-        sizeof(offsbuf), offs);
-    if (res != sizeof(offs)) {
-      return;
+      // Printable ASCII, excluding the space.
+      *plain++ = (c > 0x20 && c < 0x7f)
+        ? static_cast<char>(c)
+        : (PLACEHOLDER ? PLACEHOLDER : ' ');
     }
 
-    // The offset buffer now holds the entire offset, but we want to
-    // truncate it to the offset size. That means we're only serializing
-    // the last N bytes.
-    auto ptr = offsbuf + sizeof(offsbuf) - OFFSET_SIZE;
-    res = hexencode(
-        buf, remaining,
-        ptr, OFFSET_SIZE);
-    if (res != OFFSET_SIZE * 2) {
-      return;
+    // Also add closing frame
+    if (FRAME) {
+      *plain++ = FRAME;
     }
 
-    buf += res;
-    remaining -= res;
+    return plain - buf;
   }
 
 
-  static inline void add_pad(::liberate::types::byte *& buf,
-      size_t & remaining, size_t amount)
+  static inline void add_offset(char * buf, uintptr_t display_offset)
   {
-    for (size_t i = 0 ; i < amount ; ++i) {
-      *buf++ = ' ';
-      --remaining;
+    // Only the last OFFSET_SIZE Bytes of the offset are displayed.
+    for (size_t i = 0 ; i < O_OFFSET_WIDTH_UNPADDED ; ++i) {
+      auto shift = (O_OFFSET_WIDTH_UNPADDED - 1 - i) * 4;
+      buf[i] = HEX_DIGITS[(display_offset >> shift) & 0x0f];
     }
   }
-
 };
 
 // The default parameters are almost as with he canonical -C parameter from
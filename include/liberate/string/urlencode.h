@@ -22,16 +22,41 @@
 
 #include <liberate.h>
 
+#include <cstddef>
+#include <string>
+#include <string_view>
+
 namespace liberate::string {
 
 /**
  * URL encode and decode.
+ *
+ * Alphanumeric ASCII characters as well as '-', '_', '.' and '/' are kept
+ * as-is when encoding, everything else is percent-encoded. When decoding,
+ * malformed percent-encodings are replaced by '?'.
  **/
 LIBERATE_API
-std::string urlencode(std::string const & input);
+std::string urlencode(std::string_view input);
+
+LIBERATE_API
+std::string urldecode(std::string_view input);
+
+/**
+ * Variants that write to caller supplied buffers. Like the hex encoding
+ * functions, they return the size of the output buffer used, or 0 if the
+ * output buffer is too small.
+ *
+ * urlencoded_size() returns the exact output size urlencode() needs. The
+ * decoded output is never larger than the input.
+ **/
+LIBERATE_API
+size_t urlencoded_size(std::string_view input);
+
+LIBERATE_API
+size_t urlencode(char * output, size_t output_size, std::string_view input);
 
 LIBERATE_API
-std::string urldecode(std::string const & input);
+size_t urldecode(char * output, size_t output_size, std::string_view input);
 
 } // namespace liberate::string
 
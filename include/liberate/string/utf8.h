@@ -22,8 +22,64 @@
 
 #include <liberate.h>
 
+#include <cstddef>
+#include <string>
+
 namespace liberate::string {
 
+/**
+ * UTF-8 validation and transcoding between UTF-8, UTF-16 and UTF-32.
+ *
+ * All functions take explicit input sizes in code units rather than relying
+ * on NUL termination, and write into caller supplied buffers. UTF-16 and
+ * UTF-32 use the host byte order.
+ *
+ * Input is valid if it contains only complete, shortest-form encodings of
+ * Unicode scalar values, i.e. no surrogates and nothing beyond U+10FFFF.
+ * The UTF-8 functions use SIMD where the CPU supports it; ASCII in
+ * particular is processed in blocks.
+ **/
+LIBERATE_API
+bool utf8_validate(char const * input, size_t input_size);
+
+/**
+ * Transcoding functions return the number of code units written to the
+ * output buffer, or 0 if the input is invalid or the output buffer is too
+ * small.
+ **/
+LIBERATE_API
+size_t utf8_to_utf16(char16_t * output, size_t output_size,
+    char const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf8_to_utf32(char32_t * output, size_t output_size,
+    char const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf16_to_utf8(char * output, size_t output_size,
+    char16_t const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf32_to_utf8(char * output, size_t output_size,
+    char32_t const * input, size_t input_size);
+
+/**
+ * Output sizes required for transcoding valid input. The results are
+ * meaningless for invalid input.
+ **/
+LIBERATE_API
+size_t utf16_length_from_utf8(char const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf32_length_from_utf8(char const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf8_length_from_utf16(char16_t const * input, size_t input_size);
+
+LIBERATE_API
+size_t utf8_length_from_utf32(char32_t const * input, size_t input_size);
+
+
 #if defined(LIBERATE_WIN32)
 
 /**
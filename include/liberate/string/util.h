@@ -22,31 +22,83 @@
 
 #include <liberate.h>
 
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 namespace liberate::string {
 
 /**
  * Lower- and uppercase strings.
+ *
+ * Only ASCII letters are converted; all other bytes are left untouched,
+ * independent of the current locale. That makes these functions safe to use
+ * on UTF-8 strings and protocol identifiers alike.
  */
 LIBERATE_API
-std::string to_lower(std::string const & other);
+std::string to_lower(std::string_view other);
 
 LIBERATE_API
-std::string to_upper(std::string const & other);
+std::string to_upper(std::string_view other);
 
 
 /**
- * Replace needle in haystack with substitute.
+ * In-place variants of the above, which avoid allocating a new string.
  */
 LIBERATE_API
-std::string replace(std::string const & haystack, std::string const & needle,
-    std::string const & substitute, bool first_only = false);
+void to_lower_inplace(char * value, size_t size);
+
+LIBERATE_API
+void to_upper_inplace(char * value, size_t size);
+
+inline void
+to_lower_inplace(std::string & value)
+{
+  to_lower_inplace(value.data(), value.size());
+}
+
+inline void
+to_upper_inplace(std::string & value)
+{
+  to_upper_inplace(value.data(), value.size());
+}
 
 
 /**
- * Perform case-insensitive search.
+ * Replace needle in haystack with substitute. An empty needle never matches.
+ *
+ * The output size is determined before the result is built, so only a
+ * single allocation is made.
+ */
+LIBERATE_API
+std::string replace(std::string_view haystack, std::string_view needle,
+    std::string_view substitute, bool first_only = false);
+
+
+/**
+ * Replace several needles in a single pass over the haystack. Each
+ * replacement is a pair of needle and substitute. Where several needles
+ * match at the same position, the one listed first wins. Substituted text is
+ * not searched again.
+ */
+using replacement_list = std::vector<
+  std::pair<std::string_view, std::string_view>
+>;
+
+LIBERATE_API
+std::string replace(std::string_view haystack,
+    replacement_list const & replacements);
+
+
+/**
+ * Perform case-insensitive search. As with to_lower() and to_upper(), only
+ * ASCII letters are compared case-insensitively.
+ *
+ * Returns the offset of the first match, or -1 if there is none.
  */
 LIBERATE_API
-ssize_t ifind(std::string const & haystack, std::string const & needle);
+ssize_t ifind(std::string_view haystack, std::string_view needle);
 
 
 } // namespace liberate::string
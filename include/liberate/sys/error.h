@@ -26,6 +26,11 @@
 
 #include <liberate.h>
 
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
 namespace liberate::sys {
 
 /**
@@ -45,6 +50,41 @@ LIBERATE_API
 std::string error_message(int code);
 
 
+/**
+ * Returns only the message for the error code, without the code. Messages are
+ * looked up once per code, and cached for the lifetime of the process, so
+ * this function does not allocate after the first call for a given code. It
+ * is safe to call from multiple threads.
+ */
+LIBERATE_API
+std::string_view error_string(int code);
+
+
+/**
+ * Formats the error code and message in the same way as error_message(), but
+ * into the given buffer, without allocating. The output is truncated to fit
+ * and always zero-terminated, unless the buffer size is zero. Returns the
+ * number of characters written, excluding the terminating zero.
+ */
+LIBERATE_API
+std::size_t format_error(char * buf, std::size_t bufsize, int code);
+
+
+/**
+ * Streams an error code and message in the format of error_message(), without
+ * allocating, e.g.:
+ *
+ *   os << "Connect failed: " << error_info{error_code()};
+ */
+struct error_info
+{
+  int code;
+};
+
+LIBERATE_API
+std::ostream & operator<<(std::ostream & os, error_info const & info);
+
+
 } // namespace liberate::sys
 
 #endif // guard
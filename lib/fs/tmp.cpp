@@ -97,7 +97,7 @@ temp_name(std::string const & prefix /* = "" */)
   if (fd < 0) {
     throw std::runtime_error{"mkstemp() failed."};
   }
-  std::string ret{buf.begin(), buf.end()};
+  std::string ret{buf.data()};
 
   // Cleanup
   close(fd);
@@ -0,0 +1,436 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <build-config.h>
+
+#include <liberate/logging/async.h>
+#include <liberate/concurrency/tasklet.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace liberate::logging {
+
+namespace {
+
+using header_type = detail::record_header;
+
+
+/**
+ * Single producer, single consumer ring buffer of records. The producer is
+ * the logging thread, the consumer the logger's tasklet.
+ */
+struct ring
+{
+  std::size_t                 capacity;
+  std::size_t                 mask;
+  std::unique_ptr<uint8_t[]>  data;
+
+  alignas(64) std::atomic<std::size_t>  head = 0; // Written by the producer
+  alignas(64) std::atomic<std::size_t>  tail = 0; // Written by the consumer
+
+  std::atomic<std::size_t>    dropped = 0;
+  std::size_t                 reported = 0; // Consumer only
+  std::atomic<bool>           closed = false;
+
+  explicit ring(std::size_t size)
+    : capacity{1}
+  {
+    while (capacity < size) {
+      capacity <<= 1;
+    }
+    mask = capacity - 1;
+    data = std::make_unique<uint8_t[]>(capacity);
+  }
+
+
+  inline void
+  write(std::size_t pos, void const * source, std::size_t size)
+  {
+    auto start = pos & mask;
+    auto first = std::min(size, capacity - start);
+    std::memcpy(data.get() + start, source, first);
+    std::memcpy(data.get(), static_cast<uint8_t const *>(source) + first,
+        size - first);
+  }
+
+
+  inline void
+  read(std::size_t pos, void * dest, std::size_t size) const
+  {
+    auto start = pos & mask;
+    auto first = std::min(size, capacity - start);
+    std::memcpy(dest, data.get() + start, first);
+    std::memcpy(static_cast<uint8_t *>(dest) + first, data.get(),
+        size - first);
+  }
+
+
+  bool
+  push(void const * record, std::size_t size)
+  {
+    auto cur = head.load(std::memory_order_relaxed);
+    if (size > capacity - (cur - tail.load(std::memory_order_acquire))) {
+      return false;
+    }
+    write(cur, record, size);
+    head.store(cur + size, std::memory_order_release);
+    return true;
+  }
+
+
+  bool
+  pop(std::vector<uint8_t> & record)
+  {
+    auto cur = tail.load(std::memory_order_relaxed);
+    if (cur == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    uint32_t size = 0;
+    read(cur, &size, sizeof(size));
+    record.resize(size);
+    read(cur, record.data(), size);
+    tail.store(cur + size, std::memory_order_release);
+    return true;
+  }
+
+
+  inline bool
+  empty() const
+  {
+    return head.load(std::memory_order_acquire)
+      == tail.load(std::memory_order_relaxed);
+  }
+};
+
+using ring_ptr = std::shared_ptr<ring>;
+
+
+/**
+ * The rings of the current thread, one per logger. Rings are closed when the
+ * thread exits, so that the logger can clean them up.
+ */
+struct thread_rings
+{
+  std::vector<std::pair<uint64_t, ring_ptr>>  rings;
+
+  ~thread_rings()
+  {
+    for (auto & entry : rings) {
+      entry.second->closed = true;
+    }
+  }
+};
+
+thread_local thread_rings t_rings;
+
+
+std::atomic<uint64_t> next_logger_id = 0;
+
+
+void
+write_stderr(level, std::string_view line)
+{
+  std::fwrite(line.data(), 1, line.size(), stderr);
+  std::fputc('\n', stderr);
+}
+
+
+void
+format_record(std::ostringstream & out, std::ios const & default_format,
+    uint8_t const * record, std::size_t size)
+{
+  out.str({});
+  out.clear();
+  out.copyfmt(default_format);
+
+  header_type header;
+  std::memcpy(&header, record, sizeof(header));
+  out << "[" << header.file << ":" << header.line << "] "
+    << level_name(header.lvl) << ": ";
+  detail::format_args(out, record, size);
+}
+
+} // anonymous namespace
+
+
+struct async_logger::async_logger_impl
+{
+  uint64_t                    id;
+  async_options               options;
+  bool                        default_sink = false;
+
+  std::mutex                  rings_mutex = {};
+  std::vector<ring_ptr>       rings = {};
+  std::size_t                 closed_dropped = 0; // From removed rings
+
+  std::atomic<uint64_t>       flush_requested = 0;
+  std::mutex                  flush_mutex = {};
+  std::condition_variable     flush_condition = {};
+  uint64_t                    flush_done = 0;
+
+  // Only used by the tasklet, or after it stopped.
+  std::vector<ring_ptr>       snapshot = {};
+  std::vector<uint8_t>        drain_record = {};
+  std::ostringstream          out = {};
+  std::ios                    default_format{nullptr};
+
+  concurrency::tasklet        worker;
+
+
+  explicit async_logger_impl(async_options const & _options)
+    : id{++next_logger_id}
+    , options{_options}
+    , worker{[this](concurrency::tasklet::context & ctx)
+        {
+          do {
+            drain();
+          } while (ctx.sleep(options.interval));
+        }}
+  {
+    if (!options.sink) {
+      options.sink = &write_stderr;
+      default_sink = true;
+    }
+    if (!options.buffer_size) {
+      throw std::invalid_argument("Need a buffer size.");
+    }
+  }
+
+
+  ring &
+  thread_ring()
+  {
+    for (auto & entry : t_rings.rings) {
+      if (entry.first == id) {
+        return *entry.second;
+      }
+    }
+
+    auto created = std::make_shared<ring>(options.buffer_size);
+    t_rings.rings.emplace_back(id, created);
+
+    std::lock_guard<std::mutex> lock{rings_mutex};
+    rings.push_back(created);
+    return *created;
+  }
+
+
+  void
+  commit(level lvl, void const * record, std::size_t size)
+  {
+    auto & buf = thread_ring();
+
+    if (size > buf.capacity) {
+      buf.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    auto policy = (lvl == level::fatal) ? overflow_policy::block
+      : options.overflow;
+    while (!buf.push(record, size)) {
+      if (policy != overflow_policy::block) {
+        buf.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      worker.wakeup();
+      std::this_thread::yield();
+    }
+
+    if (lvl == level::fatal) {
+      flush();
+    }
+  }
+
+
+  void
+  drain()
+  {
+    auto requested = flush_requested.load(std::memory_order_acquire);
+
+    {
+      std::lock_guard<std::mutex> lock{rings_mutex};
+      snapshot = rings;
+    }
+
+    bool any_closed = false;
+    for (auto & buf : snapshot) {
+      bool closed = buf->closed.load(std::memory_order_acquire);
+
+      while (buf->pop(drain_record)) {
+        format_record(out, default_format, drain_record.data(),
+            drain_record.size());
+        auto hdr = reinterpret_cast<header_type const *>(drain_record.data());
+        options.sink(hdr->lvl, out.str());
+      }
+
+      auto dropped = buf->dropped.load(std::memory_order_relaxed);
+      if (dropped != buf->reported) {
+        if (options.overflow == overflow_policy::count) {
+          options.sink(level::warn, "[liberate] " + std::to_string(
+                dropped - buf->reported)
+              + " log messages dropped due to a full buffer.");
+        }
+        buf->reported = dropped;
+      }
+
+      any_closed = any_closed || (closed && buf->empty());
+    }
+    snapshot.clear();
+
+    if (any_closed) {
+      std::lock_guard<std::mutex> lock{rings_mutex};
+      rings.erase(std::remove_if(rings.begin(), rings.end(),
+            [this](ring_ptr const & buf)
+            {
+              if (buf->closed && buf->empty()) {
+                closed_dropped += buf->dropped;
+                return true;
+              }
+              return false;
+            }),
+          rings.end());
+    }
+
+    if (default_sink) {
+      std::fflush(stderr);
+    }
+
+    if (requested) {
+      std::lock_guard<std::mutex> lock{flush_mutex};
+      flush_done = std::max(flush_done, requested);
+      flush_condition.notify_all();
+    }
+  }
+
+
+  void
+  flush()
+  {
+    auto request = flush_requested.fetch_add(1, std::memory_order_acq_rel)
+      + 1;
+    worker.wakeup();
+
+    std::unique_lock<std::mutex> lock{flush_mutex};
+    flush_condition.wait(lock, [this, request]() {
+        return flush_done >= request;
+    });
+  }
+};
+
+
+
+async_logger::async_logger(async_options const & options
+    /* = async_options{} */)
+  : m_impl{std::make_unique<async_logger_impl>(options)}
+{
+  m_impl->worker.start();
+}
+
+
+
+async_logger::~async_logger()
+{
+  m_impl->worker.stop();
+  m_impl->worker.wait();
+  m_impl->drain();
+}
+
+
+
+void
+async_logger::flush()
+{
+  m_impl->flush();
+}
+
+
+
+std::size_t
+async_logger::dropped() const
+{
+  std::lock_guard<std::mutex> lock{m_impl->rings_mutex};
+  auto ret = m_impl->closed_dropped;
+  for (auto & buf : m_impl->rings) {
+    ret += buf->dropped.load(std::memory_order_relaxed);
+  }
+  return ret;
+}
+
+
+
+void
+async_logger::commit(level lvl, void const * record, std::size_t size)
+{
+  m_impl->commit(lvl, record, size);
+}
+
+
+
+namespace {
+
+std::mutex global_mutex;
+std::optional<async_options> global_options;
+bool global_created = false;
+
+} // anonymous namespace
+
+
+async_logger &
+async_logger::global()
+{
+  // The global logger is never destroyed, so that it remains usable while
+  // other static objects are destroyed. Pending messages are written at exit.
+  static async_logger * logger = []()
+  {
+    std::lock_guard<std::mutex> lock{global_mutex};
+    global_created = true;
+    auto ret = new async_logger{global_options.value_or(async_options{})};
+    std::atexit([]() { async_logger::global().flush(); });
+    return ret;
+  }();
+  return *logger;
+}
+
+
+
+bool
+async_logger::configure_global(async_options const & options)
+{
+  std::lock_guard<std::mutex> lock{global_mutex};
+  if (global_created) {
+    return false;
+  }
+  global_options = options;
+  return true;
+}
+
+} // namespace liberate::logging
@@ -0,0 +1,1078 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <build-config.h>
+
+#include <liberate/logging/binary.h>
+
+#include <liberate/fs/tmp.h>
+#include <liberate/serialization/integer.h>
+#include <liberate/serialization/varint.h>
+#include <liberate/sys/error.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(LIBERATE_WIN32)
+#include <liberate/string/utf8.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace liberate::logging {
+
+namespace {
+
+namespace ser = ::liberate::serialization;
+
+using varint = ::liberate::types::varint;
+using varint_base = ::liberate::types::varint_base;
+
+/**
+ * The log file starts with a header, followed by the ring buffer. Head and
+ * tail count the Bytes written since the file was created; their position in
+ * the ring buffer is their value modulo the capacity. Tail always points to
+ * the start of a frame. A frame is a varint payload length, followed by the
+ * payload.
+ *
+ * The payload starts with a varint of the statement ID shifted left by one;
+ * the lowest bit is set if the message is written as text. A varint of the
+ * microseconds since the dictionary's start time follows. The remainder is
+ * either the message text, or the arguments in the statement's slots.
+ */
+constexpr char LOG_MAGIC[] = "LIBLOGR1";
+constexpr char DICT_MAGIC[] = "LIBLOGD1";
+constexpr std::size_t MAGIC_SIZE = 8;
+
+constexpr std::size_t OFFSET_CAPACITY = 8;
+constexpr std::size_t OFFSET_HEAD = 16;
+constexpr std::size_t OFFSET_TAIL = 24;
+constexpr std::size_t HEADER_SIZE = 64;
+
+/**
+ * The dictionary starts with its magic and the start time in microseconds
+ * since the epoch. Each entry then holds a statement's ID, level, line, file
+ * and format. The format is a sequence of items.
+ */
+enum item_kind : uint8_t
+{
+  ITEM_TEXT = 0,
+  ITEM_MANIPULATOR,
+  ITEM_SLOT,
+};
+
+enum manipulator_id : uint8_t
+{
+  MANIP_ENDL = 0,
+  MANIP_FLUSH,
+  MANIP_HEX,
+  MANIP_DEC,
+  MANIP_OCT,
+  MANIP_BOOLALPHA,
+  MANIP_NOBOOLALPHA,
+  MANIP_SHOWBASE,
+  MANIP_NOSHOWBASE,
+  MANIP_UPPERCASE,
+  MANIP_NOUPPERCASE,
+  MANIP_SHOWPOS,
+  MANIP_NOSHOWPOS,
+  MANIP_FIXED,
+  MANIP_SCIENTIFIC,
+  MANIP_DEFAULTFLOAT,
+
+  MANIP_UNKNOWN,
+};
+
+using ostream_manipulator = std::ostream & (*)(std::ostream &);
+using ios_manipulator = std::ios_base & (*)(std::ios_base &);
+
+struct ios_manipulator_entry
+{
+  ios_manipulator func;
+  manipulator_id  id;
+};
+
+ios_manipulator_entry const IOS_MANIPULATORS[] = {
+  { std::hex, MANIP_HEX },
+  { std::dec, MANIP_DEC },
+  { std::oct, MANIP_OCT },
+  { std::boolalpha, MANIP_BOOLALPHA },
+  { std::noboolalpha, MANIP_NOBOOLALPHA },
+  { std::showbase, MANIP_SHOWBASE },
+  { std::noshowbase, MANIP_NOSHOWBASE },
+  { std::uppercase, MANIP_UPPERCASE },
+  { std::nouppercase, MANIP_NOUPPERCASE },
+  { std::showpos, MANIP_SHOWPOS },
+  { std::noshowpos, MANIP_NOSHOWPOS },
+  { std::fixed, MANIP_FIXED },
+  { std::scientific, MANIP_SCIENTIFIC },
+  { std::defaultfloat, MANIP_DEFAULTFLOAT },
+};
+
+
+template <typename T>
+inline T
+read_value(void const * value)
+{
+  T ret;
+  std::memcpy(&ret, value, sizeof(T));
+  return ret;
+}
+
+
+manipulator_id
+identify_manipulator(detail::arg_tag tag, void const * value)
+{
+  if (tag == detail::ARG_MANIPULATOR) {
+    auto func = read_value<ostream_manipulator>(value);
+    if (func == static_cast<ostream_manipulator>(std::endl)) {
+      return MANIP_ENDL;
+    }
+    if (func == static_cast<ostream_manipulator>(std::flush)) {
+      return MANIP_FLUSH;
+    }
+    return MANIP_UNKNOWN;
+  }
+
+  auto func = read_value<ios_manipulator>(value);
+  for (auto & entry : IOS_MANIPULATORS) {
+    if (entry.func == func) {
+      return entry.id;
+    }
+  }
+  return MANIP_UNKNOWN;
+}
+
+
+void
+apply_manipulator(std::ostream & out, uint8_t id)
+{
+  if (id == MANIP_ENDL) {
+    out << '\n';
+    return;
+  }
+  for (auto & entry : IOS_MANIPULATORS) {
+    if (entry.id == id) {
+      out << entry.func;
+      return;
+    }
+  }
+}
+
+
+inline uint64_t
+now_us()
+{
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+
+/**
+ * Appending to and reading from encoded buffers.
+ */
+template <typename formatT = ser::varint_continuation>
+inline void
+put_varint(std::vector<uint8_t> & buf, uint64_t value)
+{
+  auto offset = buf.size();
+  buf.resize(offset + ser::VARINT_MAX_BUFSIZE);
+  auto used = ser::serialize_varint<formatT>(buf.data() + offset,
+      ser::VARINT_MAX_BUFSIZE, varint{static_cast<varint_base>(value)});
+  buf.resize(offset + used);
+}
+
+
+inline void
+put_string(std::vector<uint8_t> & buf, void const * data, std::size_t size)
+{
+  put_varint(buf, size);
+  auto offset = buf.size();
+  buf.resize(offset + size);
+  std::memcpy(buf.data() + offset, data, size);
+}
+
+
+struct reader
+{
+  uint8_t const * data;
+  std::size_t     size;
+  std::size_t     offset = 0;
+
+  template <typename formatT = ser::varint_continuation>
+  uint64_t
+  get_varint()
+  {
+    varint value{};
+    auto used = ser::deserialize_varint<formatT>(value, data + offset,
+        size - offset);
+    if (!used) {
+      throw std::runtime_error{"Malformed binary log: bad varint."};
+    }
+    offset += used;
+    return static_cast<uint64_t>(static_cast<varint_base>(value));
+  }
+
+  template <typename T>
+  T
+  get_int()
+  {
+    T value{};
+    if (!ser::deserialize_int(value, data + offset, size - offset)) {
+      throw std::runtime_error{"Malformed binary log: truncated."};
+    }
+    offset += sizeof(T);
+    return value;
+  }
+
+  std::string_view
+  get_bytes(std::size_t length)
+  {
+    if (length > size - offset) {
+      throw std::runtime_error{"Malformed binary log: truncated."};
+    }
+    std::string_view ret{reinterpret_cast<char const *>(data + offset),
+      length};
+    offset += length;
+    return ret;
+  }
+
+  std::string_view
+  get_string()
+  {
+    return get_bytes(get_varint());
+  }
+
+  bool
+  done() const
+  {
+    return offset >= size;
+  }
+};
+
+
+
+/**
+ * Memory-mapped file of a fixed size.
+ */
+struct mapped_file
+{
+  uint8_t *   data = nullptr;
+  std::size_t size = 0;
+#if defined(LIBERATE_WIN32)
+  HANDLE      file = INVALID_HANDLE_VALUE;
+  HANDLE      mapping = nullptr;
+#else
+  int         fd = -1;
+#endif
+
+  mapped_file(std::string const & path, std::size_t _size)
+    : size{_size}
+  {
+#if defined(LIBERATE_WIN32)
+    auto wpath = string::from_utf8(path.c_str());
+    file = CreateFileW(wpath.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      fail("Could not create binary log file: " + path);
+    }
+    auto size64 = static_cast<uint64_t>(size);
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+        nullptr);
+    if (!mapping) {
+      fail("Could not map binary log file: " + path);
+    }
+    data = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0,
+          0, size));
+    if (!data) {
+      fail("Could not map binary log file: " + path);
+    }
+#else
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      fail("Could not create binary log file: " + path);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+      fail("Could not size binary log file: " + path);
+    }
+    auto mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd, 0);
+    if (mapped == MAP_FAILED) {
+      fail("Could not map binary log file: " + path);
+    }
+    data = static_cast<uint8_t *>(mapped);
+#endif
+  }
+
+
+  ~mapped_file()
+  {
+    close();
+  }
+
+
+  void
+  sync()
+  {
+#if defined(LIBERATE_WIN32)
+    FlushViewOfFile(data, size);
+    FlushFileBuffers(file);
+#else
+    ::msync(data, size, MS_SYNC);
+#endif
+  }
+
+
+  [[noreturn]] void
+  fail(std::string const & message)
+  {
+    auto error = sys::error_message(sys::error_code());
+    close();
+    throw std::runtime_error{message + " // " + error};
+  }
+
+
+  void
+  close()
+  {
+#if defined(LIBERATE_WIN32)
+    if (data) {
+      UnmapViewOfFile(data);
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data) {
+      ::munmap(data, size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    fd = -1;
+#endif
+    data = nullptr;
+  }
+};
+
+
+/**
+ * A log statement is identified by its file and line.
+ */
+struct statement_key
+{
+  char const *  file;
+  uint32_t      line;
+
+  inline bool
+  operator==(statement_key const & other) const
+  {
+    return file == other.file && line == other.line;
+  }
+};
+
+struct statement_key_hash
+{
+  inline std::size_t
+  operator()(statement_key const & key) const
+  {
+    return std::hash<char const *>{}(key.file) ^ (std::size_t{key.line} << 1);
+  }
+};
+
+
+struct format_item
+{
+  item_kind     kind;
+  uint8_t       value;          // Argument tag or manipulator ID
+  std::string   text = {};      // Static text
+};
+
+
+struct statement
+{
+  uint64_t                  id;
+  bool                      compact = true;
+  std::vector<format_item>  items = {};
+};
+
+} // anonymous namespace
+
+
+
+struct binary_logger::binary_logger_impl
+{
+  std::string     path;
+  mapped_file     log;
+  std::FILE *     dict = nullptr;
+  std::size_t     capacity;
+  uint64_t        start_time;
+
+  std::mutex      mutex = {};
+  uint64_t        head = 0;
+  uint64_t        tail = 0;
+  std::size_t     dropped = 0;
+
+  std::unordered_map<statement_key, statement, statement_key_hash>
+                        statements = {};
+  std::vector<uint8_t>  payload = {};
+  std::vector<uint8_t>  frame = {};
+  std::ostringstream    text = {};
+  std::ios              default_format{nullptr};
+
+
+  explicit binary_logger_impl(binary_options const & options)
+    : path{options.path.empty() ? default_path() : options.path}
+    , log{path, HEADER_SIZE + validate_size(options.size)}
+    , capacity{options.size}
+    , start_time{now_us()}
+  {
+    default_format.copyfmt(text);
+
+    std::memset(log.data, 0, HEADER_SIZE);
+    std::memcpy(log.data, LOG_MAGIC, MAGIC_SIZE);
+    ser::serialize_int(log.data + OFFSET_CAPACITY, sizeof(uint64_t),
+        static_cast<uint64_t>(capacity));
+    store_positions();
+
+    auto dict_path = path + ".dict";
+    dict = std::fopen(dict_path.c_str(), "wb");
+    if (!dict) {
+      throw std::runtime_error{"Could not create binary log dictionary: "
+        + dict_path + " // " + sys::error_message(sys::error_code())};
+    }
+    std::vector<uint8_t> header{DICT_MAGIC, DICT_MAGIC + MAGIC_SIZE};
+    header.resize(MAGIC_SIZE + sizeof(uint64_t));
+    ser::serialize_int(header.data() + MAGIC_SIZE, sizeof(uint64_t),
+        start_time);
+    write_dict(header);
+  }
+
+
+  /**
+   * A file name in the temporary directory that includes the process ID, so
+   * that processes do not overwrite each other's logs.
+   */
+  static std::string
+  default_path()
+  {
+#if defined(LIBERATE_WIN32)
+    auto pid = static_cast<unsigned long>(GetCurrentProcessId());
+#else
+    auto pid = static_cast<unsigned long>(::getpid());
+#endif
+    return fs::temp_name("liberate-" + std::to_string(pid)) + ".blog";
+  }
+
+
+  static std::size_t
+  validate_size(std::size_t size)
+  {
+    if (!size) {
+      throw std::invalid_argument{"Binary log size must not be zero."};
+    }
+    return size;
+  }
+
+
+  ~binary_logger_impl()
+  {
+    if (dict) {
+      std::fclose(dict);
+    }
+  }
+
+
+  inline void
+  store_positions()
+  {
+    ser::serialize_int(log.data + OFFSET_HEAD, sizeof(uint64_t), head);
+    ser::serialize_int(log.data + OFFSET_TAIL, sizeof(uint64_t), tail);
+  }
+
+
+  void
+  write_dict(std::vector<uint8_t> const & entry)
+  {
+    std::fwrite(entry.data(), 1, entry.size(), dict);
+    std::fflush(dict);
+  }
+
+
+  /**
+   * Register a statement when it is first logged; its format is taken from
+   * the record.
+   */
+  statement &
+  get_statement(detail::record_header const & header, uint8_t const * record,
+      std::size_t size)
+  {
+    statement_key key{header.file, header.line};
+    auto iter = statements.find(key);
+    if (iter != statements.end()) {
+      return iter->second;
+    }
+
+    statement stmt{statements.size()};
+    detail::for_each_arg(record, size,
+        [&stmt](detail::arg_tag tag, void const * value,
+          std::size_t value_size)
+    {
+      switch (tag) {
+        case detail::ARG_STATIC:
+          stmt.items.push_back({ITEM_TEXT, 0,
+              {static_cast<char const *>(value), value_size}});
+          break;
+
+        case detail::ARG_MANIPULATOR:
+        case detail::ARG_IOS_MANIPULATOR:
+          {
+            auto id = identify_manipulator(tag, value);
+            stmt.compact = stmt.compact && (id != MANIP_UNKNOWN);
+            stmt.items.push_back({ITEM_MANIPULATOR, id});
+          }
+          break;
+
+        default:
+          stmt.items.push_back({ITEM_SLOT, tag});
+          break;
+      }
+    });
+    if (!stmt.compact) {
+      stmt.items.clear();
+    }
+
+    std::vector<uint8_t> entry;
+    put_varint(entry, stmt.id);
+    entry.push_back(static_cast<uint8_t>(header.lvl));
+    put_varint(entry, header.line);
+    put_string(entry, header.file, std::strlen(header.file));
+    put_varint(entry, stmt.items.size());
+    for (auto & item : stmt.items) {
+      entry.push_back(item.kind);
+      if (item.kind == ITEM_TEXT) {
+        put_string(entry, item.text.data(), item.text.size());
+      }
+      else {
+        entry.push_back(item.value);
+      }
+    }
+    write_dict(entry);
+
+    return statements.emplace(key, std::move(stmt)).first->second;
+  }
+
+
+  /**
+   * Encode the record's arguments into the payload; returns false if they
+   * do not match the statement's format.
+   */
+  bool
+  encode_args(statement const & stmt, uint8_t const * record,
+      std::size_t size)
+  {
+    if (!stmt.compact) {
+      return false;
+    }
+
+    bool matches = true;
+    std::size_t index = 0;
+    detail::for_each_arg(record, size,
+        [&](detail::arg_tag tag, void const * value, std::size_t value_size)
+    {
+      if (!matches || index >= stmt.items.size()) {
+        matches = false;
+        return;
+      }
+      auto & item = stmt.items[index++];
+      switch (item.kind) {
+        case ITEM_TEXT:
+          // Constant character arrays need not be literals, so compare the
+          // text rather than its address.
+          matches = (tag == detail::ARG_STATIC)
+            && (item.text == std::string_view{
+                static_cast<char const *>(value), value_size});
+          return;
+
+        case ITEM_MANIPULATOR:
+          matches = (tag == detail::ARG_MANIPULATOR
+              || tag == detail::ARG_IOS_MANIPULATOR)
+            && (identify_manipulator(tag, value) == item.value);
+          return;
+
+        default:
+          if (tag != item.value) {
+            matches = false;
+            return;
+          }
+          break;
+      }
+
+      switch (tag) {
+        case detail::ARG_BOOL:
+        case detail::ARG_CHAR:
+          payload.push_back(*static_cast<uint8_t const *>(value));
+          break;
+
+        case detail::ARG_SIGNED:
+          put_varint<ser::varint_zigzag>(payload,
+              static_cast<uint64_t>(read_value<int64_t>(value)));
+          break;
+
+        case detail::ARG_UNSIGNED:
+          put_varint<ser::varint_prefix>(payload, read_value<uint64_t>(value));
+          break;
+
+        case detail::ARG_POINTER:
+          put_varint<ser::varint_prefix>(payload, static_cast<uint64_t>(
+                reinterpret_cast<uintptr_t>(read_value<void const *>(value))));
+          break;
+
+        case detail::ARG_DOUBLE:
+          {
+            uint64_t bits = 0;
+            std::memcpy(&bits, value, sizeof(bits));
+            auto offset = payload.size();
+            payload.resize(offset + sizeof(bits));
+            ser::serialize_int(payload.data() + offset, sizeof(bits), bits);
+          }
+          break;
+
+        case detail::ARG_STRING:
+          put_string(payload, value, value_size);
+          break;
+
+        default:
+          matches = false;
+          break;
+      }
+    });
+    return matches && index == stmt.items.size();
+  }
+
+
+  /**
+   * Copy into the ring buffer, wrapping around at the end.
+   */
+  inline void
+  ring_write(uint64_t pos, uint8_t const * source, std::size_t size)
+  {
+    auto start = static_cast<std::size_t>(pos % capacity);
+    auto first = std::min(size, capacity - start);
+    std::memcpy(log.data + HEADER_SIZE + start, source, first);
+    std::memcpy(log.data + HEADER_SIZE, source + first, size - first);
+  }
+
+
+  inline void
+  ring_read(uint64_t pos, uint8_t * dest, std::size_t size) const
+  {
+    auto start = static_cast<std::size_t>(pos % capacity);
+    auto first = std::min(size, capacity - start);
+    std::memcpy(dest, log.data + HEADER_SIZE + start, first);
+    std::memcpy(dest + first, log.data + HEADER_SIZE, size - first);
+  }
+
+
+  void
+  write_frame()
+  {
+    frame.clear();
+    put_varint(frame, payload.size());
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    if (frame.size() > capacity) {
+      ++dropped;
+      return;
+    }
+
+    // Drop the oldest frames until there is room.
+    while (head + frame.size() - tail > capacity) {
+      uint8_t buf[ser::VARINT_MAX_BUFSIZE];
+      auto avail = static_cast<std::size_t>(std::min<uint64_t>(sizeof(buf),
+            head - tail));
+      ring_read(tail, buf, avail);
+      varint length{};
+      auto used = ser::deserialize_varint(length, buf, avail);
+      tail += used + static_cast<uint64_t>(static_cast<varint_base>(length));
+    }
+
+    ring_write(head, frame.data(), frame.size());
+    head += frame.size();
+    store_positions();
+  }
+
+
+  void
+  commit(uint8_t const * record, std::size_t size)
+  {
+    detail::record_header header;
+    std::memcpy(&header, record, sizeof(header));
+    auto timestamp = now_us();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto & stmt = get_statement(header, record, size);
+
+    payload.clear();
+    put_varint(payload, stmt.id << 1);
+    put_varint(payload, timestamp > start_time ? timestamp - start_time : 0);
+    if (!encode_args(stmt, record, size)) {
+      // Write as text instead
+      text.str({});
+      text.clear();
+      text.copyfmt(default_format);
+      detail::format_args(text, record, size);
+      auto str = text.str();
+
+      payload.clear();
+      put_varint(payload, (stmt.id << 1) | 1);
+      put_varint(payload, timestamp > start_time ? timestamp - start_time : 0);
+      put_string(payload, str.data(), str.size());
+    }
+    write_frame();
+  }
+};
+
+
+
+binary_logger::binary_logger(binary_options const & options
+    /* = binary_options{} */)
+  : m_impl{std::make_unique<binary_logger_impl>(options)}
+{
+}
+
+
+
+binary_logger::~binary_logger()
+{
+  flush();
+}
+
+
+
+void
+binary_logger::flush()
+{
+  std::lock_guard<std::mutex> lock{m_impl->mutex};
+  m_impl->log.sync();
+}
+
+
+
+std::size_t
+binary_logger::dropped() const
+{
+  std::lock_guard<std::mutex> lock{m_impl->mutex};
+  return m_impl->dropped;
+}
+
+
+
+std::string const &
+binary_logger::path() const
+{
+  return m_impl->path;
+}
+
+
+
+void
+binary_logger::commit(level, void const * record, std::size_t size)
+{
+  m_impl->commit(static_cast<uint8_t const *>(record), size);
+}
+
+
+
+bool
+binary_logger::consumes_immediately() const
+{
+  return true;
+}
+
+
+
+namespace {
+
+std::mutex global_mutex;
+std::optional<binary_options> global_options;
+bool global_created = false;
+
+} // anonymous namespace
+
+
+binary_logger &
+binary_logger::global()
+{
+  // As with the async logger, the global logger is never destroyed.
+  static binary_logger * logger = []()
+  {
+    std::lock_guard<std::mutex> lock{global_mutex};
+    global_created = true;
+    return new binary_logger{global_options.value_or(binary_options{})};
+  }();
+  return *logger;
+}
+
+
+
+bool
+binary_logger::configure_global(binary_options const & options)
+{
+  std::lock_guard<std::mutex> lock{global_mutex};
+  if (global_created) {
+    return false;
+  }
+  global_options = options;
+  return true;
+}
+
+
+
+namespace {
+
+std::vector<uint8_t>
+read_file(std::string const & path)
+{
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"Could not open binary log file: " + path};
+  }
+  return std::vector<uint8_t>{std::istreambuf_iterator<char>{file},
+    std::istreambuf_iterator<char>{}};
+}
+
+
+struct decoded_statement
+{
+  level                     lvl;
+  uint64_t                  line;
+  std::string_view          file;
+  std::vector<format_item>  items = {};
+  std::vector<std::string_view> texts = {};
+};
+
+
+void
+write_timestamp(std::ostream & out, uint64_t micros)
+{
+  auto secs = static_cast<std::time_t>(micros / 1000000);
+  std::tm tm{};
+#if defined(LIBERATE_WIN32)
+  gmtime_s(&tm, &secs);
+#else
+  gmtime_r(&secs, &tm);
+#endif
+  out << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S") << '.'
+    << std::setw(6) << std::setfill('0') << (micros % 1000000)
+    << std::setfill(' ') << "Z ";
+}
+
+
+void
+decode_args(std::ostream & out, decoded_statement const & stmt,
+    reader & input)
+{
+  std::size_t text_index = 0;
+  for (auto & item : stmt.items) {
+    switch (item.kind) {
+      case ITEM_TEXT:
+        out << stmt.texts[text_index++];
+        break;
+
+      case ITEM_MANIPULATOR:
+        apply_manipulator(out, item.value);
+        break;
+
+      case ITEM_SLOT:
+        switch (item.value) {
+          case detail::ARG_BOOL:
+            out << (input.get_bytes(1)[0] != 0);
+            break;
+
+          case detail::ARG_CHAR:
+            out << input.get_bytes(1)[0];
+            break;
+
+          case detail::ARG_SIGNED:
+            out << static_cast<int64_t>(
+                input.get_varint<ser::varint_zigzag>());
+            break;
+
+          case detail::ARG_UNSIGNED:
+            out << input.get_varint<ser::varint_prefix>();
+            break;
+
+          case detail::ARG_POINTER:
+            out << reinterpret_cast<void const *>(static_cast<uintptr_t>(
+                  input.get_varint<ser::varint_prefix>()));
+            break;
+
+          case detail::ARG_DOUBLE:
+            {
+              auto bits = input.get_int<uint64_t>();
+              double value = 0;
+              std::memcpy(&value, &bits, sizeof(value));
+              out << value;
+            }
+            break;
+
+          case detail::ARG_STRING:
+            out << input.get_string();
+            break;
+
+          default:
+            throw std::runtime_error{"Malformed binary log: bad argument."};
+        }
+        break;
+
+      default:
+        throw std::runtime_error{"Malformed binary log: bad format item."};
+    }
+  }
+}
+
+} // anonymous namespace
+
+
+std::size_t
+decode_binary_log(std::ostream & out, std::string const & path,
+    bool timestamps /* = true */)
+{
+  // Dictionary
+  auto dict_data = read_file(path + ".dict");
+  if (dict_data.size() < MAGIC_SIZE + sizeof(uint64_t)
+      || std::memcmp(dict_data.data(), DICT_MAGIC, MAGIC_SIZE))
+  {
+    throw std::runtime_error{"Not a binary log dictionary: " + path
+      + ".dict"};
+  }
+  reader dict{dict_data.data(), dict_data.size(), MAGIC_SIZE};
+  auto start_time = dict.get_int<uint64_t>();
+
+  std::unordered_map<uint64_t, decoded_statement> statements;
+  while (!dict.done()) {
+    auto id = dict.get_varint();
+    decoded_statement stmt{static_cast<level>(dict.get_bytes(1)[0]),
+      dict.get_varint(), {}};
+    stmt.file = dict.get_string();
+    auto count = dict.get_varint();
+    for (uint64_t i = 0 ; i < count ; ++i) {
+      auto kind = static_cast<item_kind>(dict.get_bytes(1)[0]);
+      if (kind == ITEM_TEXT) {
+        stmt.items.push_back({kind, 0});
+        stmt.texts.push_back(dict.get_string());
+      }
+      else {
+        stmt.items.push_back({kind,
+            static_cast<uint8_t>(dict.get_bytes(1)[0])});
+      }
+    }
+    statements[id] = std::move(stmt);
+  }
+
+  // Log file
+  auto log_data = read_file(path);
+  if (log_data.size() < HEADER_SIZE
+      || std::memcmp(log_data.data(), LOG_MAGIC, MAGIC_SIZE))
+  {
+    throw std::runtime_error{"Not a binary log file: " + path};
+  }
+  reader header{log_data.data(), HEADER_SIZE, OFFSET_CAPACITY};
+  auto capacity = header.get_int<uint64_t>();
+  auto head = header.get_int<uint64_t>();
+  auto tail = header.get_int<uint64_t>();
+  if (!capacity || log_data.size() - HEADER_SIZE < capacity || tail > head
+      || head - tail > capacity)
+  {
+    throw std::runtime_error{"Malformed binary log: bad header."};
+  }
+
+  // Unwrap the ring buffer.
+  std::vector<uint8_t> frames(static_cast<std::size_t>(head - tail));
+  auto start = static_cast<std::size_t>(tail % capacity);
+  auto first = std::min<std::size_t>(frames.size(),
+      static_cast<std::size_t>(capacity) - start);
+  std::memcpy(frames.data(), log_data.data() + HEADER_SIZE + start, first);
+  std::memcpy(frames.data() + first, log_data.data() + HEADER_SIZE,
+      frames.size() - first);
+
+  std::ostringstream line;
+  std::ios default_format{nullptr};
+  default_format.copyfmt(line);
+
+  std::size_t count = 0;
+  reader input{frames.data(), frames.size()};
+  while (!input.done()) {
+    auto frame_size = input.get_varint();
+    auto frame = input.get_bytes(frame_size);
+    reader payload{reinterpret_cast<uint8_t const *>(frame.data()),
+      frame.size()};
+
+    auto id = payload.get_varint();
+    auto time = payload.get_varint();
+    auto iter = statements.find(id >> 1);
+    if (iter == statements.end()) {
+      throw std::runtime_error{"Malformed binary log: unknown statement."};
+    }
+    auto & stmt = iter->second;
+
+    line.str({});
+    line.clear();
+    line.copyfmt(default_format);
+    if (timestamps) {
+      write_timestamp(line, start_time + time);
+    }
+    line << "[" << stmt.file << ":" << stmt.line << "] "
+      << level_name(stmt.lvl) << ": ";
+    if (id & 1) {
+      line << payload.get_string();
+    }
+    else {
+      decode_args(line, stmt, payload);
+    }
+
+    out << line.str() << '\n';
+    ++count;
+  }
+  return count;
+}
+
+} // namespace liberate::logging
@@ -0,0 +1,70 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging/level.h>
+
+namespace liberate::logging {
+
+namespace detail {
+
+std::atomic<uint8_t> runtime_min_level{static_cast<uint8_t>(level::trace)};
+
+} // namespace detail
+
+
+char const *
+level_name(level lvl)
+{
+  switch (lvl) {
+    case level::trace:
+      return "TRACE";
+    case level::debug:
+      return "DEBUG";
+    case level::info:
+      return "INFO";
+    case level::warn:
+      return "WARN";
+    case level::error:
+      return "ERROR";
+    case level::fatal:
+      return "FATAL";
+  }
+  return "UNKNOWN";
+}
+
+
+
+void
+set_level(level lvl)
+{
+  detail::runtime_min_level.store(static_cast<uint8_t>(lvl),
+      std::memory_order_relaxed);
+}
+
+
+
+level
+get_level()
+{
+  return static_cast<level>(
+      detail::runtime_min_level.load(std::memory_order_relaxed));
+}
+
+} // namespace liberate::logging
@@ -0,0 +1,184 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging/record.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace liberate::logging {
+
+namespace {
+
+using header_type = detail::record_header;
+
+/**
+ * Staging buffer for records being captured. Nested log statements, e.g. in
+ * stream output operators, use their own buffer instead.
+ */
+struct staging_buffer
+{
+  std::vector<uint8_t>  buffer;
+  bool                  in_use = false;
+};
+
+thread_local staging_buffer t_staging;
+
+
+template <typename T>
+inline T
+read_value(void const * value)
+{
+  T ret;
+  std::memcpy(&ret, value, sizeof(T));
+  return ret;
+}
+
+} // anonymous namespace
+
+
+namespace detail {
+
+void
+format_args(std::ostream & out, uint8_t const * record, std::size_t size)
+{
+  for_each_arg(record, size,
+      [&out](arg_tag tag, void const * value, std::size_t value_size)
+  {
+    switch (tag) {
+      case ARG_BOOL:
+        out << read_value<bool>(value);
+        break;
+
+      case ARG_CHAR:
+        out << read_value<char>(value);
+        break;
+
+      case ARG_SIGNED:
+        out << read_value<int64_t>(value);
+        break;
+
+      case ARG_UNSIGNED:
+        out << read_value<uint64_t>(value);
+        break;
+
+      case ARG_DOUBLE:
+        out << read_value<double>(value);
+        break;
+
+      case ARG_STRING:
+      case ARG_STATIC:
+        out.write(static_cast<char const *>(value),
+            static_cast<std::streamsize>(value_size));
+        break;
+
+      case ARG_POINTER:
+        out << read_value<void const *>(value);
+        break;
+
+      case ARG_MANIPULATOR:
+        out << read_value<std::ostream & (*)(std::ostream &)>(value);
+        break;
+
+      case ARG_IOS_MANIPULATOR:
+        out << read_value<std::ios_base & (*)(std::ios_base &)>(value);
+        break;
+    }
+  });
+}
+
+} // namespace detail
+
+
+
+record_stream::record_stream(record_consumer & consumer, level lvl,
+    char const * file, unsigned line)
+  : m_consumer{consumer}
+  , m_level{lvl}
+  , m_static_text{consumer.consumes_immediately()}
+  , m_buffer{&m_own}
+{
+  if (!t_staging.in_use) {
+    t_staging.in_use = true;
+    m_buffer = &t_staging.buffer;
+  }
+
+  header_type header{};
+  header.lvl = lvl;
+  header.line = line;
+  header.file = file;
+  m_buffer->resize(sizeof(header));
+  std::memcpy(m_buffer->data(), &header, sizeof(header));
+}
+
+
+
+record_stream::~record_stream()
+{
+  auto size = m_buffer->size();
+  if (size <= std::numeric_limits<uint32_t>::max()) {
+    auto size32 = static_cast<uint32_t>(size);
+    std::memcpy(m_buffer->data() + offsetof(header_type, size), &size32,
+        sizeof(size32));
+    try {
+      m_consumer.commit(m_level, m_buffer->data(), size);
+    } catch (...) {
+      // Logging must not throw.
+    }
+  }
+
+  m_buffer->clear();
+  if (m_buffer == &t_staging.buffer) {
+    t_staging.in_use = false;
+  }
+}
+
+
+
+void
+record_stream::append_string(std::string_view value)
+{
+  auto length = static_cast<uint32_t>(std::min(value.size(),
+        std::size_t{std::numeric_limits<uint32_t>::max()}));
+  auto offset = m_buffer->size();
+  m_buffer->resize(offset + 1 + sizeof(length) + length);
+  auto out = m_buffer->data() + offset;
+  *out = detail::ARG_STRING;
+  std::memcpy(out + 1, &length, sizeof(length));
+  std::memcpy(out + 1 + sizeof(length), value.data(), length);
+}
+
+
+
+void
+record_stream::append_static(char const * text, std::size_t length)
+{
+  auto length32 = static_cast<uint32_t>(std::min(length,
+        std::size_t{std::numeric_limits<uint32_t>::max()}));
+  auto offset = m_buffer->size();
+  m_buffer->resize(offset + 1 + sizeof(text) + sizeof(length32));
+  auto out = m_buffer->data() + offset;
+  *out = detail::ARG_STATIC;
+  std::memcpy(out + 1, &text, sizeof(text));
+  std::memcpy(out + 1 + sizeof(text), &length32, sizeof(length32));
+}
+
+} // namespace liberate::logging
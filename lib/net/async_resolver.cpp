@@ -0,0 +1,439 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/async_resolver.h>
+#include <liberate/net/resolve.h>
+#include <liberate/net/resolver_backend.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace liberate::net {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+using result_type = async_resolver::result_type;
+
+
+struct request_state
+{
+  async_resolver::request_id  id = 0;
+  std::string                 hostname = {};
+  async_resolver::callback    cb = {};
+
+  // Set once the request completed in any way; whoever sets it first
+  // invokes the callback.
+  std::atomic<bool>           done = false;
+
+  // Merged results of the individual lookups.
+  std::mutex                  mutex = {};
+  std::size_t                 outstanding = 0;
+  std::size_t                 succeeded = 0;
+  result_type                 results = {};
+  std::exception_ptr          error = {};
+
+  // Protected by the resolver's mutex.
+  bool                                            has_deadline = false;
+  std::multimap<clock::time_point,
+    std::weak_ptr<request_state>>::iterator       deadline = {};
+};
+
+using request_ptr = std::shared_ptr<request_state>;
+
+
+struct job
+{
+  request_ptr   request;
+  address_type  type;
+};
+
+
+inline std::exception_ptr
+make_error(std::errc code, char const * what)
+{
+  return std::make_exception_ptr(std::system_error{
+      std::make_error_code(code), what});
+}
+
+} // anonymous namespace
+
+
+struct async_resolver::async_resolver_impl
+{
+  lookup_function                                       lookup;
+
+  std::mutex                                            mutex = {};
+  std::condition_variable                               work_condition = {};
+  std::condition_variable                               timer_condition = {};
+  bool                                                  stopping = false;
+
+  std::deque<job>                                       jobs = {};
+  std::multimap<clock::time_point,
+    std::weak_ptr<request_state>>                       deadlines = {};
+  std::map<request_id, std::weak_ptr<request_state>>    requests = {};
+  request_id                                            next_id = 0;
+
+  std::vector<std::thread>                              workers = {};
+  std::thread                                           timer = {};
+
+
+  async_resolver_impl(lookup_function && _lookup,
+      async_resolver_options const & options)
+    : lookup{std::move(_lookup)}
+  {
+    if (!lookup) {
+      throw std::invalid_argument("Need to provide a lookup function.");
+    }
+    if (!options.workers) {
+      throw std::invalid_argument("Need at least one worker.");
+    }
+
+    for (std::size_t i = 0 ; i < options.workers ; ++i) {
+      workers.emplace_back([this]() { work(); });
+    }
+    timer = std::thread{[this]() { watch_deadlines(); }};
+  }
+
+
+  ~async_resolver_impl()
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      stopping = true;
+    }
+    work_condition.notify_all();
+    timer_condition.notify_all();
+
+    for (auto & worker : workers) {
+      worker.join();
+    }
+    timer.join();
+
+    // Whatever is left did not complete.
+    std::vector<request_ptr> remaining;
+    for (auto & [id, weak] : requests) {
+      auto req = weak.lock();
+      if (req) {
+        remaining.push_back(req);
+      }
+    }
+    for (auto & req : remaining) {
+      complete(req, {}, make_error(std::errc::operation_canceled,
+            "Resolver shut down."));
+    }
+  }
+
+
+  /**
+   * Completes the request, unless that already happened.
+   */
+  void
+  complete(request_ptr const & req, result_type const & results,
+      std::exception_ptr error)
+  {
+    if (req->done.exchange(true)) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      requests.erase(req->id);
+      if (req->has_deadline) {
+        deadlines.erase(req->deadline);
+        req->has_deadline = false;
+      }
+    }
+
+    req->cb(results, error);
+  }
+
+
+  void
+  work()
+  {
+    while (true) {
+      job next;
+      {
+        std::unique_lock<std::mutex> lock{mutex};
+        work_condition.wait(lock, [this]() {
+            return stopping || !jobs.empty();
+        });
+        if (stopping) {
+          return;
+        }
+        next = std::move(jobs.front());
+        jobs.pop_front();
+      }
+
+      auto & req = next.request;
+      if (req->done) {
+        // Cancelled or timed out while queued.
+        continue;
+      }
+
+      result_type results;
+      std::exception_ptr error;
+      try {
+        results = lookup(next.type, req->hostname);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      bool finished = false;
+      {
+        std::lock_guard<std::mutex> lock{req->mutex};
+        if (error) {
+          if (!req->error) {
+            req->error = error;
+          }
+        }
+        else {
+          ++req->succeeded;
+          for (auto & addr : results) {
+            if (std::find(req->results.begin(), req->results.end(), addr)
+                == req->results.end())
+            {
+              req->results.push_back(addr);
+            }
+          }
+        }
+
+        finished = (--req->outstanding == 0);
+        if (finished) {
+          // The lookups finish in any order; sort merged results.
+          results = std::move(req->results);
+          if (req->succeeded > 1) {
+            sort_by_preference(results);
+          }
+          error = req->succeeded ? std::exception_ptr{} : req->error;
+        }
+      }
+
+      if (finished) {
+        complete(req, results, error);
+      }
+    }
+  }
+
+
+  void
+  watch_deadlines()
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    while (!stopping) {
+      if (deadlines.empty()) {
+        timer_condition.wait(lock);
+        continue;
+      }
+
+      auto first = deadlines.begin();
+      if (clock::now() < first->first) {
+        timer_condition.wait_until(lock, first->first);
+        continue;
+      }
+
+      auto req = first->second.lock();
+      deadlines.erase(first);
+      if (!req) {
+        continue;
+      }
+      req->has_deadline = false;
+
+      lock.unlock();
+      complete(req, {}, make_error(std::errc::timed_out,
+            "Resolution timed out."));
+      lock.lock();
+    }
+  }
+
+
+  request_id
+  start(address_type type, std::string const & hostname, callback && cb,
+      std::chrono::milliseconds timeout)
+  {
+    if (hostname.empty()) {
+      throw std::invalid_argument("Need to provide a hostname.");
+    }
+
+    auto req = std::make_shared<request_state>();
+    req->hostname = hostname;
+    req->cb = std::move(cb);
+
+    switch (type) {
+      case AT_UNSPEC:
+        req->outstanding = 2;
+        break;
+
+      case AT_INET4:
+      case AT_INET6:
+        req->outstanding = 1;
+        break;
+
+      default:
+        throw std::invalid_argument("Unsupported address type specified.");
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (stopping) {
+        throw std::logic_error("Resolver is shutting down.");
+      }
+
+      req->id = ++next_id;
+      requests[req->id] = req;
+
+      if (timeout > std::chrono::milliseconds::zero()) {
+        req->deadline = deadlines.emplace(clock::now() + timeout, req);
+        req->has_deadline = true;
+        timer_condition.notify_one();
+      }
+
+      // Issue both lookups at once, so that they run in parallel.
+      if (AT_UNSPEC == type) {
+        jobs.push_back({req, AT_INET4});
+        jobs.push_back({req, AT_INET6});
+      }
+      else {
+        jobs.push_back({req, type});
+      }
+    }
+    work_condition.notify_all();
+
+    return req->id;
+  }
+
+
+  bool
+  cancel(request_id id)
+  {
+    request_ptr req;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      auto iter = requests.find(id);
+      if (iter == requests.end()) {
+        return false;
+      }
+      req = iter->second.lock();
+    }
+
+    if (!req || req->done) {
+      return false;
+    }
+    complete(req, {}, make_error(std::errc::operation_canceled,
+          "Resolution cancelled."));
+    return true;
+  }
+};
+
+
+
+async_resolver::async_resolver(api & api,
+    async_resolver_options const & options)
+  : m_impl{std::make_unique<async_resolver_impl>(
+      [&api](address_type type, std::string const & hostname)
+      {
+        return ::liberate::net::resolve(api, type, hostname);
+      },
+      options)}
+{
+}
+
+
+
+async_resolver::async_resolver(resolver_backend & backend,
+    async_resolver_options const & options)
+  : m_impl{std::make_unique<async_resolver_impl>(
+      [&backend](address_type type, std::string const & hostname)
+      {
+        return ::liberate::net::resolve(backend, type, hostname);
+      },
+      options)}
+{
+}
+
+
+
+async_resolver::async_resolver(lookup_function && lookup,
+    async_resolver_options const & options)
+  : m_impl{std::make_unique<async_resolver_impl>(std::move(lookup), options)}
+{
+}
+
+
+
+async_resolver::~async_resolver() = default;
+
+
+
+async_resolver::request_id
+async_resolver::resolve(address_type type, std::string const & hostname,
+    callback && cb, std::chrono::milliseconds timeout)
+{
+  if (!cb) {
+    throw std::invalid_argument("Need to provide a callback.");
+  }
+  return m_impl->start(type, hostname, std::move(cb), timeout);
+}
+
+
+
+std::future<async_resolver::result_type>
+async_resolver::resolve(address_type type, std::string const & hostname,
+    std::chrono::milliseconds timeout, request_id * id)
+{
+  auto promise = std::make_shared<std::promise<result_type>>();
+  auto future = promise->get_future();
+
+  auto started = m_impl->start(type, hostname,
+      [promise](result_type const & results, std::exception_ptr error)
+      {
+        if (error) {
+          promise->set_exception(error);
+        }
+        else {
+          promise->set_value(results);
+        }
+      },
+      timeout);
+
+  if (id) {
+    *id = started;
+  }
+  return future;
+}
+
+
+
+bool
+async_resolver::cancel(request_id id)
+{
+  return m_impl->cancel(id);
+}
+
+} // namespace liberate::net
@@ -0,0 +1,276 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <build-config.h>
+
+#include <liberate/net/flow_key.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "netincludes.h"
+
+namespace liberate::net {
+
+namespace {
+
+constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+
+// Finalizer from MurmurHash3
+inline uint64_t
+fmix64(uint64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+
+inline uint64_t
+mix_in(uint64_t hash, uint64_t word)
+{
+  hash = (hash ^ word) * MULTIPLIER;
+  return (hash << 31) | (hash >> 33);
+}
+
+
+inline uint64_t
+hash_endpoints(flow_key const & key,
+    flow_key::address_bytes const & first, uint16_t first_port,
+    flow_key::address_bytes const & second, uint16_t second_port,
+    uint64_t seed)
+{
+  uint64_t words[4];
+  std::memcpy(words, first.data(), 16);
+  std::memcpy(words + 2, second.data(), 16);
+
+  auto hash = seed ^ ((uint64_t{first_port} << 48)
+      | (uint64_t{second_port} << 32)
+      | (uint64_t{key.protocol} << 16)
+      | (uint64_t{key.has_ports} << 8)
+      | static_cast<uint8_t>(key.type));
+  for (auto word : words) {
+    hash = mix_in(hash, word);
+  }
+  return fmix64(hash);
+}
+
+
+inline void
+copy_address(flow_key::address_bytes & bytes, socket_address const & addr)
+{
+  bytes.fill(::liberate::types::byte{0});
+  if (AT_INET4 == addr.type()) {
+    std::memcpy(bytes.data(),
+        &(static_cast<sockaddr_in const *>(addr.buffer())->sin_addr), 4);
+  }
+  else {
+    std::memcpy(bytes.data(),
+        &(static_cast<sockaddr_in6 const *>(addr.buffer())->sin6_addr), 16);
+  }
+}
+
+} // anonymous namespace
+
+
+flow_key::flow_key(packet_headers const & headers, size_t index)
+  : type{headers.type[index]}
+  , protocol{headers.protocol[index]}
+  , has_ports{0 != (headers.flags[index] & packet_headers::PH_PORTS)}
+  , source{headers.source[index]}
+  , dest{headers.dest[index]}
+  , source_port{headers.source_port[index]}
+  , dest_port{headers.dest_port[index]}
+{
+}
+
+
+
+flow_key::flow_key(uint8_t _protocol, socket_address const & _source,
+    socket_address const & _dest)
+  : type{_source.type()}
+  , protocol{_protocol}
+  , has_ports{true}
+  , source_port{_source.port()}
+  , dest_port{_dest.port()}
+{
+  if ((type != AT_INET4 && type != AT_INET6) || type != _dest.type()) {
+    throw std::invalid_argument("Flow keys need two IPv4 or two IPv6 "
+        "addresses.");
+  }
+
+  copy_address(source, _source);
+  copy_address(dest, _dest);
+}
+
+
+
+flow_key
+flow_key::reversed() const
+{
+  flow_key ret{*this};
+  std::swap(ret.source, ret.dest);
+  std::swap(ret.source_port, ret.dest_port);
+  return ret;
+}
+
+
+
+size_t
+flow_key::hash() const
+{
+  return static_cast<size_t>(hash_endpoints(*this, source, source_port,
+        dest, dest_port, 0));
+}
+
+
+
+bool
+flow_key::is_equal_to(flow_key const & other) const
+{
+  return type == other.type && protocol == other.protocol
+    && has_ports == other.has_ports
+    && source_port == other.source_port && dest_port == other.dest_port
+    && source == other.source && dest == other.dest;
+}
+
+
+
+bool
+flow_key::is_less_than(flow_key const & other) const
+{
+  return std::tie(type, protocol, has_ports, source, dest, source_port,
+      dest_port) < std::tie(other.type, other.protocol, other.has_ports,
+        other.source, other.dest, other.source_port, other.dest_port);
+}
+
+
+
+uint64_t
+symmetric_flow_hash(flow_key const & key, uint64_t seed /* = 0 */)
+{
+  // Hash the endpoints in a fixed order, regardless of direction.
+  auto cmp = std::memcmp(key.source.data(), key.dest.data(),
+      key.source.size());
+  if (cmp < 0 || (0 == cmp && key.source_port <= key.dest_port)) {
+    return hash_endpoints(key, key.source, key.source_port, key.dest,
+        key.dest_port, seed);
+  }
+  return hash_endpoints(key, key.dest, key.dest_port, key.source,
+      key.source_port, seed);
+}
+
+
+
+toeplitz_hash::toeplitz_hash(key_type const & key /* = DEFAULT_KEY */)
+  : toeplitz_hash{key.data(), key.size()}
+{
+}
+
+
+
+toeplitz_hash::toeplitz_hash(uint8_t const * key, size_t key_size)
+{
+  if (!key || key_size < 8) {
+    throw std::invalid_argument("Toeplitz keys must be at least 8 Bytes.");
+  }
+
+  // Input bit n contributes the 32 key bits starting at bit n.
+  auto input_size = key_size - 4;
+  m_table.resize(input_size * 256);
+  for (size_t pos = 0 ; pos < input_size ; ++pos) {
+    uint64_t window = 0;
+    for (size_t i = 0 ; i < 5 ; ++i) {
+      window = (window << 8) | key[pos + i];
+    }
+
+    uint32_t bits[8];
+    for (size_t bit = 0 ; bit < 8 ; ++bit) {
+      bits[bit] = static_cast<uint32_t>(window >> (8 - bit));
+    }
+
+    auto table = m_table.data() + pos * 256;
+    for (size_t value = 0 ; value < 256 ; ++value) {
+      uint32_t result = 0;
+      for (size_t bit = 0 ; bit < 8 ; ++bit) {
+        if (value & (0x80 >> bit)) {
+          result ^= bits[bit];
+        }
+      }
+      table[value] = result;
+    }
+  }
+}
+
+
+
+uint32_t
+toeplitz_hash::operator()(uint8_t const * input, size_t size) const
+{
+  if (size > max_input_size()) {
+    throw std::invalid_argument("Input exceeds the Toeplitz key size.");
+  }
+
+  uint32_t result = 0;
+  auto table = m_table.data();
+  for (size_t i = 0 ; i < size ; ++i, table += 256) {
+    result ^= table[input[i]];
+  }
+  return result;
+}
+
+
+
+uint32_t
+toeplitz_hash::operator()(flow_key const & key) const
+{
+  size_t address_size = 0;
+  switch (key.type) {
+    case AT_INET4:
+      address_size = 4;
+      break;
+
+    case AT_INET6:
+      address_size = 16;
+      break;
+
+    default:
+      return 0;
+  }
+
+  uint8_t input[36];
+  std::memcpy(input, key.source.data(), address_size);
+  std::memcpy(input + address_size, key.dest.data(), address_size);
+  auto size = address_size * 2;
+  if (key.has_ports) {
+    input[size++] = static_cast<uint8_t>(key.source_port >> 8);
+    input[size++] = static_cast<uint8_t>(key.source_port);
+    input[size++] = static_cast<uint8_t>(key.dest_port >> 8);
+    input[size++] = static_cast<uint8_t>(key.dest_port);
+  }
+  return (*this)(input, size);
+}
+
+} // namespace liberate::net
@@ -20,6 +20,8 @@
 #include <liberate/net/ip.h>
 #include <liberate/net/address_type.h>
 
+#include <cstring>
+
 #include "../macros.h"
 
 namespace liberate::net {
@@ -95,6 +97,215 @@ parse_address_helper(socket_address * source, socket_address * dest,
   return false;
 }
 
+// Protocol numbers, see https://www.iana.org/assignments/protocol-numbers
+constexpr uint8_t PROTO_HOPOPTS = 0;
+constexpr uint8_t PROTO_TCP = 6;
+constexpr uint8_t PROTO_UDP = 17;
+constexpr uint8_t PROTO_DCCP = 33;
+constexpr uint8_t PROTO_ROUTING = 43;
+constexpr uint8_t PROTO_FRAGMENT = 44;
+constexpr uint8_t PROTO_AH = 51;
+constexpr uint8_t PROTO_DSTOPTS = 60;
+constexpr uint8_t PROTO_SCTP = 132;
+constexpr uint8_t PROTO_MOBILITY = 135;
+constexpr uint8_t PROTO_UDPLITE = 136;
+constexpr uint8_t PROTO_HIP = 139;
+constexpr uint8_t PROTO_SHIM6 = 140;
+
+constexpr size_t IPV4_MIN_HEADER = 20;
+constexpr size_t IPV6_HEADER = 40;
+
+
+inline uint8_t
+read_u8(::liberate::types::byte const * buffer, size_t offset)
+{
+  return static_cast<uint8_t>(buffer[offset]);
+}
+
+
+inline uint16_t
+read_u16(::liberate::types::byte const * buffer, size_t offset)
+{
+  return static_cast<uint16_t>((read_u8(buffer, offset) << 8)
+      | read_u8(buffer, offset + 1));
+}
+
+
+inline bool
+has_ports(uint8_t protocol)
+{
+  switch (protocol) {
+    case PROTO_TCP:
+    case PROTO_UDP:
+    case PROTO_DCCP:
+    case PROTO_SCTP:
+    case PROTO_UDPLITE:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+
+/**
+ * Follow the IPv6 extension header chain, starting with the next header
+ * field of the fixed header. Returns false if the chain exceeds the buffer.
+ */
+inline bool
+skip_ipv6_extensions(uint8_t & protocol, size_t & offset, uint8_t & flags,
+    bool & first_fragment, ::liberate::types::byte const * buffer,
+    size_t bufsize)
+{
+  while (true) {
+    size_t length = 0;
+    switch (protocol) {
+      case PROTO_HOPOPTS:
+      case PROTO_ROUTING:
+      case PROTO_DSTOPTS:
+      case PROTO_MOBILITY:
+      case PROTO_HIP:
+      case PROTO_SHIM6:
+        if (offset + 2 > bufsize) {
+          return false;
+        }
+        length = (size_t{read_u8(buffer, offset + 1)} + 1) * 8;
+        break;
+
+      case PROTO_FRAGMENT:
+        if (offset + 8 > bufsize) {
+          return false;
+        }
+        length = 8;
+        flags |= packet_headers::PH_FRAGMENT;
+        // The upper 13 bits are the fragment offset.
+        first_fragment = !(read_u16(buffer, offset + 2) & 0xfff8);
+        if (!first_fragment) {
+          // Later fragments continue the payload of the original packet, so
+          // there are no more headers to follow.
+          protocol = read_u8(buffer, offset);
+          offset += length;
+          return true;
+        }
+        break;
+
+      case PROTO_AH:
+        if (offset + 2 > bufsize) {
+          return false;
+        }
+        length = (size_t{read_u8(buffer, offset + 1)} + 2) * 4;
+        break;
+
+      default:
+        // Transport header, or something we cannot look past.
+        return offset <= bufsize;
+    }
+
+    protocol = read_u8(buffer, offset);
+    offset += length;
+  }
+}
+
+
+/**
+ * Parse a single packet into the given index of the headers; all fields are
+ * written, so that nothing from previous batches remains.
+ */
+inline bool
+parse_headers_helper(packet_headers & headers, size_t index,
+    ::liberate::types::byte const * buffer, size_t bufsize)
+{
+  auto & source = headers.source[index];
+  auto & dest = headers.dest[index];
+
+  address_type type = AT_UNSPEC;
+  uint8_t flags = 0;
+  uint8_t protocol = 0;
+  size_t offset = 0;
+  bool first_fragment = true;
+
+  uint8_t proto = bufsize ? (read_u8(buffer, 0) >> 4) : 0;
+  if (4 == proto && bufsize >= IPV4_MIN_HEADER) {
+    offset = static_cast<size_t>(read_u8(buffer, 0) & 0x0f) * 4;
+    if (offset >= IPV4_MIN_HEADER && offset <= bufsize) {
+      type = AT_INET4;
+      protocol = read_u8(buffer, 9);
+
+      // More fragments flag and fragment offset
+      auto fragment = read_u16(buffer, 6);
+      if (fragment & 0x3fff) {
+        flags |= packet_headers::PH_FRAGMENT;
+        first_fragment = !(fragment & 0x1fff);
+      }
+
+      std::memcpy(source.data(), buffer + 12, 4);
+      std::memset(source.data() + 4, 0, source.size() - 4);
+      std::memcpy(dest.data(), buffer + 16, 4);
+      std::memset(dest.data() + 4, 0, dest.size() - 4);
+    }
+  }
+  else if (6 == proto && bufsize >= IPV6_HEADER) {
+    protocol = read_u8(buffer, 6);
+    offset = IPV6_HEADER;
+    if (skip_ipv6_extensions(protocol, offset, flags, first_fragment, buffer,
+          bufsize) && offset <= UINT16_MAX)
+    {
+      type = AT_INET6;
+      std::memcpy(source.data(), buffer + 8, 16);
+      std::memcpy(dest.data(), buffer + 24, 16);
+    }
+  }
+
+  headers.type[index] = type;
+  if (AT_UNSPEC == type) {
+    headers.flags[index] = 0;
+    headers.protocol[index] = 0;
+    headers.transport_offset[index] = 0;
+    source.fill(::liberate::types::byte{0});
+    dest.fill(::liberate::types::byte{0});
+    headers.source_port[index] = 0;
+    headers.dest_port[index] = 0;
+    return false;
+  }
+
+  uint16_t source_port = 0;
+  uint16_t dest_port = 0;
+  if (first_fragment && has_ports(protocol) && offset + 4 <= bufsize) {
+    flags |= packet_headers::PH_PORTS;
+    source_port = read_u16(buffer, offset);
+    dest_port = read_u16(buffer, offset + 2);
+  }
+
+  headers.flags[index] = flags;
+  headers.protocol[index] = protocol;
+  headers.transport_offset[index] = static_cast<uint16_t>(offset);
+  headers.source_port[index] = source_port;
+  headers.dest_port[index] = dest_port;
+  return true;
+}
+
+
+inline socket_address
+make_address(address_type type, packet_headers::address_bytes const & bytes,
+    bool has_port, uint16_t port)
+{
+  if (!has_port) {
+    port = 0;
+  }
+
+  switch (type) {
+    case AT_INET4:
+      return socket_address{AT_INET4, bytes.data(), 4, port};
+
+    case AT_INET6:
+      return socket_address{AT_INET6, bytes.data(), 16, port};
+
+    default:
+      return socket_address{};
+  }
+}
+
+
 } // anonymous namespace
 
 
@@ -122,4 +333,54 @@ parse_dest_address(socket_address & dest,
 }
 
 
+void
+packet_headers::resize(size_t size)
+{
+  type.resize(size);
+  flags.resize(size);
+  protocol.resize(size);
+  transport_offset.resize(size);
+  source.resize(size);
+  dest.resize(size);
+  source_port.resize(size);
+  dest_port.resize(size);
+}
+
+
+socket_address
+packet_headers::source_address(size_t index) const
+{
+  return make_address(type[index], source[index], flags[index] & PH_PORTS,
+      source_port[index]);
+}
+
+
+socket_address
+packet_headers::dest_address(size_t index) const
+{
+  return make_address(type[index], dest[index], flags[index] & PH_PORTS,
+      dest_port[index]);
+}
+
+
+size_t
+parse_headers(packet_headers & headers,
+    ::liberate::serialization::const_segment const * packets, size_t amount)
+{
+  if (!packets) {
+    amount = 0;
+  }
+  headers.resize(amount);
+
+  size_t parsed = 0;
+  for (size_t i = 0 ; i < amount ; ++i) {
+    auto bufsize = packets[i].data ? packets[i].size : 0;
+    if (parse_headers_helper(headers, i, packets[i].data, bufsize)) {
+      ++parsed;
+    }
+  }
+  return parsed;
+}
+
+
 } // namespace liberate::net
@@ -25,6 +25,8 @@
 #include <cstring>
 #include <cmath>
 
+#include <algorithm>
+#include <bitset>
 #include <functional>
 #include <set>
 #include <sstream>
@@ -46,22 +48,38 @@ namespace {
 
 inline uint32_t make_mask32(size_t mask_size)
 {
-  uint32_t mask = 0;
-  for (size_t i = 0 ; i < mask_size ; ++i) {
-    mask |= 1 << (31 - i);
+  if (!mask_size) {
+    return 0;
   }
-  return mask;
+  return ~uint32_t{0} << (32 - mask_size);
 }
 
 
-inline void make_mask128(sockaddr_in6 & mask, size_t mask_size)
+inline void make_mask128(uint64_t (&mask)[2], size_t mask_size)
 {
-  ::memset(mask.sin6_addr.s6_addr, 0, 16);
-  for (ssize_t i = mask_size, j = 0 ; i > 0 ; i -= 8, ++j) {
-    mask.sin6_addr.s6_addr[j] = i >= 8
-      ? 0xff
-      : 0xff << (8 - i);
+  // Build the mask in network Byte order, then treat it as two words. That
+  // way, the words can be applied to addresses without caring about the host
+  // Byte order.
+  uint8_t bytes[16];
+  size_t full = mask_size / 8;
+  ::memset(bytes, 0xff, full);
+  ::memset(bytes + full, 0, 16 - full);
+  if (full < 16 && mask_size % 8) {
+    bytes[full] = static_cast<uint8_t>(0xff << (8 - (mask_size % 8)));
   }
+  ::memcpy(mask, bytes, sizeof(bytes));
+}
+
+
+inline void load128(uint64_t (&words)[2], in6_addr const & addr)
+{
+  ::memcpy(words, addr.s6_addr, sizeof(words));
+}
+
+
+inline void store128(in6_addr & addr, uint64_t const (&words)[2])
+{
+  ::memcpy(addr.s6_addr, words, sizeof(words));
 }
 
 
@@ -102,6 +120,13 @@ struct network::network_impl
   sa_family_t               m_family;
   std::set<socket_address>  m_allocated;
 
+  // Masks and the masked network address, precomputed in network Byte order
+  // for the given family.
+  uint32_t                  m_mask32 = 0;
+  uint32_t                  m_masked32 = 0;
+  uint64_t                  m_mask128[2] = { 0, 0 };
+  uint64_t                  m_masked128[2] = { 0, 0 };
+
   inline explicit network_impl(std::string const & netspec)
     : m_netspec(netspec)
     , m_network("0.0.0.0") // Fake for now, see below
@@ -119,6 +144,34 @@ struct network::network_impl
     }
     m_mask_size = result.mask;
     m_family = result.proto;
+
+    if (AF_INET == m_family) {
+      m_mask32 = htonl(make_mask32(m_mask_size));
+      m_masked32 = m_network.data.sa_in.sin_addr.s_addr & m_mask32;
+    }
+    else {
+      make_mask128(m_mask128, m_mask_size);
+      load128(m_masked128, m_network.data.sa_in6.sin6_addr);
+      m_masked128[0] &= m_mask128[0];
+      m_masked128[1] &= m_mask128[1];
+    }
+  }
+
+
+  inline bool contains(detail::address_data const & data) const
+  {
+    if (data.sa_storage.ss_family != m_family) {
+      return false;
+    }
+
+    if (AF_INET == m_family) {
+      return (data.sa_in.sin_addr.s_addr & m_mask32) == m_masked32;
+    }
+
+    uint64_t words[2];
+    load128(words, data.sa_in6.sin6_addr);
+    return ((words[0] & m_mask128[0]) == m_masked128[0])
+      && ((words[1] & m_mask128[1]) == m_masked128[1]);
   }
 
 
@@ -219,8 +272,36 @@ bool
 network::in_network(socket_address const & address) const
 {
   // Thanks to bitmasking magic, the address is in the network if it's masked
-  // version is the same as the network address.
-  return network_address() == make_masked(address);
+  // version is the same as the network address. We don't need to construct
+  // either address for that, though; the precomputed masks are sufficient.
+  return m_impl->contains(address.data);
+}
+
+
+
+size_t
+network::in_network(socket_address const * addresses, size_t amount,
+    uint64_t * bitmap) const
+{
+  if (!amount) {
+    return 0;
+  }
+  if (nullptr == addresses || nullptr == bitmap) {
+    throw std::invalid_argument{"Need addresses and a bitmap to write to."};
+  }
+
+  size_t found = 0;
+  for (size_t word = 0 ; word < (amount + 63) / 64 ; ++word) {
+    uint64_t bits = 0;
+    size_t limit = std::min(amount - word * 64, size_t{64});
+    for (size_t bit = 0 ; bit < limit ; ++bit) {
+      bits |= uint64_t{m_impl->contains(addresses[word * 64 + bit].data)}
+        << bit;
+    }
+    bitmap[word] = bits;
+    found += std::bitset<64>{bits}.count();
+  }
+  return found;
 }
 
 
@@ -255,24 +336,17 @@ network::broadcast_address() const
   if (AF_INET == m_impl->m_family) {
     // IPv4 addresses are pretty easy to handle. They're 32 bits long, so all
     // we need is a 32 bit mask for them.
-    uint32_t mask = make_mask32(m_impl->m_mask_size);
-
-    // Apply the mask
-    uint32_t ip = ntohl(addr.data.sa_in.sin_addr.s_addr);
-    ip |= ~mask;
-    addr.data.sa_in.sin_addr.s_addr = htonl(ip);
+    addr.data.sa_in.sin_addr.s_addr |= ~m_impl->m_mask32;
     addr.data.sa_in.sin_port = htons(UINT16_MAX);
   }
   else {
     // IPv6 addresses are a bit more difficult, because there are no (portable)
-    // 128 bit operations available.
-    sockaddr_in6 mask;
-    make_mask128(mask, m_impl->m_mask_size);
-
-    // Apply the mask
-    for (size_t i = 0 ; i < 16 ; ++i) {
-      addr.data.sa_in6.sin6_addr.s6_addr[i] |= ~mask.sin6_addr.s6_addr[i];
-    }
+    // 128 bit operations available. Two 64 bit words do the trick.
+    uint64_t words[2];
+    load128(words, addr.data.sa_in6.sin6_addr);
+    words[0] |= ~m_impl->m_mask128[0];
+    words[1] |= ~m_impl->m_mask128[1];
+    store128(addr.data.sa_in6.sin6_addr, words);
     addr.data.sa_in6.sin6_port = htons(UINT16_MAX);
   }
 
@@ -480,24 +554,17 @@ network::make_masked(socket_address const & input) const
   if (AF_INET == m_impl->m_family) {
     // IPv4 addresses are pretty easy to handle. They're 32 bits long, so all
     // we need is a 32 bit mask for them.
-    uint32_t mask = make_mask32(m_impl->m_mask_size);
-
-    // Apply the mask
-    uint32_t ip = ntohl(addr.data.sa_in.sin_addr.s_addr);
-    ip &= mask;
-    addr.data.sa_in.sin_addr.s_addr = htonl(ip);
+    addr.data.sa_in.sin_addr.s_addr &= m_impl->m_mask32;
     addr.data.sa_in.sin_port = 0;
   }
   else {
     // IPv6 addresses are a bit more difficult, because there are no (portable)
-    // 128 bit operations available.
-    sockaddr_in6 mask;
-    make_mask128(mask, m_impl->m_mask_size);
-
-    // Apply the mask
-    for (size_t i = 0 ; i < 16 ; ++i) {
-      addr.data.sa_in6.sin6_addr.s6_addr[i] &= mask.sin6_addr.s6_addr[i];
-    }
+    // 128 bit operations available. Two 64 bit words do the trick.
+    uint64_t words[2];
+    load128(words, addr.data.sa_in6.sin6_addr);
+    words[0] &= m_impl->m_mask128[0];
+    words[1] &= m_impl->m_mask128[1];
+    store128(addr.data.sa_in6.sin6_addr, words);
     addr.data.sa_in6.sin6_port = 0;
   }
 
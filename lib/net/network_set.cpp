@@ -0,0 +1,711 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#include <build-config.h>
+
+#include <liberate/net/network_set.h>
+
+#include <algorithm>
+
+namespace liberate::net {
+
+/*****************************************************************************
+ * Helper functions
+ **/
+namespace {
+
+/**
+ * There are no portable 128 bit integers, so we use a pair of 64 bit
+ * integers to represent addresses numerically. IPv4 addresses just use the
+ * lower 32 bits.
+ **/
+struct address_value
+{
+  uint64_t hi = 0;
+  uint64_t lo = 0;
+
+  inline bool operator==(address_value const & other) const
+  {
+    return hi == other.hi && lo == other.lo;
+  }
+
+  inline bool operator<(address_value const & other) const
+  {
+    return hi < other.hi || (hi == other.hi && lo < other.lo);
+  }
+
+  inline address_value operator|(address_value const & other) const
+  {
+    return {hi | other.hi, lo | other.lo};
+  }
+};
+
+LIBERATE_MAKE_COMPARABLE(address_value)
+
+
+inline address_value
+successor(address_value value)
+{
+  ++value.lo;
+  if (!value.lo) {
+    ++value.hi;
+  }
+  return value;
+}
+
+
+inline address_value
+predecessor(address_value value)
+{
+  if (!value.lo) {
+    --value.hi;
+  }
+  --value.lo;
+  return value;
+}
+
+
+/**
+ * Return a value with the lowest bits set.
+ **/
+inline address_value
+low_bits(size_t bits)
+{
+  constexpr uint64_t all = ~uint64_t{0};
+  if (bits >= 128) {
+    return {all, all};
+  }
+  if (bits > 64) {
+    return {all >> (128 - bits), all};
+  }
+  if (bits == 64) {
+    return {0, all};
+  }
+  if (bits > 0) {
+    return {0, all >> (64 - bits)};
+  }
+  return {0, 0};
+}
+
+
+inline size_t
+trailing_zeros(address_value const & value)
+{
+  size_t offset = 0;
+  uint64_t part = value.lo;
+  if (!part) {
+    if (!value.hi) {
+      return 128;
+    }
+    offset = 64;
+    part = value.hi;
+  }
+
+  size_t count = 0;
+  for ( ; !(part & 1) ; part >>= 1, ++count); //!OCLINT
+  return offset + count;
+}
+
+
+inline size_t
+address_bits(address_type type)
+{
+  return AT_INET4 == type ? 32 : 128;
+}
+
+
+inline address_value
+to_value(socket_address const & address)
+{
+  uint8_t buf[16] = {};
+  auto size = address.serialize(buf, sizeof(buf), false, false);
+
+  address_value ret;
+  for (size_t i = 0 ; i < size ; ++i) {
+    ret.hi = (ret.hi << 8) | (ret.lo >> 56);
+    ret.lo = (ret.lo << 8) | buf[i];
+  }
+  return ret;
+}
+
+
+inline socket_address
+from_value(address_type type, address_value const & value)
+{
+  uint8_t buf[16] = {};
+  size_t size = address_bits(type) / 8;
+
+  for (size_t i = 0 ; i < size ; ++i) {
+    size_t shift = (size - 1 - i) * 8;
+    if (shift >= 64) {
+      buf[i] = static_cast<uint8_t>(value.hi >> (shift - 64));
+    }
+    else {
+      buf[i] = static_cast<uint8_t>(value.lo >> shift);
+    }
+  }
+
+  return socket_address{type, buf, size};
+}
+
+
+inline network
+make_network(address_type type, address_value const & value, size_t mask)
+{
+  return network{from_value(type, value).cidr_str() + "/"
+    + std::to_string(mask)};
+}
+
+
+/**
+ * Ranges are inclusive. Range lists are sorted, and ranges within them
+ * neither overlap nor are adjacent.
+ **/
+struct address_range
+{
+  address_value first;
+  address_value last;
+
+  inline bool operator==(address_range const & other) const
+  {
+    return first == other.first && last == other.last;
+  }
+
+  inline bool operator<(address_range const & other) const
+  {
+    if (first == other.first) {
+      return last < other.last;
+    }
+    return first < other.first;
+  }
+};
+
+using range_list = std::vector<address_range>;
+
+
+inline range_list::iterator
+first_touching(range_list & list, address_value const & value)
+{
+  // The first range that is not entirely before value, and not adjacent
+  // to it either.
+  return std::partition_point(list.begin(), list.end(),
+      [&value](address_range const & range)
+      {
+        return range.last < value && successor(range.last) != value;
+      });
+}
+
+
+inline range_list::const_iterator
+first_overlapping(range_list const & list, address_value const & value)
+{
+  return std::partition_point(list.begin(), list.end(),
+      [&value](address_range const & range)
+      {
+        return range.last < value;
+      });
+}
+
+
+void
+add_range(range_list & list, address_value first, address_value last)
+{
+  auto begin = first_touching(list, first);
+  auto end = begin;
+  for ( ; end != list.end()
+      && (end->first <= last || end->first == successor(last)) ; ++end); //!OCLINT
+
+  if (begin != end) {
+    first = std::min(first, begin->first);
+    last = std::max(last, (end - 1)->last);
+  }
+
+  auto pos = list.erase(begin, end);
+  list.insert(pos, {first, last});
+}
+
+
+void
+remove_range(range_list & list, address_value const & first,
+    address_value const & last)
+{
+  auto begin = std::partition_point(list.begin(), list.end(),
+      [&first](address_range const & range)
+      {
+        return range.last < first;
+      });
+  auto end = begin;
+  for ( ; end != list.end() && end->first <= last ; ++end); //!OCLINT
+
+  if (begin == end) {
+    return;
+  }
+
+  // Only the first and last affected range can have remainders.
+  range_list remainder;
+  if (begin->first < first) {
+    remainder.push_back({begin->first, predecessor(first)});
+  }
+  if (last < (end - 1)->last) {
+    remainder.push_back({successor(last), (end - 1)->last});
+  }
+
+  auto pos = list.erase(begin, end);
+  list.insert(pos, remainder.begin(), remainder.end());
+}
+
+
+inline bool
+contains_range(range_list const & list, address_value const & first,
+    address_value const & last)
+{
+  auto iter = first_overlapping(list, first);
+  return iter != list.end() && iter->first <= first && last <= iter->last;
+}
+
+
+inline bool
+overlaps_range(range_list const & list, address_value const & first,
+    address_value const & last)
+{
+  auto iter = first_overlapping(list, first);
+  return iter != list.end() && iter->first <= last;
+}
+
+
+range_list
+unite(range_list const & first, range_list const & second)
+{
+  range_list merged;
+  merged.reserve(first.size() + second.size());
+  std::merge(first.begin(), first.end(), second.begin(), second.end(),
+      std::back_inserter(merged));
+
+  // Coalesce overlapping and adjacent ranges.
+  range_list ret;
+  for (auto & range : merged) {
+    if (!ret.empty()) {
+      auto & prev = ret.back();
+      if (range.first <= prev.last || range.first == successor(prev.last)) {
+        prev.last = std::max(prev.last, range.last);
+        continue;
+      }
+    }
+    ret.push_back(range);
+  }
+  return ret;
+}
+
+
+range_list
+intersect(range_list const & first, range_list const & second)
+{
+  range_list ret;
+  auto iter1 = first.begin();
+  auto iter2 = second.begin();
+  while (iter1 != first.end() && iter2 != second.end()) {
+    auto lo = std::max(iter1->first, iter2->first);
+    auto hi = std::min(iter1->last, iter2->last);
+    if (lo <= hi) {
+      ret.push_back({lo, hi});
+    }
+
+    if (iter1->last < iter2->last) {
+      ++iter1;
+    }
+    else {
+      ++iter2;
+    }
+  }
+  return ret;
+}
+
+
+range_list
+subtract(range_list const & first, range_list const & second)
+{
+  range_list ret;
+  auto subtrahend = second.begin();
+  for (auto & range : first) {
+    auto cur = range.first;
+    for ( ; subtrahend != second.end() && subtrahend->last < cur ;
+        ++subtrahend); //!OCLINT
+
+    bool consumed = false;
+    for (auto iter = subtrahend ; iter != second.end()
+        && iter->first <= range.last ; ++iter) {
+      if (cur < iter->first) {
+        ret.push_back({cur, predecessor(iter->first)});
+      }
+      if (range.last <= iter->last) {
+        consumed = true;
+        break;
+      }
+      cur = successor(iter->last);
+    }
+
+    if (!consumed) {
+      ret.push_back({cur, range.last});
+    }
+  }
+  return ret;
+}
+
+
+void
+cover_range(std::vector<network> & result, address_type type,
+    address_value first, address_value const & last)
+{
+  size_t width = address_bits(type);
+  while (true) {
+    // Find the largest block that is aligned at first, but doesn't extend
+    // beyond last. The network class cannot represent a zero mask size, so
+    // the largest block is half the address space.
+    size_t bits = std::min(trailing_zeros(first), width - 1);
+    for ( ; bits > 0 && last < (first | low_bits(bits)) ; --bits); //!OCLINT
+
+    result.push_back(make_network(type, first, width - bits));
+
+    auto block_last = first | low_bits(bits);
+    if (!(block_last < last)) {
+      break;
+    }
+    first = successor(block_last);
+  }
+}
+
+} // anonymous namespace
+
+
+/*****************************************************************************
+ * Implementation
+ **/
+struct network_set::network_set_impl
+{
+  // Indexed by address type; that is, AT_INET4 and AT_INET6.
+  range_list  m_ranges[2];
+
+  inline range_list * ranges(address_type type)
+  {
+    if (AT_INET4 != type && AT_INET6 != type) {
+      return nullptr;
+    }
+    return &m_ranges[type];
+  }
+
+  inline range_list const * ranges(address_type type) const
+  {
+    if (AT_INET4 != type && AT_INET6 != type) {
+      return nullptr;
+    }
+    return &m_ranges[type];
+  }
+};
+
+
+/*****************************************************************************
+ * Member functions
+ **/
+network_set::network_set()
+  : m_impl{std::make_unique<network_set_impl>()}
+{
+}
+
+
+
+network_set::~network_set()
+{
+}
+
+
+
+network_set::network_set(network_set const & other)
+  : m_impl{std::make_unique<network_set_impl>(*other.m_impl)}
+{
+}
+
+
+
+network_set::network_set(network_set &&) = default;
+
+
+
+network_set &
+network_set::operator=(network_set const & other)
+{
+  *m_impl = *other.m_impl;
+  return *this;
+}
+
+
+
+network_set &
+network_set::operator=(network_set &&) = default;
+
+
+
+void
+network_set::insert(network const & net)
+{
+  auto list = m_impl->ranges(net.family());
+  if (!list) {
+    throw std::invalid_argument{"Can only add IPv4 or IPv6 networks."};
+  }
+
+  add_range(*list, to_value(net.network_address()),
+      to_value(net.broadcast_address()));
+}
+
+
+
+void
+network_set::insert(std::string const & netspec)
+{
+  insert(network{netspec});
+}
+
+
+
+void
+network_set::erase(network const & net)
+{
+  auto list = m_impl->ranges(net.family());
+  if (!list) {
+    return;
+  }
+
+  remove_range(*list, to_value(net.network_address()),
+      to_value(net.broadcast_address()));
+}
+
+
+
+void
+network_set::erase(std::string const & netspec)
+{
+  erase(network{netspec});
+}
+
+
+
+void
+network_set::clear()
+{
+  for (auto & list : m_impl->m_ranges) {
+    list.clear();
+  }
+}
+
+
+
+bool
+network_set::empty() const
+{
+  for (auto & list : m_impl->m_ranges) {
+    if (!list.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool
+network_set::contains(socket_address const & address) const
+{
+  auto list = m_impl->ranges(address.type());
+  if (!list) {
+    return false;
+  }
+
+  auto value = to_value(address);
+  return contains_range(*list, value, value);
+}
+
+
+
+bool
+network_set::contains(network const & net) const
+{
+  auto list = m_impl->ranges(net.family());
+  if (!list) {
+    return false;
+  }
+
+  return contains_range(*list, to_value(net.network_address()),
+      to_value(net.broadcast_address()));
+}
+
+
+
+bool
+network_set::overlaps(network const & net) const
+{
+  auto list = m_impl->ranges(net.family());
+  if (!list) {
+    return false;
+  }
+
+  return overlaps_range(*list, to_value(net.network_address()),
+      to_value(net.broadcast_address()));
+}
+
+
+
+bool
+network_set::overlaps(network_set const & other) const
+{
+  return !set_intersection(other).empty();
+}
+
+
+
+network_set
+network_set::set_union(network_set const & other) const
+{
+  network_set ret;
+  for (size_t i = 0 ; i < 2 ; ++i) {
+    ret.m_impl->m_ranges[i] = unite(m_impl->m_ranges[i],
+        other.m_impl->m_ranges[i]);
+  }
+  return ret;
+}
+
+
+
+network_set
+network_set::set_intersection(network_set const & other) const
+{
+  network_set ret;
+  for (size_t i = 0 ; i < 2 ; ++i) {
+    ret.m_impl->m_ranges[i] = intersect(m_impl->m_ranges[i],
+        other.m_impl->m_ranges[i]);
+  }
+  return ret;
+}
+
+
+
+network_set
+network_set::set_difference(network_set const & other) const
+{
+  network_set ret;
+  for (size_t i = 0 ; i < 2 ; ++i) {
+    ret.m_impl->m_ranges[i] = subtract(m_impl->m_ranges[i],
+        other.m_impl->m_ranges[i]);
+  }
+  return ret;
+}
+
+
+
+std::vector<network>
+network_set::networks() const
+{
+  std::vector<network> ret;
+  for (auto type : {AT_INET4, AT_INET6}) {
+    for (auto & range : *m_impl->ranges(type)) {
+      cover_range(ret, type, range.first, range.last);
+    }
+  }
+  return ret;
+}
+
+
+
+std::vector<network>
+network_set::cidr_cover(socket_address const & first,
+    socket_address const & last)
+{
+  auto type = first.type();
+  if ((AT_INET4 != type && AT_INET6 != type) || type != last.type()) {
+    throw std::invalid_argument{"Can only cover ranges of IPv4 or IPv6 "
+      "addresses of the same family."};
+  }
+
+  auto first_value = to_value(first);
+  auto last_value = to_value(last);
+  if (last_value < first_value) {
+    throw std::invalid_argument{"The last address of a range cannot be "
+      "smaller than the first."};
+  }
+
+  std::vector<network> ret;
+  cover_range(ret, type, first_value, last_value);
+  return ret;
+}
+
+
+
+void
+network_set::swap(network_set & other)
+{
+  std::swap(m_impl, other.m_impl);
+}
+
+
+
+bool
+network_set::is_equal_to(network_set const & other) const
+{
+  for (size_t i = 0 ; i < 2 ; ++i) {
+    if (m_impl->m_ranges[i] != other.m_impl->m_ranges[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool
+network_set::is_less_than(network_set const & other) const
+{
+  for (size_t i = 0 ; i < 2 ; ++i) {
+    auto & mine = m_impl->m_ranges[i];
+    auto & theirs = other.m_impl->m_ranges[i];
+    if (mine != theirs) {
+      return std::lexicographical_compare(mine.begin(), mine.end(),
+          theirs.begin(), theirs.end());
+    }
+  }
+  return false;
+}
+
+
+/*****************************************************************************
+ * Friend functions
+ **/
+std::ostream &
+operator<<(std::ostream & os, network_set const & set)
+{
+  bool first = true;
+  for (auto & net : set.networks()) {
+    if (!first) {
+      os << ", ";
+    }
+    os << net;
+    first = false;
+  }
+  return os;
+}
+
+
+} // namespace liberate::net
@@ -0,0 +1,261 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/query_map.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <liberate/cpp/hash.h>
+
+namespace liberate::net {
+
+namespace {
+
+// Up to this many entries, a linear scan over the key hashes beats a binary
+// search over the key strings.
+constexpr std::size_t LINEAR_SCAN_LIMIT = 16;
+
+inline size_t
+key_hash(std::string_view key)
+{
+  return std::hash<std::string_view>{}(key);
+}
+
+} // anonymous namespace
+
+
+query_map::query_map(std::initializer_list<value_type> init)
+{
+  for (auto & entry : init) {
+    insert_or_assign(entry.first, entry.second);
+  }
+}
+
+
+
+void
+query_map::clear()
+{
+  m_entries.clear();
+  m_hashes.clear();
+}
+
+
+
+query_map::size_type
+query_map::lower_bound(std::string_view key, size_t hash, bool & found) const
+{
+  auto iter = std::lower_bound(m_entries.begin(), m_entries.end(), key,
+      [](entry_type const & entry, std::string_view const & value)
+      {
+        return std::string_view{entry.first} < value;
+      });
+  size_type index = iter - m_entries.begin();
+  found = (iter != m_entries.end() && m_hashes[index] == hash
+      && iter->first == key);
+  return index;
+}
+
+
+
+query_map::const_iterator
+query_map::find(std::string_view key) const
+{
+  auto hash = key_hash(key);
+
+  if (m_entries.size() <= LINEAR_SCAN_LIMIT) {
+    for (size_type i = 0 ; i < m_hashes.size() ; ++i) {
+      if (m_hashes[i] == hash && m_entries[i].first == key) {
+        return begin() + i;
+      }
+    }
+    return end();
+  }
+
+  bool found = false;
+  auto index = lower_bound(key, hash, found);
+  if (!found) {
+    return end();
+  }
+  return begin() + index;
+}
+
+
+
+query_map::iterator
+query_map::find(std::string_view key)
+{
+  auto iter = static_cast<query_map const *>(this)->find(key);
+  return begin() + (iter - cbegin());
+}
+
+
+
+query_map::size_type
+query_map::count(std::string_view key) const
+{
+  return find(key) == end() ? 0 : 1;
+}
+
+
+
+std::string &
+query_map::operator[](std::string_view key)
+{
+  auto hash = key_hash(key);
+  bool found = false;
+  auto index = lower_bound(key, hash, found);
+  if (!found) {
+    m_entries.emplace(m_entries.begin() + index, std::string{key},
+        std::string{});
+    m_hashes.insert(m_hashes.begin() + index, hash);
+  }
+  return m_entries[index].second;
+}
+
+
+
+std::pair<query_map::iterator, bool>
+query_map::insert_or_assign(std::string_view key, std::string value)
+{
+  auto hash = key_hash(key);
+  bool found = false;
+  auto index = lower_bound(key, hash, found);
+  if (found) {
+    m_entries[index].second = std::move(value);
+  }
+  else {
+    m_entries.emplace(m_entries.begin() + index, std::string{key},
+        std::move(value));
+    m_hashes.insert(m_hashes.begin() + index, hash);
+  }
+  return std::make_pair(begin() + index, !found);
+}
+
+
+
+std::pair<query_map::iterator, bool>
+query_map::insert(value_type value)
+{
+  auto hash = key_hash(value.first);
+  bool found = false;
+  auto index = lower_bound(value.first, hash, found);
+  if (!found) {
+    m_entries.emplace(m_entries.begin() + index, std::move(value));
+    m_hashes.insert(m_hashes.begin() + index, hash);
+  }
+  return std::make_pair(begin() + index, !found);
+}
+
+
+
+std::string &
+query_map::at(std::string_view key)
+{
+  auto iter = find(key);
+  if (iter == end()) {
+    throw std::out_of_range{"Query parameter not found: " + std::string{key}};
+  }
+  return iter->second;
+}
+
+
+
+std::string const &
+query_map::at(std::string_view key) const
+{
+  auto iter = find(key);
+  if (iter == end()) {
+    throw std::out_of_range{"Query parameter not found: " + std::string{key}};
+  }
+  return iter->second;
+}
+
+
+
+query_map::size_type
+query_map::erase(std::string_view key)
+{
+  bool found = false;
+  auto index = lower_bound(key, key_hash(key), found);
+  if (!found) {
+    return 0;
+  }
+
+  m_entries.erase(m_entries.begin() + index);
+  m_hashes.erase(m_hashes.begin() + index);
+  return 1;
+}
+
+
+
+query_map::iterator
+query_map::erase(const_iterator pos)
+{
+  auto index = pos - cbegin();
+  m_hashes.erase(m_hashes.begin() + index);
+  return iterator{m_entries.erase(pos.m_iter)};
+}
+
+
+
+size_t
+query_map::hash() const
+{
+  size_t ret = 0;
+  for (size_type i = 0 ; i < m_entries.size() ; ++i) {
+    liberate::cpp::hash_combine(ret, m_hashes[i]);
+    liberate::cpp::hash_combine(ret, liberate::cpp::multi_hash(
+          m_entries[i].second));
+  }
+  return ret;
+}
+
+
+
+void
+query_map::swap(query_map & other)
+{
+  std::swap(m_entries, other.m_entries);
+  std::swap(m_hashes, other.m_hashes);
+}
+
+
+
+bool
+query_map::is_equal_to(query_map const & other) const
+{
+  // Comparing the hashes first rules out most mismatches without touching
+  // the strings.
+  return m_hashes == other.m_hashes
+    && m_entries == other.m_entries;
+}
+
+
+
+bool
+query_map::is_less_than(query_map const & other) const
+{
+  return m_entries < other.m_entries;
+}
+
+} // namespace liberate::net
@@ -33,8 +33,12 @@
 #endif
 
 #include <liberate/net/resolve.h>
+#include <liberate/net/resolver_backend.h>
 #include <liberate/sys/error.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include <liberate/logging.h>
 
 #include "../macros.h"
@@ -60,8 +64,8 @@ struct addrinfo_holder
 
 
 bool
-resolve_internal(std::set<socket_address> & results, int family,
-    std::string const & hostname, uint16_t port)
+resolve_internal(std::vector<socket_address> & results, int family,
+    std::string const & hostname)
 {
 #if defined(GETADDRINFO_IS_IMPLEMENTED)
   // Construct hints
@@ -127,10 +131,13 @@ resolve_internal(std::set<socket_address> & results, int family,
         throw std::range_error("Unexpected address type returned!");
     }
 
-    // Parse the address and add it to our list
+    // Parse the address and add it to our list. Without a socket type in
+    // the hints, each address is returned once per socket type; we only
+    // want it once, and in the order getaddrinfo() prefers.
     auto addr = socket_address{cur->ai_addr, static_cast<size_t>(cur->ai_addrlen)};
-    addr.set_port(port);
-    results.insert(addr);
+    if (std::find(results.begin(), results.end(), addr) == results.end()) {
+      results.push_back(addr);
+    }
   }
 #else
   throw std::domain_error("Not implemented on this platform.");
@@ -138,51 +145,240 @@ resolve_internal(std::set<socket_address> & results, int family,
   return true;
 }
 
-} // anonymous namespace
 
 
-// Note: the api instance is unused, but we need an instance for WSASetup() to
-//       have occurred.
-std::set<socket_address>
-resolve(api &, address_type type, std::string const & hostname)
+/**
+ * Default policy table from RFC 6724, section 2.1, longest prefixes first.
+ * IPv4 addresses are treated as IPv4-mapped IPv6 addresses.
+ */
+struct policy_entry
 {
-  // Validate input & set hints
-  if (hostname.empty()) {
-    throw std::invalid_argument("Need to provide a hostname.");
+  uint8_t prefix[16];
+  size_t  bits;
+  int     precedence;
+};
+
+policy_entry const POLICY_TABLE[] = {
+  { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }, 128, 50 }, // ::1/128
+  { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff }, 96, 35 }, // ::ffff:0:0/96
+  { {}, 96, 1 },                                            // ::/96
+  { { 0x20, 0x01, 0, 0 }, 32, 5 },                          // 2001::/32
+  { { 0x20, 0x02 }, 16, 30 },                               // 2002::/16
+  { { 0x3f, 0xfe }, 16, 1 },                                // 3ffe::/16
+  { { 0xfe, 0xc0 }, 10, 1 },                                // fec0::/10
+  { { 0xfc }, 7, 3 },                                       // fc00::/7
+  { {}, 0, 40 },                                            // ::/0
+};
+
+
+// Scope values as in RFC 4007
+constexpr int SCOPE_LINK_LOCAL = 0x2;
+constexpr int SCOPE_SITE_LOCAL = 0x5;
+constexpr int SCOPE_GLOBAL = 0xe;
+
+
+inline bool
+prefix_matches(uint8_t const * address, uint8_t const * prefix, size_t bits)
+{
+  auto bytes = bits / 8;
+  if (0 != std::memcmp(address, prefix, bytes)) {
+    return false;
+  }
+  auto rest = bits % 8;
+  if (!rest) {
+    return true;
   }
+  auto mask = static_cast<uint8_t>(0xff << (8 - rest));
+  return (address[bytes] & mask) == (prefix[bytes] & mask);
+}
 
-  auto lookup_host = hostname;
-  auto sep = lookup_host.find(":");
-  uint16_t port = 0;
-  if (sep != std::string::npos) {
-    lookup_host = hostname.substr(0, sep);
-    auto port_str = hostname.substr(sep + 1);
-    port = std::stoi(port_str);
+
+inline int
+ipv4_scope(uint8_t const * address)
+{
+  // RFC 6724, section 3.2: loopback and auto-configured addresses have
+  // link-local scope.
+  if (127 == address[0] || (169 == address[0] && 254 == address[1])) {
+    return SCOPE_LINK_LOCAL;
   }
+  return SCOPE_GLOBAL;
+}
+
+
+struct preference
+{
+  int precedence = -1;
+  int scope = SCOPE_GLOBAL + 1;
+
+  // Higher precedence first, then smaller scope.
+  inline bool operator<(preference const & other) const
+  {
+    if (precedence != other.precedence) {
+      return precedence > other.precedence;
+    }
+    return scope < other.scope;
+  }
+};
+
+
+preference
+preference_of(socket_address const & address)
+{
+  uint8_t bytes[16] = {};
+  switch (address.type()) {
+    case AT_INET4:
+      bytes[10] = bytes[11] = 0xff;
+      std::memcpy(bytes + 12,
+          &(static_cast<sockaddr_in const *>(address.buffer())->sin_addr), 4);
+      break;
+
+    case AT_INET6:
+      std::memcpy(bytes,
+          &(static_cast<sockaddr_in6 const *>(address.buffer())->sin6_addr),
+          16);
+      break;
+
+    default:
+      // Anything else goes last.
+      return preference{};
+  }
+
+  preference ret;
+  for (auto & entry : POLICY_TABLE) {
+    if (prefix_matches(bytes, entry.prefix, entry.bits)) {
+      ret.precedence = entry.precedence;
+      break;
+    }
+  }
+
+  if (prefix_matches(bytes, POLICY_TABLE[1].prefix, POLICY_TABLE[1].bits)) {
+    ret.scope = ipv4_scope(bytes + 12);
+  }
+  else if (0xff == bytes[0]) {
+    ret.scope = bytes[1] & 0x0f; // Multicast
+  }
+  else if (prefix_matches(bytes, POLICY_TABLE[0].prefix, 128)
+      || (0xfe == bytes[0] && 0x80 == (bytes[1] & 0xc0)))
+  {
+    ret.scope = SCOPE_LINK_LOCAL;
+  }
+  else if (0xfe == bytes[0] && 0xc0 == (bytes[1] & 0xc0)) {
+    ret.scope = SCOPE_SITE_LOCAL;
+  }
+  else {
+    ret.scope = SCOPE_GLOBAL;
+  }
+  return ret;
+}
 
-  std::set<socket_address> results;
+} // anonymous namespace
+
+
+
+resolver_backend::~resolver_backend() = default;
+
+
+
+system_resolver_backend::system_resolver_backend(api &)
+{
+}
+
+
+
+std::vector<socket_address>
+system_resolver_backend::lookup(address_type type,
+    std::string const & hostname)
+{
+  std::vector<socket_address> results;
   switch (type) {
     case AT_UNSPEC:
-      resolve_internal(results, AF_INET, lookup_host, port);
-      resolve_internal(results, AF_INET6, lookup_host, port);
+      // A single query for both families lets getaddrinfo() sort all results
+      // by preference.
+      resolve_internal(results, AF_UNSPEC, hostname);
       break;
 
     case AT_INET4:
-      resolve_internal(results, AF_INET, lookup_host, port);
+      resolve_internal(results, AF_INET, hostname);
+      break;
+
+    case AT_INET6:
+      resolve_internal(results, AF_INET6, hostname);
       break;
 
+    default:
+      throw std::invalid_argument("Unsupported address type specified.");
+  }
+  return results;
+}
+
+
+
+std::vector<socket_address>
+resolve(api & api, address_type type, std::string const & hostname)
+{
+  system_resolver_backend backend{api};
+  return resolve(backend, type, hostname);
+}
+
+
+
+std::vector<socket_address>
+resolve(resolver_backend & backend, address_type type,
+    std::string const & hostname)
+{
+  // Validate input
+  if (hostname.empty()) {
+    throw std::invalid_argument("Need to provide a hostname.");
+  }
+
+  switch (type) {
+    case AT_UNSPEC:
+    case AT_INET4:
     case AT_INET6:
-      resolve_internal(results, AF_INET6, lookup_host, port);
       break;
 
     default:
       throw std::invalid_argument("Unsupported address type specified.");
   }
 
+  auto lookup_host = hostname;
+  auto sep = lookup_host.find(":");
+  uint16_t port = 0;
+  if (sep != std::string::npos) {
+    lookup_host = hostname.substr(0, sep);
+    auto port_str = hostname.substr(sep + 1);
+    port = std::stoi(port_str);
+  }
+
+  auto results = backend.lookup(type, lookup_host);
+  if (port) {
+    for (auto & addr : results) {
+      addr.set_port(port);
+    }
+  }
   return results;
 }
 
 
-} // namespace liberate::net
 
+void
+sort_by_preference(std::vector<socket_address> & addresses)
+{
+  std::vector<std::pair<preference, socket_address>> decorated;
+  decorated.reserve(addresses.size());
+  for (auto & addr : addresses) {
+    decorated.emplace_back(preference_of(addr), std::move(addr));
+  }
 
+  std::stable_sort(decorated.begin(), decorated.end(),
+      [](auto const & first, auto const & second)
+      {
+        return first.first < second.first;
+      });
+
+  for (size_t i = 0 ; i < decorated.size() ; ++i) {
+    addresses[i] = std::move(decorated[i].second);
+  }
+}
+
+} // namespace liberate::net
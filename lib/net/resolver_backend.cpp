@@ -0,0 +1,217 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <build-config.h>
+
+#include <liberate/net/resolver_backend.h>
+#include <liberate/net/resolve.h>
+#include <liberate/string/util.h>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace liberate::net {
+
+struct static_resolver_backend::static_resolver_backend_impl
+{
+  mutable std::shared_mutex                                     mutex = {};
+  std::unordered_map<std::string, std::vector<socket_address>>  table = {};
+};
+
+
+
+static_resolver_backend::static_resolver_backend()
+  : m_impl{std::make_unique<static_resolver_backend_impl>()}
+{
+}
+
+
+
+static_resolver_backend::~static_resolver_backend() = default;
+
+
+
+void
+static_resolver_backend::add(std::string const & hostname,
+    socket_address const & address)
+{
+  if (hostname.empty()) {
+    throw std::invalid_argument("Need to provide a hostname.");
+  }
+  if (address.type() != AT_INET4 && address.type() != AT_INET6) {
+    throw std::invalid_argument("Only IP addresses can be added.");
+  }
+
+  auto key = string::to_lower(hostname);
+
+  std::unique_lock<std::shared_mutex> lock{m_impl->mutex};
+  auto & addresses = m_impl->table[key];
+  if (std::find(addresses.begin(), addresses.end(), address)
+      != addresses.end())
+  {
+    return;
+  }
+  addresses.push_back(address);
+  sort_by_preference(addresses);
+}
+
+
+
+void
+static_resolver_backend::remove(std::string const & hostname)
+{
+  auto key = string::to_lower(hostname);
+
+  std::unique_lock<std::shared_mutex> lock{m_impl->mutex};
+  m_impl->table.erase(key);
+}
+
+
+
+void
+static_resolver_backend::clear()
+{
+  std::unique_lock<std::shared_mutex> lock{m_impl->mutex};
+  m_impl->table.clear();
+}
+
+
+
+std::size_t
+static_resolver_backend::size() const
+{
+  std::shared_lock<std::shared_mutex> lock{m_impl->mutex};
+  return m_impl->table.size();
+}
+
+
+
+std::vector<socket_address>
+static_resolver_backend::lookup(address_type type,
+    std::string const & hostname)
+{
+  auto key = string::to_lower(hostname);
+
+  std::shared_lock<std::shared_mutex> lock{m_impl->mutex};
+  auto iter = m_impl->table.find(key);
+  if (iter == m_impl->table.end()) {
+    return {};
+  }
+
+  if (AT_UNSPEC == type) {
+    return iter->second;
+  }
+
+  std::vector<socket_address> results;
+  for (auto & addr : iter->second) {
+    if (addr.type() == type) {
+      results.push_back(addr);
+    }
+  }
+  return results;
+}
+
+
+
+std::size_t
+hosts_resolver_backend::load(std::istream & input)
+{
+  std::size_t added = 0;
+  std::string line;
+  while (std::getline(input, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+
+    std::istringstream fields{line};
+    std::string address;
+    if (!(fields >> address) || !socket_address::verify_cidr(address)) {
+      continue;
+    }
+
+    socket_address addr{address};
+    std::string hostname;
+    while (fields >> hostname) {
+      add(hostname, addr);
+      ++added;
+    }
+  }
+  return added;
+}
+
+
+
+std::size_t
+hosts_resolver_backend::load_file(std::string const & path
+    /* = default_path() */)
+{
+  std::ifstream input{path};
+  if (!input) {
+    throw std::runtime_error("Could not open hosts file: " + path);
+  }
+  return load(input);
+}
+
+
+
+std::string
+hosts_resolver_backend::default_path()
+{
+#if defined(LIBERATE_WIN32)
+  return "C:\\Windows\\System32\\drivers\\etc\\hosts";
+#else
+  return "/etc/hosts";
+#endif
+}
+
+
+
+chained_resolver_backend::chained_resolver_backend(backend_list && backends)
+  : m_backends{std::move(backends)}
+{
+  for (auto & backend : m_backends) {
+    if (!backend) {
+      throw std::invalid_argument("Backends must not be null.");
+    }
+  }
+}
+
+
+
+std::vector<socket_address>
+chained_resolver_backend::lookup(address_type type,
+    std::string const & hostname)
+{
+  for (auto & backend : m_backends) {
+    auto results = backend->lookup(type, hostname);
+    if (!results.empty()) {
+      return results;
+    }
+  }
+  return {};
+}
+
+} // namespace liberate::net
@@ -0,0 +1,281 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/resolver_cache.h>
+#include <liberate/net/resolve.h>
+#include <liberate/net/resolver_backend.h>
+
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace liberate::net {
+
+namespace {
+
+using clock = resolver_cache_options::clock;
+using result_type = resolver_cache::result_type;
+using cache_key = std::pair<address_type, std::string>;
+
+} // anonymous namespace
+
+
+struct resolver_cache::resolver_cache_impl
+{
+  struct entry
+  {
+    // Each lookup gets a new id, so that a finished lookup can tell whether
+    // its entry was invalidated in the meantime.
+    std::uint64_t                       id = 0;
+    bool                                ready = false;
+    result_type                         result = {};
+    clock::time_point                   expires = {};
+    std::shared_future<result_type>     pending = {};
+    std::list<cache_key>::iterator      lru = {};
+  };
+
+  lookup_function                 lookup;
+  resolver_cache_options          options;
+
+  mutable std::mutex              mutex = {};
+  std::map<cache_key, entry>      entries = {};
+  std::list<cache_key>            lru = {}; // Most recently used first
+  std::uint64_t                   next_id = 0;
+
+
+  resolver_cache_impl(lookup_function && _lookup,
+      resolver_cache_options const & _options)
+    : lookup{std::move(_lookup)}
+    , options{_options}
+  {
+    if (!options.now) {
+      options.now = &clock::now;
+    }
+  }
+
+
+  inline void
+  touch(entry & ent)
+  {
+    lru.splice(lru.begin(), lru, ent.lru);
+  }
+
+
+  inline void
+  erase(std::map<cache_key, entry>::iterator iter)
+  {
+    lru.erase(iter->second.lru);
+    entries.erase(iter);
+  }
+
+
+  void
+  evict()
+  {
+    // Evict the least recently used entries, but leave lookups in progress
+    // alone; their callers rely on them for deduplication.
+    auto iter = lru.end();
+    while (entries.size() > options.max_entries && iter != lru.begin()) {
+      --iter;
+      auto found = entries.find(*iter);
+      if (!found->second.ready) {
+        continue;
+      }
+      iter = lru.erase(iter);
+      entries.erase(found);
+    }
+  }
+
+
+  result_type
+  resolve(address_type type, std::string const & hostname)
+  {
+    if (hostname.empty()) {
+      throw std::invalid_argument("Need to provide a hostname.");
+    }
+
+    switch (type) {
+      case AT_UNSPEC:
+      case AT_INET4:
+      case AT_INET6:
+        break;
+
+      default:
+        throw std::invalid_argument("Unsupported address type specified.");
+    }
+
+    cache_key key{type, hostname};
+    std::promise<result_type> promise;
+    std::shared_future<result_type> pending;
+    std::uint64_t id = 0;
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+
+      auto iter = entries.find(key);
+      if (iter != entries.end()) {
+        auto & ent = iter->second;
+        touch(ent);
+
+        if (!ent.ready) {
+          // Someone else is looking this up already.
+          pending = ent.pending;
+        }
+        else if (options.now() < ent.expires) {
+          return ent.result;
+        }
+      }
+      else {
+        lru.push_front(key);
+        iter = entries.emplace(key, entry{}).first;
+        iter->second.lru = lru.begin();
+      }
+
+      if (!pending.valid()) {
+        // Start a new lookup
+        auto & ent = iter->second;
+        id = ++next_id;
+        ent.id = id;
+        ent.ready = false;
+        ent.pending = promise.get_future().share();
+      }
+    }
+
+    if (pending.valid()) {
+      return pending.get();
+    }
+
+    result_type result;
+    try {
+      result = lookup(type, hostname);
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto iter = entries.find(key);
+        if (iter != entries.end() && iter->second.id == id) {
+          erase(iter);
+        }
+      }
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      auto iter = entries.find(key);
+      if (iter != entries.end() && iter->second.id == id) {
+        auto & ent = iter->second;
+        ent.ready = true;
+        ent.result = result;
+        ent.expires = options.now() + (result.empty()
+            ? options.negative_ttl : options.positive_ttl);
+        ent.pending = {};
+        evict();
+      }
+    }
+
+    promise.set_value(result);
+    return result;
+  }
+};
+
+
+
+resolver_cache::resolver_cache(api & api,
+    resolver_cache_options const & options)
+  : m_impl{std::make_unique<resolver_cache_impl>(
+      [&api](address_type type, std::string const & hostname)
+      {
+        return ::liberate::net::resolve(api, type, hostname);
+      },
+      options)}
+{
+}
+
+
+
+resolver_cache::resolver_cache(resolver_backend & backend,
+    resolver_cache_options const & options)
+  : m_impl{std::make_unique<resolver_cache_impl>(
+      [&backend](address_type type, std::string const & hostname)
+      {
+        return ::liberate::net::resolve(backend, type, hostname);
+      },
+      options)}
+{
+}
+
+
+
+resolver_cache::resolver_cache(lookup_function && lookup,
+    resolver_cache_options const & options)
+  : m_impl{std::make_unique<resolver_cache_impl>(std::move(lookup), options)}
+{
+  if (!m_impl->lookup) {
+    throw std::invalid_argument("Need to provide a lookup function.");
+  }
+}
+
+
+
+resolver_cache::~resolver_cache() = default;
+
+
+
+resolver_cache::result_type
+resolver_cache::resolve(address_type type, std::string const & hostname)
+{
+  return m_impl->resolve(type, hostname);
+}
+
+
+
+void
+resolver_cache::invalidate(address_type type, std::string const & hostname)
+{
+  std::lock_guard<std::mutex> lock{m_impl->mutex};
+  auto iter = m_impl->entries.find(cache_key{type, hostname});
+  if (iter != m_impl->entries.end()) {
+    m_impl->erase(iter);
+  }
+}
+
+
+
+void
+resolver_cache::clear()
+{
+  std::lock_guard<std::mutex> lock{m_impl->mutex};
+  m_impl->entries.clear();
+  m_impl->lru.clear();
+}
+
+
+
+std::size_t
+resolver_cache::size() const
+{
+  std::lock_guard<std::mutex> lock{m_impl->mutex};
+  return m_impl->entries.size();
+}
+
+} // namespace liberate::net
@@ -19,12 +19,13 @@
  **/
 
 #include <liberate/net/url.h>
+#include <liberate/net/url_view.h>
 
 #include <iostream>
 #include <functional>
+#include <tuple>
 
 #include <liberate/cpp/hash.h>
-#include <liberate/string/util.h>
 #include <liberate/string/urlencode.h>
 
 #include "string.h"
@@ -33,172 +34,17 @@
 
 namespace liberate::net {
 
-namespace {
-
-std::string
-normalize_value(std::string const & value)
-{
-  // std::cout << "pre normalization: " << value << std::endl;
-  std::string ret = string::to_lower(value);
-
-  if ("true" == ret or "yes" == ret) {
-    ret = "1";
-  } else if ("false" == ret or "no" == ret) {
-    ret = "0";
-  }
-
-  return ret;
-}
-
-void
-split_query(std::map<std::string, std::string> & params,
-    std::string const & query)
-{
-  bool keep_going = true;
-  std::string::size_type start = 0;
-  do {
-    auto end = query.find_first_of('&', start);
-    if (std::string::npos == end) {
-      end = query.length();
-      keep_going = false;
-    }
-    // std::cout << "end at: " << end << std::endl;
-    auto equal = query.find_first_of('=', start);
-    if (std::string::npos == equal) {
-      equal = query.length();
-    }
-    // std::cout << "equal at: " << equal << std::endl;
-    if (equal >= end) {
-      // Parameter without value.
-      auto key = string::to_lower(query.substr(start, end - start));
-
-      // std::cout << "got simple: " << key << std::endl;
-      params[string::urldecode(key)] = "1"; // Treat as boolean
-      start = end + 1;
-    }
-    else {
-      // Parameter with value
-      auto key = string::to_lower(query.substr(start, equal - start));
-      auto value = normalize_value(query.substr(equal + 1, end - equal - 1));
-      // std::cout << "got kv: " << key << " = " << value << std::endl;
-      params[string::urldecode(key)] = string::urldecode(value);
-      start = end + 1;
-    }
-  } while (keep_going);
-}
-
-} // anonymous namespace
-
-
 url
 url::parse(char const * url_string)
 {
-  // Lazy... use the std::string version.
-  return parse(std::string(url_string));
+  return url_view::parse(url_string).to_url();
 }
 
 
 url
 url::parse(std::string const & url_string)
-  OCLINT_SUPPRESS("high npath complexity")
-  OCLINT_SUPPRESS("high cyclomatic complexity")
-  OCLINT_SUPPRESS("long method")
 {
-  url ret;
-
-  // std::cout << "string: " << url_string << " - " << url_string.size() << std::endl;
-
-  // We'll find the first occurrence of a colon; that *should* delimit the
-  // scheme.
-  auto end = url_string.find_first_of(':');
-  if (std::string::npos == end) {
-    throw std::invalid_argument{
-        std::string{"No scheme separator found in connector URL: "}
-        + url_string};
-  }
-  // std::cout << "colon at: " << end << std::endl;
-
-  // We'll then try to see if the characters immediately following are two
-  // slashes.
-  if (end + 3 > url_string.size()) {
-    throw std::invalid_argument{
-        std::string{"Bad scheme separator found in connector URL: "}
-        + url_string};
-
-  }
-  // std::cout << "end + 1: " << url_string[end + 1] << std::endl;
-  // std::cout << "end + 2: " << url_string[end + 2] << std::endl;
-  if (!('/' == url_string[end + 1] && '/' == url_string[end + 2])) {
-    throw std::invalid_argument{
-        std::string{"Bad scheme separator found in connector URL: "}
-        + url_string};
-  }
-
-  // Ok, we seem to have a scheme part. Lower-case it.
-  ret.scheme = string::to_lower(url_string.substr(0, end));
-  // std::cout << "got scheme: " << ret.scheme << std::endl;
-
-  // Next grab the authority - that's everything until the next '/' character.
-  auto start = end + 3;
-  auto query_start = url_string.find_first_of('?', start);
-  auto fragment_start = url_string.find_first_of('#', start);
-  end = url_string.find_first_of('/', start);
-  if (std::string::npos == end) {
-    if (query_start != std::string::npos) {
-      end = query_start;
-    }
-    else if (fragment_start != std::string::npos) {
-      end = fragment_start;
-    }
-    else {
-      end = url_string.length();
-    }
-  }
-  // std::cout << "new end: " << end << std::endl;
-  ret.authority = string::urldecode(url_string.substr(start, end - start));
-  // std::cout << "got authority: " << ret.authority << std::endl;
-
-  // The path is anything up until a '?' or '#' or the end - whichever
-  // comes first.
-  start = end;
-  if (query_start != std::string::npos) {
-    end = query_start;
-  }
-  else if (fragment_start != std::string::npos) {
-    end = fragment_start;
-  }
-  else {
-    end = url_string.length();
-  }
-  // std::cout << "new end: " << end << std::endl;
-  ret.path = string::urldecode(url_string.substr(start, end - start));
-  // std::cout << "got path: " << ret.path << std::endl;
-
-  // The query is anything until the end or npos
-  if (query_start != std::string::npos) {
-    start = query_start + 1;
-    end = fragment_start;
-    if (std::string::npos == end) {
-      end = url_string.length();
-    }
-
-    // std::cout << "new end: " << end << std::endl;
-    auto query = url_string.substr(start, end - start);
-    // std::cout << "got query: " << query << std::endl;
-    split_query(ret.query, query);
-
-    for (auto elem : ret.query) {
-      // std::cout << "  " << elem.first << " = " << elem.second << std::endl;
-    }
-  }
-
-  // Last, the fragment
-  if (fragment_start != std::string::npos) {
-    ret.fragment = url_string.substr(fragment_start + 1);
-    // std::cout << "got fragment: " << ret.fragment << std::endl;
-  }
-
-  return ret;
+  return url_view::parse(url_string).to_url();
 }
 
 
@@ -206,22 +52,21 @@ url::parse(std::string const & url_string)
 bool
 url::is_equal_to(url const & other) const
 {
+  // The query is the most expensive part to compare, so leave it for last.
   return scheme == other.scheme
     && authority == other.authority
     && path == other.path
-    && query == other.query
-    && fragment == other.fragment;
+    && fragment == other.fragment
+    && query == other.query;
 }
 
 
 bool
 url::is_less_than(url const & other) const
 {
-  return scheme < other.scheme
-    || authority < other.authority
-    || path < other.path
-    || query < other.query
-    || fragment < other.fragment;
+  return std::tie(scheme, authority, path, query, fragment)
+    < std::tie(other.scheme, other.authority, other.path, other.query,
+        other.fragment);
 }
 
 
@@ -235,7 +80,7 @@ url::str() const
 
   if (!query.empty()) {
     ret += "?";
-    for (auto elem : query) {
+    for (auto const & elem : query) {
       // cppcheck-suppress useStlAlgorithm
       ret += string::urlencode(elem.first) + "=" + string::urlencode(elem.second) + "&";
     }
@@ -268,12 +113,7 @@ url::hash() const
 {
   size_t base = liberate::cpp::multi_hash(
       scheme, authority, path, fragment);
-
-  for (auto elem : query) {
-    liberate::cpp::hash_combine(base,
-        liberate::cpp::multi_hash(elem.first, elem.second));
-  }
-
+  liberate::cpp::hash_combine(base, query.hash());
   return base;
 }
 
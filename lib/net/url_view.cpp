@@ -0,0 +1,267 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/url_view.h>
+
+#include <stdexcept>
+
+#include <liberate/string/util.h>
+#include <liberate/string/urlencode.h>
+
+#include "../macros.h"
+
+namespace liberate::net {
+
+namespace {
+
+std::string
+normalize_value(std::string_view value)
+{
+  std::string ret = string::to_lower(value);
+
+  if ("true" == ret or "yes" == ret) {
+    ret = "1";
+  } else if ("false" == ret or "no" == ret) {
+    ret = "0";
+  }
+
+  return ret;
+}
+
+
+inline char
+ascii_lower(char ch)
+{
+  if (ch >= 'A' && ch <= 'Z') {
+    return ch - 'A' + 'a';
+  }
+  return ch;
+}
+
+
+inline int
+hex_value(char ch)
+{
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  ch = ascii_lower(ch);
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  return -1;
+}
+
+
+/**
+ * Compare a raw query key to an already normalized key, decoding and
+ * lower-casing on the fly. This mirrors what url::parse() does to keys, that
+ * is lower-casing first and URL decoding second.
+ */
+bool
+key_matches(std::string_view raw, std::string_view key)
+{
+  size_t matched = 0;
+  for (size_t i = 0 ; i < raw.size() ; ++i) {
+    char ch = raw[i];
+    if ('%' == ch) {
+      int hi = i + 1 < raw.size() ? hex_value(raw[i + 1]) : -1;
+      int lo = i + 2 < raw.size() ? hex_value(raw[i + 2]) : -1;
+      ch = (hi < 0 || lo < 0) ? '?' : static_cast<char>((hi << 4) | lo);
+      i += 2;
+    }
+    else {
+      ch = ascii_lower(ch);
+    }
+
+    if (matched >= key.size() || key[matched] != ch) {
+      return false;
+    }
+    ++matched;
+  }
+  return matched == key.size();
+}
+
+
+inline std::string
+normalize_key(std::string_view raw)
+{
+  return string::urldecode(string::to_lower(raw));
+}
+
+} // anonymous namespace
+
+
+url_view
+url_view::parse(std::string_view url_string)
+{
+  url_view ret;
+
+  // We'll find the first occurrence of a colon; that *should* delimit the
+  // scheme.
+  auto end = url_string.find(':');
+  if (std::string_view::npos == end) {
+    throw std::invalid_argument{
+        std::string{"No scheme separator found in connector URL: "}
+        + std::string{url_string}};
+  }
+
+  // We'll then try to see if the characters immediately following are two
+  // slashes.
+  if (end + 3 > url_string.size()
+      || !('/' == url_string[end + 1] && '/' == url_string[end + 2]))
+  {
+    throw std::invalid_argument{
+        std::string{"Bad scheme separator found in connector URL: "}
+        + std::string{url_string}};
+  }
+
+  ret.m_scheme = url_string.substr(0, end);
+
+  // Find all other delimiters in a single pass. The first '#' ends
+  // everything; the first '?' before it starts the query, and the first '/'
+  // before that starts the path.
+  auto start = end + 3;
+  auto size = url_string.size();
+  auto path_start = std::string_view::npos;
+  auto query_start = std::string_view::npos;
+  auto fragment_start = size;
+  for (auto i = start ; i < size ; ++i) {
+    auto ch = url_string[i];
+    if ('#' == ch) {
+      fragment_start = i;
+      break;
+    }
+    if ('?' == ch) {
+      if (std::string_view::npos == query_start) {
+        query_start = i;
+      }
+    }
+    else if ('/' == ch && std::string_view::npos == path_start
+        && std::string_view::npos == query_start)
+    {
+      path_start = i;
+    }
+  }
+
+  auto path_end = std::string_view::npos == query_start
+    ? fragment_start : query_start;
+  auto authority_end = std::string_view::npos == path_start
+    ? path_end : path_start;
+
+  ret.m_authority = url_string.substr(start, authority_end - start);
+  if (std::string_view::npos != path_start) {
+    ret.m_path = url_string.substr(path_start, path_end - path_start);
+  }
+  if (std::string_view::npos != query_start) {
+    ret.m_query = url_string.substr(query_start + 1,
+        fragment_start - query_start - 1);
+  }
+  if (fragment_start < size) {
+    ret.m_fragment = url_string.substr(fragment_start + 1);
+  }
+
+  return ret;
+}
+
+
+
+bool
+url_view::scheme_is(std::string_view lower_scheme) const
+{
+  if (m_scheme.size() != lower_scheme.size()) {
+    return false;
+  }
+  for (size_t i = 0 ; i < m_scheme.size() ; ++i) {
+    if (ascii_lower(m_scheme[i]) != lower_scheme[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool
+url_view::has_query(std::string_view key) const
+{
+  bool found = false;
+  for_each_query([&](std::string_view raw_key, std::string_view, bool)
+  {
+    found = found || key_matches(raw_key, key);
+  });
+  return found;
+}
+
+
+
+std::optional<std::string>
+url_view::query_value(std::string_view key) const
+{
+  // Find the last matching parameter first, so that we only decode one.
+  bool found = false;
+  bool found_has_value = false;
+  std::string_view found_value;
+  for_each_query([&](std::string_view raw_key, std::string_view raw_value,
+        bool has_value)
+  {
+    if (key_matches(raw_key, key)) {
+      found = true;
+      found_has_value = has_value;
+      found_value = raw_value;
+    }
+  });
+
+  if (!found) {
+    return {};
+  }
+  if (!found_has_value) {
+    return std::string{"1"}; // Treat as boolean
+  }
+  return string::urldecode(normalize_value(found_value));
+}
+
+
+
+url
+url_view::to_url() const
+{
+  url ret;
+  ret.scheme = string::to_lower(m_scheme);
+  ret.authority = string::urldecode(m_authority);
+  ret.path = string::urldecode(m_path);
+
+  for_each_query([&ret](std::string_view raw_key, std::string_view raw_value,
+        bool has_value)
+  {
+    if (has_value) {
+      ret.query[normalize_key(raw_key)] = string::urldecode(
+          normalize_value(raw_value));
+    }
+    else {
+      ret.query[normalize_key(raw_key)] = "1"; // Treat as boolean
+    }
+  });
+
+  ret.fragment = std::string{m_fragment};
+  return ret;
+}
+
+} // namespace liberate::net
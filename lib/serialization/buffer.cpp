@@ -0,0 +1,291 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/serialization/buffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace liberate::serialization {
+
+namespace {
+
+template <typename segmentT>
+inline std::size_t
+total_size(segmentT const * segments, std::size_t amount)
+{
+  std::size_t ret = 0;
+  for (std::size_t i = 0 ; i < amount ; ++i) {
+    ret += segments[i].data ? segments[i].size : 0;
+  }
+  return ret;
+}
+
+} // anonymous namespace
+
+
+/*****************************************************************************
+ * buffer_writer
+ **/
+buffer_writer::buffer_writer(byte * buffer, std::size_t size)
+  : m_single{buffer, buffer ? size : 0}
+  , m_capacity{m_single.size}
+{
+  enter_segment(0);
+}
+
+
+
+buffer_writer::buffer_writer(segment const * segments, std::size_t amount)
+  : m_segments{segments}
+  , m_amount{segments ? amount : 0}
+  , m_capacity{total_size(segments, m_amount)}
+{
+  enter_segment(0);
+}
+
+
+
+void
+buffer_writer::reset()
+{
+  m_done = 0;
+  m_error = false;
+  enter_segment(0);
+}
+
+
+
+void
+buffer_writer::enter_segment(std::size_t index)
+{
+  m_index = index;
+  if (index >= m_amount) {
+    m_start = m_cur = m_end = nullptr;
+    return;
+  }
+
+  auto const & seg = m_segments ? m_segments[index] : m_single;
+  m_start = m_cur = seg.data;
+  m_end = seg.data ? seg.data + seg.size : seg.data;
+}
+
+
+
+buffer_writer &
+buffer_writer::write_slow(void const * data, std::size_t size)
+{
+  if (m_error) {
+    return *this;
+  }
+  if (size > remaining()) {
+    return fail();
+  }
+
+  auto input = static_cast<byte const *>(data);
+  while (size > 0) {
+    if (!space()) {
+      m_done += static_cast<std::size_t>(m_cur - m_start);
+      enter_segment(m_index + 1);
+      continue;
+    }
+
+    auto amount = std::min(size, space());
+    std::memcpy(m_cur, input, amount);
+    m_cur += amount;
+    input += amount;
+    size -= amount;
+  }
+  return *this;
+}
+
+
+
+buffer_writer &
+buffer_writer::fail()
+{
+  m_error = true;
+  return *this;
+}
+
+
+/*****************************************************************************
+ * buffer_reader
+ **/
+buffer_reader::buffer_reader(byte const * buffer, std::size_t size)
+  : m_single{buffer, buffer ? size : 0}
+  , m_capacity{m_single.size}
+{
+  enter_segment(0);
+}
+
+
+
+buffer_reader::buffer_reader(const_segment const * segments,
+    std::size_t amount)
+  : m_segments{segments}
+  , m_amount{segments ? amount : 0}
+  , m_capacity{total_size(segments, m_amount)}
+{
+  enter_segment(0);
+}
+
+
+
+void
+buffer_reader::reset()
+{
+  m_done = 0;
+  m_error = false;
+  enter_segment(0);
+}
+
+
+
+void
+buffer_reader::enter_segment(std::size_t index)
+{
+  m_index = index;
+  if (index >= m_amount) {
+    m_start = m_cur = m_end = nullptr;
+    return;
+  }
+
+  auto const & seg = m_segments ? m_segments[index] : m_single;
+  m_start = m_cur = seg.data;
+  m_end = seg.data ? seg.data + seg.size : seg.data;
+}
+
+
+
+bool
+buffer_reader::read_slow(void * data, std::size_t size)
+{
+  if (m_error) {
+    return false;
+  }
+  if (size > remaining()) {
+    fail();
+    return false;
+  }
+
+  auto output = static_cast<byte *>(data);
+  while (size > 0) {
+    if (!space()) {
+      m_done += static_cast<std::size_t>(m_cur - m_start);
+      enter_segment(m_index + 1);
+      continue;
+    }
+
+    auto amount = std::min(size, space());
+    std::memcpy(output, m_cur, amount);
+    m_cur += amount;
+    output += amount;
+    size -= amount;
+  }
+  return true;
+}
+
+
+
+std::size_t
+buffer_reader::peek(void * data, std::size_t size) const
+{
+  size = std::min(size, remaining());
+
+  auto output = static_cast<byte *>(data);
+  auto amount = std::min(size, space());
+  if (amount) {
+    std::memcpy(output, m_cur, amount);
+  }
+
+  std::size_t copied = amount;
+  for (auto index = m_index + 1 ; copied < size && index < m_amount ; ++index) {
+    auto const & seg = m_segments[index];
+    if (!seg.data) {
+      continue;
+    }
+    amount = std::min(size - copied, seg.size);
+    std::memcpy(output + copied, seg.data, amount);
+    copied += amount;
+  }
+  return copied;
+}
+
+
+
+buffer_reader &
+buffer_reader::skip(std::size_t size)
+{
+  if (m_error) {
+    return *this;
+  }
+  if (size > remaining()) {
+    return fail();
+  }
+
+  while (size > 0) {
+    if (!space()) {
+      m_done += static_cast<std::size_t>(m_cur - m_start);
+      enter_segment(m_index + 1);
+      continue;
+    }
+
+    auto amount = std::min(size, space());
+    m_cur += amount;
+    size -= amount;
+  }
+  return *this;
+}
+
+
+
+buffer_reader &
+buffer_reader::read_view(byte const * & view, std::size_t size)
+{
+  if (m_error) {
+    return *this;
+  }
+
+  // Views start in the next non-empty segment if the current one is used up.
+  while (!space() && size > 0 && m_index + 1 < m_amount) {
+    m_done += static_cast<std::size_t>(m_cur - m_start);
+    enter_segment(m_index + 1);
+  }
+
+  if (size > space()) {
+    return fail();
+  }
+
+  view = m_cur;
+  m_cur += size;
+  return *this;
+}
+
+
+
+buffer_reader &
+buffer_reader::fail()
+{
+  m_error = true;
+  return *this;
+}
+
+} // namespace liberate::serialization
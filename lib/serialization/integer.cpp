@@ -0,0 +1,247 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <build-config.h>
+
+#include <liberate/serialization/integer.h>
+
+#include "../simd.h"
+
+namespace liberate::serialization {
+
+namespace {
+
+#if !defined(LIBERATE_BIGENDIAN)
+
+/**
+ * Vector kernels swap as many whole blocks as fit into the input, and return
+ * the number of Bytes processed. The remainder is left to the scalar code.
+ */
+using swap_kernel = std::size_t (*)(std::uint8_t * output,
+    std::uint8_t const * input, std::size_t size, std::size_t width);
+
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+/**
+ * Shuffle masks reversing the Bytes of each 2, 4 and 8 Byte integer in a
+ * 16 Byte block.
+ */
+alignas(16) constexpr std::uint8_t SWAP_MASKS[3][16] = {
+  { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+  { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+  { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+};
+
+inline std::uint8_t const *
+swap_mask(std::size_t width)
+{
+  return SWAP_MASKS[width == 2 ? 0 : (width == 4 ? 1 : 2)];
+}
+
+
+LIBERATE_SIMD_TARGET("ssse3")
+std::size_t
+swap_ssse3(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t size, std::size_t width)
+{
+  auto const mask = _mm_load_si128(
+      reinterpret_cast<__m128i const *>(swap_mask(width)));
+
+  std::size_t i = 0;
+  for ( ; i + 16 <= size ; i += 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i),
+        _mm_shuffle_epi8(in, mask));
+  }
+  return i;
+}
+
+#endif // SSSE3
+
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+LIBERATE_SIMD_TARGET("avx2")
+std::size_t
+swap_avx2(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t size, std::size_t width)
+{
+  // The shuffle works per 16 Byte lane, so the same mask serves both lanes.
+  auto const mask = _mm256_broadcastsi128_si256(_mm_load_si128(
+        reinterpret_cast<__m128i const *>(swap_mask(width))));
+
+  std::size_t i = 0;
+  for ( ; i + 64 <= size ; i += 64) {
+    auto in0 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(input + i));
+    auto in1 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(input + i + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i),
+        _mm256_shuffle_epi8(in0, mask));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i + 32),
+        _mm256_shuffle_epi8(in1, mask));
+  }
+  for ( ; i + 32 <= size ; i += 32) {
+    auto in = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(input + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i),
+        _mm256_shuffle_epi8(in, mask));
+  }
+  return i;
+}
+
+#endif // AVX2
+
+
+#if defined(LIBERATE_SIMD_NEON)
+
+std::size_t
+swap_neon(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t size, std::size_t width)
+{
+  std::size_t i = 0;
+  for ( ; i + 16 <= size ; i += 16) {
+    auto in = vld1q_u8(input + i);
+    switch (width) {
+      case 2:
+        in = vrev16q_u8(in);
+        break;
+      case 4:
+        in = vrev32q_u8(in);
+        break;
+      default:
+        in = vrev64q_u8(in);
+        break;
+    }
+    vst1q_u8(output + i, in);
+  }
+  return i;
+}
+
+#endif // NEON
+
+
+/**
+ * Select the best kernel for this CPU once. A null kernel means that only the
+ * scalar code is used.
+ */
+swap_kernel
+select_kernel()
+{
+  swap_kernel ret = nullptr;
+
+#if defined(LIBERATE_SIMD_NEON)
+  ret = swap_neon;
+#endif
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_ssse3()) {
+    ret = swap_ssse3;
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_avx2()) {
+    ret = swap_avx2;
+  }
+#endif
+
+  return ret;
+}
+
+
+inline swap_kernel
+active_kernel()
+{
+  static swap_kernel const ret = select_kernel();
+  return ret;
+}
+
+
+template <typename T>
+inline void
+swap_scalar(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t amount)
+{
+  for (std::size_t i = 0 ; i < amount ; ++i) {
+    T tmp;
+    std::memcpy(&tmp, input + i * sizeof(T), sizeof(T));
+    tmp = detail::byte_swap(tmp);
+    std::memcpy(output + i * sizeof(T), &tmp, sizeof(T));
+  }
+}
+
+#endif // LIBERATE_BIGENDIAN
+
+} // anonymous namespace
+
+
+namespace detail {
+
+void
+convert_byte_order(std::uint8_t * output, std::uint8_t const * input,
+    std::size_t amount, std::size_t width)
+{
+#if defined(LIBERATE_BIGENDIAN)
+  std::memmove(output, input, amount * width);
+#else
+  if (width <= 1) {
+    std::memmove(output, input, amount * width);
+    return;
+  }
+
+  std::size_t done = 0;
+  auto kernel = active_kernel();
+  if (kernel && (width == 2 || width == 4 || width == 8)) {
+    done = kernel(output, input, amount * width, width) / width;
+  }
+
+  output += done * width;
+  input += done * width;
+  amount -= done;
+
+  switch (width) {
+    case 2:
+      swap_scalar<std::uint16_t>(output, input, amount);
+      break;
+
+    case 4:
+      swap_scalar<std::uint32_t>(output, input, amount);
+      break;
+
+    case 8:
+      swap_scalar<std::uint64_t>(output, input, amount);
+      break;
+
+    default:
+      for (std::size_t i = 0 ; i < amount ; ++i) {
+        for (std::size_t j = 0 ; j < width ; ++j) {
+          output[i * width + j] = input[i * width + width - j - 1];
+        }
+      }
+      break;
+  }
+#endif
+}
+
+} // namespace detail
+
+} // namespace liberate::serialization
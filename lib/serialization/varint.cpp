@@ -0,0 +1,190 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/serialization/varint.h>
+
+#include "../simd.h"
+
+namespace liberate::serialization {
+
+namespace {
+
+using varint = ::liberate::types::varint;
+using varint_base = ::liberate::types::varint_base;
+
+/**
+ * Decode a varint whose length is already known, e.g. from the positions of
+ * the continuation bits. Lengths up to 8 cannot overflow, so there is no need
+ * to check.
+ */
+constexpr std::size_t KNOWN_LENGTH_MAX = 8;
+
+inline varint_base
+decode_known_length(std::uint8_t const * input, std::size_t length)
+{
+  auto val = static_cast<std::uint64_t>(input[0] & 127);
+  for (std::size_t i = 1 ; i < length ; ++i) {
+    val = ((val + 1) << 7) | (input[i] & 127);
+  }
+  return static_cast<varint_base>(val);
+}
+
+
+#if defined(LIBERATE_SIMD_SSE2)
+
+/**
+ * Store 16 single Byte values as varints.
+ */
+inline void
+widen_block(varint * values, __m128i block)
+{
+  auto const zero = _mm_setzero_si128();
+  auto out = reinterpret_cast<__m128i *>(values);
+
+  __m128i const words[2] = {
+    _mm_unpacklo_epi8(block, zero),
+    _mm_unpackhi_epi8(block, zero),
+  };
+  for (auto & word : words) {
+    __m128i const dwords[2] = {
+      _mm_unpacklo_epi16(word, zero),
+      _mm_unpackhi_epi16(word, zero),
+    };
+    for (auto & dword : dwords) {
+      _mm_storeu_si128(out++, _mm_unpacklo_epi32(dword, zero));
+      _mm_storeu_si128(out++, _mm_unpackhi_epi32(dword, zero));
+    }
+  }
+}
+
+#endif
+
+} // anonymous namespace
+
+
+std::size_t
+serialized_size(varint const * values, std::size_t amount)
+{
+  std::size_t ret = 0;
+  for (std::size_t i = 0 ; i < amount ; ++i) {
+    ret += serialized_size(values[i]);
+  }
+  return ret;
+}
+
+
+namespace detail {
+
+std::size_t
+serialize_varints(std::uint8_t * output, std::size_t output_length,
+    varint const * values, std::size_t amount)
+{
+  if (!output || !values) {
+    return 0;
+  }
+
+  std::size_t offset = 0;
+  for (std::size_t i = 0 ; i < amount ; ++i) {
+    auto input = static_cast<varint_base>(values[i]);
+
+    // Single Byte values are by far the most common.
+    if (input >= 0 && input < 128 && offset < output_length) {
+      output[offset++] = static_cast<std::uint8_t>(input);
+      continue;
+    }
+
+    auto written = serialize_varint(output + offset, output_length - offset,
+        values[i]);
+    if (!written) {
+      return 0;
+    }
+    offset += written;
+  }
+  return offset;
+}
+
+
+
+std::size_t
+deserialize_varints(varint * values, std::size_t amount,
+    std::uint8_t const * input, std::size_t input_length)
+{
+  if (!values || !input) {
+    return 0;
+  }
+
+  std::size_t offset = 0;
+  std::size_t decoded = 0;
+
+#if defined(LIBERATE_SIMD_SSE2)
+  // The continuation bits of 16 Bytes at a time tell where each varint in
+  // the block ends, so the varints can be decoded without checking every
+  // Byte. Blocks without continuation bits consist of 16 single Byte values.
+  while (decoded + 16 <= amount && offset + 16 <= input_length) {
+    auto block = _mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(input + offset));
+    auto continued = static_cast<std::uint32_t>(_mm_movemask_epi8(block));
+    if (!continued) {
+      widen_block(values + decoded, block);
+      decoded += 16;
+      offset += 16;
+      continue;
+    }
+
+    std::size_t start = 0;
+    for (auto ends = ~continued & 0xffff ; ends ; ends &= ends - 1) {
+      std::size_t end = ::liberate::simd::trailing_zeros(ends);
+      auto length = end - start + 1;
+      if (length > KNOWN_LENGTH_MAX) {
+        break;
+      }
+      values[decoded++] = varint{decode_known_length(input + offset + start,
+          length)};
+      start = end + 1;
+    }
+
+    if (!start) {
+      // A long varint starts the block; leave it to the scalar code.
+      auto used = deserialize_varint(values[decoded], input + offset,
+          input_length - offset);
+      if (!used) {
+        return 0;
+      }
+      ++decoded;
+      start = used;
+    }
+    offset += start;
+  }
+#endif
+
+  for ( ; decoded < amount ; ++decoded) {
+    auto used = deserialize_varint(values[decoded], input + offset,
+        input_length - offset);
+    if (!used) {
+      return 0;
+    }
+    offset += used;
+  }
+  return offset;
+}
+
+} // namespace detail
+
+} // namespace liberate::serialization
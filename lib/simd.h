@@ -0,0 +1,147 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#ifndef LIBERATE_SIMD_H
+#define LIBERATE_SIMD_H
+
+#ifndef __cplusplus
+#error You are trying to include a C++ only header file
+#endif
+
+#include <build-config.h>
+
+/**
+ * Compile-time SIMD instruction set detection. These reflect what the
+ * compiler may emit for the whole library, not what the CPU running it
+ * supports. SSE2 is part of the x86_64 baseline, and NEON of the AArch64
+ * baseline, so both are generally available there. We only use NEON on
+ * AArch64, where horizontal operations are available.
+ *
+ * Define LIBERATE_SIMD_DISABLE to build scalar code only.
+ **/
+#if !defined(LIBERATE_SIMD_DISABLE)
+
+#  if defined(__AVX2__)
+#    define LIBERATE_SIMD_AVX2
+#  endif
+
+#  if defined(__SSSE3__) || defined(__AVX__)
+#    define LIBERATE_SIMD_SSSE3
+#  endif
+
+#  if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define LIBERATE_SIMD_SSE2
+#  endif
+
+#  if (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+#    define LIBERATE_SIMD_NEON
+#  endif
+
+/**
+ * Runtime dispatch. GCC and clang can compile individual functions for
+ * instruction sets beyond the library's baseline via LIBERATE_SIMD_TARGET;
+ * such functions must only be called if cpu_supports_*() below returns true.
+ * Elsewhere, LIBERATE_SIMD_TARGET expands to nothing, and only instruction
+ * sets enabled at compile time can be used.
+ **/
+#  if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#    define LIBERATE_SIMD_DISPATCH_X86
+#  endif
+
+#endif // LIBERATE_SIMD_DISABLE
+
+#if defined(LIBERATE_SIMD_DISPATCH_X86)
+#  define LIBERATE_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define LIBERATE_SIMD_TARGET(isa)
+#endif
+
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+#  include <immintrin.h>
+#elif defined(LIBERATE_SIMD_SSSE3)
+#  include <tmmintrin.h>
+#elif defined(LIBERATE_SIMD_SSE2)
+#  include <emmintrin.h>
+#endif
+
+#if defined(LIBERATE_SIMD_NEON)
+#  include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#include <cstdint>
+
+namespace liberate::simd {
+
+/**
+ * Index of the lowest set bit, e.g. of a comparison mask. The value must not
+ * be zero.
+ **/
+inline unsigned
+trailing_zeros(uint32_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward(&index, value);
+  return index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+
+/**
+ * Runtime CPU feature checks. These are true if the instruction set is
+ * enabled at compile time, or if it can be dispatched to at runtime and the
+ * CPU supports it.
+ **/
+inline bool
+cpu_supports_ssse3()
+{
+#if defined(LIBERATE_SIMD_SSSE3)
+  return true;
+#elif defined(LIBERATE_SIMD_DISPATCH_X86)
+  return __builtin_cpu_supports("ssse3");
+#else
+  return false;
+#endif
+}
+
+
+inline bool
+cpu_supports_avx2()
+{
+#if defined(LIBERATE_SIMD_AVX2)
+  return true;
+#elif defined(LIBERATE_SIMD_DISPATCH_X86)
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+} // namespace liberate::simd
+
+#endif // guard
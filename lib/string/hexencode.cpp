@@ -21,6 +21,8 @@
 
 #include <liberate/logging.h>
 
+#include "../simd.h"
+
 namespace liberate::string {
 
 namespace {
@@ -38,7 +40,7 @@ static constexpr byte hexalpha_upper[] = {
   byte{'0'}, byte{'1'}, byte{'2'}, byte{'3'},
   byte{'4'}, byte{'5'}, byte{'6'}, byte{'7'},
   byte{'8'}, byte{'9'}, byte{'A'}, byte{'B'},
-  byte{'D'}, byte{'D'}, byte{'E'}, byte{'F'},
+  byte{'C'}, byte{'D'}, byte{'E'}, byte{'F'},
 };
 
 
@@ -49,7 +51,7 @@ inline int decode_half(byte half)
     return c - '0';
   }
 
-  c = ::tolower(c);
+  c = static_cast<char>(c | 0x20);
   if (c < 'a' || c > 'f') {
     return -1;
   }
@@ -57,10 +59,269 @@ inline int decode_half(byte half)
 }
 
 
+/**
+ * Vector kernels process as much of the input as fits their block size, and
+ * return the number of input Bytes consumed. The remainder is left to the
+ * scalar code.
+ *
+ * Decoding kernels validate each block before producing output; they stop at
+ * the first block containing a non-hex character, and leave reporting the
+ * error to the scalar code.
+ */
+using encode_kernel = size_t (*)(byte * output, byte const * input,
+    size_t input_size, byte const * alphabet);
+using decode_kernel = size_t (*)(byte * output, byte const * input,
+    size_t input_size);
+
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+LIBERATE_SIMD_TARGET("ssse3")
+size_t
+encode_ssse3(byte * output, byte const * input, size_t input_size,
+    byte const * alphabet)
+{
+  // The alphabet has exactly 16 entries, so it fits a shuffle table.
+  auto const table = _mm_loadu_si128(
+      reinterpret_cast<__m128i const *>(alphabet));
+  auto const nibble = _mm_set1_epi8(0x0f);
+
+  size_t i = 0;
+  for ( ; i + 16 <= input_size ; i += 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+    auto high = _mm_shuffle_epi8(table,
+        _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+    auto low = _mm_shuffle_epi8(table, _mm_and_si128(in, nibble));
+
+    auto out = reinterpret_cast<__m128i *>(output + (i * 2));
+    _mm_storeu_si128(out, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(high, low));
+  }
+  return i;
+}
+
+
+LIBERATE_SIMD_TARGET("ssse3")
+size_t
+decode_ssse3(byte * output, byte const * input, size_t input_size)
+{
+  auto const zero = _mm_set1_epi8('0');
+  auto const lower_a = _mm_set1_epi8('a');
+  auto const case_bit = _mm_set1_epi8(0x20);
+  auto const max_digit = _mm_set1_epi8(9);
+  auto const max_alpha = _mm_set1_epi8(5);
+  auto const ten = _mm_set1_epi8(10);
+  // Multiplies the high nibble (even byte) by 16, the low nibble by 1.
+  auto const weights = _mm_set1_epi16(0x0110);
+
+  size_t i = 0;
+  for ( ; i + 16 <= input_size ; i += 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+
+    // Unsigned range checks via min(); digits and letters can't overlap.
+    auto digit = _mm_sub_epi8(in, zero);
+    auto alpha = _mm_sub_epi8(_mm_or_si128(in, case_bit), lower_a);
+    auto is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, max_digit), digit);
+    auto is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, max_alpha), alpha);
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xffff) {
+      break;
+    }
+
+    auto nibbles = _mm_or_si128(_mm_and_si128(is_digit, digit),
+        _mm_and_si128(is_alpha, _mm_add_epi8(alpha, ten)));
+    auto words = _mm_maddubs_epi16(nibbles, weights);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output + (i / 2)),
+        _mm_packus_epi16(words, words));
+  }
+  return i;
+}
+
+#endif // SSSE3
+
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+LIBERATE_SIMD_TARGET("avx2")
+size_t
+encode_avx2(byte * output, byte const * input, size_t input_size,
+    byte const * alphabet)
+{
+  auto const table = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+      reinterpret_cast<__m128i const *>(alphabet)));
+  auto const nibble = _mm256_set1_epi8(0x0f);
+
+  size_t i = 0;
+  for ( ; i + 32 <= input_size ; i += 32) {
+    auto in = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(input + i));
+    auto high = _mm256_shuffle_epi8(table,
+        _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble));
+    auto low = _mm256_shuffle_epi8(table, _mm256_and_si256(in, nibble));
+
+    // Unpacking works per 128 bit lane, so the halves need reordering.
+    auto first = _mm256_unpacklo_epi8(high, low);
+    auto second = _mm256_unpackhi_epi8(high, low);
+
+    auto out = reinterpret_cast<__m256i *>(output + (i * 2));
+    _mm256_storeu_si256(out, _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(out + 1,
+        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  return i;
+}
+
+
+LIBERATE_SIMD_TARGET("avx2")
+size_t
+decode_avx2(byte * output, byte const * input, size_t input_size)
+{
+  auto const zero = _mm256_set1_epi8('0');
+  auto const lower_a = _mm256_set1_epi8('a');
+  auto const case_bit = _mm256_set1_epi8(0x20);
+  auto const max_digit = _mm256_set1_epi8(9);
+  auto const max_alpha = _mm256_set1_epi8(5);
+  auto const ten = _mm256_set1_epi8(10);
+  auto const weights = _mm256_set1_epi16(0x0110);
+
+  size_t i = 0;
+  for ( ; i + 32 <= input_size ; i += 32) {
+    auto in = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(input + i));
+
+    auto digit = _mm256_sub_epi8(in, zero);
+    auto alpha = _mm256_sub_epi8(_mm256_or_si256(in, case_bit), lower_a);
+    auto is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, max_digit),
+        digit);
+    auto is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, max_alpha),
+        alpha);
+    if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1) {
+      break;
+    }
+
+    auto nibbles = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+        _mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, ten)));
+    auto words = _mm256_maddubs_epi16(nibbles, weights);
+
+    // Packing also works per lane; gather both lanes' low halves.
+    auto packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(words, words), 0xd8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (i / 2)),
+        _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+
+#endif // AVX2
+
+
+#if defined(LIBERATE_SIMD_NEON)
+
+size_t
+encode_neon(byte * output, byte const * input, size_t input_size,
+    byte const * alphabet)
+{
+  auto const table = vld1q_u8(reinterpret_cast<uint8_t const *>(alphabet));
+  auto const nibble = vdupq_n_u8(0x0f);
+
+  size_t i = 0;
+  for ( ; i + 16 <= input_size ; i += 16) {
+    auto in = vld1q_u8(reinterpret_cast<uint8_t const *>(input + i));
+    uint8x16x2_t chars;
+    chars.val[0] = vqtbl1q_u8(table, vshrq_n_u8(in, 4));
+    chars.val[1] = vqtbl1q_u8(table, vandq_u8(in, nibble));
+    // Interleaving store
+    vst2q_u8(reinterpret_cast<uint8_t *>(output + (i * 2)), chars);
+  }
+  return i;
+}
+
+
+inline uint8x16_t
+decode_nibbles_neon(uint8x16_t in, uint8x16_t & valid)
+{
+  auto digit = vsubq_u8(in, vdupq_n_u8('0'));
+  auto alpha = vsubq_u8(vorrq_u8(in, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  auto is_digit = vcltq_u8(digit, vdupq_n_u8(10));
+  auto is_alpha = vcltq_u8(alpha, vdupq_n_u8(6));
+  valid = vandq_u8(valid, vorrq_u8(is_digit, is_alpha));
+  return vorrq_u8(vandq_u8(is_digit, digit),
+      vandq_u8(is_alpha, vaddq_u8(alpha, vdupq_n_u8(10))));
+}
+
+
+size_t
+decode_neon(byte * output, byte const * input, size_t input_size)
+{
+  size_t i = 0;
+  for ( ; i + 32 <= input_size ; i += 32) {
+    // De-interleaving load: high nibbles in val[0], low nibbles in val[1]
+    auto in = vld2q_u8(reinterpret_cast<uint8_t const *>(input + i));
+    auto valid = vdupq_n_u8(0xff);
+    auto high = decode_nibbles_neon(in.val[0], valid);
+    auto low = decode_nibbles_neon(in.val[1], valid);
+    if (vminvq_u8(valid) == 0) {
+      break;
+    }
+    vst1q_u8(reinterpret_cast<uint8_t *>(output + (i / 2)),
+        vorrq_u8(vshlq_n_u8(high, 4), low));
+  }
+  return i;
+}
+
+#endif // NEON
+
+
+/**
+ * Select the best kernels for this CPU once. Null kernels mean that only the
+ * scalar code is used.
+ */
+struct kernels
+{
+  encode_kernel encode = nullptr;
+  decode_kernel decode = nullptr;
+};
+
+
+kernels
+select_kernels()
+{
+  kernels ret;
+
+#if defined(LIBERATE_SIMD_NEON)
+  ret.encode = encode_neon;
+  ret.decode = decode_neon;
+#endif
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_ssse3()) {
+    ret.encode = encode_ssse3;
+    ret.decode = decode_ssse3;
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_avx2()) {
+    ret.encode = encode_avx2;
+    ret.decode = decode_avx2;
+  }
+#endif
+
+  return ret;
+}
+
+
+inline kernels const &
+active_kernels()
+{
+  static kernels const ret = select_kernels();
+  return ret;
+}
+
+
 
 inline size_t
 hexencode_impl(byte * output, size_t output_size, byte const * input,
-    size_t input_size, byte const * alphabet, size_t alphabet_size)
+    size_t input_size, byte const * alphabet)
 {
   size_t required_size = input_size * 2;
   if (output_size < required_size) {
@@ -69,16 +330,20 @@ hexencode_impl(byte * output, size_t output_size, byte const * input,
     return 0;
   }
 
-  // Convert
-  byte const * cur = input;
-  size_t offset = 0;
-  for ( ; cur < input + input_size ; ++cur) {
-    int val = static_cast<int>(*cur);
-    output[offset++] = alphabet[val / alphabet_size];
-    output[offset++] = alphabet[val % alphabet_size];
+  size_t done = 0;
+  auto kernel = active_kernels().encode;
+  if (kernel) {
+    done = kernel(output, input, input_size, alphabet);
+  }
+
+  // Convert the remainder
+  for ( ; done < input_size ; ++done) {
+    auto val = static_cast<unsigned>(input[done]);
+    output[done * 2] = alphabet[val >> 4];
+    output[done * 2 + 1] = alphabet[val & 0x0f];
   }
 
-  return offset;
+  return required_size;
 }
 
 } // anonymous namespace
@@ -89,8 +354,7 @@ hexencode(::liberate::types::byte * output, size_t output_size, ::liberate::type
     size_t input_size, bool uppercase /* = false */)
 {
   return hexencode_impl(output, output_size, input, input_size,
-      uppercase ? hexalpha_upper : hexalpha_lower,
-      uppercase ? sizeof(hexalpha_upper) : sizeof(hexalpha_lower));
+      uppercase ? hexalpha_upper : hexalpha_lower);
 }
 
 
@@ -99,25 +363,34 @@ size_t
 hexdecode(::liberate::types::byte * output, size_t output_size, ::liberate::types::byte const * input,
     size_t input_size)
 {
+  // An odd number of characters can't be decoded.
+  if (input_size % 2) {
+    return 0;
+  }
 
   size_t required_size = input_size / 2;
   if (output_size < required_size) {
     return 0;
   }
 
-  // Convert
-  byte const * cur = input;
-  size_t offset = 0;
-  while (cur < input + input_size) {
-    int v1 = decode_half(*cur++);
+  size_t done = 0;
+  auto kernel = active_kernels().decode;
+  if (kernel) {
+    done = kernel(output, input, input_size);
+  }
+
+  // Convert the remainder, or find the invalid character the kernel
+  // stopped at.
+  for ( ; done < input_size ; done += 2) {
+    int v1 = decode_half(input[done]);
     if (v1 < 0) return 0;
-    int v2 = decode_half(*cur++);
+    int v2 = decode_half(input[done + 1]);
     if (v2 < 0) return 0;
 
-    output[offset++] = static_cast<byte>((v1 << 4) + v2);
+    output[done / 2] = static_cast<byte>((v1 << 4) + v2);
   }
 
-  return offset;
+  return required_size;
 }
 
 
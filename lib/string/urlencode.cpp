@@ -19,58 +19,256 @@
  **/
 #include <liberate/string/urlencode.h>
 
-#include <liberate/string/hexencode.h>
+#include <algorithm>
+#include <cstring>
+
+#include "../simd.h"
 
 namespace liberate::string {
 
-std::string
-urlencode(std::string const & input)
+namespace {
+
+/**
+ * Lookup tables for the characters that pass through unencoded, and for the
+ * values of hex digits (or -1).
+ */
+struct tables
 {
-  std::string ret;
+  bool    safe[256];
+  int8_t  hex_value[256];
+};
+
+
+constexpr tables
+make_tables()
+{
+  tables ret{};
+  for (int i = 0 ; i < 256 ; ++i) {
+    ret.safe[i] = (i >= '0' && i <= '9')
+      || (i >= 'A' && i <= 'Z') || (i >= 'a' && i <= 'z')
+      || i == '-' || i == '_' || i == '.' || i == '/';
+
+    ret.hex_value[i] = -1;
+    if (i >= '0' && i <= '9') {
+      ret.hex_value[i] = i - '0';
+    }
+    else if (i >= 'A' && i <= 'F') {
+      ret.hex_value[i] = i - 'A' + 10;
+    }
+    else if (i >= 'a' && i <= 'f') {
+      ret.hex_value[i] = i - 'a' + 10;
+    }
+  }
+  return ret;
+}
+
+constexpr tables TABLES = make_tables();
+
+constexpr char HEX_UPPER[] = "0123456789ABCDEF";
+
+
+inline bool
+is_safe(char ch)
+{
+  return TABLES.safe[static_cast<unsigned char>(ch)];
+}
+
+
+inline int
+hex_value(char ch)
+{
+  return TABLES.hex_value[static_cast<unsigned char>(ch)];
+}
+
+
+/**
+ * Return the length of the run of safe characters at the start of the input.
+ */
+inline size_t
+safe_run(char const * input, size_t size)
+{
+  size_t i = 0;
+
+#if defined(LIBERATE_SIMD_SSE2)
+  {
+    // Safe are '-' to '9' (which includes '.' and '/'), letters and '_'.
+    // Bytes >= 0x80 are negative in signed comparisons, so never in range.
+    auto const dash_lo = _mm_set1_epi8('-' - 1);
+    auto const nine_hi = _mm_set1_epi8('9' + 1);
+    auto const alpha_lo = _mm_set1_epi8('a' - 1);
+    auto const alpha_hi = _mm_set1_epi8('z' + 1);
+    auto const case_bit = _mm_set1_epi8(0x20);
+    auto const underscore = _mm_set1_epi8('_');
+    for ( ; i + 16 <= size ; i += 16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+      auto lowered = _mm_or_si128(v, case_bit);
+      auto safe = _mm_or_si128(
+          _mm_or_si128(
+            _mm_and_si128(_mm_cmpgt_epi8(v, dash_lo),
+              _mm_cmplt_epi8(v, nine_hi)),
+            _mm_and_si128(_mm_cmpgt_epi8(lowered, alpha_lo),
+              _mm_cmplt_epi8(lowered, alpha_hi))),
+          _mm_cmpeq_epi8(v, underscore));
+      uint32_t unsafe = ~static_cast<uint32_t>(_mm_movemask_epi8(safe))
+        & 0xffff;
+      if (unsafe) {
+        return i + ::liberate::simd::trailing_zeros(unsafe);
+      }
+    }
+  }
+#elif defined(LIBERATE_SIMD_NEON)
+  {
+    auto const dash = vdupq_n_u8('-');
+    auto const nine = vdupq_n_u8('9');
+    auto const lower_a = vdupq_n_u8('a');
+    auto const lower_z = vdupq_n_u8('z');
+    auto const case_bit = vdupq_n_u8(0x20);
+    auto const underscore = vdupq_n_u8('_');
+    for ( ; i + 16 <= size ; i += 16) {
+      auto v = vld1q_u8(reinterpret_cast<uint8_t const *>(input + i));
+      auto lowered = vorrq_u8(v, case_bit);
+      auto safe = vorrq_u8(
+          vorrq_u8(
+            vandq_u8(vcgeq_u8(v, dash), vcleq_u8(v, nine)),
+            vandq_u8(vcgeq_u8(lowered, lower_a), vcleq_u8(lowered, lower_z))),
+          vceqq_u8(v, underscore));
+      if (vminvq_u8(safe) == 0) {
+        // The scalar loop below finds the exact position.
+        break;
+      }
+    }
+  }
+#endif
+
+  for ( ; i < size && is_safe(input[i]) ; ++i) {} //!OCLINT
+  return i;
+}
 
-  for (auto ch : input) {
-    // Keep alphanumeric and other accepted characters intact
-    if (isalnum(ch) || ch == '-' || ch == '_' || ch == '.' || ch == '/') {
-      ret += ch;
-      continue;
+
+/**
+ * Encode into a buffer known to be large enough.
+ */
+inline size_t
+encode_into(char * output, std::string_view input)
+{
+  auto out = output;
+  size_t i = 0;
+  while (i < input.size()) {
+    // Copy safe characters in bulk
+    auto run = safe_run(input.data() + i, input.size() - i);
+    std::memcpy(out, input.data() + i, run);
+    out += run;
+    i += run;
+
+    if (i >= input.size()) {
+      break;
     }
 
-    ret += "%";
-    ret += hexencode(&ch, 1, true);
+    auto ch = static_cast<unsigned char>(input[i++]);
+    *out++ = '%';
+    *out++ = HEX_UPPER[ch >> 4];
+    *out++ = HEX_UPPER[ch & 0x0f];
   }
+  return out - output;
+}
 
+} // anonymous namespace
+
+
+size_t
+urlencoded_size(std::string_view input)
+{
+  size_t ret = input.size();
+  size_t i = 0;
+  while (i < input.size()) {
+    i += safe_run(input.data() + i, input.size() - i);
+    if (i < input.size()) {
+      // Each escaped character takes two more.
+      ret += 2;
+      ++i;
+    }
+  }
   return ret;
 }
 
 
 
+size_t
+urlencode(char * output, size_t output_size, std::string_view input)
+{
+  auto required = urlencoded_size(input);
+  if (!output || output_size < required) {
+    return 0;
+  }
+  return encode_into(output, input);
+}
+
+
+
 std::string
-urldecode(std::string const & input)
+urlencode(std::string_view input)
 {
   std::string ret;
+  ret.resize(urlencoded_size(input));
+  encode_into(&ret[0], input);
+  return ret;
+}
 
-  for (std::string::size_type i = 0 ; i < input.size() ; ++i) {
-    auto ch = input[i];
 
-    // Percent-encoded
-    if (ch == '%') {
-      ::liberate::types::byte val;
-      auto used = hexdecode(&val, 1,
-          reinterpret_cast<::liberate::types::byte const *>(input.c_str() + i + 1), 2);
-      if (used > 0) {
-        ret += static_cast<char>(val);
-      }
-      else {
-        ret += "?";
-      }
-      i += 2;
-      continue;
+
+size_t
+urldecode(char * output, size_t output_size, std::string_view input)
+{
+  if (!output) {
+    return 0;
+  }
+
+  auto out = output;
+  auto out_end = output + output_size;
+  auto cur = input.data();
+  auto end = input.data() + input.size();
+  while (cur < end) {
+    // Copy everything up to the next escape in bulk
+    auto pct = static_cast<char const *>(std::memchr(cur, '%', end - cur));
+    auto run = static_cast<size_t>((pct ? pct : end) - cur);
+    if (run > static_cast<size_t>(out_end - out)) {
+      return 0;
     }
+    std::memcpy(out, cur, run);
+    out += run;
+    cur += run;
 
-    // Regular value
-    ret += ch;
+    if (cur >= end) {
+      break;
+    }
+    if (out >= out_end) {
+      return 0;
+    }
+
+    // Percent-encoded
+    int high = (end - cur > 1) ? hex_value(cur[1]) : -1;
+    int low = (end - cur > 2) ? hex_value(cur[2]) : -1;
+    if (high < 0 || low < 0) {
+      *out++ = '?';
+    }
+    else {
+      *out++ = static_cast<char>((high << 4) | low);
+    }
+    cur += std::min<ptrdiff_t>(3, end - cur);
   }
 
+  return out - output;
+}
+
+
+
+std::string
+urldecode(std::string_view input)
+{
+  std::string ret;
+  ret.resize(input.size());
+  auto used = urldecode(&ret[0], ret.size(), input);
+  ret.resize(used);
   return ret;
 }
 
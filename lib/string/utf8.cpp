@@ -19,6 +19,902 @@
  **/
 #include <liberate/string/utf8.h>
 
+#include <cstdint>
+#include <cstring>
+
+#include "../simd.h"
+
+namespace liberate::string {
+
+namespace {
+
+/**
+ * Scalar decoding and encoding of single code points. The decoder returns the
+ * number of code units consumed, or 0 if the input is invalid.
+ */
+inline size_t
+decode_utf8(uint8_t const * input, size_t remaining, char32_t & cp)
+{
+  auto lead = input[0];
+  if (lead < 0x80) {
+    cp = lead;
+    return 1;
+  }
+
+  // Continuation bytes, overlong two byte sequences and anything beyond
+  // U+10FFFF can be rejected by the lead byte alone.
+  size_t length = 0;
+  if (lead < 0xc2) {
+    return 0;
+  }
+  else if (lead < 0xe0) {
+    length = 2;
+    cp = lead & 0x1f;
+  }
+  else if (lead < 0xf0) {
+    length = 3;
+    cp = lead & 0x0f;
+  }
+  else if (lead < 0xf5) {
+    length = 4;
+    cp = lead & 0x07;
+  }
+  else {
+    return 0;
+  }
+
+  if (remaining < length) {
+    return 0;
+  }
+  for (size_t i = 1 ; i < length ; ++i) {
+    if ((input[i] & 0xc0) != 0x80) {
+      return 0;
+    }
+    cp = (cp << 6) | (input[i] & 0x3f);
+  }
+
+  // Overlong encodings, surrogates and values that are too large.
+  if ((length == 3 && cp < 0x800)
+      || (length == 4 && (cp < 0x10000 || cp > 0x10ffff))
+      || (cp >= 0xd800 && cp <= 0xdfff))
+  {
+    return 0;
+  }
+  return length;
+}
+
+
+inline size_t
+utf8_length(char32_t cp)
+{
+  return cp < 0x80 ? 1 : (cp < 0x800 ? 2 : (cp < 0x10000 ? 3 : 4));
+}
+
+
+inline void
+encode_utf8(char * output, char32_t cp, size_t length)
+{
+  switch (length) {
+    case 1:
+      output[0] = static_cast<char>(cp);
+      break;
+
+    case 2:
+      output[0] = static_cast<char>(0xc0 | (cp >> 6));
+      output[1] = static_cast<char>(0x80 | (cp & 0x3f));
+      break;
+
+    case 3:
+      output[0] = static_cast<char>(0xe0 | (cp >> 12));
+      output[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+      output[2] = static_cast<char>(0x80 | (cp & 0x3f));
+      break;
+
+    default:
+      output[0] = static_cast<char>(0xf0 | (cp >> 18));
+      output[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+      output[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+      output[3] = static_cast<char>(0x80 | (cp & 0x3f));
+      break;
+  }
+}
+
+
+inline bool
+is_surrogate(char32_t cp)
+{
+  return cp >= 0xd800 && cp <= 0xdfff;
+}
+
+
+bool
+validate_scalar(uint8_t const * input, size_t input_size)
+{
+  size_t i = 0;
+  while (i < input_size) {
+    // Skip ASCII eight Bytes at a time.
+    uint64_t block;
+    if (i + 8 <= input_size) {
+      std::memcpy(&block, input + i, sizeof(block));
+      if (!(block & 0x8080808080808080ULL)) {
+        i += 8;
+        continue;
+      }
+    }
+
+    char32_t cp = 0;
+    auto used = decode_utf8(input + i, input_size - i, cp);
+    if (!used) {
+      return false;
+    }
+    i += used;
+  }
+  return true;
+}
+
+
+/**
+ * Vectorized validation after Keiser and Lemire, "Validating UTF-8 in less
+ * than one instruction per byte". Each byte is classified by looking up its
+ * high nibble, and the high and low nibble of its predecessor in three
+ * tables; the bitwise AND of the lookups is non-zero exactly where a two byte
+ * pattern is invalid. Sequences of three or four Bytes are then checked by
+ * comparing where continuations are expected with where they are found.
+ */
+constexpr uint8_t TOO_SHORT = 1 << 0;      // 11______ 0_______ or 11______
+constexpr uint8_t TOO_LONG = 1 << 1;       // 0_______ 10______
+constexpr uint8_t OVERLONG_3 = 1 << 2;     // 11100000 100_____
+constexpr uint8_t TOO_LARGE = 1 << 3;      // 11110100 1001____ and above
+constexpr uint8_t SURROGATE = 1 << 4;      // 11101101 101_____
+constexpr uint8_t OVERLONG_2 = 1 << 5;     // 1100000_ 10______
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101 1000____ and above
+constexpr uint8_t OVERLONG_4 = 1 << 6;     // 11110000 1000____
+constexpr uint8_t TWO_CONTS = 1 << 7;      // 10______ 10______
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// Indexed by the high nibble of the first Byte
+alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+  // ASCII
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  // Continuation
+  TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+  // Two Byte lead
+  TOO_SHORT | OVERLONG_2,
+  TOO_SHORT,
+  // Three Byte lead
+  TOO_SHORT | OVERLONG_3 | SURROGATE,
+  // Four Byte lead
+  TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+// Indexed by the low nibble of the first Byte
+alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+  CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+  CARRY | OVERLONG_2,
+  CARRY,
+  CARRY,
+  CARRY | TOO_LARGE,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+// Indexed by the high nibble of the second Byte
+alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+  // ASCII
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  // Continuation: 1000____, 1001____, 101_____
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  // Leads
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// A block is incomplete if it ends in a lead Byte whose sequence does not fit;
+// Bytes greater than these values are such leads.
+alignas(16) constexpr uint8_t INCOMPLETE_MAX[32] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+LIBERATE_SIMD_TARGET("ssse3")
+inline __m128i
+load_table_ssse3(uint8_t const * table)
+{
+  return _mm_load_si128(reinterpret_cast<__m128i const *>(table));
+}
+
+
+LIBERATE_SIMD_TARGET("ssse3")
+inline __m128i
+block_errors_ssse3(__m128i input, __m128i prev_input)
+{
+  auto const nibble = _mm_set1_epi8(0x0f);
+
+  auto prev1 = _mm_alignr_epi8(input, prev_input, 15);
+  auto special = _mm_and_si128(
+      _mm_and_si128(
+        _mm_shuffle_epi8(load_table_ssse3(BYTE_1_HIGH),
+          _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+        _mm_shuffle_epi8(load_table_ssse3(BYTE_1_LOW), _mm_and_si128(prev1, nibble))),
+      _mm_shuffle_epi8(load_table_ssse3(BYTE_2_HIGH),
+        _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+  // Only 111_____ and 1111____ leads two or three Bytes back end up with
+  // the high bit set, which is exactly where TWO_CONTS is expected.
+  auto prev2 = _mm_alignr_epi8(input, prev_input, 14);
+  auto prev3 = _mm_alignr_epi8(input, prev_input, 13);
+  auto must23 = _mm_or_si128(
+      _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+      _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+  return _mm_xor_si128(_mm_and_si128(must23,
+        _mm_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+
+LIBERATE_SIMD_TARGET("ssse3")
+inline void
+check_block_ssse3(__m128i block, __m128i const & incomplete_max,
+    __m128i & error, __m128i & prev_input, __m128i & prev_incomplete)
+{
+  if (!_mm_movemask_epi8(block)) {
+    // ASCII; only the previous block can be in error.
+    error = _mm_or_si128(error, prev_incomplete);
+    prev_incomplete = _mm_setzero_si128();
+  }
+  else {
+    error = _mm_or_si128(error, block_errors_ssse3(block, prev_input));
+    prev_incomplete = _mm_subs_epu8(block, incomplete_max);
+  }
+  prev_input = block;
+}
+
+
+LIBERATE_SIMD_TARGET("ssse3")
+bool
+validate_ssse3(uint8_t const * input, size_t input_size)
+{
+  auto const incomplete_max = _mm_loadu_si128(
+      reinterpret_cast<__m128i const *>(INCOMPLETE_MAX + 16));
+  auto error = _mm_setzero_si128();
+  auto prev_input = _mm_setzero_si128();
+  auto prev_incomplete = _mm_setzero_si128();
+
+  size_t i = 0;
+  for ( ; i + 16 <= input_size ; i += 16) {
+    check_block_ssse3(
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i)),
+        incomplete_max, error, prev_input, prev_incomplete);
+  }
+
+  // Pad the last block with NUL, which is valid ASCII.
+  if (i < input_size) {
+    alignas(16) uint8_t last[16] = {};
+    std::memcpy(last, input + i, input_size - i);
+    check_block_ssse3(
+        _mm_load_si128(reinterpret_cast<__m128i const *>(last)),
+        incomplete_max, error, prev_input, prev_incomplete);
+  }
+
+  error = _mm_or_si128(error, prev_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128()))
+    == 0xffff;
+}
+
+#endif // SSSE3
+
+
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+
+LIBERATE_SIMD_TARGET("avx2")
+inline __m256i
+prev_avx2(__m256i input, __m256i prev_input, int const n)
+{
+  // Both alignr and the shift amount work per lane, so the shifted in bytes
+  // of the low lane must come from the previous block's high lane.
+  auto shifted_in = _mm256_permute2x128_si256(prev_input, input, 0x21);
+  switch (n) {
+    case 1:
+      return _mm256_alignr_epi8(input, shifted_in, 15);
+    case 2:
+      return _mm256_alignr_epi8(input, shifted_in, 14);
+    default:
+      return _mm256_alignr_epi8(input, shifted_in, 13);
+  }
+}
+
+
+LIBERATE_SIMD_TARGET("avx2")
+inline __m256i
+load_table_avx2(uint8_t const * table)
+{
+  return _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<__m128i const *>(table)));
+}
+
+
+LIBERATE_SIMD_TARGET("avx2")
+inline __m256i
+block_errors_avx2(__m256i input, __m256i prev_input)
+{
+  auto const nibble = _mm256_set1_epi8(0x0f);
+
+  auto prev1 = prev_avx2(input, prev_input, 1);
+  auto special = _mm256_and_si256(
+      _mm256_and_si256(
+        _mm256_shuffle_epi8(load_table_avx2(BYTE_1_HIGH),
+          _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+        _mm256_shuffle_epi8(load_table_avx2(BYTE_1_LOW),
+          _mm256_and_si256(prev1, nibble))),
+      _mm256_shuffle_epi8(load_table_avx2(BYTE_2_HIGH),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+  auto must23 = _mm256_or_si256(
+      _mm256_subs_epu8(prev_avx2(input, prev_input, 2),
+        _mm256_set1_epi8(0xe0 - 0x80)),
+      _mm256_subs_epu8(prev_avx2(input, prev_input, 3),
+        _mm256_set1_epi8(0xf0 - 0x80)));
+  return _mm256_xor_si256(_mm256_and_si256(must23,
+        _mm256_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+
+LIBERATE_SIMD_TARGET("avx2")
+inline void
+check_block_avx2(__m256i block, __m256i const & incomplete_max,
+    __m256i & error, __m256i & prev_input, __m256i & prev_incomplete)
+{
+  if (!_mm256_movemask_epi8(block)) {
+    error = _mm256_or_si256(error, prev_incomplete);
+    prev_incomplete = _mm256_setzero_si256();
+  }
+  else {
+    error = _mm256_or_si256(error, block_errors_avx2(block, prev_input));
+    prev_incomplete = _mm256_subs_epu8(block, incomplete_max);
+  }
+  prev_input = block;
+}
+
+
+LIBERATE_SIMD_TARGET("avx2")
+bool
+validate_avx2(uint8_t const * input, size_t input_size)
+{
+  auto const incomplete_max = _mm256_load_si256(
+      reinterpret_cast<__m256i const *>(INCOMPLETE_MAX));
+  auto error = _mm256_setzero_si256();
+  auto prev_input = _mm256_setzero_si256();
+  auto prev_incomplete = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for ( ; i + 32 <= input_size ; i += 32) {
+    check_block_avx2(
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(input + i)),
+        incomplete_max, error, prev_input, prev_incomplete);
+  }
+
+  if (i < input_size) {
+    alignas(32) uint8_t last[32] = {};
+    std::memcpy(last, input + i, input_size - i);
+    check_block_avx2(
+        _mm256_load_si256(reinterpret_cast<__m256i const *>(last)),
+        incomplete_max, error, prev_input, prev_incomplete);
+  }
+
+  error = _mm256_or_si256(error, prev_incomplete);
+  return _mm256_testz_si256(error, error);
+}
+
+#endif // AVX2
+
+
+#if defined(LIBERATE_SIMD_NEON)
+
+inline uint8x16_t
+block_errors_neon(uint8x16_t input, uint8x16_t prev_input)
+{
+  auto const nibble = vdupq_n_u8(0x0f);
+
+  auto prev1 = vextq_u8(prev_input, input, 15);
+  auto special = vandq_u8(
+      vandq_u8(
+        vqtbl1q_u8(vld1q_u8(BYTE_1_HIGH), vshrq_n_u8(prev1, 4)),
+        vqtbl1q_u8(vld1q_u8(BYTE_1_LOW), vandq_u8(prev1, nibble))),
+      vqtbl1q_u8(vld1q_u8(BYTE_2_HIGH), vshrq_n_u8(input, 4)));
+
+  auto must23 = vorrq_u8(
+      vqsubq_u8(vextq_u8(prev_input, input, 14), vdupq_n_u8(0xe0 - 0x80)),
+      vqsubq_u8(vextq_u8(prev_input, input, 13), vdupq_n_u8(0xf0 - 0x80)));
+  return veorq_u8(vandq_u8(must23, vdupq_n_u8(0x80)), special);
+}
+
+
+bool
+validate_neon(uint8_t const * input, size_t input_size)
+{
+  auto const incomplete_max = vld1q_u8(INCOMPLETE_MAX + 16);
+  auto error = vdupq_n_u8(0);
+  auto prev_input = vdupq_n_u8(0);
+  auto prev_incomplete = vdupq_n_u8(0);
+
+  auto process = [&](uint8x16_t block)
+  {
+    if (vmaxvq_u8(block) < 0x80) {
+      error = vorrq_u8(error, prev_incomplete);
+      prev_incomplete = vdupq_n_u8(0);
+    }
+    else {
+      error = vorrq_u8(error, block_errors_neon(block, prev_input));
+      prev_incomplete = vqsubq_u8(block, incomplete_max);
+    }
+    prev_input = block;
+  };
+
+  size_t i = 0;
+  for ( ; i + 16 <= input_size ; i += 16) {
+    process(vld1q_u8(input + i));
+  }
+
+  if (i < input_size) {
+    uint8_t last[16] = {};
+    std::memcpy(last, input + i, input_size - i);
+    process(vld1q_u8(last));
+  }
+
+  error = vorrq_u8(error, prev_incomplete);
+  return vmaxvq_u8(error) == 0;
+}
+
+#endif // NEON
+
+
+using validate_kernel = bool (*)(uint8_t const * input, size_t input_size);
+
+validate_kernel
+select_validate()
+{
+#if defined(LIBERATE_SIMD_AVX2) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_avx2()) {
+    return validate_avx2;
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_SSSE3) || defined(LIBERATE_SIMD_DISPATCH_X86)
+  if (::liberate::simd::cpu_supports_ssse3()) {
+    return validate_ssse3;
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_NEON)
+  return validate_neon;
+#else
+  return validate_scalar;
+#endif
+}
+
+
+/**
+ * ASCII fast paths for transcoding: convert a block of 16 code units at once
+ * if they are all ASCII, and return false otherwise.
+ */
+constexpr size_t ASCII_BLOCK = 16;
+
+inline bool
+ascii_block_to_utf16(char16_t * output, uint8_t const * input)
+{
+#if defined(LIBERATE_SIMD_SSE2)
+  auto v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input));
+  if (_mm_movemask_epi8(v)) {
+    return false;
+  }
+  auto const zero = _mm_setzero_si128();
+  auto out = reinterpret_cast<__m128i *>(output);
+  _mm_storeu_si128(out, _mm_unpacklo_epi8(v, zero));
+  _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(v, zero));
+  return true;
+#elif defined(LIBERATE_SIMD_NEON)
+  auto v = vld1q_u8(input);
+  if (vmaxvq_u8(v) >= 0x80) {
+    return false;
+  }
+  auto out = reinterpret_cast<uint16_t *>(output);
+  vst1q_u16(out, vmovl_u8(vget_low_u8(v)));
+  vst1q_u16(out + 8, vmovl_high_u8(v));
+  return true;
+#else
+  uint64_t block[2];
+  std::memcpy(block, input, sizeof(block));
+  if ((block[0] | block[1]) & 0x8080808080808080ULL) {
+    return false;
+  }
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    output[i] = input[i];
+  }
+  return true;
+#endif
+}
+
+
+inline bool
+ascii_block_to_utf32(char32_t * output, uint8_t const * input)
+{
+#if defined(LIBERATE_SIMD_SSE2)
+  auto v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input));
+  if (_mm_movemask_epi8(v)) {
+    return false;
+  }
+  auto const zero = _mm_setzero_si128();
+  auto low = _mm_unpacklo_epi8(v, zero);
+  auto high = _mm_unpackhi_epi8(v, zero);
+  auto out = reinterpret_cast<__m128i *>(output);
+  _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+  _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+  _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+  _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+  return true;
+#elif defined(LIBERATE_SIMD_NEON)
+  auto v = vld1q_u8(input);
+  if (vmaxvq_u8(v) >= 0x80) {
+    return false;
+  }
+  auto low = vmovl_u8(vget_low_u8(v));
+  auto high = vmovl_high_u8(v);
+  auto out = reinterpret_cast<uint32_t *>(output);
+  vst1q_u32(out, vmovl_u16(vget_low_u16(low)));
+  vst1q_u32(out + 4, vmovl_high_u16(low));
+  vst1q_u32(out + 8, vmovl_u16(vget_low_u16(high)));
+  vst1q_u32(out + 12, vmovl_high_u16(high));
+  return true;
+#else
+  uint64_t block[2];
+  std::memcpy(block, input, sizeof(block));
+  if ((block[0] | block[1]) & 0x8080808080808080ULL) {
+    return false;
+  }
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    output[i] = input[i];
+  }
+  return true;
+#endif
+}
+
+
+inline bool
+ascii_block_from_utf16(char * output, char16_t const * input)
+{
+#if defined(LIBERATE_SIMD_SSE2)
+  auto in = reinterpret_cast<__m128i const *>(input);
+  auto first = _mm_loadu_si128(in);
+  auto second = _mm_loadu_si128(in + 1);
+  auto non_ascii = _mm_and_si128(_mm_or_si128(first, second),
+      _mm_set1_epi16(static_cast<short>(0xff80)));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128()))
+      != 0xffff)
+  {
+    return false;
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(output),
+      _mm_packus_epi16(first, second));
+  return true;
+#elif defined(LIBERATE_SIMD_NEON)
+  auto in = reinterpret_cast<uint16_t const *>(input);
+  auto first = vld1q_u16(in);
+  auto second = vld1q_u16(in + 8);
+  if (vmaxvq_u16(vorrq_u16(first, second)) >= 0x80) {
+    return false;
+  }
+  vst1q_u8(reinterpret_cast<uint8_t *>(output),
+      vcombine_u8(vmovn_u16(first), vmovn_u16(second)));
+  return true;
+#else
+  char16_t all = 0;
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    all |= input[i];
+  }
+  if (all >= 0x80) {
+    return false;
+  }
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    output[i] = static_cast<char>(input[i]);
+  }
+  return true;
+#endif
+}
+
+
+inline bool
+ascii_block_from_utf32(char * output, char32_t const * input)
+{
+#if defined(LIBERATE_SIMD_SSE2)
+  auto in = reinterpret_cast<__m128i const *>(input);
+  auto v0 = _mm_loadu_si128(in);
+  auto v1 = _mm_loadu_si128(in + 1);
+  auto v2 = _mm_loadu_si128(in + 2);
+  auto v3 = _mm_loadu_si128(in + 3);
+  auto non_ascii = _mm_and_si128(
+      _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3)),
+      _mm_set1_epi32(static_cast<int>(0xffffff80)));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi32(non_ascii, _mm_setzero_si128()))
+      != 0xffff)
+  {
+    return false;
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(output),
+      _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+  return true;
+#elif defined(LIBERATE_SIMD_NEON)
+  auto in = reinterpret_cast<uint32_t const *>(input);
+  auto v0 = vld1q_u32(in);
+  auto v1 = vld1q_u32(in + 4);
+  auto v2 = vld1q_u32(in + 8);
+  auto v3 = vld1q_u32(in + 12);
+  if (vmaxvq_u32(vorrq_u32(vorrq_u32(v0, v1), vorrq_u32(v2, v3))) >= 0x80) {
+    return false;
+  }
+  auto first = vcombine_u16(vmovn_u32(v0), vmovn_u32(v1));
+  auto second = vcombine_u16(vmovn_u32(v2), vmovn_u32(v3));
+  vst1q_u8(reinterpret_cast<uint8_t *>(output),
+      vcombine_u8(vmovn_u16(first), vmovn_u16(second)));
+  return true;
+#else
+  char32_t all = 0;
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    all |= input[i];
+  }
+  if (all >= 0x80) {
+    return false;
+  }
+  for (size_t i = 0 ; i < ASCII_BLOCK ; ++i) {
+    output[i] = static_cast<char>(input[i]);
+  }
+  return true;
+#endif
+}
+
+} // anonymous namespace
+
+
+bool
+utf8_validate(char const * input, size_t input_size)
+{
+  if (!input) {
+    return !input_size;
+  }
+  static validate_kernel const kernel = select_validate();
+  return kernel(reinterpret_cast<uint8_t const *>(input), input_size);
+}
+
+
+
+size_t
+utf8_to_utf16(char16_t * output, size_t output_size,
+    char const * input, size_t input_size)
+{
+  if (!output || !input) {
+    return 0;
+  }
+
+  auto in = reinterpret_cast<uint8_t const *>(input);
+  size_t i = 0;
+  size_t o = 0;
+  while (i < input_size) {
+    if (i + ASCII_BLOCK <= input_size && o + ASCII_BLOCK <= output_size
+        && ascii_block_to_utf16(output + o, in + i))
+    {
+      i += ASCII_BLOCK;
+      o += ASCII_BLOCK;
+      continue;
+    }
+
+    char32_t cp = 0;
+    auto used = decode_utf8(in + i, input_size - i, cp);
+    if (!used) {
+      return 0;
+    }
+    i += used;
+
+    if (cp < 0x10000) {
+      if (o + 1 > output_size) {
+        return 0;
+      }
+      output[o++] = static_cast<char16_t>(cp);
+    }
+    else {
+      if (o + 2 > output_size) {
+        return 0;
+      }
+      cp -= 0x10000;
+      output[o++] = static_cast<char16_t>(0xd800 + (cp >> 10));
+      output[o++] = static_cast<char16_t>(0xdc00 + (cp & 0x3ff));
+    }
+  }
+  return o;
+}
+
+
+
+size_t
+utf8_to_utf32(char32_t * output, size_t output_size,
+    char const * input, size_t input_size)
+{
+  if (!output || !input) {
+    return 0;
+  }
+
+  auto in = reinterpret_cast<uint8_t const *>(input);
+  size_t i = 0;
+  size_t o = 0;
+  while (i < input_size) {
+    if (i + ASCII_BLOCK <= input_size && o + ASCII_BLOCK <= output_size
+        && ascii_block_to_utf32(output + o, in + i))
+    {
+      i += ASCII_BLOCK;
+      o += ASCII_BLOCK;
+      continue;
+    }
+
+    char32_t cp = 0;
+    auto used = decode_utf8(in + i, input_size - i, cp);
+    if (!used || o >= output_size) {
+      return 0;
+    }
+    i += used;
+    output[o++] = cp;
+  }
+  return o;
+}
+
+
+
+size_t
+utf16_to_utf8(char * output, size_t output_size,
+    char16_t const * input, size_t input_size)
+{
+  if (!output || !input) {
+    return 0;
+  }
+
+  size_t i = 0;
+  size_t o = 0;
+  while (i < input_size) {
+    if (i + ASCII_BLOCK <= input_size && o + ASCII_BLOCK <= output_size
+        && ascii_block_from_utf16(output + o, input + i))
+    {
+      i += ASCII_BLOCK;
+      o += ASCII_BLOCK;
+      continue;
+    }
+
+    char32_t cp = input[i++];
+    if (is_surrogate(cp)) {
+      // Must be a high surrogate followed by a low surrogate.
+      if (cp >= 0xdc00 || i >= input_size
+          || input[i] < 0xdc00 || input[i] > 0xdfff)
+      {
+        return 0;
+      }
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (input[i++] - 0xdc00);
+    }
+
+    auto length = utf8_length(cp);
+    if (o + length > output_size) {
+      return 0;
+    }
+    encode_utf8(output + o, cp, length);
+    o += length;
+  }
+  return o;
+}
+
+
+
+size_t
+utf32_to_utf8(char * output, size_t output_size,
+    char32_t const * input, size_t input_size)
+{
+  if (!output || !input) {
+    return 0;
+  }
+
+  size_t i = 0;
+  size_t o = 0;
+  while (i < input_size) {
+    if (i + ASCII_BLOCK <= input_size && o + ASCII_BLOCK <= output_size
+        && ascii_block_from_utf32(output + o, input + i))
+    {
+      i += ASCII_BLOCK;
+      o += ASCII_BLOCK;
+      continue;
+    }
+
+    auto cp = input[i++];
+    if (cp > 0x10ffff || is_surrogate(cp)) {
+      return 0;
+    }
+
+    auto length = utf8_length(cp);
+    if (o + length > output_size) {
+      return 0;
+    }
+    encode_utf8(output + o, cp, length);
+    o += length;
+  }
+  return o;
+}
+
+
+
+size_t
+utf16_length_from_utf8(char const * input, size_t input_size)
+{
+  // Every Byte but continuations starts a code point; four Byte sequences
+  // need a surrogate pair. This loop is simple enough to be auto-vectorized.
+  size_t ret = 0;
+  for (size_t i = 0 ; i < input_size ; ++i) {
+    auto byte = static_cast<uint8_t>(input[i]);
+    ret += ((byte & 0xc0) != 0x80) + (byte >= 0xf0);
+  }
+  return ret;
+}
+
+
+
+size_t
+utf32_length_from_utf8(char const * input, size_t input_size)
+{
+  size_t ret = 0;
+  for (size_t i = 0 ; i < input_size ; ++i) {
+    ret += ((static_cast<uint8_t>(input[i]) & 0xc0) != 0x80);
+  }
+  return ret;
+}
+
+
+
+size_t
+utf8_length_from_utf16(char16_t const * input, size_t input_size)
+{
+  // Surrogate pairs are two code units yielding four Bytes.
+  size_t ret = 0;
+  for (size_t i = 0 ; i < input_size ; ++i) {
+    auto unit = input[i];
+    ret += 1 + (unit >= 0x80) + (unit >= 0x800 && !is_surrogate(unit));
+  }
+  return ret;
+}
+
+
+
+size_t
+utf8_length_from_utf32(char32_t const * input, size_t input_size)
+{
+  size_t ret = 0;
+  for (size_t i = 0 ; i < input_size ; ++i) {
+    ret += utf8_length(input[i]);
+  }
+  return ret;
+}
+
+} // namespace liberate::string
+
+
 #if defined(LIBERATE_WIN32)
 
 #include <vector>
@@ -19,118 +19,410 @@
  **/
 #include <liberate/string/util.h>
 
-#include <algorithm>
-#include <locale>
-#include <cctype>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
+
+#include "../simd.h"
 
 namespace liberate::string {
 
-std::string
-to_lower(std::string const & value)
+namespace {
+
+inline char
+ascii_lower(char ch)
 {
-  std::string ret;
-  ret.resize(value.size());
-  std::transform(
-      value.begin(), value.end(), ret.begin(),
-      [] (std::string::value_type ch) -> std::string::value_type
-      {
-        return std::tolower<std::string::value_type>(
-            ch, std::locale());
-      }
-  );
-  return ret;
+  return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch | 0x20) : ch;
 }
 
 
-std::string
-to_upper(std::string const & value)
+inline char
+ascii_upper(char ch)
 {
-  std::string ret;
-  ret.resize(value.size());
-  std::transform(
-      value.begin(), value.end(), ret.begin(),
-      [] (std::string::value_type ch) -> std::string::value_type
-      {
-        return std::toupper<std::string::value_type>(
-            ch, std::locale());
-      }
-  );
-  return ret;
+  return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch & ~0x20) : ch;
 }
 
 
+/**
+ * Flip the case bit of all characters in the range [LOW, HIGH]. For ASCII,
+ * that is all it takes to convert between upper and lower case.
+ */
+template <char LOW, char HIGH>
+inline void
+flip_case(char * data, size_t size)
+{
+  size_t i = 0;
 
-std::string
-replace(std::string const & haystack, std::string const & needle,
-    std::string const & substitute, bool first_only /* = false */)
+#if defined(LIBERATE_SIMD_AVX2)
+  {
+    // Bytes >= 0x80 are negative in signed comparisons, so they never fall
+    // into the range.
+    auto const low = _mm256_set1_epi8(LOW - 1);
+    auto const high = _mm256_set1_epi8(HIGH + 1);
+    auto const bit = _mm256_set1_epi8(0x20);
+    for ( ; i + 32 <= size ; i += 32) {
+      auto ptr = reinterpret_cast<__m256i *>(data + i);
+      auto v = _mm256_loadu_si256(ptr);
+      auto in_range = _mm256_and_si256(_mm256_cmpgt_epi8(v, low),
+          _mm256_cmpgt_epi8(high, v));
+      _mm256_storeu_si256(ptr,
+          _mm256_xor_si256(v, _mm256_and_si256(in_range, bit)));
+    }
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_SSE2)
+  {
+    auto const low = _mm_set1_epi8(LOW - 1);
+    auto const high = _mm_set1_epi8(HIGH + 1);
+    auto const bit = _mm_set1_epi8(0x20);
+    for ( ; i + 16 <= size ; i += 16) {
+      auto ptr = reinterpret_cast<__m128i *>(data + i);
+      auto v = _mm_loadu_si128(ptr);
+      auto in_range = _mm_and_si128(_mm_cmpgt_epi8(v, low),
+          _mm_cmplt_epi8(v, high));
+      _mm_storeu_si128(ptr, _mm_xor_si128(v, _mm_and_si128(in_range, bit)));
+    }
+  }
+#elif defined(LIBERATE_SIMD_NEON)
+  {
+    auto const low = vdupq_n_u8(LOW);
+    auto const high = vdupq_n_u8(HIGH);
+    auto const bit = vdupq_n_u8(0x20);
+    for ( ; i + 16 <= size ; i += 16) {
+      auto ptr = reinterpret_cast<uint8_t *>(data + i);
+      auto v = vld1q_u8(ptr);
+      auto in_range = vandq_u8(vcgeq_u8(v, low), vcleq_u8(v, high));
+      vst1q_u8(ptr, veorq_u8(v, vandq_u8(in_range, bit)));
+    }
+  }
+#endif
+
+  for ( ; i < size ; ++i) {
+    if (data[i] >= LOW && data[i] <= HIGH) {
+      data[i] ^= 0x20;
+    }
+  }
+}
+
+
+inline bool
+iequal_ascii(char const * first, char const * second, size_t size)
 {
-  std::string ret;
+  for (size_t i = 0 ; i < size ; ++i) {
+    if (ascii_lower(first[i]) != ascii_lower(second[i])) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  std::string::size_type start = 0;
-  do {
-    auto delim_pos = haystack.find(needle, start);
 
-    // Skip until the end.
-    if (delim_pos == std::string::npos) {
-      ret += haystack.substr(start);
+/**
+ * Find needle in haystack, starting at the given offset. The needle must not
+ * be empty. Candidate positions are those where both the first and the last
+ * character of the needle match; those are found a block at a time, and
+ * only they need a full comparison.
+ */
+size_t
+find_exact(std::string_view haystack, std::string_view needle, size_t start)
+{
+  if (start > haystack.size() || needle.size() > haystack.size() - start) {
+    return std::string_view::npos;
+  }
+
+  auto const data = haystack.data();
+  size_t const last = haystack.size() - needle.size();
+  size_t const tail = needle.size() - 1;
+  char const first_char = needle[0];
+  char const last_char = needle[tail];
+  auto matches_at = [&](size_t pos) -> bool
+  {
+    return !std::memcmp(data + pos + 1, needle.data() + 1, tail);
+  };
+
+  size_t i = start;
+
+#if defined(LIBERATE_SIMD_AVX2)
+  {
+    auto const vfirst = _mm256_set1_epi8(first_char);
+    auto const vlast = _mm256_set1_epi8(last_char);
+    for ( ; i + 32 <= last + 1 ; i += 32) {
+      auto f = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + i));
+      auto l = _mm256_loadu_si256(
+          reinterpret_cast<__m256i const *>(data + i + tail));
+      auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(f, vfirst),
+              _mm256_cmpeq_epi8(l, vlast))));
+      for ( ; mask ; mask &= mask - 1) {
+        auto pos = i + simd::trailing_zeros(mask);
+        if (matches_at(pos)) {
+          return pos;
+        }
+      }
+    }
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_SSE2)
+  {
+    auto const vfirst = _mm_set1_epi8(first_char);
+    auto const vlast = _mm_set1_epi8(last_char);
+    for ( ; i + 16 <= last + 1 ; i += 16) {
+      auto f = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data + i));
+      auto l = _mm_loadu_si128(
+          reinterpret_cast<__m128i const *>(data + i + tail));
+      auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(f, vfirst),
+              _mm_cmpeq_epi8(l, vlast))));
+      for ( ; mask ; mask &= mask - 1) {
+        auto pos = i + simd::trailing_zeros(mask);
+        if (matches_at(pos)) {
+          return pos;
+        }
+      }
+    }
+  }
+#endif
+
+  // The remainder, or everything without SIMD, uses memchr() to skip ahead
+  // to candidates.
+  while (i <= last) {
+    auto found = static_cast<char const *>(
+        std::memchr(data + i, first_char, last - i + 1));
+    if (!found) {
       break;
     }
+    i = found - data;
+    if (data[i + tail] == last_char && matches_at(i)) {
+      return i;
+    }
+    ++i;
+  }
+  return std::string_view::npos;
+}
 
-    // Take everything up until the needle, then add substitute
-    ret += haystack.substr(start, delim_pos - start);
-    ret += substitute;
 
-    // Advance start by length of needle.
-    start = delim_pos + needle.size();
+/**
+ * Call func(position, index) for every non-overlapping match of any of the
+ * needles, from left to right. The next array caches the next match position
+ * of each needle, and must have as many entries as there are replacements.
+ */
+template <typename funcT>
+inline void
+scan_matches(std::string_view haystack,
+    replacement_list::value_type const * replacements, size_t * next,
+    size_t amount, bool first_only, funcT && func)
+{
+  auto const npos = std::string_view::npos;
+  for (size_t k = 0 ; k < amount ; ++k) {
+    next[k] = replacements[k].first.empty()
+      ? npos
+      : find_exact(haystack, replacements[k].first, 0);
+  }
+
+  while (true) {
+    // The leftmost match wins; on ties, the first listed one.
+    size_t best = amount;
+    for (size_t k = 0 ; k < amount ; ++k) {
+      if (next[k] != npos && (best == amount || next[k] < next[best])) {
+        best = k;
+      }
+    }
+    if (best == amount) {
+      return;
+    }
 
-    // If we only wanted the first match, bail out early.
+    auto pos = next[best];
+    func(pos, best);
     if (first_only) {
-      ret += haystack.substr(start);
-      break;
+      return;
+    }
+
+    // Matches overlapping the one just consumed must be searched again.
+    auto resume = pos + replacements[best].first.size();
+    for (size_t k = 0 ; k < amount ; ++k) {
+      if (next[k] != npos && next[k] < resume) {
+        next[k] = find_exact(haystack, replacements[k].first, resume);
+      }
     }
-  } while (start < haystack.length());
+  }
+}
+
+
+std::string
+replace_impl(std::string_view haystack,
+    replacement_list::value_type const * replacements, size_t * next,
+    size_t amount, bool first_only)
+{
+  // First pass: determine the output size.
+  size_t matches = 0;
+  size_t size = haystack.size();
+  scan_matches(haystack, replacements, next, amount, first_only,
+      [&](size_t, size_t index)
+      {
+        ++matches;
+        size = size - replacements[index].first.size()
+          + replacements[index].second.size();
+      });
+  if (!matches) {
+    return std::string{haystack};
+  }
+
+  // Second pass: build the result.
+  std::string ret;
+  ret.reserve(size);
+  size_t copied = 0;
+  scan_matches(haystack, replacements, next, amount, first_only,
+      [&](size_t pos, size_t index)
+      {
+        ret.append(haystack.data() + copied, pos - copied);
+        ret.append(replacements[index].second);
+        copied = pos + replacements[index].first.size();
+      });
+  ret.append(haystack.data() + copied, haystack.size() - copied);
 
   return ret;
 }
 
+} // anonymous namespace
 
-namespace {
 
-//
-// Templates case-insensitive equal
-//
-template <typename T>
-struct case_insensitive_equal
+std::string
+to_lower(std::string_view value)
 {
-  std::locale const & m_loc;
+  std::string ret{value};
+  to_lower_inplace(ret);
+  return ret;
+}
 
-  inline explicit case_insensitive_equal(std::locale const & loc)
-    : m_loc(loc)
-  {
-  }
 
-  inline bool operator()(T const & first, T const & second)
-  {
-    return std::tolower(first, m_loc) == std::tolower(second, m_loc);
-  }
-};
+std::string
+to_upper(std::string_view value)
+{
+  std::string ret{value};
+  to_upper_inplace(ret);
+  return ret;
+}
 
-} // anonymous namespace
+
+void
+to_lower_inplace(char * value, size_t size)
+{
+  flip_case<'A', 'Z'>(value, size);
+}
+
+
+void
+to_upper_inplace(char * value, size_t size)
+{
+  flip_case<'a', 'z'>(value, size);
+}
 
 
 
+std::string
+replace(std::string_view haystack, std::string_view needle,
+    std::string_view substitute, bool first_only /* = false */)
+{
+  replacement_list::value_type const replacement{needle, substitute};
+  size_t next = 0;
+  return replace_impl(haystack, &replacement, &next, 1, first_only);
+}
+
+
+
+std::string
+replace(std::string_view haystack, replacement_list const & replacements)
+{
+  std::vector<size_t> next(replacements.size());
+  return replace_impl(haystack, replacements.data(), next.data(),
+      replacements.size(), false);
+}
+
+
 ssize_t
-ifind(std::string const & haystack, std::string const & needle)
+ifind(std::string_view haystack, std::string_view needle)
 {
-  auto it = std::search(haystack.begin(), haystack.end(),
-      needle.begin(), needle.end(),
-      case_insensitive_equal<std::string::value_type>(std::locale()));
-  if (it == haystack.end()) {
+  if (haystack.empty() || needle.size() > haystack.size()) {
     return -1;
   }
-  return it - haystack.begin();
+  if (needle.empty()) {
+    return 0;
+  }
+
+  // Candidates are filtered by comparing the first needle character in both
+  // cases; only those need a full comparison.
+  auto const data = haystack.data();
+  size_t const last = haystack.size() - needle.size();
+  char const lower = ascii_lower(needle[0]);
+  char const upper = ascii_upper(needle[0]);
+  auto matches_at = [&](size_t pos) -> bool
+  {
+    return iequal_ascii(data + pos + 1, needle.data() + 1, needle.size() - 1);
+  };
+
+  size_t i = 0;
+
+#if defined(LIBERATE_SIMD_AVX2)
+  {
+    auto const vlower = _mm256_set1_epi8(lower);
+    auto const vupper = _mm256_set1_epi8(upper);
+    for ( ; i + 32 <= last + 1 ; i += 32) {
+      auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + i));
+      auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, vlower),
+              _mm256_cmpeq_epi8(v, vupper))));
+      for ( ; mask ; mask &= mask - 1) {
+        auto pos = i + simd::trailing_zeros(mask);
+        if (matches_at(pos)) {
+          return pos;
+        }
+      }
+    }
+  }
+#endif
+
+#if defined(LIBERATE_SIMD_SSE2)
+  {
+    auto const vlower = _mm_set1_epi8(lower);
+    auto const vupper = _mm_set1_epi8(upper);
+    for ( ; i + 16 <= last + 1 ; i += 16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data + i));
+      auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, vlower),
+              _mm_cmpeq_epi8(v, vupper))));
+      for ( ; mask ; mask &= mask - 1) {
+        auto pos = i + simd::trailing_zeros(mask);
+        if (matches_at(pos)) {
+          return pos;
+        }
+      }
+    }
+  }
+#elif defined(LIBERATE_SIMD_NEON)
+  {
+    auto const vlower = vdupq_n_u8(static_cast<uint8_t>(lower));
+    auto const vupper = vdupq_n_u8(static_cast<uint8_t>(upper));
+    for ( ; i + 16 <= last + 1 ; i += 16) {
+      auto v = vld1q_u8(reinterpret_cast<uint8_t const *>(data + i));
+      auto eq = vorrq_u8(vceqq_u8(v, vlower), vceqq_u8(v, vupper));
+      if (!vmaxvq_u8(eq)) {
+        continue;
+      }
+      for (size_t pos = i ; pos < i + 16 ; ++pos) {
+        if ((data[pos] == lower || data[pos] == upper) && matches_at(pos)) {
+          return pos;
+        }
+      }
+    }
+  }
+#endif
+
+  for ( ; i <= last ; ++i) {
+    if ((data[i] == lower || data[i] == upper) && matches_at(i)) {
+      return i;
+    }
+  }
+  return -1;
 }
 
 
@@ -21,8 +21,11 @@
 
 #include <liberate/sys/error.h>
 
-#include <sstream>
-#include <ios>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
 
 #if defined(LIBERATE_POSIX)
 #  include <string.h>
@@ -35,21 +38,22 @@ namespace liberate::sys {
 
 namespace {
 
-#if defined(LIBERATE_POSIX)
-
 static constexpr char const * const FALLBACK_ERROR = "Error copying error message.";
 
+#if defined(LIBERATE_POSIX)
+
 std::string
-strerror_helper(int code)
+system_message(int code)
 {
-  static char buf[1024] = { 0 };
 #if defined(LIBERATE_HAVE_STRERROR_S)
+  char buf[1024] = { 0 };
   auto e = ::strerror_s(buf, sizeof(buf), code);
   if (e) {
     return FALLBACK_ERROR;
   }
   return buf;
 #elif defined(LIBERATE_HAVE_STRERROR_R)
+  char buf[1024] = { 0 };
 #  if (_POSIX_C_SOURCE >= 200112L) && !  _GNU_SOURCE
   // XSI compliant
   int e = ::strerror_r(code, buf, sizeof(buf));
@@ -71,7 +75,88 @@ strerror_helper(int code)
 #endif
 }
 
+#else // LIBERATE_POSIX
+
+std::string
+system_message(int code)
+{
+  TCHAR * errmsg = NULL;
+  FormatMessageW(
+      FORMAT_MESSAGE_ALLOCATE_BUFFER|FORMAT_MESSAGE_FROM_SYSTEM|FORMAT_MESSAGE_IGNORE_INSERTS,
+      NULL, code,
+      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+      (LPWSTR) &errmsg, 0, NULL);
+  if (!errmsg) {
+    return FALLBACK_ERROR;
+  }
+
+  auto ret = ::liberate::string::to_utf8(errmsg);
+  LocalFree(errmsg);
+  return ret;
+}
+
+#endif // LIBERATE_POSIX
+
+
+/**
+ * Cache of error messages. The common codes - errno values, and WSA codes on
+ * Windows - each have a slot that is filled on first use and never changes
+ * afterwards, so that lookups are a single atomic load. Any other codes are
+ * kept in a map under a mutex.
+ */
+constexpr int DIRECT_SIZE = 256;
+#if defined(LIBERATE_WIN32)
+constexpr int WSA_BASE = WSABASEERR;
+constexpr int WSA_SIZE = 1200;
+#else
+constexpr int WSA_SIZE = 0;
+#endif
+
+struct message_cache
+{
+  std::atomic<std::string const *>      slots[DIRECT_SIZE + WSA_SIZE] = {};
+
+  std::mutex                            mutex = {};
+  std::unordered_map<int, std::string>  others = {};
+
+  inline std::atomic<std::string const *> *
+  slot(int code)
+  {
+    if (code >= 0 && code < DIRECT_SIZE) {
+      return &slots[code];
+    }
+#if defined(LIBERATE_WIN32)
+    if (code >= WSA_BASE && code < WSA_BASE + WSA_SIZE) {
+      return &slots[DIRECT_SIZE + code - WSA_BASE];
+    }
 #endif
+    return nullptr;
+  }
+};
+
+
+message_cache &
+cache()
+{
+  // Never destroyed, so that messages can be looked up during static
+  // destruction, e.g. when loggers are flushed at exit.
+  static message_cache * instance = new message_cache{};
+  return *instance;
+}
+
+
+/**
+ * The "[0x16 (22)] " prefix of formatted messages.
+ */
+constexpr std::size_t PREFIX_SIZE = 32;
+
+inline std::size_t
+format_prefix(char (&buf)[PREFIX_SIZE], int code)
+{
+  auto len = std::snprintf(buf, PREFIX_SIZE, "[0x%x (%d)] ",
+      static_cast<unsigned>(code), code);
+  return (len < 0) ? 0 : static_cast<std::size_t>(len);
+}
 
 } // anonymous namespace
 
@@ -88,29 +173,84 @@ int error_code()
 
 
 
+std::string_view
+error_string(int code)
+{
+  auto & messages = cache();
+
+  auto slot = messages.slot(code);
+  if (slot) {
+    auto msg = slot->load(std::memory_order_acquire);
+    if (msg) {
+      return *msg;
+    }
+
+    // Another thread may be looking up the same message; whichever is first
+    // to store it wins.
+    auto created = new std::string{system_message(code)};
+    if (slot->compare_exchange_strong(msg, created,
+          std::memory_order_acq_rel, std::memory_order_acquire)) {
+      return *created;
+    }
+    delete created;
+    return *msg;
+  }
+
+  std::lock_guard<std::mutex> lock{messages.mutex};
+  auto iter = messages.others.find(code);
+  if (iter == messages.others.end()) {
+    iter = messages.others.emplace(code, system_message(code)).first;
+  }
+  return iter->second;
+}
+
+
+
+std::size_t
+format_error(char * buf, std::size_t bufsize, int code)
+{
+  if (!buf || !bufsize) {
+    return 0;
+  }
+
+  auto msg = error_string(code);
+  auto len = std::snprintf(buf, bufsize, "[0x%x (%d)] %.*s",
+      static_cast<unsigned>(code), code, static_cast<int>(msg.size()),
+      msg.data());
+  if (len < 0) {
+    buf[0] = '\0';
+    return 0;
+  }
+  return std::min(static_cast<std::size_t>(len), bufsize - 1);
+}
+
+
+
 std::string
 error_message(int code)
 {
-#if defined(LIBERATE_POSIX)
-  std::stringstream msg;
-  msg << "[0x" << std::hex << code << std::dec << " (" << code << ")] "
-    << strerror_helper(code);
-  return msg.str();
-#else
-  TCHAR * errmsg = NULL;
-  FormatMessageW(
-      FORMAT_MESSAGE_ALLOCATE_BUFFER|FORMAT_MESSAGE_FROM_SYSTEM|FORMAT_MESSAGE_IGNORE_INSERTS,
-      NULL, code,
-      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-      (LPWSTR) &errmsg, 0, NULL);
+  char prefix[PREFIX_SIZE];
+  auto len = format_prefix(prefix, code);
+  auto msg = error_string(code);
 
-  std::stringstream msg;
-  msg << "[0x" << std::hex << code << std::dec << " (" << code << ")] "
-      << ::liberate::string::to_utf8(errmsg);
+  std::string ret;
+  ret.reserve(len + msg.size());
+  ret.append(prefix, len);
+  ret.append(msg);
+  return ret;
+}
 
-  LocalFree(errmsg);
-  return msg.str();
-#endif
+
+
+std::ostream &
+operator<<(std::ostream & os, error_info const & info)
+{
+  char prefix[PREFIX_SIZE];
+  auto len = format_prefix(prefix, info.code);
+  auto msg = error_string(info.code);
+
+  os.write(prefix, static_cast<std::streamsize>(len));
+  return os.write(msg.data(), static_cast<std::streamsize>(msg.size()));
 }
 
 
@@ -19,6 +19,7 @@
  **/
 #include <liberate/fs/tmp.h>
 
+#include <cstring>
 #include <fstream>
 
 #include <gtest/gtest.h>
@@ -35,6 +36,17 @@ TEST(FsTmp, has_value)
 
 
 
+TEST(FsTmp, no_embedded_nul)
+{
+  auto tmp = liberate::fs::temp_name();
+  ASSERT_EQ(tmp.size(), std::strlen(tmp.c_str()));
+
+  tmp = liberate::fs::temp_name("foo");
+  ASSERT_EQ(tmp.size(), std::strlen(tmp.c_str()));
+}
+
+
+
 TEST(FsTmp, contains_prefix)
 {
   auto tmp = liberate::fs::temp_name("foo");
@@ -0,0 +1,296 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging/async.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace logging = liberate::logging;
+
+namespace {
+
+/**
+ * Collects the lines written by a logger.
+ */
+struct collector
+{
+  std::mutex                mutex;
+  std::vector<std::string>  lines;
+
+  std::function<void (logging::level, std::string_view)>
+  sink()
+  {
+    return [this](logging::level, std::string_view line)
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      lines.emplace_back(line);
+    };
+  }
+
+  std::vector<std::string>
+  get()
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    return lines;
+  }
+};
+
+
+struct formatted_later
+{
+  int value;
+};
+
+std::ostream &
+operator<<(std::ostream & os, formatted_later const & val)
+{
+  return os << "<" << val.value << ">";
+}
+
+
+// Logs while being formatted.
+struct logs_itself
+{
+  logging::async_logger & logger;
+};
+
+std::ostream &
+operator<<(std::ostream & os, logs_itself const & val)
+{
+  logging::record_stream nested{val.logger, logging::level::debug, "nested",
+    1};
+  nested << "nested message";
+  return os << "outer";
+}
+
+
+logging::async_options
+options_for(collector & coll, logging::overflow_policy overflow,
+    std::size_t buffer_size = 64 * 1024,
+    std::chrono::milliseconds interval = std::chrono::milliseconds{1})
+{
+  logging::async_options opts;
+  opts.sink = coll.sink();
+  opts.overflow = overflow;
+  opts.buffer_size = buffer_size;
+  opts.interval = interval;
+  return opts;
+}
+
+} // anonymous namespace
+
+
+TEST(LoggingAsync, format)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::block)};
+
+  {
+    std::string str{"string"};
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 42};
+    rec << "Values: " << -42 << " " << 1.5 << ' ' << true << " " << str
+      << " " << formatted_later{3} << " " << std::hex << 255u;
+  }
+  logger.flush();
+
+  auto lines = coll.get();
+  ASSERT_EQ(1, lines.size());
+  ASSERT_EQ("[file.cpp:42] INFO: Values: -42 1.5 1 string <3> ff", lines[0]);
+}
+
+
+TEST(LoggingAsync, formatting_state_is_reset)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::block)};
+
+  {
+    logging::record_stream rec{logger, logging::level::warn, "file.cpp", 1};
+    rec << std::hex << 255;
+  }
+  {
+    logging::record_stream rec{logger, logging::level::error, "file.cpp", 2};
+    rec << 255;
+  }
+  logger.flush();
+
+  auto lines = coll.get();
+  ASSERT_EQ(2, lines.size());
+  ASSERT_EQ("[file.cpp:1] WARN: ff", lines[0]);
+  ASSERT_EQ("[file.cpp:2] ERROR: 255", lines[1]);
+}
+
+
+TEST(LoggingAsync, nested)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::block)};
+
+  {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "before " << logs_itself{logger} << " after";
+  }
+  logger.flush();
+
+  auto lines = coll.get();
+  ASSERT_EQ(2, lines.size());
+  ASSERT_EQ("[nested:1] DEBUG: nested message", lines[0]);
+  ASSERT_EQ("[file.cpp:1] INFO: before outer after", lines[1]);
+}
+
+
+TEST(LoggingAsync, threads)
+{
+  constexpr int THREADS = 4;
+  constexpr int MESSAGES = 2000;
+
+  collector coll;
+  {
+    logging::async_logger logger{options_for(coll,
+        logging::overflow_policy::block, 1024)};
+
+    std::vector<std::thread> threads;
+    for (int t = 0 ; t < THREADS ; ++t) {
+      threads.emplace_back([&logger, t]()
+      {
+        for (int i = 0 ; i < MESSAGES ; ++i) {
+          logging::record_stream rec{logger, logging::level::info, "thread",
+            static_cast<unsigned>(t)};
+          rec << i;
+        }
+      });
+    }
+    for (auto & thread : threads) {
+      thread.join();
+    }
+    ASSERT_EQ(0, logger.dropped());
+  }
+
+  // Each thread's messages must be complete and in order.
+  auto lines = coll.get();
+  ASSERT_EQ(THREADS * MESSAGES, lines.size());
+  std::vector<int> next(THREADS, 0);
+  for (auto & line : lines) {
+    auto t = std::stoi(line.substr(8, 1));
+    auto i = std::stoi(line.substr(line.rfind(' ') + 1));
+    ASSERT_EQ(next[t], i);
+    ++next[t];
+  }
+}
+
+
+TEST(LoggingAsync, overflow_count)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::count, 256, std::chrono::hours{1})};
+
+  for (int i = 0 ; i < 100 ; ++i) {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "message " << i;
+  }
+  auto dropped = logger.dropped();
+  ASSERT_GT(dropped, 0);
+  logger.flush();
+
+  auto lines = coll.get();
+  ASSERT_EQ(100, lines.size() - 1 + dropped);
+  ASSERT_EQ("[liberate] " + std::to_string(dropped)
+      + " log messages dropped due to a full buffer.", lines.back());
+}
+
+
+TEST(LoggingAsync, overflow_drop)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::drop, 256, std::chrono::hours{1})};
+
+  for (int i = 0 ; i < 100 ; ++i) {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "message " << i;
+  }
+  auto dropped = logger.dropped();
+  ASSERT_GT(dropped, 0);
+  logger.flush();
+
+  ASSERT_EQ(100, coll.get().size() + dropped);
+}
+
+
+TEST(LoggingAsync, overflow_block)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::block, 256, std::chrono::hours{1})};
+
+  for (int i = 0 ; i < 100 ; ++i) {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "message " << i;
+  }
+  logger.flush();
+
+  ASSERT_EQ(0, logger.dropped());
+  ASSERT_EQ(100, coll.get().size());
+}
+
+
+TEST(LoggingAsync, fatal_flushes)
+{
+  collector coll;
+  logging::async_logger logger{options_for(coll,
+      logging::overflow_policy::drop, 64 * 1024, std::chrono::hours{1})};
+
+  {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "info";
+  }
+  {
+    logging::record_stream rec{logger, logging::level::fatal, "file.cpp", 2};
+    rec << "fatal";
+  }
+
+  // No flush() necessary
+  auto lines = coll.get();
+  ASSERT_EQ(2, lines.size());
+  ASSERT_EQ("[file.cpp:2] FATAL: fatal", lines[1]);
+}
+
+
+TEST(LoggingAsync, destructor_flushes)
+{
+  collector coll;
+  {
+    logging::async_logger logger{options_for(coll,
+        logging::overflow_policy::drop, 64 * 1024, std::chrono::hours{1})};
+
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << "info";
+  }
+  ASSERT_EQ(1, coll.get().size());
+}
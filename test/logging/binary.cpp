@@ -0,0 +1,332 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging/binary.h>
+#include <liberate/fs/tmp.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(LIBERATE_WIN32)
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+namespace logging = liberate::logging;
+
+namespace {
+
+struct formatted_later
+{
+  int value;
+};
+
+std::ostream &
+operator<<(std::ostream & os, formatted_later const & val)
+{
+  return os << "<" << val.value << ">";
+}
+
+
+std::string
+temp_dir()
+{
+  auto name = liberate::fs::temp_name();
+  return name.substr(0, name.find_last_of("/\\") + 1);
+}
+
+
+std::string
+process_id()
+{
+#if defined(LIBERATE_WIN32)
+  return std::to_string(GetCurrentProcessId());
+#else
+  return std::to_string(getpid());
+#endif
+}
+
+
+/**
+ * Creates a logger with temporary files, and removes them afterwards.
+ */
+struct temp_log
+{
+  std::string path = liberate::fs::temp_name("liberate-binary-log");
+
+  ~temp_log()
+  {
+    std::remove(path.c_str());
+    std::remove((path + ".dict").c_str());
+  }
+
+  logging::binary_options
+  options(std::size_t size = 64 * 1024)
+  {
+    logging::binary_options opts;
+    opts.path = path;
+    opts.size = size;
+    return opts;
+  }
+
+  std::vector<std::string>
+  decode()
+  {
+    std::stringstream sstream;
+    logging::decode_binary_log(sstream, path, false);
+
+    std::vector<std::string> ret;
+    std::string line;
+    while (std::getline(sstream, line)) {
+      ret.push_back(line);
+    }
+    return ret;
+  }
+
+  std::size_t
+  file_size(std::string const & name)
+  {
+    auto file = std::fopen(name.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    auto ret = static_cast<std::size_t>(std::ftell(file));
+    std::fclose(file);
+    return ret;
+  }
+};
+
+
+void
+log_value(logging::binary_logger & logger, int value)
+{
+  logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+  rec << "Value: " << value;
+}
+
+} // anonymous namespace
+
+
+TEST(LoggingBinary, round_trip)
+{
+  temp_log tmp;
+  {
+    logging::binary_logger logger{tmp.options()};
+
+    std::string str{"string"};
+    char buffer[] = "buffer";
+    int64_t negative = -123456789;
+    {
+      logging::record_stream rec{logger, logging::level::info, "file.cpp",
+        42};
+      rec << "Values: " << -42 << " " << 1.5 << ' ' << true << " " << str
+        << " " << buffer << " " << formatted_later{3} << " " << std::hex
+        << 255u << " " << std::dec << negative << " "
+        << uint64_t{0xffffffffffffffffULL};
+    }
+    {
+      logging::record_stream rec{logger, logging::level::error, "other.cpp",
+        1};
+      rec << std::boolalpha << false << std::endl << "next line";
+    }
+  }
+
+  auto lines = tmp.decode();
+  ASSERT_EQ(3, lines.size());
+  ASSERT_EQ("[file.cpp:42] INFO: Values: -42 1.5 1 string buffer <3> ff "
+      "-123456789 18446744073709551615", lines[0]);
+  ASSERT_EQ("[other.cpp:1] ERROR: false", lines[1]);
+  ASSERT_EQ("next line", lines[2]);
+}
+
+
+TEST(LoggingBinary, static_text_registered_once)
+{
+  temp_log tmp;
+  logging::binary_logger logger{tmp.options()};
+
+  log_value(logger, 0);
+  auto dict_size = tmp.file_size(tmp.path + ".dict");
+
+  for (int i = 1 ; i < 100 ; ++i) {
+    log_value(logger, i);
+  }
+  logger.flush();
+  ASSERT_EQ(dict_size, tmp.file_size(tmp.path + ".dict"));
+
+  auto lines = tmp.decode();
+  ASSERT_EQ(100, lines.size());
+  for (int i = 0 ; i < 100 ; ++i) {
+    ASSERT_EQ("[file.cpp:1] INFO: Value: " + std::to_string(i), lines[i]);
+  }
+}
+
+
+TEST(LoggingBinary, changing_char_array)
+{
+  temp_log tmp;
+  logging::binary_logger logger{tmp.options()};
+
+  // Constant character arrays that are not literals may change between
+  // executions of a statement.
+  char buffer[16] = {};
+  char const (&text)[16] = buffer;
+  char const * values[] = { "first", "second", "first" };
+  for (auto value : values) {
+    std::strcpy(buffer, value);
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << text << ": " << 42;
+  }
+
+  auto lines = tmp.decode();
+  ASSERT_EQ(3, lines.size());
+  ASSERT_EQ("[file.cpp:1] INFO: first: 42", lines[0]);
+  ASSERT_EQ("[file.cpp:1] INFO: second: 42", lines[1]);
+  ASSERT_EQ("[file.cpp:1] INFO: first: 42", lines[2]);
+}
+
+
+TEST(LoggingBinary, changing_format)
+{
+  temp_log tmp;
+  logging::binary_logger logger{tmp.options()};
+
+  // The same statement with different arguments is written as text.
+  for (int i = 0 ; i < 3 ; ++i) {
+    logging::record_stream rec{logger, logging::level::warn, "file.cpp", 1};
+    if (i == 1) {
+      rec << "String " << std::string{"one"};
+    }
+    else {
+      rec << "Number " << i;
+    }
+  }
+
+  // Unknown manipulators are applied before writing text.
+  {
+    logging::record_stream rec{logger, logging::level::warn, "file.cpp", 2};
+    rec << std::setw(4) << 42;
+  }
+  {
+    logging::record_stream rec{logger, logging::level::warn, "file.cpp", 3};
+    rec << "a" << std::ends << "b";
+  }
+  logger.flush();
+
+  auto lines = tmp.decode();
+  ASSERT_EQ(5, lines.size());
+  ASSERT_EQ("[file.cpp:1] WARN: Number 0", lines[0]);
+  ASSERT_EQ("[file.cpp:1] WARN: String one", lines[1]);
+  ASSERT_EQ("[file.cpp:1] WARN: Number 2", lines[2]);
+  ASSERT_EQ("[file.cpp:2] WARN: 42", lines[3]);
+  ASSERT_EQ(std::string("[file.cpp:3] WARN: a\0b", 22), lines[4]);
+}
+
+
+TEST(LoggingBinary, ring_wraps_around)
+{
+  temp_log tmp;
+  logging::binary_logger logger{tmp.options(64)};
+
+  for (int i = 0 ; i < 1000 ; ++i) {
+    log_value(logger, i);
+  }
+  logger.flush();
+
+  // Only the most recent messages remain, in order.
+  auto lines = tmp.decode();
+  ASSERT_GT(lines.size(), 5);
+  ASSERT_LT(lines.size(), 64);
+  auto first = 1000 - static_cast<int>(lines.size());
+  for (std::size_t i = 0 ; i < lines.size() ; ++i) {
+    ASSERT_EQ("[file.cpp:1] INFO: Value: " + std::to_string(first + i),
+        lines[i]);
+  }
+}
+
+
+TEST(LoggingBinary, too_large)
+{
+  temp_log tmp;
+  logging::binary_logger logger{tmp.options(64)};
+
+  {
+    logging::record_stream rec{logger, logging::level::info, "file.cpp", 1};
+    rec << std::string(100, 'x');
+  }
+  ASSERT_EQ(1, logger.dropped());
+  ASSERT_EQ(0, tmp.decode().size());
+}
+
+
+TEST(LoggingBinary, timestamps)
+{
+  temp_log tmp;
+  {
+    logging::binary_logger logger{tmp.options()};
+    log_value(logger, 1);
+  }
+
+  std::stringstream sstream;
+  ASSERT_EQ(1, logging::decode_binary_log(sstream, tmp.path));
+  auto line = sstream.str();
+  // YYYY-MM-DDTHH:MM:SS.uuuuuuZ
+  ASSERT_EQ('T', line[10]);
+  ASSERT_EQ('.', line[19]);
+  ASSERT_EQ("Z [file.cpp:1] INFO: Value: 1\n", line.substr(26));
+}
+
+
+TEST(LoggingBinary, bad_files)
+{
+  std::stringstream sstream;
+  ASSERT_THROW(logging::decode_binary_log(sstream, "/does/not/exist"),
+      std::runtime_error);
+
+  logging::binary_options opts;
+  opts.path = "/does/not/exist";
+  ASSERT_THROW(logging::binary_logger{opts}, std::runtime_error);
+}
+
+
+TEST(LoggingBinary, default_path)
+{
+  std::string first_path;
+  std::string second_path;
+  {
+    logging::binary_logger first{logging::binary_options{"", 1024}};
+    logging::binary_logger second{logging::binary_options{"", 1024}};
+    first_path = first.path();
+    second_path = second.path();
+  }
+  std::remove(first_path.c_str());
+  std::remove((first_path + ".dict").c_str());
+  std::remove(second_path.c_str());
+  std::remove((second_path + ".dict").c_str());
+
+  // Loggers in one process get separate files in the temporary directory.
+  ASSERT_NE(first_path, second_path);
+  ASSERT_EQ(0, first_path.find(temp_dir()));
+  ASSERT_NE(std::string::npos, first_path.find("liberate-" + process_id()));
+  ASSERT_EQ(".blog", first_path.substr(first_path.size() - 5));
+}
@@ -0,0 +1,112 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging.h>
+
+#include <gtest/gtest.h>
+
+namespace logging = liberate::logging;
+
+namespace {
+
+struct counts_formatting
+{
+  int & count;
+};
+
+std::ostream &
+operator<<(std::ostream & os, counts_formatting const & val)
+{
+  ++val.count;
+  return os << "counted";
+}
+
+
+/**
+ * Restores the runtime level after each test.
+ */
+class LoggingLevel : public ::testing::Test
+{
+protected:
+  void TearDown() override
+  {
+    logging::set_level(logging::level::trace);
+  }
+};
+
+} // anonymous namespace
+
+
+TEST_F(LoggingLevel, level_names)
+{
+  ASSERT_STREQ("TRACE", logging::level_name(logging::level::trace));
+  ASSERT_STREQ("WARN", logging::level_name(logging::level::warn));
+  ASSERT_STREQ("FATAL", logging::level_name(logging::level::fatal));
+}
+
+
+TEST_F(LoggingLevel, backend_levels)
+{
+  ASSERT_EQ(logging::level::trace, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_TRACE));
+  ASSERT_EQ(logging::level::debug, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_DEBUG));
+  ASSERT_EQ(logging::level::info, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_INFO));
+  ASSERT_EQ(logging::level::warn, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_WARN));
+  ASSERT_EQ(logging::level::error, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_ERROR));
+  ASSERT_EQ(logging::level::fatal, LIBLOG_LEVEL_OF(LIBLOG_LEVEL_FATAL));
+}
+
+
+TEST_F(LoggingLevel, runtime_level)
+{
+  ASSERT_EQ(logging::level::trace, logging::get_level());
+
+  logging::set_level(logging::level::warn);
+  ASSERT_EQ(logging::level::warn, logging::get_level());
+
+  ASSERT_FALSE(logging::is_enabled(logging::level::trace));
+  ASSERT_FALSE(logging::is_enabled(logging::level::info));
+  ASSERT_TRUE(logging::is_enabled(logging::level::warn));
+  ASSERT_TRUE(logging::is_enabled(logging::level::fatal));
+}
+
+
+TEST_F(LoggingLevel, compile_time_level)
+{
+  ASSERT_TRUE(logging::is_compiled_in(logging::level::fatal));
+  ASSERT_EQ(LIBERATE_LOG_MIN_LEVEL <= LIBLOG_LEVEL_NUM_TRACE,
+      logging::is_compiled_in(logging::level::trace));
+  ASSERT_EQ(LIBERATE_LOG_MIN_LEVEL <= LIBLOG_LEVEL_NUM_INFO,
+      logging::is_enabled(logging::level::info));
+}
+
+
+TEST_F(LoggingLevel, disabled_statements_skip_formatting)
+{
+  logging::set_level(logging::level::fatal);
+
+  int count = 0;
+  LIBLOG(LIBLOG_LEVEL_TRACE, "Not formatted: " << counts_formatting{count});
+  LIBLOG_DEBUG("Not formatted: " << counts_formatting{count});
+  LIBLOG_INFO("Not formatted: " << counts_formatting{count});
+  LIBLOG_WARN("Not formatted: " << counts_formatting{count});
+  LIBLOG_ERROR("Not formatted: " << counts_formatting{count});
+  LIBLOG_ERR(EINVAL, "Not formatted: " << counts_formatting{count});
+  ASSERT_EQ(0, count);
+}
@@ -0,0 +1,223 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace logging = liberate::logging;
+
+namespace {
+
+constexpr uint64_t SECOND = 1'000'000'000;
+
+struct counts_formatting
+{
+  int & count;
+};
+
+std::ostream &
+operator<<(std::ostream & os, counts_formatting const & val)
+{
+  ++val.count;
+  return os << "counted";
+}
+
+// The stderr backend only writes messages in debug builds.
+#if LIBERATE_LOG_BACKEND != LIBERATE_LOG_BACKEND_STDERR \
+  || (defined(DEBUG) && !defined(NDEBUG))
+constexpr bool FORMATS_MESSAGES = true;
+#else
+constexpr bool FORMATS_MESSAGES = false;
+#endif
+
+} // anonymous namespace
+
+
+TEST(LoggingRateLimit, every_n)
+{
+  logging::every_n sampler;
+  std::vector<int> logged;
+  for (int i = 0 ; i < 10 ; ++i) {
+    if (sampler.should_log(4)) {
+      logged.push_back(i);
+    }
+  }
+  ASSERT_EQ((std::vector<int>{0, 4, 8}), logged);
+}
+
+
+TEST(LoggingRateLimit, first_n)
+{
+  logging::first_n sampler;
+  int logged = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    if (sampler.should_log(3)) {
+      ++logged;
+    }
+  }
+  ASSERT_EQ(3, logged);
+}
+
+
+TEST(LoggingRateLimit, first_n_threads)
+{
+  logging::first_n sampler;
+  std::atomic<int> logged = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0 ; t < 4 ; ++t) {
+    threads.emplace_back([&sampler, &logged]()
+    {
+      for (int i = 0 ; i < 1000 ; ++i) {
+        if (sampler.should_log(100)) {
+          ++logged;
+        }
+      }
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(100, logged);
+}
+
+
+TEST(LoggingRateLimit, token_bucket_burst)
+{
+  logging::token_bucket bucket;
+  uint64_t now = 42 * SECOND;
+
+  // A full bucket permits a burst, then nothing until it refills.
+  for (int i = 0 ; i < 5 ; ++i) {
+    ASSERT_TRUE(bucket.should_log(10, 5, now));
+  }
+  ASSERT_FALSE(bucket.should_log(10, 5, now));
+
+  // At ten per second, one token is back after 100ms.
+  ASSERT_FALSE(bucket.should_log(10, 5, now + SECOND / 20));
+  ASSERT_TRUE(bucket.should_log(10, 5, now + SECOND / 10));
+  ASSERT_FALSE(bucket.should_log(10, 5, now + SECOND / 10));
+
+  // After a long pause, the bucket is full again, but not fuller.
+  now += 100 * SECOND;
+  for (int i = 0 ; i < 5 ; ++i) {
+    ASSERT_TRUE(bucket.should_log(10, 5, now));
+  }
+  ASSERT_FALSE(bucket.should_log(10, 5, now));
+}
+
+
+TEST(LoggingRateLimit, token_bucket_rate)
+{
+  logging::token_bucket bucket;
+  int permitted = 0;
+
+  // Over ten seconds at two per second, with a burst of one.
+  for (uint64_t now = 0 ; now < 10 * SECOND ; now += SECOND / 100) {
+    if (bucket.should_log(2, 1, now)) {
+      ++permitted;
+    }
+  }
+  ASSERT_EQ(20, permitted);
+}
+
+
+TEST(LoggingRateLimit, token_bucket_disabled)
+{
+  logging::token_bucket bucket;
+  ASSERT_FALSE(bucket.should_log(0, 10, 0));
+}
+
+
+TEST(LoggingRateLimit, suppression_counter)
+{
+  logging::suppression_counter counter;
+  ASSERT_EQ(0, counter.take());
+
+  counter.add();
+  counter.add();
+  ASSERT_EQ(2, counter.take());
+  ASSERT_EQ(0, counter.take());
+}
+
+
+TEST(LoggingRateLimit, suppressed_output)
+{
+  std::stringstream s1;
+  s1 << "message" << logging::suppressed{0};
+  ASSERT_EQ("message", s1.str());
+
+  std::stringstream s2;
+  s2 << "message" << logging::suppressed{3};
+  ASSERT_EQ("message [suppressed 3 messages]", s2.str());
+}
+
+
+TEST(LoggingRateLimit, macros)
+{
+  if (!FORMATS_MESSAGES) {
+    GTEST_SKIP();
+  }
+
+  int count = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    LIBLOG_EVERY_N(LIBLOG_LEVEL_INFO, 5, "Every 5th: " << counts_formatting{count});
+  }
+  ASSERT_EQ(2, count);
+
+  count = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    LIBLOG_FIRST_N(LIBLOG_LEVEL_INFO, 3, "First 3: " << counts_formatting{count});
+  }
+  ASSERT_EQ(3, count);
+
+  count = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    LIBLOG_RATE_LIMITED(LIBLOG_LEVEL_INFO, 0.001, 2,
+        "Rate limited: " << counts_formatting{count});
+  }
+  ASSERT_EQ(2, count);
+
+  count = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    errno = EINVAL;
+    LIBLOG_ERRNO_RATE_LIMITED(0.001, 1,
+        "Rate limited: " << counts_formatting{count});
+  }
+  ASSERT_EQ(1, count);
+}
+
+
+TEST(LoggingRateLimit, macros_below_level)
+{
+  logging::set_level(logging::level::warn);
+
+  int count = 0;
+  for (int i = 0 ; i < 10 ; ++i) {
+    LIBLOG_FIRST_N(LIBLOG_LEVEL_INFO, 3, "Not logged: " << counts_formatting{count});
+  }
+  logging::set_level(logging::level::trace);
+  ASSERT_EQ(0, count);
+}
@@ -0,0 +1,232 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#include <liberate/net/async_resolver.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+namespace net = liberate::net;
+
+namespace {
+
+using result_type = net::async_resolver::result_type;
+
+/**
+ * Lookups block until released, so that tests control the timing.
+ */
+struct gate
+{
+  std::mutex              mutex;
+  std::condition_variable condition;
+  bool                    open = false;
+  int                     waiting = 0;
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    ++waiting;
+    condition.notify_all();
+    condition.wait(lock, [this]() { return open; });
+  }
+
+  // Wait until the given number of lookups are blocked, or a second passed.
+  bool wait_for_waiting(int amount)
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    return condition.wait_for(lock, std::chrono::seconds{1},
+        [this, amount]() { return waiting >= amount; });
+  }
+
+  void release()
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    open = true;
+    condition.notify_all();
+  }
+};
+
+
+result_type
+fake_lookup(net::address_type type, std::string const & hostname)
+{
+  if (hostname == "error.test") {
+    throw std::runtime_error("lookup failed");
+  }
+  if (hostname == "v6error.test" && type == net::AT_INET6) {
+    throw std::runtime_error("lookup failed");
+  }
+  if (type == net::AT_INET4) {
+    return { net::socket_address{"10.0.0.1"} };
+  }
+  return { net::socket_address{"2001:db8::1"} };
+}
+
+} // anonymous namespace
+
+
+TEST(AsyncResolver, future)
+{
+  net::async_resolver resolver{&fake_lookup};
+
+  auto v4 = resolver.resolve(net::AT_INET4, "host.test");
+  auto v6 = resolver.resolve(net::AT_INET6, "host.test");
+  auto both = resolver.resolve(net::AT_UNSPEC, "host.test");
+
+  auto result = v4.get();
+  ASSERT_EQ(1, result.size());
+  ASSERT_EQ(net::socket_address{"10.0.0.1"}, *result.begin());
+
+  result = v6.get();
+  ASSERT_EQ(1, result.size());
+  ASSERT_EQ(net::socket_address{"2001:db8::1"}, *result.begin());
+
+  // IPv6 is preferred over IPv4, regardless of which lookup finished first.
+  result = both.get();
+  ASSERT_EQ(2, result.size());
+  ASSERT_EQ(net::socket_address{"2001:db8::1"}, result[0]);
+  ASSERT_EQ(net::socket_address{"10.0.0.1"}, result[1]);
+}
+
+
+TEST(AsyncResolver, callback)
+{
+  net::async_resolver resolver{&fake_lookup};
+
+  std::promise<result_type> done;
+  resolver.resolve(net::AT_UNSPEC, "host.test",
+      [&done](result_type const & results, std::exception_ptr error)
+      {
+        ASSERT_FALSE(error);
+        done.set_value(results);
+      });
+  ASSERT_EQ(2, done.get_future().get().size());
+}
+
+
+TEST(AsyncResolver, errors)
+{
+  net::async_resolver resolver{&fake_lookup};
+
+  // Both lookups fail
+  auto result = resolver.resolve(net::AT_UNSPEC, "error.test");
+  ASSERT_THROW(result.get(), std::runtime_error);
+
+  // Only one fails; the other's results are used.
+  auto partial = resolver.resolve(net::AT_UNSPEC, "v6error.test").get();
+  ASSERT_EQ(1, partial.size());
+  ASSERT_EQ(net::AT_INET4, partial.begin()->type());
+
+  // Invalid arguments are reported immediately.
+  ASSERT_THROW(resolver.resolve(net::AT_UNSPEC, ""), std::invalid_argument);
+  ASSERT_THROW(resolver.resolve(net::AT_LOCAL, "host.test"),
+      std::invalid_argument);
+}
+
+
+TEST(AsyncResolver, parallel_unspec)
+{
+  gate g;
+  net::async_resolver resolver{
+    [&g](net::address_type type, std::string const & hostname)
+    {
+      g.wait();
+      return fake_lookup(type, hostname);
+    }
+  };
+
+  // Both lookups must be in progress at the same time.
+  auto result = resolver.resolve(net::AT_UNSPEC, "host.test");
+  ASSERT_TRUE(g.wait_for_waiting(2));
+  g.release();
+  ASSERT_EQ(2, result.get().size());
+}
+
+
+TEST(AsyncResolver, timeout)
+{
+  gate g;
+  net::async_resolver resolver{
+    [&g](net::address_type type, std::string const & hostname)
+    {
+      g.wait();
+      return fake_lookup(type, hostname);
+    }
+  };
+
+  auto result = resolver.resolve(net::AT_INET4, "host.test",
+      std::chrono::milliseconds{20});
+  try {
+    result.get();
+    FAIL() << "Expected a timeout.";
+  } catch (std::system_error const & ex) {
+    ASSERT_EQ(std::make_error_code(std::errc::timed_out), ex.code());
+  }
+
+  // Requests that finish in time are unaffected.
+  g.release();
+  auto in_time = resolver.resolve(net::AT_INET4, "host.test",
+      std::chrono::seconds{10});
+  ASSERT_EQ(1, in_time.get().size());
+}
+
+
+TEST(AsyncResolver, cancel)
+{
+  gate g;
+  net::async_resolver resolver{
+    [&g](net::address_type type, std::string const & hostname)
+    {
+      g.wait();
+      return fake_lookup(type, hostname);
+    },
+    net::async_resolver_options{1}
+  };
+
+  // With a single worker, the second request stays queued.
+  net::async_resolver::request_id first = 0;
+  net::async_resolver::request_id second = 0;
+  auto first_result = resolver.resolve(net::AT_INET4, "host.test",
+      std::chrono::milliseconds::zero(), &first);
+  auto second_result = resolver.resolve(net::AT_INET4, "host.test",
+      std::chrono::milliseconds::zero(), &second);
+  ASSERT_TRUE(g.wait_for_waiting(1));
+
+  // Cancel both the running and the queued request.
+  ASSERT_TRUE(resolver.cancel(first));
+  ASSERT_TRUE(resolver.cancel(second));
+  ASSERT_FALSE(resolver.cancel(second));
+
+  for (auto * result : { &first_result, &second_result }) {
+    try {
+      result->get();
+      FAIL() << "Expected cancellation.";
+    } catch (std::system_error const & ex) {
+      ASSERT_EQ(std::make_error_code(std::errc::operation_canceled),
+          ex.code());
+    }
+  }
+
+  g.release();
+}
@@ -0,0 +1,173 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/flow_key.h>
+
+#include <stdexcept>
+#include <unordered_set>
+
+#include <gtest/gtest.h>
+
+namespace net = liberate::net;
+
+namespace {
+
+constexpr uint8_t PROTO_TCP = 6;
+
+struct rss_test_data
+{
+  char const *  source;
+  uint16_t      source_port;
+  char const *  dest;
+  uint16_t      dest_port;
+  uint32_t      address_hash;
+  uint32_t      port_hash;
+};
+
+// Verification suite from Microsoft's RSS specification
+rss_test_data const rss_tests[] = {
+  { "66.9.149.187", 2794, "161.142.100.80", 1766,
+    0x323e8fc2, 0x51ccc178 },
+  { "199.92.111.2", 14230, "65.69.140.83", 4739,
+    0xd718262a, 0xc626b0ea },
+  { "24.19.198.95", 12898, "12.22.207.184", 38024,
+    0xd2d0a5de, 0x5c2b394a },
+  { "38.27.205.30", 48228, "209.142.163.6", 2217,
+    0x82989176, 0xafc7327f },
+  { "153.39.163.191", 44251, "202.188.127.2", 1303,
+    0x5d1809c5, 0x10e828a2 },
+  { "3ffe:2501:200:1fff::7", 2794, "3ffe:2501:200:3::1", 1766,
+    0x2cc18cd5, 0x40207d3d },
+  { "3ffe:501:8::260:97ff:fe40:efab", 14230, "ff02::1", 4739,
+    0x0f0c461c, 0xdde51bbf },
+  { "3ffe:1900:4545:3:200:f8ff:fe21:67cf", 44251,
+    "fe80::200:f8ff:fe21:67cf", 38024,
+    0x4b61e985, 0x02d1feef },
+};
+
+} // anonymous namespace
+
+
+TEST(FlowKey, from_socket_addresses)
+{
+  net::flow_key key{PROTO_TCP, net::socket_address{"10.0.0.1", 1234},
+    net::socket_address{"10.0.0.2", 80}};
+  ASSERT_EQ(net::AT_INET4, key.type);
+  ASSERT_TRUE(key.has_ports);
+  ASSERT_EQ(1234, key.source_port);
+  ASSERT_EQ(80, key.dest_port);
+
+  auto reversed = key.reversed();
+  ASSERT_EQ(80, reversed.source_port);
+  ASSERT_EQ(key.source, reversed.dest);
+  ASSERT_NE(key, reversed);
+  ASSERT_EQ(key, reversed.reversed());
+
+  ASSERT_THROW(net::flow_key(PROTO_TCP, net::socket_address{"10.0.0.1"},
+        net::socket_address{"::1"}), std::invalid_argument);
+  ASSERT_THROW(net::flow_key(PROTO_TCP, net::socket_address{"/tmp/sock"},
+        net::socket_address{"/tmp/sock"}), std::invalid_argument);
+}
+
+
+TEST(FlowKey, from_packet_headers)
+{
+  using byte = liberate::types::byte;
+  byte const packet[] = {
+    byte{0x45}, byte{0x00}, byte{0x00}, byte{0x1c},
+    byte{0x00}, byte{0x00}, byte{0x40}, byte{0x00},
+    byte{0x40}, byte{0x11}, byte{0x00}, byte{0x00},
+    byte{0x0a}, byte{0x00}, byte{0x00}, byte{0x01},
+    byte{0x0a}, byte{0x00}, byte{0x00}, byte{0x02},
+    byte{0x04}, byte{0xd2}, byte{0x00}, byte{0x35},
+  };
+  liberate::serialization::const_segment segment{packet, sizeof(packet)};
+
+  net::packet_headers headers;
+  ASSERT_EQ(1, net::parse_headers(headers, &segment, 1));
+
+  net::flow_key key{headers, 0};
+  ASSERT_EQ((net::flow_key{17, net::socket_address{"10.0.0.1", 1234},
+      net::socket_address{"10.0.0.2", 53}}), key);
+}
+
+
+TEST(FlowKey, hash)
+{
+  net::flow_key key{PROTO_TCP, net::socket_address{"2001:db8::1", 1234},
+    net::socket_address{"2001:db8::2", 80}};
+  auto reversed = key.reversed();
+
+  ASSERT_NE(key.hash(), reversed.hash());
+  ASSERT_EQ(net::symmetric_flow_hash(key),
+      net::symmetric_flow_hash(reversed));
+  ASSERT_NE(net::symmetric_flow_hash(key),
+      net::symmetric_flow_hash(key, 42));
+
+  // Keys that differ only in the ports.
+  auto other = key;
+  other.source_port = 1235;
+  ASSERT_NE(net::symmetric_flow_hash(key), net::symmetric_flow_hash(other));
+
+  std::unordered_set<net::flow_key> keys{key, reversed, other};
+  ASSERT_EQ(3, keys.size());
+}
+
+
+TEST(FlowKey, toeplitz_rss_verification)
+{
+  net::toeplitz_hash hash;
+  ASSERT_EQ(36, hash.max_input_size());
+
+  for (auto & test : rss_tests) {
+    net::flow_key key{PROTO_TCP,
+      net::socket_address{test.source, test.source_port},
+      net::socket_address{test.dest, test.dest_port}};
+    ASSERT_EQ(test.port_hash, hash(key)) << test.source;
+
+    key.has_ports = false;
+    ASSERT_EQ(test.address_hash, hash(key)) << test.source;
+  }
+}
+
+
+TEST(FlowKey, toeplitz_symmetric)
+{
+  net::toeplitz_hash hash{net::toeplitz_hash::SYMMETRIC_KEY};
+
+  for (auto & test : rss_tests) {
+    net::flow_key key{PROTO_TCP,
+      net::socket_address{test.source, test.source_port},
+      net::socket_address{test.dest, test.dest_port}};
+    ASSERT_EQ(hash(key), hash(key.reversed())) << test.source;
+  }
+}
+
+
+TEST(FlowKey, toeplitz_bad_arguments)
+{
+  uint8_t const key[] = { 1, 2, 3, 4, 5, 6, 7 };
+  ASSERT_THROW(net::toeplitz_hash(key, sizeof(key)), std::invalid_argument);
+
+  uint8_t const valid_key[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  net::toeplitz_hash hash{valid_key, sizeof(valid_key)};
+  ASSERT_EQ(4, hash.max_input_size());
+  ASSERT_THROW(hash(valid_key, 5), std::invalid_argument);
+}
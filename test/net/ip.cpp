@@ -20,6 +20,8 @@
 
 #include <liberate/net/ip.h>
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "../test_name.h"
@@ -53,6 +55,17 @@ constexpr byte const ipv6_buf[] = {
     byte{0x00}, byte{0x00}, byte{0x00}, byte{0x01}
   };
 
+
+std::vector<byte>
+make_packet(std::initializer_list<uint8_t> values)
+{
+  std::vector<byte> ret;
+  for (auto value : values) {
+    ret.push_back(byte{value});
+  }
+  return ret;
+}
+
 } // anonymous namespace
 
 
@@ -133,3 +146,161 @@ TEST(IP, parse_bad_packet)
       reinterpret_cast<byte const *>("Hello, world!"), 13);
   ASSERT_FALSE(res);
 }
+
+
+
+TEST(IP, parse_headers_batch)
+{
+  std::vector<std::vector<byte>> packets = {
+    // IPv4 UDP, 10.0.0.1:1234 -> 10.0.0.2:53
+    make_packet({
+        0x45, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x40, 0x00,
+        0x40, 0x11, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x01,
+        0x0a, 0x00, 0x00, 0x02,
+        0x04, 0xd2, 0x00, 0x35, 0x00, 0x08, 0x00, 0x00,
+    }),
+    // IPv4 TCP with options, 10.0.0.1:8080 -> 10.0.0.2:80
+    make_packet({
+        0x46, 0x00, 0x00, 0x20, 0x00, 0x00, 0x40, 0x00,
+        0x40, 0x06, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x01,
+        0x0a, 0x00, 0x00, 0x02, 0x01, 0x01, 0x01, 0x00,
+        0x1f, 0x90, 0x00, 0x50,
+    }),
+    // IPv4 UDP, first fragment
+    make_packet({
+        0x45, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x20, 0x00,
+        0x40, 0x11, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x01,
+        0x0a, 0x00, 0x00, 0x02,
+        0x04, 0xd2, 0x00, 0x35, 0x00, 0x08, 0x00, 0x00,
+    }),
+    // IPv4 UDP, later fragment
+    make_packet({
+        0x45, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x10,
+        0x40, 0x11, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x01,
+        0x0a, 0x00, 0x00, 0x02,
+        0x04, 0xd2, 0x00, 0x35, 0x00, 0x08, 0x00, 0x00,
+    }),
+    // IPv6 with hop-by-hop options and fragment headers, UDP,
+    // [2001:db8::1]:1234 -> [2001:db8::2]:53
+    make_packet({
+        0x60, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x40,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+        0x2c, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00,
+        0x11, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x2a,
+        0x04, 0xd2, 0x00, 0x35, 0x00, 0x08, 0x00, 0x00,
+    }),
+    // IPv6 with an extension header chain exceeding the packet
+    make_packet({
+        0x60, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x40,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+        0x11, 0x02,
+    }),
+    make_packet({}),
+  };
+
+  std::vector<liberate::serialization::const_segment> segments;
+  for (auto & packet : packets) {
+    segments.push_back({ packet.data(), packet.size() });
+  }
+  segments.push_back({ ipv6_buf, sizeof(ipv6_buf) });
+
+  net::packet_headers headers;
+  ASSERT_EQ(6, net::parse_headers(headers, segments.data(), segments.size()));
+  ASSERT_EQ(segments.size(), headers.size());
+
+  ASSERT_EQ(net::AT_INET4, headers.type[0]);
+  ASSERT_EQ(net::packet_headers::PH_PORTS, headers.flags[0]);
+  ASSERT_EQ(17, headers.protocol[0]);
+  ASSERT_EQ(20, headers.transport_offset[0]);
+  ASSERT_EQ(1234, headers.source_port[0]);
+  ASSERT_EQ(53, headers.dest_port[0]);
+  ASSERT_EQ(net::socket_address("10.0.0.1", 1234), headers.source_address(0));
+  ASSERT_EQ(net::socket_address("10.0.0.2", 53), headers.dest_address(0));
+
+  ASSERT_EQ(net::AT_INET4, headers.type[1]);
+  ASSERT_EQ(6, headers.protocol[1]);
+  ASSERT_EQ(24, headers.transport_offset[1]);
+  ASSERT_EQ(8080, headers.source_port[1]);
+  ASSERT_EQ(80, headers.dest_port[1]);
+
+  ASSERT_EQ(net::packet_headers::PH_FRAGMENT | net::packet_headers::PH_PORTS,
+      headers.flags[2]);
+  ASSERT_EQ(1234, headers.source_port[2]);
+
+  ASSERT_EQ(net::packet_headers::PH_FRAGMENT, headers.flags[3]);
+  ASSERT_EQ(0, headers.source_port[3]);
+  ASSERT_EQ(net::socket_address{"10.0.0.1"}, headers.source_address(3));
+
+  ASSERT_EQ(net::AT_INET6, headers.type[4]);
+  ASSERT_EQ(net::packet_headers::PH_FRAGMENT | net::packet_headers::PH_PORTS,
+      headers.flags[4]);
+  ASSERT_EQ(17, headers.protocol[4]);
+  ASSERT_EQ(56, headers.transport_offset[4]);
+  ASSERT_EQ(net::socket_address("2001:db8::1", 1234),
+      headers.source_address(4));
+  ASSERT_EQ(net::socket_address("2001:db8::2", 53), headers.dest_address(4));
+
+  ASSERT_EQ(net::AT_UNSPEC, headers.type[5]);
+  ASSERT_EQ(net::AT_UNSPEC, headers.type[6]);
+  ASSERT_EQ(net::socket_address{}, headers.source_address(6));
+
+  // TCP, but the packet ends after the IP header.
+  ASSERT_EQ(net::AT_INET6, headers.type[7]);
+  ASSERT_EQ(6, headers.protocol[7]);
+  ASSERT_EQ(0, headers.flags[7]);
+  ASSERT_EQ(net::socket_address{"::1"}, headers.source_address(7));
+}
+
+
+TEST(IP, parse_headers_ipv6_later_fragment)
+{
+  // The fragment header's next header is destination options, but in a later
+  // fragment, the bytes after it are payload and must not be parsed.
+  auto packet = make_packet({
+      0x60, 0x00, 0x00, 0x00, 0x00, 0x10, 0x2c, 0x40,
+      0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+      0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+      0x3c, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x2a,
+      0x11, 0xff, 0x04, 0xd2, 0x00, 0x35, 0x00, 0x08,
+  });
+
+  net::packet_headers headers;
+  liberate::serialization::const_segment segment{ packet.data(),
+    packet.size() };
+  ASSERT_EQ(1, net::parse_headers(headers, &segment, 1));
+
+  ASSERT_EQ(net::AT_INET6, headers.type[0]);
+  ASSERT_EQ(net::packet_headers::PH_FRAGMENT, headers.flags[0]);
+  ASSERT_EQ(60, headers.protocol[0]);
+  ASSERT_EQ(48, headers.transport_offset[0]);
+  ASSERT_EQ(0, headers.source_port[0]);
+  ASSERT_EQ(0, headers.dest_port[0]);
+  ASSERT_EQ(net::socket_address("2001:db8::1"), headers.source_address(0));
+}
+
+
+TEST(IP, parse_headers_reuse)
+{
+  net::packet_headers headers;
+  liberate::serialization::const_segment segment{ ipv4_buf, sizeof(ipv4_buf) };
+  ASSERT_EQ(1, net::parse_headers(headers, &segment, 1));
+  ASSERT_EQ(net::AT_INET4, headers.type[0]);
+
+  // Bad packets leave nothing behind from previous batches.
+  segment = { reinterpret_cast<byte const *>("Hello, world!"), 13 };
+  ASSERT_EQ(0, net::parse_headers(headers, &segment, 1));
+  ASSERT_EQ(1, headers.size());
+  ASSERT_EQ(net::AT_UNSPEC, headers.type[0]);
+  ASSERT_EQ(net::packet_headers::address_bytes{}, headers.source[0]);
+
+  ASSERT_EQ(0, net::parse_headers(headers, nullptr, 3));
+  ASSERT_EQ(0, headers.size());
+}
@@ -372,3 +372,45 @@ TEST(Network, direct_allocation)
   // Reserving outside of the network will fail.
   ASSERT_FALSE(net.reserve_address(socket_address("10.0.0.1")));
 }
+
+
+TEST(Network, batch_in_network)
+{
+  using namespace net;
+
+  network net4{"192.168.0.0/24"};
+  network net6{"2001:C00::/22"};
+
+  // More than 64 addresses, so we span multiple bitmap words.
+  std::vector<socket_address> addrs;
+  for (size_t i = 0 ; i < 70 ; ++i) {
+    if (i % 3 == 0) {
+      addrs.push_back(socket_address{"192.168.0." + std::to_string(i)});
+    }
+    else if (i % 3 == 1) {
+      addrs.push_back(socket_address{"192.168.1." + std::to_string(i)});
+    }
+    else {
+      addrs.push_back(socket_address{"2001:fff::" + std::to_string(i)});
+    }
+  }
+
+  uint64_t bitmap[2] = { ~uint64_t{0}, ~uint64_t{0} };
+  ASSERT_EQ(24, net4.in_network(addrs.data(), addrs.size(), bitmap));
+  for (size_t i = 0 ; i < addrs.size() ; ++i) {
+    bool bit = bitmap[i / 64] & (uint64_t{1} << (i % 64));
+    ASSERT_EQ(net4.in_network(addrs[i]), bit) << addrs[i];
+    ASSERT_EQ(i % 3 == 0, bit);
+  }
+  // Bits beyond the amount are cleared.
+  ASSERT_EQ(0, bitmap[1] >> 6);
+
+  ASSERT_EQ(23, net6.in_network(addrs.data(), addrs.size(), bitmap));
+  for (size_t i = 0 ; i < addrs.size() ; ++i) {
+    bool bit = bitmap[i / 64] & (uint64_t{1} << (i % 64));
+    ASSERT_EQ(i % 3 == 2, bit);
+  }
+
+  ASSERT_EQ(0, net4.in_network(addrs.data(), 0, nullptr));
+  ASSERT_THROW(net4.in_network(nullptr, 1, bitmap), std::invalid_argument);
+}
@@ -0,0 +1,296 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/network_set.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "../test_name.h"
+
+namespace net = liberate::net;
+
+namespace {
+
+inline std::string
+to_string(net::network_set const & set)
+{
+  std::stringstream s;
+  s << set;
+  return s.str();
+}
+
+
+inline std::string
+to_string(std::vector<net::network> const & nets)
+{
+  std::stringstream s;
+  bool first = true;
+  for (auto & n : nets) {
+    if (!first) {
+      s << ", ";
+    }
+    s << n;
+    first = false;
+  }
+  return s.str();
+}
+
+} // anonymous namespace
+
+
+/*****************************************************************************
+ * NetworkSetCover
+ */
+
+namespace {
+
+struct cover_test_data
+{
+  char const *  first;
+  char const *  last;
+  char const *  expected;
+} cover_tests[] = {
+  { "192.168.0.1",    "192.168.0.1",    "192.168.0.1/32", },
+  { "192.168.0.0",    "192.168.0.255",  "192.168.0.0/24", },
+  { "192.168.0.0",    "192.168.1.255",  "192.168.0.0/23", },
+  { "192.168.0.1",    "192.168.0.6",    "192.168.0.1/32, 192.168.0.2/31, "
+    "192.168.0.4/31, 192.168.0.6/32", },
+  { "10.0.0.255",     "10.0.1.0",       "10.0.0.255/32, 10.0.1.0/32", },
+  { "0.0.0.0",        "255.255.255.255",  "0.0.0.0/1, 128.0.0.0/1", },
+  { "2001:db8::",     "2001:db8::ffff:ffff:ffff:ffff",  "2001:db8::/64", },
+  { "2001:db8::ffff:ffff:ffff:ffff",  "2001:db8:0:1::",
+    "2001:db8::ffff:ffff:ffff:ffff/128, 2001:db8:0:1::/128", },
+  { "::",             "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff",  "::/1, 8000::/1", },
+};
+
+
+std::string cover_name(testing::TestParamInfo<cover_test_data> const & info)
+{
+  std::string name{info.param.first};
+  name += "_";
+  name += info.param.last;
+  return symbolize_name(name);
+}
+
+} // anonymous namespace
+
+
+class NetworkSetCover
+  : public testing::TestWithParam<cover_test_data>
+{
+};
+
+
+TEST_P(NetworkSetCover, cidr_cover)
+{
+  using namespace net;
+  auto td = GetParam();
+
+  auto res = network_set::cidr_cover(socket_address{td.first},
+      socket_address{td.last});
+  ASSERT_EQ(std::string{td.expected}, to_string(res));
+}
+
+
+INSTANTIATE_TEST_SUITE_P(net, NetworkSetCover,
+    testing::ValuesIn(cover_tests),
+    cover_name);
+
+
+TEST(NetworkSet, cover_bad_range)
+{
+  using namespace net;
+
+  ASSERT_THROW(network_set::cidr_cover(socket_address{"10.0.0.2"},
+        socket_address{"10.0.0.1"}), std::invalid_argument);
+  ASSERT_THROW(network_set::cidr_cover(socket_address{"10.0.0.2"},
+        socket_address{"::1"}), std::invalid_argument);
+  ASSERT_THROW(network_set::cidr_cover(socket_address{},
+        socket_address{}), std::invalid_argument);
+}
+
+
+/*****************************************************************************
+ * NetworkSet
+ */
+
+TEST(NetworkSet, empty)
+{
+  using namespace net;
+
+  network_set set;
+  ASSERT_TRUE(set.empty());
+  ASSERT_TRUE(set.networks().empty());
+  ASSERT_FALSE(set.contains(socket_address{"192.168.0.1"}));
+  ASSERT_FALSE(set.contains(socket_address{}));
+}
+
+
+TEST(NetworkSet, normalize)
+{
+  using namespace net;
+
+  network_set set;
+
+  // Adjacent networks get merged.
+  set.insert("192.168.0.0/24");
+  set.insert("192.168.1.0/24");
+  ASSERT_EQ("192.168.0.0/23", to_string(set));
+
+  // Contained networks vanish.
+  set.insert("192.168.1.128/25");
+  ASSERT_EQ("192.168.0.0/23", to_string(set));
+
+  // Containing networks swallow everything.
+  set.insert("192.168.0.0/16");
+  ASSERT_EQ("192.168.0.0/16", to_string(set));
+
+  // Non-adjacent networks stay separate; IPv4 sorts before IPv6.
+  set.insert("2001:db8::/32");
+  set.insert("10.0.0.0/8");
+  ASSERT_EQ("10.0.0.0/8, 192.168.0.0/16, 2001:db8::/32", to_string(set));
+
+  // Bridging the gap between networks merges them, too.
+  set.insert("10.0.0.1/32");
+  set.insert("12.0.0.0/8");
+  set.insert("11.0.0.0/8");
+  ASSERT_EQ("10.0.0.0/7, 12.0.0.0/8, 192.168.0.0/16, 2001:db8::/32",
+      to_string(set));
+
+  set.clear();
+  ASSERT_TRUE(set.empty());
+}
+
+
+TEST(NetworkSet, erase)
+{
+  using namespace net;
+
+  network_set set;
+  set.insert("192.168.0.0/24");
+
+  // Punch a hole in the middle.
+  set.erase("192.168.0.64/26");
+  ASSERT_EQ("192.168.0.0/26, 192.168.0.128/25", to_string(set));
+  ASSERT_TRUE(set.contains(socket_address{"192.168.0.63"}));
+  ASSERT_FALSE(set.contains(socket_address{"192.168.0.64"}));
+  ASSERT_FALSE(set.contains(socket_address{"192.168.0.127"}));
+  ASSERT_TRUE(set.contains(socket_address{"192.168.0.128"}));
+
+  // Erase across both remaining ranges.
+  set.erase("192.168.0.0/25");
+  ASSERT_EQ("192.168.0.128/25", to_string(set));
+
+  // Erasing non-members does nothing.
+  set.erase("10.0.0.0/8");
+  set.erase("2001:db8::/32");
+  ASSERT_EQ("192.168.0.128/25", to_string(set));
+
+  // Erasing a containing network clears everything.
+  set.erase("192.168.0.0/16");
+  ASSERT_TRUE(set.empty());
+}
+
+
+TEST(NetworkSet, contains)
+{
+  using namespace net;
+
+  network_set set;
+  set.insert("10.0.0.0/8");
+  set.insert("192.168.0.0/24");
+  set.insert("2001:db8::/32");
+
+  ASSERT_TRUE(set.contains(socket_address{"10.1.2.3", 1234}));
+  ASSERT_TRUE(set.contains(socket_address{"192.168.0.255"}));
+  ASSERT_FALSE(set.contains(socket_address{"192.168.1.0"}));
+  ASSERT_FALSE(set.contains(socket_address{"9.255.255.255"}));
+  ASSERT_TRUE(set.contains(socket_address{"2001:db8::1"}));
+  ASSERT_FALSE(set.contains(socket_address{"2001:db9::1"}));
+  ASSERT_FALSE(set.contains(socket_address{"/foo/bar"}));
+
+  ASSERT_TRUE(set.contains(network{"10.10.0.0/16"}));
+  ASSERT_FALSE(set.contains(network{"10.0.0.0/7"}));
+  ASSERT_TRUE(set.overlaps(network{"10.0.0.0/7"}));
+  ASSERT_FALSE(set.overlaps(network{"11.0.0.0/8"}));
+  ASSERT_TRUE(set.overlaps(network{"2001:db8:1::/48"}));
+  ASSERT_FALSE(set.overlaps(network{"2001:db9::/32"}));
+}
+
+
+TEST(NetworkSet, algebra)
+{
+  using namespace net;
+
+  network_set a;
+  a.insert("10.0.0.0/8");
+  a.insert("192.168.0.0/24");
+  a.insert("2001:db8::/32");
+
+  network_set b;
+  b.insert("10.128.0.0/9");
+  b.insert("11.0.0.0/8");
+  b.insert("192.168.0.0/25");
+  b.insert("2001:db8:8000::/33");
+
+  ASSERT_EQ("10.0.0.0/7, 192.168.0.0/24, 2001:db8::/32",
+      to_string(a.set_union(b)));
+  ASSERT_EQ("10.128.0.0/9, 192.168.0.0/25, 2001:db8:8000::/33",
+      to_string(a.set_intersection(b)));
+  ASSERT_EQ("10.0.0.0/9, 192.168.0.128/25, 2001:db8::/33",
+      to_string(a.set_difference(b)));
+  ASSERT_EQ("11.0.0.0/8", to_string(b.set_difference(a)));
+
+  ASSERT_TRUE(a.overlaps(b));
+  ASSERT_FALSE(a.set_difference(b).overlaps(b));
+
+  // Union with itself is itself; difference with itself is empty.
+  ASSERT_EQ(a, a.set_union(a));
+  ASSERT_EQ(a, a.set_intersection(a));
+  ASSERT_TRUE(a.set_difference(a).empty());
+  ASSERT_NE(a, b);
+}
+
+
+TEST(NetworkSet, value_semantics)
+{
+  using namespace net;
+
+  network_set a;
+  a.insert("10.0.0.0/8");
+
+  network_set b{a};
+  ASSERT_EQ(a, b);
+
+  b.insert("11.0.0.0/8");
+  ASSERT_NE(a, b);
+  ASSERT_EQ("10.0.0.0/8", to_string(a));
+
+  a = b;
+  ASSERT_EQ(a, b);
+
+  network_set c;
+  swap(a, c);
+  ASSERT_TRUE(a.empty());
+  ASSERT_EQ(b, c);
+}
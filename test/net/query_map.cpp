@@ -0,0 +1,184 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/query_map.h>
+#include <liberate/net/url.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+
+namespace net = liberate::net;
+
+TEST(QueryMap, empty)
+{
+  net::query_map map;
+  ASSERT_TRUE(map.empty());
+  ASSERT_EQ(0, map.size());
+  ASSERT_EQ(map.end(), map.find("foo"));
+  ASSERT_EQ(0, map.count("foo"));
+  ASSERT_EQ(0, map.erase("foo"));
+}
+
+
+TEST(QueryMap, insert_and_find)
+{
+  net::query_map map;
+  map["zeta"] = "1";
+  map["alpha"] = "2";
+  auto [iter, inserted] = map.insert_or_assign("mu", "3");
+  ASSERT_TRUE(inserted);
+  ASSERT_EQ("mu", iter->first);
+
+  std::tie(iter, inserted) = map.insert_or_assign("alpha", "4");
+  ASSERT_FALSE(inserted);
+  ASSERT_EQ("4", iter->second);
+
+  ASSERT_EQ(3, map.size());
+  ASSERT_EQ("4", map.find("alpha")->second);
+  ASSERT_EQ("3", map.find("mu")->second);
+  ASSERT_EQ("1", map.find("zeta")->second);
+  ASSERT_EQ(map.end(), map.find("beta"));
+
+  // Iteration is in key order, like std::map
+  std::string keys;
+  for (auto const & [key, value] : map) {
+    keys += key;
+  }
+  ASSERT_EQ("alphamuzeta", keys);
+
+  ASSERT_EQ(1, map.erase("mu"));
+  ASSERT_EQ(2, map.size());
+  ASSERT_EQ(map.end(), map.find("mu"));
+}
+
+
+TEST(QueryMap, map_interface)
+{
+  net::query_map map;
+  auto [iter, inserted] = map.insert({"b", "1"});
+  ASSERT_TRUE(inserted);
+  ASSERT_EQ("b", iter->first);
+
+  // insert() and emplace() do not replace existing values.
+  std::tie(iter, inserted) = map.insert({"b", "2"});
+  ASSERT_FALSE(inserted);
+  ASSERT_EQ("1", iter->second);
+
+  std::tie(iter, inserted) = map.emplace("a", "3");
+  ASSERT_TRUE(inserted);
+  std::tie(iter, inserted) = map.emplace("a", "4");
+  ASSERT_FALSE(inserted);
+  ASSERT_EQ("3", iter->second);
+
+  ASSERT_EQ("1", map.at("b"));
+  map.at("b") = "5";
+  ASSERT_EQ("5", static_cast<net::query_map const &>(map).at("b"));
+  ASSERT_THROW(map.at("c"), std::out_of_range);
+
+  // Values can be modified through iterators; keys are const.
+  for (auto && [key, value] : map) {
+    value += key;
+  }
+  static_assert(std::is_const_v<std::remove_reference_t<
+      decltype(map.begin()->first)>>);
+  ASSERT_EQ("3a", map.find("a")->second);
+  ASSERT_EQ("5b", map.find("b")->second);
+
+  net::query_map::const_iterator citer = map.begin();
+  ASSERT_EQ("a", citer->first);
+  ASSERT_EQ(2, map.end() - citer);
+
+  iter = map.erase(citer);
+  ASSERT_EQ("b", iter->first);
+  ASSERT_EQ(1, map.size());
+  ASSERT_EQ(map.end(), map.find("a"));
+  ASSERT_EQ(map.begin(), map.find("b"));
+}
+
+
+TEST(QueryMap, many_entries)
+{
+  // Exceed the linear scan limit, and compare against std::map.
+  net::query_map map;
+  std::map<std::string, std::string> reference;
+  for (int i = 0 ; i < 100 ; ++i) {
+    auto key = "key" + std::to_string((i * 37) % 100);
+    map[key] = std::to_string(i);
+    reference[key] = std::to_string(i);
+  }
+
+  ASSERT_EQ(reference.size(), map.size());
+  auto iter = map.begin();
+  for (auto & [key, value] : reference) {
+    ASSERT_EQ(key, iter->first);
+    ASSERT_EQ(value, iter->second);
+    ASSERT_EQ(value, map.find(key)->second);
+    ++iter;
+  }
+  ASSERT_EQ(map.end(), map.find("key100"));
+}
+
+
+TEST(QueryMap, comparison_and_hash)
+{
+  net::query_map first{{"a", "1"}, {"b", "2"}};
+  net::query_map second;
+  second["b"] = "2";
+  second["a"] = "1";
+
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(first.hash(), second.hash());
+
+  second["b"] = "3";
+  ASSERT_NE(first, second);
+  ASSERT_LT(first, second);
+  ASSERT_NE(first.hash(), second.hash());
+
+  swap(first, second);
+  ASSERT_EQ("3", first.find("b")->second);
+}
+
+
+TEST(QueryMap, url_as_cache_key)
+{
+  auto url1 = net::url::parse("tcp4://127.0.0.1:123?a=1&b=2");
+  auto url2 = net::url::parse("tcp4://127.0.0.1:123?b=2&a=1");
+  auto url3 = net::url::parse("tcp4://127.0.0.1:123?a=1&b=3");
+
+  ASSERT_EQ(url1, url2);
+  ASSERT_NE(url1, url3);
+  ASSERT_EQ(url1.hash(), url2.hash());
+
+  // Ordering is a strict weak ordering.
+  ASSERT_TRUE(url1 < url3);
+  ASSERT_FALSE(url3 < url1);
+  ASSERT_FALSE(url1 < url2);
+  ASSERT_FALSE(url2 < url1);
+
+  std::unordered_set<net::url> cache;
+  cache.insert(url1);
+  cache.insert(url2);
+  cache.insert(url3);
+  ASSERT_EQ(2, cache.size());
+}
@@ -0,0 +1,211 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/resolver_backend.h>
+#include <liberate/net/resolve.h>
+#include <liberate/net/resolver_cache.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+namespace net = liberate::net;
+
+namespace {
+
+std::vector<net::socket_address>
+addresses(std::initializer_list<char const *> strings)
+{
+  std::vector<net::socket_address> ret;
+  for (auto str : strings) {
+    ret.push_back(net::socket_address{str});
+  }
+  return ret;
+}
+
+
+/**
+ * Counts lookups and returns nothing, as a fallback.
+ */
+struct counting_backend : public net::resolver_backend
+{
+  int calls = 0;
+
+  virtual std::vector<net::socket_address>
+  lookup(net::address_type, std::string const &) override
+  {
+    ++calls;
+    return {};
+  }
+};
+
+} // anonymous namespace
+
+
+TEST(ResolverBackend, sort_by_precedence)
+{
+  auto result = addresses({
+      "fd00::1", "2002::1", "10.0.0.1", "2001::1", "2001:db8::1", "::1",
+  });
+  net::sort_by_preference(result);
+
+  ASSERT_EQ(addresses({
+      "::1", "2001:db8::1", "10.0.0.1", "2002::1", "2001::1", "fd00::1",
+  }), result);
+}
+
+
+TEST(ResolverBackend, sort_by_scope)
+{
+  auto result = addresses({
+      "2001:db8::1", "fe80::1", "10.0.0.2", "10.0.0.1", "127.0.0.1",
+  });
+  net::sort_by_preference(result);
+
+  // Equal addresses otherwise keep their order.
+  ASSERT_EQ(addresses({
+      "fe80::1", "2001:db8::1", "127.0.0.1", "10.0.0.2", "10.0.0.1",
+  }), result);
+}
+
+
+TEST(ResolverBackend, static_lookup)
+{
+  net::static_resolver_backend backend;
+  backend.add("Service.test", net::socket_address{"10.0.0.1"});
+  backend.add("service.test", net::socket_address{"2001:db8::1"});
+  backend.add("service.test", net::socket_address{"10.0.0.1"});
+  backend.add("other.test", net::socket_address{"10.0.0.2"});
+  ASSERT_EQ(2, backend.size());
+
+  ASSERT_EQ(addresses({ "2001:db8::1", "10.0.0.1" }),
+      backend.lookup(net::AT_UNSPEC, "SERVICE.test"));
+  ASSERT_EQ(addresses({ "10.0.0.1" }),
+      backend.lookup(net::AT_INET4, "service.test"));
+  ASSERT_EQ(addresses({ "2001:db8::1" }),
+      backend.lookup(net::AT_INET6, "service.test"));
+  ASSERT_TRUE(backend.lookup(net::AT_INET6, "other.test").empty());
+  ASSERT_TRUE(backend.lookup(net::AT_UNSPEC, "unknown.test").empty());
+
+  backend.remove("service.test");
+  ASSERT_TRUE(backend.lookup(net::AT_UNSPEC, "service.test").empty());
+  ASSERT_EQ(1, backend.size());
+
+  backend.clear();
+  ASSERT_EQ(0, backend.size());
+}
+
+
+TEST(ResolverBackend, static_bad_arguments)
+{
+  net::static_resolver_backend backend;
+  ASSERT_THROW(backend.add("", net::socket_address{"10.0.0.1"}),
+      std::invalid_argument);
+  ASSERT_THROW(backend.add("local.test", net::socket_address{"/tmp/socket"}),
+      std::invalid_argument);
+}
+
+
+TEST(ResolverBackend, hosts_load)
+{
+  std::istringstream input{
+    "# Comment line\n"
+    "127.0.0.1\tlocalhost\n"
+    "::1     localhost ip6-localhost # trailing comment\n"
+    "\n"
+    "10.0.0.1 service.test alias.test\n"
+    "fe80::1%lo0 zone.test\n"
+    "not-an-address broken.test\n"
+    "10.0.0.2\n"
+  };
+
+  net::hosts_resolver_backend backend;
+  ASSERT_EQ(5, backend.load(input));
+  ASSERT_EQ(4, backend.size());
+
+  ASSERT_EQ(addresses({ "::1", "127.0.0.1" }),
+      backend.lookup(net::AT_UNSPEC, "localhost"));
+  ASSERT_EQ(addresses({ "::1" }),
+      backend.lookup(net::AT_UNSPEC, "ip6-localhost"));
+  ASSERT_EQ(addresses({ "10.0.0.1" }),
+      backend.lookup(net::AT_INET4, "alias.test"));
+  ASSERT_TRUE(backend.lookup(net::AT_UNSPEC, "zone.test").empty());
+  ASSERT_TRUE(backend.lookup(net::AT_UNSPEC, "broken.test").empty());
+}
+
+
+TEST(ResolverBackend, hosts_missing_file)
+{
+  net::hosts_resolver_backend backend;
+  ASSERT_THROW(backend.load_file("/nonexistent/hosts"), std::runtime_error);
+}
+
+
+TEST(ResolverBackend, chained)
+{
+  auto local = std::make_shared<net::static_resolver_backend>();
+  local->add("service.test", net::socket_address{"10.0.0.1"});
+  auto fallback = std::make_shared<counting_backend>();
+
+  net::chained_resolver_backend backend{{ local, fallback }};
+
+  ASSERT_EQ(addresses({ "10.0.0.1" }),
+      backend.lookup(net::AT_UNSPEC, "service.test"));
+  ASSERT_EQ(0, fallback->calls);
+
+  ASSERT_TRUE(backend.lookup(net::AT_UNSPEC, "other.test").empty());
+  ASSERT_EQ(1, fallback->calls);
+
+  ASSERT_THROW(net::chained_resolver_backend({ local, nullptr }),
+      std::invalid_argument);
+}
+
+
+TEST(ResolverBackend, resolve_with_port)
+{
+  net::static_resolver_backend backend;
+  backend.add("service.test", net::socket_address{"10.0.0.1"});
+
+  auto result = net::resolve(backend, net::AT_INET4, "service.test:1234");
+  ASSERT_EQ(1, result.size());
+  ASSERT_EQ(net::socket_address("10.0.0.1", 1234), result[0]);
+
+  ASSERT_THROW(net::resolve(backend, net::AT_INET4, ""),
+      std::invalid_argument);
+  ASSERT_THROW(net::resolve(backend, net::AT_LOCAL, "service.test"),
+      std::invalid_argument);
+}
+
+
+TEST(ResolverBackend, cache)
+{
+  auto local = std::make_shared<net::static_resolver_backend>();
+  local->add("service.test", net::socket_address{"10.0.0.1"});
+  auto fallback = std::make_shared<counting_backend>();
+  net::chained_resolver_backend backend{{ fallback, local }};
+
+  net::resolver_cache cache{backend};
+  ASSERT_EQ(addresses({ "10.0.0.1" }),
+      cache.resolve(net::AT_UNSPEC, "service.test"));
+  ASSERT_EQ(addresses({ "10.0.0.1" }),
+      cache.resolve(net::AT_UNSPEC, "service.test"));
+  ASSERT_EQ(1, fallback->calls);
+}
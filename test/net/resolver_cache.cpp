@@ -0,0 +1,223 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#include <liberate/net/resolver_cache.h>
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace net = liberate::net;
+
+namespace {
+
+/**
+ * Stand-in for the system resolver, with a fixed table and call counting.
+ */
+struct fake_resolver
+{
+  std::map<std::string, std::vector<net::socket_address>> table = {
+    { "one.test", { net::socket_address{"10.0.0.1"} } },
+    { "two.test", { net::socket_address{"10.0.0.2"},
+                    net::socket_address{"2001:db8::2"} } },
+  };
+  std::atomic<int> calls = 0;
+
+  net::resolver_cache::lookup_function
+  lookup()
+  {
+    return [this](net::address_type, std::string const & hostname)
+    {
+      ++calls;
+      if (hostname == "error.test") {
+        throw std::runtime_error("lookup failed");
+      }
+      auto iter = table.find(hostname);
+      if (iter == table.end()) {
+        return std::vector<net::socket_address>{};
+      }
+      return iter->second;
+    };
+  }
+};
+
+
+/**
+ * Manually advanced clock.
+ */
+struct fake_clock
+{
+  net::resolver_cache_options::clock::time_point time = {};
+
+  std::function<net::resolver_cache_options::clock::time_point ()>
+  now()
+  {
+    return [this]() { return time; };
+  }
+};
+
+} // anonymous namespace
+
+
+TEST(ResolverCache, positive_ttl)
+{
+  fake_resolver resolver;
+  fake_clock clock;
+
+  net::resolver_cache_options opts;
+  opts.positive_ttl = std::chrono::seconds{10};
+  opts.now = clock.now();
+  net::resolver_cache cache{resolver.lookup(), opts};
+
+  auto result = cache.resolve(net::AT_UNSPEC, "two.test");
+  ASSERT_EQ(2, result.size());
+  ASSERT_EQ(1, resolver.calls);
+
+  // Cached
+  clock.time += std::chrono::seconds{9};
+  ASSERT_EQ(result, cache.resolve(net::AT_UNSPEC, "two.test"));
+  ASSERT_EQ(1, resolver.calls);
+
+  // Other address types are cached separately.
+  cache.resolve(net::AT_INET4, "two.test");
+  ASSERT_EQ(2, resolver.calls);
+  ASSERT_EQ(2, cache.size());
+
+  // Expired
+  clock.time += std::chrono::seconds{1};
+  ASSERT_EQ(result, cache.resolve(net::AT_UNSPEC, "two.test"));
+  ASSERT_EQ(3, resolver.calls);
+
+  // Invalidated
+  cache.invalidate(net::AT_UNSPEC, "two.test");
+  ASSERT_EQ(1, cache.size());
+  cache.resolve(net::AT_UNSPEC, "two.test");
+  ASSERT_EQ(4, resolver.calls);
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+}
+
+
+TEST(ResolverCache, negative_ttl)
+{
+  fake_resolver resolver;
+  fake_clock clock;
+
+  net::resolver_cache_options opts;
+  opts.positive_ttl = std::chrono::seconds{60};
+  opts.negative_ttl = std::chrono::seconds{2};
+  opts.now = clock.now();
+  net::resolver_cache cache{resolver.lookup(), opts};
+
+  ASSERT_TRUE(cache.resolve(net::AT_UNSPEC, "missing.test").empty());
+  ASSERT_TRUE(cache.resolve(net::AT_UNSPEC, "missing.test").empty());
+  ASSERT_EQ(1, resolver.calls);
+
+  clock.time += std::chrono::seconds{2};
+  ASSERT_TRUE(cache.resolve(net::AT_UNSPEC, "missing.test").empty());
+  ASSERT_EQ(2, resolver.calls);
+}
+
+
+TEST(ResolverCache, errors_are_not_cached)
+{
+  fake_resolver resolver;
+  net::resolver_cache cache{resolver.lookup()};
+
+  ASSERT_THROW(cache.resolve(net::AT_UNSPEC, "error.test"),
+      std::runtime_error);
+  ASSERT_THROW(cache.resolve(net::AT_UNSPEC, "error.test"),
+      std::runtime_error);
+  ASSERT_EQ(2, resolver.calls);
+  ASSERT_EQ(0, cache.size());
+
+  // Bad arguments are rejected before any lookup.
+  ASSERT_THROW(cache.resolve(net::AT_UNSPEC, ""), std::invalid_argument);
+  ASSERT_THROW(cache.resolve(net::AT_LOCAL, "one.test"),
+      std::invalid_argument);
+  ASSERT_EQ(2, resolver.calls);
+}
+
+
+TEST(ResolverCache, lru_eviction)
+{
+  fake_resolver resolver;
+  net::resolver_cache_options opts;
+  opts.max_entries = 2;
+  net::resolver_cache cache{resolver.lookup(), opts};
+
+  cache.resolve(net::AT_INET4, "one.test");
+  cache.resolve(net::AT_INET4, "two.test");
+  ASSERT_EQ(2, cache.size());
+
+  // Use "one.test", so "two.test" is evicted next.
+  cache.resolve(net::AT_INET4, "one.test");
+  cache.resolve(net::AT_INET4, "three.test");
+  ASSERT_EQ(2, cache.size());
+  ASSERT_EQ(3, resolver.calls);
+
+  cache.resolve(net::AT_INET4, "one.test");
+  ASSERT_EQ(3, resolver.calls);
+  cache.resolve(net::AT_INET4, "two.test");
+  ASSERT_EQ(4, resolver.calls);
+}
+
+
+TEST(ResolverCache, single_flight)
+{
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> calls = 0;
+
+  net::resolver_cache cache{
+    [&](net::address_type, std::string const &)
+    {
+      ++calls;
+      released.wait();
+      return std::vector<net::socket_address>{net::socket_address{"10.0.0.1"}};
+    }
+  };
+
+  std::vector<std::future<std::vector<net::socket_address>>> results;
+  for (int i = 0 ; i < 4 ; ++i) {
+    results.push_back(std::async(std::launch::async, [&cache]()
+    {
+      return cache.resolve(net::AT_INET4, "one.test");
+    }));
+  }
+
+  // Wait for the first lookup to start, give the others a chance to queue up
+  // behind it, and then let it finish.
+  while (calls == 0) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  release.set_value();
+
+  for (auto & result : results) {
+    ASSERT_EQ(1, result.get().size());
+  }
+  ASSERT_EQ(1, calls);
+}
@@ -0,0 +1,126 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/net/url_view.h>
+
+#include <gtest/gtest.h>
+
+namespace net = liberate::net;
+
+TEST(URLView, components)
+{
+  std::string source{"HTTPS://finkhaeuser.de/path%20to?Some=VaLue&simple&other=tRue#myFrag"};
+  auto view = net::url_view::parse(source);
+
+  // Raw components point into the source.
+  ASSERT_EQ("HTTPS", view.scheme());
+  ASSERT_EQ("finkhaeuser.de", view.authority());
+  ASSERT_EQ("/path%20to", view.path());
+  ASSERT_EQ("Some=VaLue&simple&other=tRue", view.query());
+  ASSERT_EQ("myFrag", view.fragment());
+  ASSERT_EQ(source.data(), view.scheme().data());
+  ASSERT_EQ(source.data() + 8, view.authority().data());
+
+  ASSERT_TRUE(view.scheme_is("https"));
+  ASSERT_FALSE(view.scheme_is("http"));
+}
+
+
+TEST(URLView, missing_components)
+{
+  auto view = net::url_view::parse("anon://");
+  ASSERT_EQ("anon", view.scheme());
+  ASSERT_TRUE(view.authority().empty());
+  ASSERT_TRUE(view.path().empty());
+  ASSERT_TRUE(view.query().empty());
+  ASSERT_TRUE(view.fragment().empty());
+
+  view = net::url_view::parse("file://?a=b#frag");
+  ASSERT_TRUE(view.authority().empty());
+  ASSERT_TRUE(view.path().empty());
+  ASSERT_EQ("a=b", view.query());
+  ASSERT_EQ("frag", view.fragment());
+
+  // Slashes and question marks in the query or fragment don't confuse the
+  // parser.
+  view = net::url_view::parse("tcp://host?path=/foo?bar#/frag?x");
+  ASSERT_EQ("host", view.authority());
+  ASSERT_TRUE(view.path().empty());
+  ASSERT_EQ("path=/foo?bar", view.query());
+  ASSERT_EQ("/frag?x", view.fragment());
+}
+
+
+TEST(URLView, bad_scheme)
+{
+  ASSERT_THROW(net::url_view::parse("foo"), std::invalid_argument);
+  ASSERT_THROW(net::url_view::parse("foo:"), std::invalid_argument);
+  ASSERT_THROW(net::url_view::parse("foo:/bar"), std::invalid_argument);
+}
+
+
+TEST(URLView, query_lookup)
+{
+  auto view = net::url_view::parse("pipe:///foo/bar?Blocking=false&"
+      "simple&Enc%4fded=a%20b&dup=1&dup=2&&");
+
+  ASSERT_TRUE(view.has_query("blocking"));
+  ASSERT_TRUE(view.has_query("simple"));
+  ASSERT_TRUE(view.has_query("encOded"));
+  ASSERT_FALSE(view.has_query("encoded"));
+  ASSERT_FALSE(view.has_query("missing"));
+  ASSERT_FALSE(view.has_query(""));
+
+  ASSERT_EQ("0", view.query_value("blocking").value());
+  ASSERT_EQ("1", view.query_value("simple").value());
+  ASSERT_EQ("a b", view.query_value("encOded").value());
+  ASSERT_EQ("2", view.query_value("dup").value());
+  ASSERT_FALSE(view.query_value("missing").has_value());
+
+  size_t count = 0;
+  view.for_each_query([&count](std::string_view, std::string_view, bool)
+  {
+    ++count;
+  });
+  ASSERT_EQ(5, count);
+}
+
+
+TEST(URLView, to_url)
+{
+  char const * sources[] = {
+    "https://finkhaeuser.de/path/to?some=value&simple&other=tRue#myfrag",
+    "TcP4://127.0.0.1:123",
+    "file:///path/to#myfrag",
+    "pipe:///foo%20bar?Behaviour=Datagram&x=%41",
+  };
+
+  for (auto source : sources) {
+    auto view = net::url_view::parse(source);
+    auto url = view.to_url();
+    ASSERT_EQ(net::url::parse(source), url);
+  }
+
+  auto url = net::url_view::parse(sources[3]).to_url();
+  ASSERT_EQ("pipe", url.scheme);
+  ASSERT_EQ("/foo bar", url.path);
+  ASSERT_EQ("datagram", url.query["behaviour"]);
+  ASSERT_EQ("A", url.query["x"]);
+}
@@ -0,0 +1,234 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#include <liberate/serialization/buffer.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace liberate::serialization;
+using liberate::types::varint;
+using liberate::types::byte;
+
+struct pair
+{
+  uint16_t  first = 0;
+  varint    second = varint{0};
+
+  using serialization_schema = schema<
+    int_field<&pair::first>,
+    varint_field<&pair::second>
+  >;
+};
+
+
+// Writes a fixed sequence of values, returns the writer state.
+bool
+write_sequence(buffer_writer & writer)
+{
+  byte const raw[] = { byte{0xaa}, byte{0xbb}, byte{0xcc} };
+  pair p;
+  p.first = 0x1234;
+  p.second = varint{1000};
+
+  writer.write_int(uint32_t{0x01020304})
+    .write_varint(varint{300})
+    .write_varint<varint_zigzag>(varint{-3})
+    .write_bytes(raw, sizeof(raw))
+    .write_struct(p)
+    .write_int(uint8_t{0x42});
+  return writer.ok();
+}
+
+
+// Reads the same sequence back and checks it.
+void
+read_sequence(buffer_reader & reader)
+{
+  uint32_t u32 = 0;
+  varint v1{0};
+  varint v2{0};
+  byte raw[3];
+  pair p;
+  uint8_t u8 = 0;
+
+  reader.read_int(u32)
+    .read_varint(v1)
+    .read_varint<varint_zigzag>(v2)
+    .read_bytes(raw, sizeof(raw))
+    .read_struct(p)
+    .read_int(u8);
+  ASSERT_TRUE(reader);
+
+  ASSERT_EQ(0x01020304, u32);
+  ASSERT_EQ(varint{300}, v1);
+  ASSERT_EQ(varint{-3}, v2);
+  ASSERT_EQ(byte{0xaa}, raw[0]);
+  ASSERT_EQ(byte{0xcc}, raw[2]);
+  ASSERT_EQ(0x1234, p.first);
+  ASSERT_EQ(varint{1000}, p.second);
+  ASSERT_EQ(0x42, u8);
+}
+
+// 4 + 2 + 1 + 3 + 4 + 1
+constexpr size_t SEQUENCE_SIZE = 15;
+
+} // anonymous namespace
+
+
+TEST(SerializationBuffer, contiguous)
+{
+  std::vector<byte> buf(64);
+  buffer_writer writer{buf.data(), buf.size()};
+  ASSERT_TRUE(write_sequence(writer));
+  ASSERT_EQ(SEQUENCE_SIZE, writer.written());
+  ASSERT_EQ(64 - SEQUENCE_SIZE, writer.remaining());
+
+  // Must match the individual serialization functions.
+  uint8_t expected[4];
+  serialize_int(expected, sizeof(expected), uint32_t{0x01020304});
+  ASSERT_EQ(byte{expected[0]}, buf[0]);
+  ASSERT_EQ(byte{expected[3]}, buf[3]);
+
+  buffer_reader reader{buf.data(), writer.written()};
+  read_sequence(reader);
+  ASSERT_EQ(SEQUENCE_SIZE, reader.consumed());
+  ASSERT_EQ(0, reader.remaining());
+}
+
+
+TEST(SerializationBuffer, exact_size)
+{
+  // Exactly sized buffers take the slow paths near the end.
+  std::vector<byte> buf(SEQUENCE_SIZE);
+  buffer_writer writer{buf.data(), buf.size()};
+  ASSERT_TRUE(write_sequence(writer));
+  ASSERT_EQ(0, writer.remaining());
+
+  buffer_reader reader{buf.data(), buf.size()};
+  read_sequence(reader);
+}
+
+
+TEST(SerializationBuffer, sticky_errors)
+{
+  std::vector<byte> buf(SEQUENCE_SIZE - 1);
+  buffer_writer writer{buf.data(), buf.size()};
+  ASSERT_FALSE(write_sequence(writer));
+
+  // Nothing is written after the first error.
+  auto written = writer.written();
+  writer.write_int(uint8_t{1});
+  ASSERT_FALSE(writer);
+  ASSERT_EQ(written, writer.written());
+
+  writer.reset();
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(0, writer.written());
+
+  // Readers fail on truncated input, and leave values alone afterwards.
+  byte const data[] = { byte{0x00}, byte{0x01}, byte{0x80} };
+  buffer_reader reader{data, sizeof(data)};
+  uint16_t value = 0;
+  varint v{42};
+  reader.read_int(value).read_varint(v);
+  ASSERT_FALSE(reader);
+  ASSERT_EQ(1, value);
+  ASSERT_EQ(varint{42}, v);
+
+  uint8_t after = 7;
+  reader.read_int(after);
+  ASSERT_EQ(7, after);
+
+  // Values that cannot be serialized set the error flag, too.
+  buffer_writer negative{buf.data(), buf.size()};
+  negative.write_varint(varint{-1});
+  ASSERT_FALSE(negative);
+}
+
+
+TEST(SerializationBuffer, segments)
+{
+  // Scatter the sequence over segments of every size up to the total,
+  // including empty ones, so that each value straddles a boundary at some
+  // point.
+  for (size_t split = 0 ; split <= SEQUENCE_SIZE ; ++split) {
+    std::vector<byte> first(split);
+    std::vector<byte> second(3);
+    std::vector<byte> third(SEQUENCE_SIZE);
+
+    segment segs[] = {
+      { first.data(), first.size() },
+      { nullptr, 0 },
+      { second.data(), second.size() },
+      { third.data(), third.size() },
+    };
+    buffer_writer writer{segs, 4};
+    ASSERT_TRUE(write_sequence(writer));
+    ASSERT_EQ(SEQUENCE_SIZE, writer.written());
+
+    // Gather the same segments for reading.
+    const_segment csegs[] = {
+      { first.data(), first.size() },
+      { nullptr, 0 },
+      { second.data(), second.size() },
+      { third.data(), third.size() },
+    };
+    buffer_reader reader{csegs, 4};
+    read_sequence(reader);
+    ASSERT_EQ(SEQUENCE_SIZE, reader.consumed());
+  }
+}
+
+
+TEST(SerializationBuffer, views)
+{
+  byte first[] = { byte{1}, byte{2} };
+  byte second[] = { byte{3}, byte{4}, byte{5} };
+  const_segment segs[] = {
+    { first, sizeof(first) },
+    { second, sizeof(second) },
+  };
+
+  buffer_reader reader{segs, 2};
+  byte const * view = nullptr;
+  reader.read_view(view, 2);
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(first, view);
+
+  // The next view starts in the second segment.
+  reader.read_view(view, 1);
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(second, view);
+
+  reader.skip(1);
+  ASSERT_EQ(4, reader.consumed());
+
+  // Too large
+  reader.read_view(view, 2);
+  ASSERT_FALSE(reader);
+
+  // Views must not straddle segments.
+  reader.reset();
+  reader.skip(1).read_view(view, 2);
+  ASSERT_FALSE(reader);
+}
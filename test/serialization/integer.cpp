@@ -19,6 +19,9 @@
  **/
 #include <liberate/serialization/integer.h>
 
+#include <cstring>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 TEST(SerializationInteger, serialize_to_byte)
@@ -123,3 +126,150 @@ TEST(SerializationInteger, detail_deserialize_from_uint16_t)
 
   ASSERT_EQ(result, 0x01020304);
 }
+
+
+TEST(SerializationInteger, high_bits)
+{
+  using namespace liberate::serialization;
+
+  // Bytes with the high bit set must not be sign extended, even from char
+  // buffers.
+  char buf[8] = { 0 };
+  uint64_t test = 0xfedcba9876543210ULL;
+  ASSERT_EQ(8, serialize_int(buf, sizeof(buf), test));
+  ASSERT_EQ(static_cast<char>(0xfe), buf[0]);
+  ASSERT_EQ(static_cast<char>(0x10), buf[7]);
+
+  uint64_t result = 0;
+  ASSERT_EQ(8, deserialize_int(result, buf, sizeof(buf)));
+  ASSERT_EQ(test, result);
+
+  // Signed values round trip.
+  int16_t value = -2;
+  ASSERT_EQ(2, serialize_int(buf, sizeof(buf), value));
+  ASSERT_EQ(static_cast<char>(0xff), buf[0]);
+  ASSERT_EQ(static_cast<char>(0xfe), buf[1]);
+
+  int16_t signed_result = 0;
+  ASSERT_EQ(2, deserialize_int(signed_result, buf, sizeof(buf)));
+  ASSERT_EQ(value, signed_result);
+
+  // Buffers that are too small fail.
+  ASSERT_EQ(0, serialize_int(buf, 3, uint32_t{42}));
+  ASSERT_EQ(0, deserialize_int(result, buf, 7));
+}
+
+
+
+namespace {
+
+constexpr uint64_t
+constexpr_roundtrip(uint64_t value)
+{
+  char buf[8] = {};
+  liberate::serialization::serialize_int(buf, sizeof(buf), value);
+
+  uint64_t result = 0;
+  liberate::serialization::deserialize_int(result, buf, sizeof(buf));
+  return result;
+}
+
+
+constexpr uint8_t
+constexpr_first_byte(uint32_t value)
+{
+  uint8_t buf[4] = {};
+  liberate::serialization::serialize_int(buf, sizeof(buf), value);
+  return buf[0];
+}
+
+} // anonymous namespace
+
+
+TEST(SerializationInteger, constexpr)
+{
+  static_assert(constexpr_first_byte(0x01020304) == 0x01);
+  static_assert(constexpr_roundtrip(0xfedcba9876543210ULL)
+      == 0xfedcba9876543210ULL);
+
+  // The results match at runtime.
+  volatile uint64_t value = 0xfedcba9876543210ULL;
+  ASSERT_EQ(value, constexpr_roundtrip(value));
+}
+
+
+namespace {
+
+template <typename T>
+void
+bulk_roundtrip()
+{
+  using namespace liberate::serialization;
+
+  // Sizes around the vector block sizes, to exercise both the vectorized and
+  // scalar code.
+  for (size_t amount : { 0, 1, 3, 7, 15, 16, 17, 33, 64, 100 }) {
+    std::vector<T> values(amount);
+    for (size_t i = 0 ; i < amount ; ++i) {
+      values[i] = static_cast<T>(0x0102030405060708ULL * (i + 1));
+    }
+
+    std::vector<uint8_t> buf(amount * sizeof(T));
+    ASSERT_EQ(buf.size(), serialize_ints(buf.data(), buf.size(),
+          values.data(), amount));
+
+    // Must match one-by-one serialization
+    for (size_t i = 0 ; i < amount ; ++i) {
+      uint8_t single[sizeof(T)];
+      ASSERT_EQ(sizeof(T), serialize_int(single, sizeof(single), values[i]));
+      ASSERT_EQ(0, std::memcmp(single, buf.data() + i * sizeof(T),
+            sizeof(T)));
+    }
+
+    std::vector<T> result(amount);
+    ASSERT_EQ(buf.size(), deserialize_ints(result.data(), amount,
+          buf.data(), buf.size()));
+    ASSERT_EQ(values, result);
+
+    if (amount) {
+      // Too small buffers fail.
+      ASSERT_EQ(0, serialize_ints(buf.data(), buf.size() - 1,
+            values.data(), amount));
+      ASSERT_EQ(0, deserialize_ints(result.data(), amount,
+            buf.data(), buf.size() - 1));
+    }
+  }
+}
+
+} // anonymous namespace
+
+
+TEST(SerializationInteger, bulk)
+{
+  bulk_roundtrip<uint8_t>();
+  bulk_roundtrip<uint16_t>();
+  bulk_roundtrip<int16_t>();
+  bulk_roundtrip<uint32_t>();
+  bulk_roundtrip<int32_t>();
+  bulk_roundtrip<uint64_t>();
+  bulk_roundtrip<int64_t>();
+}
+
+
+TEST(SerializationInteger, bulk_to_byte)
+{
+  using namespace liberate::serialization;
+
+  uint32_t values[] = { 0x01020304, 0xdeadbeef };
+  std::byte buf[8];
+  ASSERT_EQ(8, serialize_ints(buf, sizeof(buf), values, 2));
+  ASSERT_EQ(std::byte{0x01}, buf[0]);
+  ASSERT_EQ(std::byte{0x04}, buf[3]);
+  ASSERT_EQ(std::byte{0xde}, buf[4]);
+  ASSERT_EQ(std::byte{0xef}, buf[7]);
+
+  uint32_t result[2] = { 0 };
+  ASSERT_EQ(8, deserialize_ints(result, 2, buf, sizeof(buf)));
+  ASSERT_EQ(values[0], result[0]);
+  ASSERT_EQ(values[1], result[1]);
+}
@@ -0,0 +1,203 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+#include <liberate/serialization/schema.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace liberate::serialization;
+using liberate::types::varint;
+using liberate::types::byte;
+using liberate::net::socket_address;
+
+struct header
+{
+  uint8_t   version = 0;
+  uint32_t  flags = 0;
+
+  using serialization_schema = schema<
+    int_field<&header::version>,
+    int_field<&header::flags>
+  >;
+};
+
+
+struct message
+{
+  header              hdr;
+  int16_t             id = 0;
+  varint              sequence = varint{0};
+  varint              delta = varint{0};
+  socket_address      peer;
+  std::vector<byte>   payload;
+
+  using serialization_schema = schema<
+    struct_field<&message::hdr>,
+    int_field<&message::id>,
+    varint_field<&message::sequence>,
+    varint_field<&message::delta, varint_zigzag>,
+    address_field<&message::peer>,
+    bytes_field<&message::payload, 200>
+  >;
+};
+
+
+message
+test_message()
+{
+  message msg;
+  msg.hdr.version = 3;
+  msg.hdr.flags = 0xdeadbeef;
+  msg.id = -42;
+  msg.sequence = varint{300};
+  msg.delta = varint{-5};
+  msg.peer = socket_address{"192.168.0.1", 1234};
+  msg.payload = { byte{0x01}, byte{0x02}, byte{0x03} };
+  return msg;
+}
+
+
+void
+expect_equal(message const & first, message const & second)
+{
+  ASSERT_EQ(first.hdr.version, second.hdr.version);
+  ASSERT_EQ(first.hdr.flags, second.hdr.flags);
+  ASSERT_EQ(first.id, second.id);
+  ASSERT_EQ(first.sequence, second.sequence);
+  ASSERT_EQ(first.delta, second.delta);
+  ASSERT_EQ(first.peer, second.peer);
+  ASSERT_EQ(first.payload, second.payload);
+}
+
+} // anonymous namespace
+
+
+TEST(SerializationSchema, sizes)
+{
+  static_assert(header::serialization_schema::MIN_SIZE == 5);
+  static_assert(header::serialization_schema::MAX_SIZE == 5);
+
+  // 5 + 2 + 1 + 1 + 7 + 1 at least, and 5 + 2 + 10 + 10 + 19 + 2 + 200 at
+  // most.
+  static_assert(message::serialization_schema::MIN_SIZE == 17);
+  static_assert(max_serialized_size_v<message> == 248);
+
+  auto msg = test_message();
+  // Sequence takes two Bytes, the payload four.
+  ASSERT_EQ(5 + 2 + 2 + 1 + 7 + 4, serialized_size_struct(msg));
+}
+
+
+TEST(SerializationSchema, layout)
+{
+  header hdr;
+  hdr.version = 1;
+  hdr.flags = 0x01020304;
+
+  uint8_t buf[5] = { 0 };
+  ASSERT_EQ(5, serialize_struct(buf, sizeof(buf), hdr));
+
+  // Must match field by field serialization
+  uint8_t expected[5] = { 0 };
+  ASSERT_EQ(1, serialize_int(expected, 1, hdr.version));
+  ASSERT_EQ(4, serialize_int(expected + 1, 4, hdr.flags));
+  for (size_t i = 0 ; i < sizeof(buf) ; ++i) {
+    ASSERT_EQ(expected[i], buf[i]);
+  }
+
+  header result;
+  ASSERT_EQ(5, deserialize_struct(result, buf, sizeof(buf)));
+  ASSERT_EQ(hdr.version, result.version);
+  ASSERT_EQ(hdr.flags, result.flags);
+}
+
+
+TEST(SerializationSchema, roundtrip)
+{
+  auto msg = test_message();
+  auto size = serialized_size_struct(msg);
+
+  // Both with exactly sized buffers, and those of the maximum size, which
+  // take the unchecked paths.
+  for (auto bufsize : { size, max_serialized_size_v<message> }) {
+    std::vector<byte> buf(bufsize);
+    ASSERT_EQ(size, serialize_struct(buf.data(), buf.size(), msg));
+
+    message result;
+    ASSERT_EQ(size, deserialize_struct(result, buf.data(), buf.size()));
+    expect_equal(msg, result);
+  }
+
+  // IPv6 works as well.
+  msg.peer = socket_address{"2001:db8::1", 4321};
+  std::vector<byte> buf(max_serialized_size_v<message>);
+  size = serialize_struct(buf.data(), buf.size(), msg);
+  ASSERT_EQ(serialized_size_struct(msg), size);
+
+  message result;
+  ASSERT_EQ(size, deserialize_struct(result, buf.data(), size));
+  expect_equal(msg, result);
+}
+
+
+TEST(SerializationSchema, errors)
+{
+  auto msg = test_message();
+  auto size = serialized_size_struct(msg);
+  std::vector<byte> buf(max_serialized_size_v<message>);
+
+  // Buffers that are too small
+  ASSERT_EQ(0, serialize_struct(buf.data(), size - 1, msg));
+  ASSERT_EQ(size, serialize_struct(buf.data(), size, msg));
+
+  message result;
+  ASSERT_EQ(0, deserialize_struct(result, buf.data(), size - 1));
+  ASSERT_EQ(0, deserialize_struct(result, buf.data(), 3));
+
+  // Values that cannot be serialized
+  auto bad = msg;
+  bad.sequence = varint{-1};
+  ASSERT_EQ(0, serialize_struct(buf.data(), buf.size(), bad));
+
+  bad = msg;
+  bad.peer = socket_address{};
+  ASSERT_EQ(0, serialize_struct(buf.data(), buf.size(), bad));
+
+  bad = msg;
+  bad.payload.resize(201);
+  ASSERT_EQ(0, serialize_struct(buf.data(), buf.size(), bad));
+
+  // Payload lengths beyond the maximum are rejected when decoding.
+  bad.payload.resize(200);
+  ASSERT_EQ(serialized_size_struct(bad), serialize_struct(buf.data(),
+        buf.size(), bad));
+  using long_payload = schema<
+    struct_field<&message::hdr>,
+    int_field<&message::id>,
+    varint_field<&message::sequence>,
+    varint_field<&message::delta, varint_zigzag>,
+    address_field<&message::peer>,
+    bytes_field<&message::payload, 100>
+  >;
+  ASSERT_EQ(0, long_payload::deserialize(result, buf.data(), buf.size()));
+}
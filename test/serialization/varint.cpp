@@ -18,6 +18,9 @@
  * PARTICULAR PURPOSE.
  **/
 #include <cstddef>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 #include <liberate/serialization/integer.h>
 #include <liberate/serialization/varint.h>
@@ -201,3 +204,274 @@ TEST(SerializationVarint, buffer_excessively_large)
   ASSERT_EQ(read, 1);
   ASSERT_EQ(result, test);
 }
+
+
+TEST(SerializationVarint, serialized_size_boundaries)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  // The largest value for each size, and the smallest value of the next.
+  varint_base const boundaries[] = {
+    127, 16511, 2113663, 270549119,
+  };
+  for (size_t i = 0 ; i < sizeof(boundaries) / sizeof(varint_base) ; ++i) {
+    ASSERT_EQ(i + 1, serialized_size(varint{boundaries[i]}));
+    ASSERT_EQ(i + 2, serialized_size(varint{boundaries[i] + 1}));
+
+    // Serialization uses exactly as many Bytes, and round-trips.
+    uint8_t buf[VARINT_MAX_BUFSIZE] = { 0 };
+    auto written = serialize_varint(buf, sizeof(buf), varint{boundaries[i]});
+    ASSERT_EQ(i + 1, written);
+
+    varint result;
+    ASSERT_EQ(written, deserialize_varint(result, buf, written));
+    ASSERT_EQ(varint{boundaries[i]}, result);
+  }
+
+  // Thanks to the offsets, even the largest value needs one Byte less than
+  // seven bits per Byte would.
+  ASSERT_EQ(VARINT_MAX_BUFSIZE - 1, serialized_size(
+        varint{std::numeric_limits<varint_base>::max()}));
+}
+
+
+TEST(SerializationVarint, bulk_roundtrip)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  // Runs of small values, mixed with larger ones that cross SIMD block
+  // boundaries.
+  std::vector<varint> values;
+  for (varint_base i = 0 ; i < 300 ; ++i) {
+    if (i % 50 < 20) {
+      values.push_back(varint{i % 128});
+    }
+    else if (i % 7 == 0) {
+      values.push_back(varint{std::numeric_limits<varint_base>::max() - i});
+    }
+    else {
+      values.push_back(varint{i * i * i * i * i});
+    }
+  }
+
+  auto size = serialized_size(values.data(), values.size());
+  std::vector<uint8_t> buf(size);
+  ASSERT_EQ(size, serialize_varints(buf.data(), buf.size(), values.data(),
+        values.size()));
+
+  // Must match one-by-one serialization
+  size_t offset = 0;
+  for (auto & value : values) {
+    uint8_t single[VARINT_MAX_BUFSIZE];
+    auto written = serialize_varint(single, sizeof(single), value);
+    ASSERT_EQ(0, std::memcmp(single, buf.data() + offset, written));
+    offset += written;
+  }
+
+  std::vector<varint> result(values.size());
+  ASSERT_EQ(size, deserialize_varints(result.data(), result.size(),
+        buf.data(), buf.size()));
+  ASSERT_EQ(values, result);
+
+  // Also with std::byte
+  std::vector<std::byte> bytes(size);
+  ASSERT_EQ(size, serialize_varints(bytes.data(), bytes.size(),
+        values.data(), values.size()));
+  ASSERT_EQ(size, deserialize_varints(result.data(), result.size(),
+        bytes.data(), bytes.size()));
+  ASSERT_EQ(values, result);
+}
+
+
+TEST(SerializationVarint, bulk_errors)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  std::vector<varint> values(40, varint{300});
+  auto size = serialized_size(values.data(), values.size());
+  ASSERT_EQ(80, size);
+
+  std::vector<uint8_t> buf(size);
+  ASSERT_EQ(0, serialize_varints(buf.data(), size - 1, values.data(),
+        values.size()));
+  ASSERT_EQ(size, serialize_varints(buf.data(), size, values.data(),
+        values.size()));
+
+  // Asking for more values than the buffer holds fails.
+  std::vector<varint> result(41);
+  ASSERT_EQ(0, deserialize_varints(result.data(), result.size(),
+        buf.data(), buf.size()));
+
+  // As does a truncated buffer.
+  ASSERT_EQ(0, deserialize_varints(result.data(), 40, buf.data(),
+        buf.size() - 1));
+}
+
+
+namespace {
+
+template <typename formatT>
+void
+roundtrip_format(std::vector<liberate::types::varint> const & values)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  for (auto & value : values) {
+    uint8_t buf[VARINT_MAX_BUFSIZE + 8] = { 0 };
+    auto size = serialized_size<formatT>(value);
+    ASSERT_GT(size, 0);
+    ASSERT_LE(size, VARINT_MAX_BUFSIZE);
+
+    // Too small a buffer must fail.
+    ASSERT_EQ(0, serialize_varint<formatT>(buf, size - 1, value));
+    ASSERT_EQ(size, serialize_varint<formatT>(buf, sizeof(buf), value));
+
+    // Exactly sized buffers, and larger ones decode the same.
+    varint result{0};
+    ASSERT_EQ(size, deserialize_varint<formatT>(result, buf, size));
+    ASSERT_EQ(value, result);
+
+    result = varint{0};
+    ASSERT_EQ(size, deserialize_varint<formatT>(result, buf, sizeof(buf)));
+    ASSERT_EQ(value, result);
+
+    // Truncated buffers fail.
+    ASSERT_EQ(0, deserialize_varint<formatT>(result, buf, size - 1));
+  }
+}
+
+
+std::vector<liberate::types::varint>
+format_test_values()
+{
+  using namespace liberate::types;
+
+  std::vector<varint> values;
+  for (int shift = 0 ; shift < 64 ; ++shift) {
+    // Unsigned arithmetic, so that wrapping around is well defined.
+    auto base = uint64_t{1} << shift;
+    for (uint64_t value : { base - 1, base, base + 1 }) {
+      values.push_back(varint{static_cast<varint_base>(value)});
+      values.push_back(varint{static_cast<varint_base>(~value + 1)});
+    }
+  }
+  values.push_back(varint{std::numeric_limits<varint_base>::max()});
+  values.push_back(varint{std::numeric_limits<varint_base>::min()});
+  return values;
+}
+
+} // anonymous namespace
+
+
+TEST(SerializationVarint, format_continuation)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  // The tag selects the default format.
+  uint8_t tagged[VARINT_MAX_BUFSIZE];
+  uint8_t plain[VARINT_MAX_BUFSIZE];
+  auto value = varint{0x01020304};
+  ASSERT_EQ(serialized_size(value), serialized_size<varint_continuation>(value));
+  ASSERT_EQ(4, serialize_varint<varint_continuation>(tagged, sizeof(tagged),
+        value));
+  ASSERT_EQ(4, serialize_varint(plain, sizeof(plain), value));
+  ASSERT_EQ(0, std::memcmp(tagged, plain, 4));
+
+  std::vector<varint> values;
+  for (auto & v : format_test_values()) {
+    if (static_cast<varint_base>(v) >= 0) {
+      values.push_back(v);
+    }
+  }
+  roundtrip_format<varint_continuation>(values);
+}
+
+
+TEST(SerializationVarint, format_zigzag)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  // Small magnitudes are short regardless of sign.
+  ASSERT_EQ(1, serialized_size<varint_zigzag>(varint{0}));
+  ASSERT_EQ(1, serialized_size<varint_zigzag>(varint{-1}));
+  ASSERT_EQ(1, serialized_size<varint_zigzag>(varint{63}));
+  ASSERT_EQ(1, serialized_size<varint_zigzag>(varint{-64}));
+  ASSERT_EQ(2, serialized_size<varint_zigzag>(varint{64}));
+  ASSERT_EQ(2, serialized_size<varint_zigzag>(varint{-65}));
+
+  uint8_t buf[VARINT_MAX_BUFSIZE];
+  ASSERT_EQ(1, serialize_varint<varint_zigzag>(buf, sizeof(buf), varint{-1}));
+  ASSERT_EQ(1, buf[0]);
+  ASSERT_EQ(1, serialize_varint<varint_zigzag>(buf, sizeof(buf), varint{1}));
+  ASSERT_EQ(2, buf[0]);
+  ASSERT_EQ(1, serialize_varint<varint_zigzag>(buf, sizeof(buf), varint{-2}));
+  ASSERT_EQ(3, buf[0]);
+
+  // The full range can be encoded.
+  ASSERT_EQ(VARINT_MAX_BUFSIZE, serialized_size<varint_zigzag>(
+        varint{std::numeric_limits<varint_base>::min()}));
+
+  roundtrip_format<varint_zigzag>(format_test_values());
+
+  // Also with std::byte
+  std::byte bytes[VARINT_MAX_BUFSIZE];
+  varint result{0};
+  ASSERT_EQ(2, serialize_varint<varint_zigzag>(bytes, sizeof(bytes),
+        varint{-300}));
+  ASSERT_EQ(2, deserialize_varint<varint_zigzag>(result, bytes,
+        sizeof(bytes)));
+  ASSERT_EQ(varint{-300}, result);
+}
+
+
+TEST(SerializationVarint, format_prefix)
+{
+  using namespace liberate::types;
+  using namespace liberate::serialization;
+
+  ASSERT_EQ(1, serialized_size<varint_prefix>(varint{0}));
+  ASSERT_EQ(1, serialized_size<varint_prefix>(varint{127}));
+  ASSERT_EQ(2, serialized_size<varint_prefix>(varint{128}));
+  ASSERT_EQ(8, serialized_size<varint_prefix>(
+        varint{(varint_base{1} << 56) - 1}));
+  ASSERT_EQ(9, serialized_size<varint_prefix>(varint{varint_base{1} << 56}));
+  ASSERT_EQ(9, serialized_size<varint_prefix>(varint{-1}));
+
+  // The length is in the leading one bits of the first Byte.
+  uint8_t buf[VARINT_MAX_BUFSIZE];
+  ASSERT_EQ(1, serialize_varint<varint_prefix>(buf, sizeof(buf),
+        varint{0x7f}));
+  ASSERT_EQ(0x7f, buf[0]);
+
+  ASSERT_EQ(2, serialize_varint<varint_prefix>(buf, sizeof(buf),
+        varint{0x1234}));
+  ASSERT_EQ(0x92, buf[0]);
+  ASSERT_EQ(0x34, buf[1]);
+
+  ASSERT_EQ(3, serialize_varint<varint_prefix>(buf, sizeof(buf),
+        varint{0x10203}));
+  ASSERT_EQ(0xc1, buf[0]);
+  ASSERT_EQ(0x02, buf[1]);
+  ASSERT_EQ(0x03, buf[2]);
+
+  ASSERT_EQ(9, serialize_varint<varint_prefix>(buf, sizeof(buf),
+        varint{0x0102030405060708}));
+  ASSERT_EQ(0xff, buf[0]);
+  ASSERT_EQ(0x01, buf[1]);
+  ASSERT_EQ(0x08, buf[8]);
+
+  roundtrip_format<varint_prefix>(format_test_values());
+
+  // Values followed by other data decode correctly.
+  uint8_t stream[] = { 0x92, 0x34, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  varint result{0};
+  ASSERT_EQ(2, deserialize_varint<varint_prefix>(result, stream,
+        sizeof(stream)));
+  ASSERT_EQ(varint{0x1234}, result);
+}
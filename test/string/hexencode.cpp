@@ -21,6 +21,8 @@
 
 #include <gtest/gtest.h>
 
+#include <sstream>
+
 static const std::string plain = "Hello, world!";
 static const size_t plain_size = plain.size();
 static const size_t out_size = plain_size * 2;
@@ -121,6 +123,56 @@ TEST(StringHexDecode, decode_bytes)
 }
 
 
+TEST(StringHexEncode, long_buffers)
+{
+  // Lengths around the vector block sizes, so that both the vector and the
+  // scalar code paths are exercised.
+  for (size_t size : {1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257}) {
+    std::vector<::liberate::types::byte> input;
+    std::string lower;
+    std::string upper;
+    for (size_t i = 0 ; i < size ; ++i) {
+      auto val = static_cast<unsigned>((i * 37 + 11) % 256);
+      input.push_back(static_cast<::liberate::types::byte>(val));
+      lower += "0123456789abcdef"[val >> 4];
+      lower += "0123456789abcdef"[val & 0x0f];
+      upper += "0123456789ABCDEF"[val >> 4];
+      upper += "0123456789ABCDEF"[val & 0x0f];
+    }
+
+    ASSERT_EQ(lower, liberate::string::hexencode(input.data(), size));
+    ASSERT_EQ(upper, liberate::string::hexencode(input.data(), size, true));
+
+    ASSERT_EQ(input, liberate::string::hexdecode(lower.c_str(),
+          lower.size()));
+    ASSERT_EQ(input, liberate::string::hexdecode(upper.c_str(),
+          upper.size()));
+  }
+}
+
+
+
+TEST(StringHexDecode, invalid_input)
+{
+  std::string valid(128, 'a');
+  ASSERT_EQ(64, liberate::string::hexdecode(valid.c_str(),
+        valid.size()).size());
+
+  // Invalid characters anywhere fail the entire decode.
+  for (size_t pos : {0, 5, 16, 31, 40, 64, 127}) {
+    for (char bad : {'g', 'G', '/', ':', '@', '`', ' ', '\xff'}) {
+      auto invalid = valid;
+      invalid[pos] = bad;
+      ASSERT_TRUE(liberate::string::hexdecode(invalid.c_str(),
+            invalid.size()).empty()) << "at " << pos << ": " << bad;
+    }
+  }
+
+  // Odd lengths, too.
+  ASSERT_TRUE(liberate::string::hexdecode(valid.c_str(), 33).empty());
+}
+
+
 TEST(StringHexDump, canonical_raw)
 {
   std::string test{"Hello, world! The quick brown fox jumped over the lazy dog's back and sat on a tack."};
@@ -213,3 +265,46 @@ TEST(StringHexDump, wide_string)
 
   compare_wide_dump(hd_wide, result);
 }
+
+
+
+TEST(StringHexDump, streaming)
+{
+  std::string test{"Hello, world! The quick brown fox jumped over the lazy dog's back and sat on a tack."};
+
+  liberate::string::canonical_hexdump dumper;
+
+  std::stringstream sstream;
+  dumper(sstream, test);
+  ASSERT_EQ(hd_canonical, sstream.str());
+
+  std::string lines;
+  size_t count = 0;
+  dumper.format_to([&](char const * line, size_t line_size)
+      {
+        lines.append(line, line_size);
+        ++count;
+      },
+      test.c_str(), test.size());
+  ASSERT_EQ(hd_canonical, lines);
+  ASSERT_EQ(7, count);
+
+  ASSERT_EQ(hd_canonical.size(), dumper.output_size(test.size()));
+  ASSERT_EQ(0, dumper.output_size(0));
+}
+
+
+
+TEST(StringHexDump, partial_columns)
+{
+  // Partial columns are padded after the Bytes that are present.
+  liberate::string::hexdump<2, 8, 4, 2, 1, 2, '|', '.'> dumper;
+
+  std::string test{"abcdefghij\n"};
+  auto result = dumper(test);
+  ASSERT_EQ(
+      "0000  61626364  65666768  |abcdefgh|\n"
+      "0008  696a0a              |ij.|\n"
+      "000b", result);
+  ASSERT_EQ(result.size(), dumper.output_size(test.size()));
+}
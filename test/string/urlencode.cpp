@@ -43,3 +43,62 @@ TEST(StringURLDecode, urldecode)
   ASSERT_EQ(s::urldecode("%00abstract"), (std::string{"\0abstract", 9}));
   ASSERT_EQ(s::urldecode("%25asdf"), "%asdf");
 }
+
+
+
+TEST(StringURLDecode, malformed)
+{
+  namespace s = liberate::string;
+
+  ASSERT_EQ(s::urldecode("%zzfoo"), "?foo");
+  ASSERT_EQ(s::urldecode("foo%4"), "foo?");
+  ASSERT_EQ(s::urldecode("foo%"), "foo?");
+  ASSERT_EQ(s::urldecode("%7e%7E"), "~~");
+}
+
+
+
+TEST(StringURLDecode, long_strings)
+{
+  namespace s = liberate::string;
+
+  // Long enough to exercise vectorized code, with escapes at different
+  // offsets.
+  std::string plain;
+  std::string encoded;
+  for (size_t i = 0 ; i < 200 ; ++i) {
+    if (i % 23 == 7) {
+      plain += " ";
+      encoded += "%20";
+    }
+    else if (i % 31 == 0) {
+      plain += "\xe4";
+      encoded += "%E4";
+    }
+    else {
+      char ch = "abcXYZ019-_./"[i % 13];
+      plain += ch;
+      encoded += ch;
+    }
+  }
+
+  ASSERT_EQ(encoded, s::urlencode(plain));
+  ASSERT_EQ(encoded.size(), s::urlencoded_size(plain));
+  ASSERT_EQ(plain, s::urldecode(encoded));
+}
+
+
+
+TEST(StringURLDecode, buffers)
+{
+  namespace s = liberate::string;
+
+  char buf[16];
+  ASSERT_EQ(11, s::urlencode(buf, sizeof(buf), "/~foo/bar"));
+  ASSERT_EQ("/%7Efoo/bar", std::string(buf, 11));
+  ASSERT_EQ(0, s::urlencode(buf, 10, "/~foo/bar"));
+
+  ASSERT_EQ(9, s::urldecode(buf, sizeof(buf), "/%7Efoo/bar"));
+  ASSERT_EQ("/~foo/bar", std::string(buf, 9));
+  ASSERT_EQ(0, s::urldecode(buf, 8, "/%7Efoo/bar"));
+}
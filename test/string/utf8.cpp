@@ -21,6 +21,9 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
 #if defined(LIBERATE_WIN32)
 
 #if defined(LIBERATE_BIGENDIAN)
@@ -48,3 +51,176 @@ TEST(StringUTF8, utf8_to_ucs2)
 }
 
 #endif // LIBERATE_WIN32
+
+
+namespace {
+
+// "Grüße, 世界 😀" in UTF-8, UTF-16 and UTF-32
+std::string const mixed_utf8{
+  "Gr\xc3\xbc\xc3\x9f" "e, \xe4\xb8\x96\xe7\x95\x8c \xf0\x9f\x98\x80"};
+std::u16string const mixed_utf16{
+  u"Grüße, 世界 \xd83d\xde00"};
+std::u32string const mixed_utf32{
+  U"Grüße, 世界 \U0001f600"};
+
+// Surround the value with ASCII padding, so that it ends up at various
+// positions in and across SIMD blocks.
+template <typename stringT>
+std::vector<stringT>
+padded(stringT const & value)
+{
+  std::vector<stringT> ret;
+  for (size_t before : {0, 1, 13, 15, 16, 30, 31, 33, 64}) {
+    for (size_t after : {0, 1, 17, 40}) {
+      ret.push_back(stringT(before, 'x') + value + stringT(after, 'y'));
+    }
+  }
+  return ret;
+}
+
+} // anonymous namespace
+
+
+TEST(StringUTF8, validate_valid)
+{
+  namespace s = liberate::string;
+
+  char const * valid[] = {
+    "",
+    "plain ASCII",
+    "\xc2\x80",                 // U+0080
+    "\xdf\xbf",                 // U+07FF
+    "\xe0\xa0\x80",             // U+0800
+    "\xed\x9f\xbf",             // U+D7FF
+    "\xee\x80\x80",             // U+E000
+    "\xef\xbf\xbf",             // U+FFFF
+    "\xf0\x90\x80\x80",         // U+10000
+    "\xf4\x8f\xbf\xbf",         // U+10FFFF
+  };
+  for (auto v : valid) {
+    for (auto & str : padded(std::string{v})) {
+      ASSERT_TRUE(s::utf8_validate(str.c_str(), str.size())) << str;
+    }
+  }
+
+  for (auto & str : padded(mixed_utf8)) {
+    ASSERT_TRUE(s::utf8_validate(str.c_str(), str.size()));
+  }
+}
+
+
+TEST(StringUTF8, validate_invalid)
+{
+  namespace s = liberate::string;
+
+  char const * invalid[] = {
+    "\x80",                     // Lone continuation
+    "\xbf",
+    "\xc2",                     // Truncated sequences
+    "\xe0\xa0",
+    "\xf0\x90\x80",
+    "\xc0\x80",                 // Overlong encodings
+    "\xc1\xbf",
+    "\xe0\x9f\xbf",
+    "\xf0\x8f\xbf\xbf",
+    "\xed\xa0\x80",             // Surrogates
+    "\xed\xbf\xbf",
+    "\xf4\x90\x80\x80",         // Beyond U+10FFFF
+    "\xf5\x80\x80\x80",
+    "\xff",
+    "\xc2\x80\x80",             // Too many continuations
+    "\xe4\xb8\x96\x96",
+    "\xc2x",                    // ASCII instead of continuation
+    "\xe4\xb8x",
+  };
+  for (auto v : invalid) {
+    for (auto & str : padded(std::string{v})) {
+      ASSERT_FALSE(s::utf8_validate(str.c_str(), str.size())) << str;
+    }
+  }
+}
+
+
+TEST(StringUTF8, utf8_utf16_roundtrip)
+{
+  namespace s = liberate::string;
+
+  auto utf8 = padded(mixed_utf8);
+  auto utf16 = padded(mixed_utf16);
+  for (size_t i = 0 ; i < utf8.size() ; ++i) {
+    ASSERT_EQ(utf16[i].size(), s::utf16_length_from_utf8(utf8[i].c_str(),
+          utf8[i].size()));
+    ASSERT_EQ(utf8[i].size(), s::utf8_length_from_utf16(utf16[i].c_str(),
+          utf16[i].size()));
+
+    std::u16string out16(utf16[i].size(), u'\0');
+    ASSERT_EQ(out16.size(), s::utf8_to_utf16(&out16[0], out16.size(),
+          utf8[i].c_str(), utf8[i].size()));
+    ASSERT_EQ(utf16[i], out16);
+
+    std::string out8(utf8[i].size(), '\0');
+    ASSERT_EQ(out8.size(), s::utf16_to_utf8(&out8[0], out8.size(),
+          utf16[i].c_str(), utf16[i].size()));
+    ASSERT_EQ(utf8[i], out8);
+
+    // Output too small
+    ASSERT_EQ(0, s::utf8_to_utf16(&out16[0], out16.size() - 1,
+          utf8[i].c_str(), utf8[i].size()));
+    ASSERT_EQ(0, s::utf16_to_utf8(&out8[0], out8.size() - 1,
+          utf16[i].c_str(), utf16[i].size()));
+  }
+}
+
+
+TEST(StringUTF8, utf8_utf32_roundtrip)
+{
+  namespace s = liberate::string;
+
+  auto utf8 = padded(mixed_utf8);
+  auto utf32 = padded(mixed_utf32);
+  for (size_t i = 0 ; i < utf8.size() ; ++i) {
+    ASSERT_EQ(utf32[i].size(), s::utf32_length_from_utf8(utf8[i].c_str(),
+          utf8[i].size()));
+    ASSERT_EQ(utf8[i].size(), s::utf8_length_from_utf32(utf32[i].c_str(),
+          utf32[i].size()));
+
+    std::u32string out32(utf32[i].size(), U'\0');
+    ASSERT_EQ(out32.size(), s::utf8_to_utf32(&out32[0], out32.size(),
+          utf8[i].c_str(), utf8[i].size()));
+    ASSERT_EQ(utf32[i], out32);
+
+    std::string out8(utf8[i].size(), '\0');
+    ASSERT_EQ(out8.size(), s::utf32_to_utf8(&out8[0], out8.size(),
+          utf32[i].c_str(), utf32[i].size()));
+    ASSERT_EQ(utf8[i], out8);
+  }
+}
+
+
+TEST(StringUTF8, transcode_invalid)
+{
+  namespace s = liberate::string;
+
+  char16_t buf16[64];
+  char32_t buf32[64];
+  char buf8[64];
+
+  std::string bad8{"abc\xed\xa0\x80"};
+  ASSERT_EQ(0, s::utf8_to_utf16(buf16, 64, bad8.c_str(), bad8.size()));
+  ASSERT_EQ(0, s::utf8_to_utf32(buf32, 64, bad8.c_str(), bad8.size()));
+
+  // Lone and reversed surrogates
+  char16_t const bad16[][2] = {
+    { u'a', 0xd800 },
+    { 0xdc00, u'a' },
+    { 0xdc00, 0xd800 },
+  };
+  for (auto & bad : bad16) {
+    ASSERT_EQ(0, s::utf16_to_utf8(buf8, 64, bad, 2));
+  }
+
+  char32_t const bad32[] = { 0xd800, 0x110000 };
+  for (auto bad : bad32) {
+    ASSERT_EQ(0, s::utf32_to_utf8(buf8, 64, &bad, 1));
+  }
+}
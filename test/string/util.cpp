@@ -52,6 +52,48 @@ TEST(StringUtil, to_upper)
 }
 
 
+TEST(StringUtil, case_conversion_long)
+{
+  namespace s = liberate::string;
+
+  // Long enough to exercise vectorized code paths and their scalar tails,
+  // and containing non-ASCII bytes that must be left alone.
+  std::string mixed;
+  std::string lower;
+  std::string upper;
+  for (size_t i = 0 ; i < 100 ; ++i) {
+    mixed += "aZ@[`{\xc3\x84\xff";
+    lower += "az@[`{\xc3\x84\xff";
+    upper += "AZ@[`{\xc3\x84\xff";
+  }
+
+  for (size_t len = 0 ; len < mixed.size() ; len += 7) {
+    ASSERT_EQ(lower.substr(0, len), s::to_lower(mixed.substr(0, len)));
+    ASSERT_EQ(upper.substr(0, len), s::to_upper(mixed.substr(0, len)));
+  }
+}
+
+
+TEST(StringUtil, case_conversion_inplace)
+{
+  namespace s = liberate::string;
+
+  std::string value{"Hello, World! Hello, World! Hello, World!"};
+  auto data = value.data();
+
+  s::to_lower_inplace(value);
+  ASSERT_EQ("hello, world! hello, world! hello, world!", value);
+  ASSERT_EQ(data, value.data());
+
+  s::to_upper_inplace(value);
+  ASSERT_EQ("HELLO, WORLD! HELLO, WORLD! HELLO, WORLD!", value);
+
+  char buf[] = "MiXeD";
+  s::to_lower_inplace(buf, 3);
+  ASSERT_EQ(std::string{"mixeD"}, buf);
+}
+
+
 TEST(StringUtil, case_insensitive_search)
 {
   namespace s = liberate::string;
@@ -78,6 +120,35 @@ TEST(StringUtil, case_insensitive_search)
 }
 
 
+TEST(StringUtil, case_insensitive_search_long)
+{
+  namespace s = liberate::string;
+
+  // Many candidates for the first character, but only one real match; place
+  // it at every offset to cross vector block boundaries.
+  for (size_t offset = 0 ; offset < 80 ; ++offset) {
+    std::string haystack(80, 'n');
+    for (size_t i = 0 ; i < haystack.size() ; i += 3) {
+      haystack[i] = 'N';
+    }
+    haystack += "tail";
+    haystack.replace(offset, 6, "NeEdLe");
+
+    ASSERT_EQ(ssize_t(offset), s::ifind(haystack, "needle")) << haystack;
+    ASSERT_EQ(ssize_t(offset), s::ifind(haystack, "NEEDLE")) << haystack;
+  }
+
+  // Needle at the very end.
+  std::string haystack(63, 'x');
+  haystack += "Yz";
+  ASSERT_EQ(63, s::ifind(haystack, "yZ"));
+  ASSERT_EQ(-1, s::ifind(haystack, "yZz"));
+
+  // Non-letters only match exactly.
+  ASSERT_EQ(-1, s::ifind(std::string(40, '@'), "`"));
+}
+
+
 TEST(StringUtil, replace)
 {
   namespace s = liberate::string;
@@ -88,3 +159,83 @@ TEST(StringUtil, replace)
   ASSERT_EQ("\\\\quoted\\\\and\\\\separated\\\\",
       s::replace("\\quoted\\and\\separated\\", "\\", "\\\\"));
 }
+
+
+TEST(StringUtil, replace_edge_cases)
+{
+  namespace s = liberate::string;
+
+  ASSERT_EQ("", s::replace("", "foo", "bar"));
+  ASSERT_EQ("foo", s::replace("foo", "", "bar"));
+  ASSERT_EQ("foo", s::replace("foo", "fooo", "bar"));
+  ASSERT_EQ("", s::replace("foo", "foo", ""));
+  ASSERT_EQ("ba", s::replace("aaa", "aa", "b"));
+  ASSERT_EQ("bb", s::replace("aaaa", "aa", "b"));
+}
+
+
+TEST(StringUtil, replace_long)
+{
+  namespace s = liberate::string;
+
+  // Place needles at every offset relative to SIMD blocks, including at
+  // the very end.
+  for (size_t offset = 0 ; offset < 70 ; ++offset) {
+    std::string haystack(offset, 'x');
+    haystack += "{{name}}";
+    haystack += std::string(70 - offset, 'n');
+    haystack += "{{name}}";
+
+    std::string expected(offset, 'x');
+    expected += "value";
+    expected += std::string(70 - offset, 'n');
+    expected += "value";
+
+    ASSERT_EQ(expected, s::replace(haystack, "{{name}}", "value"));
+  }
+
+  // Near misses: first and last character match, but not the middle.
+  std::string haystack;
+  for (size_t i = 0 ; i < 40 ; ++i) {
+    haystack += "{{nope}}";
+  }
+  ASSERT_EQ(haystack, s::replace(haystack, "{{name}}", "value"));
+}
+
+
+TEST(StringUtil, replace_multiple)
+{
+  namespace s = liberate::string;
+
+  ASSERT_EQ("Hello, world! It is 2021.",
+      s::replace("Hello, ${who}! It is ${year}.", {
+        { "${who}", "world" },
+        { "${year}", "2021" },
+      }));
+
+  // Substitutions are not searched again, so swapping works.
+  ASSERT_EQ("ba ab", s::replace("ab ba", {
+        { "a", "b" },
+        { "b", "a" },
+      }));
+
+  // At the same position, the first listed needle wins.
+  ASSERT_EQ("1 1", s::replace("ab ab", {
+        { "ab", "1" },
+        { "a", "2" },
+      }));
+  ASSERT_EQ("2b 2b", s::replace("ab ab", {
+        { "a", "2" },
+        { "ab", "1" },
+      }));
+
+  // Overlapping matches are skipped.
+  ASSERT_EQ("x-c", s::replace("abc", {
+        { "ab", "x-" },
+        { "bc", "y-" },
+      }));
+
+  // Empty needles never match, and empty lists change nothing.
+  ASSERT_EQ("abc", s::replace("abc", { { "", "x" } }));
+  ASSERT_EQ("abc", s::replace("abc", s::replacement_list{}));
+}
@@ -0,0 +1,106 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/sys/error.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sys = liberate::sys;
+
+TEST(SysError, error_message)
+{
+  auto msg = sys::error_message(EINVAL);
+  ASSERT_EQ(0, msg.find("[0x16 (22)] "));
+  ASSERT_EQ(sys::error_string(EINVAL), msg.substr(12));
+  ASSERT_FALSE(sys::error_string(EINVAL).empty());
+}
+
+
+TEST(SysError, error_string_is_cached)
+{
+  auto first = sys::error_string(ENOENT);
+  auto second = sys::error_string(ENOENT);
+  ASSERT_EQ(first.data(), second.data());
+
+  // Codes outside of the cached range are also stable.
+  auto large = sys::error_string(123456);
+  ASSERT_EQ(large.data(), sys::error_string(123456).data());
+}
+
+
+TEST(SysError, error_string_threads)
+{
+  std::vector<std::thread> threads;
+  std::vector<char const *> results(8);
+  for (std::size_t t = 0 ; t < results.size() ; ++t) {
+    threads.emplace_back([&results, t]()
+    {
+      results[t] = sys::error_string(EAGAIN).data();
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (auto result : results) {
+    ASSERT_EQ(results[0], result);
+  }
+}
+
+
+TEST(SysError, format_error)
+{
+  char buf[256];
+  auto len = sys::format_error(buf, sizeof(buf), EINVAL);
+  ASSERT_EQ(std::strlen(buf), len);
+  ASSERT_EQ(sys::error_message(EINVAL), std::string(buf, len));
+}
+
+
+TEST(SysError, format_error_truncates)
+{
+  char buf[8];
+  auto len = sys::format_error(buf, sizeof(buf), EINVAL);
+  ASSERT_EQ(7, len);
+  ASSERT_STREQ("[0x16 (", buf);
+
+  ASSERT_EQ(0, sys::format_error(buf, 0, EINVAL));
+  ASSERT_EQ(0, sys::format_error(nullptr, sizeof(buf), EINVAL));
+}
+
+
+TEST(SysError, negative_code)
+{
+  auto msg = sys::error_message(-1);
+  ASSERT_EQ(0, msg.find("[0xffffffff (-1)] "));
+}
+
+
+TEST(SysError, stream)
+{
+  std::stringstream s;
+  s << std::hex << 255 << " " << sys::error_info{EINVAL};
+  ASSERT_EQ("ff " + sys::error_message(EINVAL), s.str());
+}
@@ -0,0 +1,60 @@
+/**
+ * This file is part of liberate.
+ *
+ * Author(s): Jens Finkhaeuser <jens@finkhaeuser.de>
+ *
+ * Copyright (c) 2021 Jens Finkhaeuser.
+ *
+ * This software is licensed under the terms of the GNU GPLv3 for personal,
+ * educational and non-profit use. For all other uses, alternative license
+ * options are available. Please contact the copyright holder for additional
+ * information, stating your intended usage.
+ *
+ * You can find the full text of the GPLv3 in the COPYING file in this code
+ * distribution.
+ *
+ * This software is distributed on an "AS IS" BASIS, WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ **/
+
+#include <liberate/logging/binary.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+  bool timestamps = true;
+  std::string path;
+  for (int i = 1 ; i < argc ; ++i) {
+    std::string arg{argv[i]};
+    if (arg == "--no-timestamps") {
+      timestamps = false;
+    }
+    else if (path.empty()) {
+      path = arg;
+    }
+    else {
+      path.clear();
+      break;
+    }
+  }
+
+  if (path.empty()) {
+    std::cerr << "usage: " << argv[0] << " [--no-timestamps] <log file>"
+      << std::endl;
+    std::cerr << "Decodes a binary log file and its dictionary, which is "
+      "expected at <log file>.dict." << std::endl;
+    return 2;
+  }
+
+  try {
+    liberate::logging::decode_binary_log(std::cout, path, timestamps);
+  } catch (std::exception const & ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}